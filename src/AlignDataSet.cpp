@@ -18,7 +18,7 @@
 
 
 
-AlignDataSet::AlignDataSet(Settings& sett) : settings(sett)  {
+AlignDataSet::AlignDataSet(Settings& sett) : settings(sett), genepairs(NULL)  {
 
 	cerr << "Creating dataset...";
 
@@ -44,6 +44,9 @@ AlignDataSet::~AlignDataSet() {
 		delete (*itm);
 		itm = evaluated_multiplicons.erase(itm);
 	}
+
+	// the genes point into the adjacency arrays of genepairs
+	delete genepairs;
 }
 
 void AlignDataSet::mapGenes() {
@@ -61,86 +64,61 @@ void AlignDataSet::mapGenes() {
 	cerr << "\t\tDone!" << endl;
 }
 
-void AlignDataSet::getGenePairs() {
-
-	try {
-		GenePairs genepairs (settings.getBlastTable());
-
-		unsigned int count = 0;
-		for (unsigned int i = 0; i < genelists.size(); i++) {
-			count += genelists[i]->getElementsLength();
-		}
-
-		hash_map<string,Gene,stringhash> genes ((unsigned int)(count*1.25));
-		for (unsigned int i = 0; i < genelists.size(); i++) {
-			vector<ListElement*>& list = genelists[i]->getElements();
-			for (unsigned int j = 0; j < list.size(); j++) {
-				//genes[string(list.at(j)->getGene().getID())] = list[j]->getGene();
-				genes.insert(pair<string, Gene> (list.at(j)->getGene().getID(), list[j]->getGene()));
-			}
-		}
-		for (unsigned int i = 0; i < genelists.size(); i++) {
-			vector<ListElement*>& list = genelists[i]->getElements();
-			for (unsigned int j = 0; j < list.size(); j++) {
-				hash_set<string,stringhash>* pairs = genepairs.getPairsOf(string(list.at(j)->getGene().getID()));
-
-				if (pairs != 0) {
-					hash_set<string, stringhash>::iterator it;
-
-					vector<hash_set<string, stringhash>::iterator> iterators;
-
-					for (it = pairs->begin(); it != pairs->end(); it++) {
-						//hash_map<string,Gene*,stringhash>::iterator iter = genes.find(*it);
-						if (genes.find(*it) == genes.end()) {
-							//this gives problems on the hagrid server, older gcc compiler?
-							//pairs->erase(it);
-							iterators.push_back(it);
-						}
-					}
-					for (unsigned int k = 0; k < iterators.size(); k ++) {
-						pairs->erase(iterators[k]);
-					}
-				}
+void AlignDataSet::internGeneIDs() {
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < genelists.size(); i++) {
+		count += genelists[i]->getElementsLength();
+	}
 
-				list.at(j)->getGene().setPairs(*pairs);
-			}
+	geneIDTable = StringTable(count);
+	for (unsigned int i = 0; i < genelists.size(); i++) {
+		vector<ListElement*>& list = genelists[i]->getElements();
+		for (unsigned int j = 0; j < list.size(); j++) {
+			Gene &gene = list[j]->getGene();
+			gene.setInternID(geneIDTable.intern(gene.getID()));
 		}
-
-	}
-	catch (const FileException& f) {
-		throw f;
 	}
 }
 
-void AlignDataSet::getGeneFamilies() {
+void AlignDataSet::getGenePairs() {
 
-	try {
+	internGeneIDs();
 
-		GeneFamily genefamily(settings.getBlastTable());
+	// pairs with genes that do not exist in the gene lists are dropped
+	// while reading the table
+	genepairs = new GenePairs(settings.getBlastTable(), geneIDTable,
+				  settings.getNumThreads());
 
-		unsigned int count = 0;
-		for (unsigned int i = 0; i < genelists.size(); i++) {
-			count += genelists[i]->getElementsLength();
+	// the genes point into the adjacency arrays of genepairs
+	for (unsigned int i = 0; i < genelists.size(); i++) {
+		vector<ListElement*>& list = genelists[i]->getElements();
+		for (unsigned int j = 0; j < list.size(); j++) {
+			Gene &gene = list[j]->getGene();
+			uint32_t numPairs;
+			const uint32_t* pairs =
+				genepairs->getPairsOf(gene.getInternID(), numPairs);
+			if (pairs != NULL)
+				gene.setPairs(pairs, numPairs);
 		}
+	}
+}
 
-		for (unsigned int i = 0; i < genelists.size(); i++) {
-			vector<ListElement*>& list = genelists[i]->getElements();
-			for (unsigned int j = 0; j < list.size(); j++) {
-
-				string ID(list.at(j)->getGene().getID());
+void AlignDataSet::getGeneFamilies() {
 
-				string fam = genefamily.getFamilyOf(ID);
-				list.at(j)->getGene().setFamily(genefamily.getFamilyOf(ID));
+	internGeneIDs();
 
-				//cerr << "\33[1;32m" << ID << "\33[0m\t" << fam << "\n";
+	GeneFamily genefamily(settings.getBlastTable(), geneIDTable,
+			      settings.getNumThreads());
 
-			}
+	StringTable familyTable;
+	for (unsigned int i = 0; i < genelists.size(); i++) {
+		vector<ListElement*>& list = genelists[i]->getElements();
+		for (unsigned int j = 0; j < list.size(); j++) {
 
+			Gene &gene = list[j]->getGene();
+			const string& fam = genefamily.getFamilyOf(gene.getInternID());
+			gene.setFamily(fam, familyTable.intern(fam));
 		}
-
-	}
-	catch (const FileException& f) {
-		throw f;
 	}
 }
 
@@ -251,7 +229,7 @@ void AlignDataSet::align() {
 
 	void AlignDataSet::output() {
 
-		GeneFamily families("monocots.fam");
+		GeneFamily families("monocots.fam", geneIDTable);
 
 		cerr << "Generating output files...";
 
@@ -265,11 +243,12 @@ void AlignDataSet::align() {
 				string part = "000000";
 				string famname = "";
 				string name = AlignedLists[j]->getGeneName(i);
+				uint32_t geneID = geneIDTable.find(name);
 				int t = 0;
 
-				if (families.hasFamily(AlignedLists[j]->getGeneName(i)))
+				if (geneID != StringTable::NOT_FOUND && families.hasFamily(geneID))
 				{
-					famname = families.getFamilyOf(AlignedLists[j]->getGeneName(i));
+					famname = families.getFamilyOf(geneID);
 					part = famname.substr(3);
 					t = atoi(part.c_str())*3;
 				}
@@ -14,6 +14,7 @@ class ListFile;
 #include "debug/FileException.h"
 
 #include "headers.h"
+#include "datastructures/StringTable.h"
 
 
 
@@ -82,6 +83,11 @@ class AlignDataSet {
 		 */
 		void profileSearch(Profile& profile, vector<Multiplicon*>& target);
 
+		/*
+		 *interns the names of all genes in the gene lists in geneIDTable
+		 */
+		void internGeneIDs();
+
 		//GeneList getGeneLists();
 		//void storeMultiplicon();
 		//Multiplicon* nextMultiplicon();
@@ -99,6 +105,10 @@ class AlignDataSet {
 		Settings& settings;
 
 		void readDataSet();
+		//interning table for the gene names
+		StringTable geneIDTable;
+		//gene pairs of the blast table, the genes point into it
+		GenePairs* genepairs;
 		//vector containing all the genelists
 		vector<GeneList*> genelists;
 		vector<GeneList*> AlignedLists;
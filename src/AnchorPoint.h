@@ -3,6 +3,7 @@
 
 #include <cstring>
 #include "Cluster.h"
+#include "WireFormat.h"
 
 class AnchorPoint
 {
@@ -25,20 +26,18 @@ public:
 		is_real(isReal) {}
 
 	/**
-	* Constructs an anchorpoint object from a packed buffer
+	* Constructs an anchorpoint object from a packed buffer, the buffer is
+	* advanced past the anchorpoint
+	* @param end End of the buffer
+	* @param prev Anchorpoint that was packed before this one
 	*/
-	AnchorPoint(const char *buffer)
+	AnchorPoint(const char *&buffer, const char *end, const AnchorPoint& prev)
 	{
-		memcpy(&geneXID, buffer, sizeof(geneXID));
-		buffer += sizeof(geneXID);
-		memcpy(&geneYID, buffer, sizeof(geneYID));
-		buffer += sizeof(geneYID);
-		memcpy(&x, buffer, sizeof(x));
-		buffer += sizeof(x);
-		memcpy(&y, buffer, sizeof(y));
-		buffer += sizeof(y);
-		memcpy(&is_real, buffer, sizeof(is_real));
-		is_real = is_real;
+		geneXID = WireFormat::getDelta(buffer, prev.geneXID, end);
+		geneYID = WireFormat::getDelta(buffer, prev.geneYID, end);
+		x = WireFormat::getDelta(buffer, prev.x, end);
+		y = WireFormat::getDelta(buffer, prev.y, end);
+		WireFormat::getRaw(buffer, is_real, end);
 	}
 
 	//////////////////
@@ -85,10 +84,13 @@ public:
 
 	/**
 	 * Return the size of the packed anchorpoint
+	 * @param prev Anchorpoint that is packed before this one
 	 */
-	static int getPackSize() {
-		return sizeof(int) + sizeof(int) + sizeof(int) +
-			sizeof(int) + sizeof(bool);
+	int getPackSize(const AnchorPoint& prev) const {
+		return WireFormat::getDeltaSize(geneXID, prev.geneXID) +
+			WireFormat::getDeltaSize(geneYID, prev.geneYID) +
+			WireFormat::getDeltaSize(x, prev.x) +
+			WireFormat::getDeltaSize(y, prev.y) + sizeof(bool);
 	}
 
 	double dpdToAP(const AnchorPoint& a) const {
@@ -96,23 +98,20 @@ public:
     }
 
 	/**
-	 * Pack data in a char stream
+	 * Pack data in a char stream, the gene IDs and coordinates are stored
+	 * relative to those of the previous anchorpoint
 	 * @param buffer Pre-allocated buffer to store the data in
+	 * @param prev Anchorpoint that is packed before this one
 	 * @return The number of chars in the buffer that were used
 	 */
-	int pack(char *buffer) const {
+	int pack(char *buffer, const AnchorPoint& prev) const {
 		const char *bufferOrig = buffer;
 
-		memcpy(buffer, &geneXID, sizeof(geneXID));
-		buffer += sizeof(geneXID);
-		memcpy(buffer, &geneYID, sizeof(geneYID));
-		buffer += sizeof(geneYID);
-		memcpy(buffer, &x, sizeof(x));
-		buffer += sizeof(x);
-		memcpy(buffer, &y, sizeof(y));
-		buffer += sizeof(y);
-		memcpy(buffer, &is_real, sizeof(is_real));
-		buffer += sizeof(is_real);
+		WireFormat::putDelta(buffer, geneXID, prev.geneXID);
+		WireFormat::putDelta(buffer, geneYID, prev.geneYID);
+		WireFormat::putDelta(buffer, x, prev.x);
+		WireFormat::putDelta(buffer, y, prev.y);
+		WireFormat::putRaw(buffer, is_real);
 
 		return buffer - bufferOrig;
 	}
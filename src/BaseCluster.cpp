@@ -2,64 +2,84 @@
 
 #include "AnchorPoint.h"
 #include "hpmath.h"
+#include "WireFormat.h"
 #include <algorithm>
+#include <climits>
 
 BaseCluster::BaseCluster(const bool orient) : multiplicon(NULL),
-        orientation(orient), b(0.0), was_twisted(false)
+        orientation(orient), b(0.0), intervalValid(false), sum_x(0.0),
+        sum_y(0.0), sum_xy(0.0), sum_x2(0.0), sum_y2(0.0),
+        lowest_y(INT_MAX), highest_y(INT_MIN), was_twisted(false)
 {
 
 }
 
-BaseCluster::BaseCluster(const char *buffer) : multiplicon(NULL)
+BaseCluster::BaseCluster(const char *&buffer, const char *end) : multiplicon(NULL)
 {
-    memcpy(&random_probability, buffer, sizeof(random_probability));
-    buffer += sizeof(random_probability);
-    memcpy(&orientation, buffer, sizeof(orientation));
-    buffer += sizeof(orientation);
-    memcpy(&a, buffer, sizeof(a));
-    buffer += sizeof(a);
-    memcpy(&b, buffer, sizeof(b));
-    buffer += sizeof(b);
-    memcpy(&avg_x, buffer, sizeof(avg_x));
-    buffer += sizeof(avg_x);
-    memcpy(&var_x, buffer, sizeof(var_x));
-    buffer += sizeof(var_x);
-    memcpy(&mrss, buffer, sizeof(mrss));
-    buffer += sizeof(mrss);
-    memcpy(&x_end1, buffer, sizeof(x_end1));
-    buffer += sizeof(x_end1);
-    memcpy(&x_end2, buffer, sizeof(x_end2));
-    buffer += sizeof(x_end2);
-    memcpy(&y_end1, buffer, sizeof(y_end1));
-    buffer += sizeof(y_end1);
-    memcpy(&y_end2, buffer, sizeof(y_end2));
-    buffer += sizeof(y_end2);
-    memcpy(&was_twisted, buffer, sizeof(was_twisted));
-    buffer += sizeof(was_twisted);
-    memcpy(&begin_x, buffer, sizeof(begin_x));
-    buffer += sizeof(begin_x);
-    memcpy(&end_x, buffer, sizeof(end_x));
-    buffer += sizeof(end_x);
-    memcpy(&begin_y, buffer, sizeof(begin_y));
-    buffer += sizeof(begin_y);
-    memcpy(&end_y, buffer, sizeof(end_y));
-    buffer += sizeof(end_y);
-
-    int size = anchorpoints.size();
-    memcpy(&size, buffer, sizeof(size));
-    buffer += sizeof(size);
-
+    WireFormat::getRaw(buffer, random_probability, end);
+    WireFormat::getRaw(buffer, orientation, end);
+    WireFormat::getRaw(buffer, a, end);
+    WireFormat::getRaw(buffer, b, end);
+    WireFormat::getRaw(buffer, avg_x, end);
+    WireFormat::getRaw(buffer, var_x, end);
+    WireFormat::getRaw(buffer, mrss, end);
+    WireFormat::getRaw(buffer, x_end1, end);
+    WireFormat::getRaw(buffer, x_end2, end);
+    WireFormat::getRaw(buffer, y_end1, end);
+    WireFormat::getRaw(buffer, y_end2, end);
+    WireFormat::getRaw(buffer, was_twisted, end);
+    begin_x = WireFormat::getVarInt(buffer, end);
+    end_x = WireFormat::getDelta(buffer, begin_x, end);
+    begin_y = WireFormat::getVarInt(buffer, end);
+    end_y = WireFormat::getDelta(buffer, begin_y, end);
+
+    int size = WireFormat::getCount(buffer, end);
+
+    anchorpoints.reserve(size);
+    AnchorPoint prev(0, 0, 0, 0, false);
     for (int i = 0; i < size; i++) {
-        anchorpoints.insert(AnchorPoint(buffer));
-        buffer += AnchorPoint::getPackSize();
+        prev = AnchorPoint(buffer, end, prev);
+        insertSorted(anchorpoints, prev);
     }
+
+    // the packed statistics are up to date
+    intervalValid = true;
+    recomputeSums();
+}
+
+void BaseCluster::insertSorted(vector<AnchorPoint>& points,
+                               const AnchorPoint& point)
+{
+    // after all points with the same x, as a multiset would do
+    points.insert(upper_bound(points.begin(), points.end(), point), point);
 }
 
 void BaseCluster::addAnchorPoint(int X, int Y) {
-    anchorpoints.insert(AnchorPoint(X, Y, true));
+    insertSorted(anchorpoints, AnchorPoint(X, Y, true));
+    addToSums(X, Y);
     b = 0.0; //indicates the statistics need to be updated
 }
 
+void BaseCluster::addToSums(int x, int y) {
+    sum_x += x;
+    sum_y += y;
+    sum_xy += x*y;
+    sum_x2 += x*x;
+    sum_y2 += y*y;
+    lowest_y = std::min(lowest_y, y);
+    highest_y = std::max(highest_y, y);
+}
+
+void BaseCluster::recomputeSums() {
+    sum_x = sum_y = sum_xy = sum_x2 = sum_y2 = 0.0;
+    lowest_y = INT_MAX;
+    highest_y = INT_MIN;
+
+    vector<AnchorPoint>::const_iterator e = anchorpoints.begin();
+    for ( ; e != anchorpoints.end(); e++)
+        addToSums(e->getX(), e->getY());
+}
+
 struct CompareAP {
     bool operator()(const AnchorPoint& left, const AnchorPoint& right) const
     {
@@ -70,17 +90,37 @@ struct CompareAP {
 };
 
 void BaseCluster::filterDuplicates() {
-    set<AnchorPoint, CompareAP> unique(anchorpoints.begin(), anchorpoints.end());
-    anchorpoints = multiset<AnchorPoint>(unique.begin(), unique.end());
+    // the statistics are not updated: keep the interval of the original
+    // anchorpoints
+    updateInterval();
+
+    // sort on (x, y) and keep the first of every coordinate pair
+    stable_sort(anchorpoints.begin(), anchorpoints.end(), CompareAP());
+    vector<AnchorPoint>::iterator out = anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator e = anchorpoints.begin();
+    for ( ; e != anchorpoints.end(); e++) {
+        if (out != anchorpoints.begin() && (out-1)->getX() == e->getX() &&
+                (out-1)->getY() == e->getY())
+            continue;
+        *out++ = *e;
+    }
+    anchorpoints.erase(out, anchorpoints.end());
+    recomputeSums();
 }
 
 void BaseCluster::addBackBone(int X, int Y) {
-    backBone.insert(AnchorPoint(X, Y, true));
+    // at most one backbone point per x, the first one is kept
+    AnchorPoint point(X, Y, true);
+    vector<AnchorPoint>::iterator it =
+        lower_bound(backBone.begin(), backBone.end(), point);
+    if (it == backBone.end() || point < *it)
+        backBone.insert(it, point);
     //b = 0.0; //indicates the statistics need to be updated
 }
 
 void BaseCluster::addAnchorPoint(AnchorPoint& point) {
-    anchorpoints.insert(point);
+    insertSorted(anchorpoints, point);
+    addToSums(point.getX(), point.getY());
     b = 0.0; //indicates the statistics need to be updated
 }
 
@@ -88,7 +128,7 @@ unsigned int BaseCluster::getCountAnchorPoints() const
 {
     unsigned int c = 0;
 
-    multiset<AnchorPoint>::const_iterator e = anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator e = anchorpoints.begin();
     for ( ; e != anchorpoints.end(); e++)
         if (e->isRealAnchorPoint())
             c++;
@@ -100,21 +140,13 @@ unsigned int BaseCluster::getLowestX() const
 {
     if (anchorpoints.size() == 0) return 0;
 
-    return anchorpoints.begin()->getX();
+    return anchorpoints.front().getX();
 }
 
 unsigned int BaseCluster::getLowestY() const
 {
     if (anchorpoints.size() == 0) return 0;
 
-    multiset<AnchorPoint>::const_iterator e = anchorpoints.begin();
-    int lowest_y = e->getY();
-
-    for (e++; e != anchorpoints.end(); e++) {
-        int y = e->getY();
-        if (y < lowest_y)
-            lowest_y = y;
-    }
     return lowest_y;
 }
 
@@ -122,20 +154,12 @@ unsigned int BaseCluster::getHighestX() const
 {
     if (anchorpoints.size() == 0) return 0;
 
-    return (--anchorpoints.end())->getX();
+    return anchorpoints.back().getX();
 }
 
 unsigned int BaseCluster::getHighestY() const {
     if (anchorpoints.size() == 0) return 0;
 
-    multiset<AnchorPoint>::const_iterator e = anchorpoints.begin();
-    int highest_y = e->getY();
-
-    for (e++; e != anchorpoints.end(); e++) {
-        int y = e->getY();
-        if (y > highest_y)
-            highest_y = y;
-    }
     return highest_y;
 }
 
@@ -143,31 +167,9 @@ void BaseCluster::setMultiplicon(Multiplicon& multiplicon) {
     this->multiplicon = &multiplicon;
 }
 
-double BaseCluster::r_squared(int X, int Y) const {
-    double sum_x = 0, sum_y = 0, sum_xy = 0, sum_x2 = 0, sum_y2 = 0;
-    unsigned int n = 0;
-
-    multiset<AnchorPoint>::const_iterator e = anchorpoints.begin();
-    for ( ; e != anchorpoints.end(); e++) {
-        int x = e->getX();
-        int y = e->getY();
-        sum_x += x;
-        sum_y += y;
-        sum_xy += x*y;
-        sum_x2 += x*x;
-        sum_y2 += y*y;
-        n++;
-    }
-    //if X and Y are given as arguments, count them too
-    if (X != 0 || Y != 0) {
-        sum_x += X;
-        sum_y += Y;
-        sum_xy += X*Y;
-        sum_x2 += X*X;
-        sum_y2 += Y*Y;
-        n++;
-    }
-
+double BaseCluster::r_squared(double n, double sum_x, double sum_y,
+                              double sum_xy, double sum_x2, double sum_y2)
+{
     double value = ((sum_x2 - sum_x * sum_x / n) * (sum_y2 - sum_y * sum_y / n));
 
     if (value == 0) {
@@ -179,53 +181,32 @@ double BaseCluster::r_squared(int X, int Y) const {
     }
 }
 
-double BaseCluster::r_squared(BaseCluster& cluster) const {
-    double sum_x = 0, sum_y = 0, sum_xy = 0, sum_x2 = 0, sum_y2 = 0;
-    unsigned int n = 0;
+double BaseCluster::r_squared(int X, int Y) const {
+    unsigned int n = anchorpoints.size();
 
-    multiset<AnchorPoint>::const_iterator e = anchorpoints.begin();
-    for ( ; e != anchorpoints.end(); e++) {
-        int x = e->getX();
-        int y = e->getY();
-        sum_x += x;
-        sum_y += y;
-        sum_xy += x*y;
-        sum_x2 += x*x;
-        sum_y2 += y*y;
-        n++;
-    }
+    //if X and Y are given as arguments, count them too
+    if (X != 0 || Y != 0)
+        return r_squared(n + 1, sum_x + X, sum_y + Y, sum_xy + X*Y,
+                         sum_x2 + X*X, sum_y2 + Y*Y);
 
-    //count the cluster too
-    e = cluster.anchorpoints.begin();
-    for (; e != cluster.anchorpoints.end(); e++) {
-        int x = e->getX();
-        int y = e->getY();
-        sum_x += x;
-        sum_y += y;
-        sum_xy += x*y;
-        sum_x2 += x*x;
-        sum_y2 += y*y;
-        n++;
-    }
+    return r_squared(n, sum_x, sum_y, sum_xy, sum_x2, sum_y2);
+}
 
-    double value = ((sum_x2 - sum_x * sum_x / n) *
-                    (sum_y2 - sum_y * sum_y / n));
+double BaseCluster::r_squared(BaseCluster& cluster) const {
+    //count the cluster too
+    unsigned int n = anchorpoints.size() + cluster.anchorpoints.size();
 
-    if (value == 0) {
-        return -1;
-    }
-    else {
-        double r = (sum_xy - (sum_x * sum_y / n)) / sqrt(value);
-        return (r * r);
-    }
+    return r_squared(n, sum_x + cluster.sum_x, sum_y + cluster.sum_y,
+                     sum_xy + cluster.sum_xy, sum_x2 + cluster.sum_x2,
+                     sum_y2 + cluster.sum_y2);
 }
 
 double BaseCluster::averageDPD() const {
 
     double totaldpd = 0;
 
-    multiset<AnchorPoint>::const_iterator prev = anchorpoints.begin();
-    multiset<AnchorPoint>::const_iterator curr = anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator prev = anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator curr = anchorpoints.begin();
     for (curr++; curr != anchorpoints.end(); prev++, curr++) {
         totaldpd += dpd(prev->getX(), prev->getY(),
                         curr->getX(), curr->getY());
@@ -240,23 +221,9 @@ void BaseCluster::updateStatistics() {
     // if it's already calculated, get out of here
     if (b != 0.0) return;
 
-    int N=anchorpoints.size();
     regression();
+    intervalValid = false;
 
-    var_x= 0.0;
-    mrss = 0.0;
-
-    multiset<AnchorPoint>::const_iterator e = anchorpoints.begin();
-    for ( ; e != anchorpoints.end(); e++) {
-        int x = e->getX();
-        int y = e->getY();
-        double y_est = b * x + a;
-        mrss += (y - y_est) * (y - y_est);
-        var_x += (x - avg_x) * (x - avg_x);
-    }
-
-    mrss   = mrss  / (N-2);
-    var_x  = var_x / (N-1);
     x_end1 = getLowestX();
     x_end2 = getHighestX();
     y_end1 = x_end1 * b + a;
@@ -268,28 +235,39 @@ void BaseCluster::regression() {
     double N=anchorpoints.size();
     if (N < 3.0) return;
 
-    double sum_x = 0.0, sum_y = 0.0, sum_xy = 0.0, sum_x2 = 0.0;
-
-    multiset<AnchorPoint>::const_iterator e = anchorpoints.begin();
-    for ( ; e != anchorpoints.end(); e++) {
-        int x = e->getX();
-        int y = e->getY();
-        sum_x += x;
-        sum_y += y;
-        sum_xy += x*y;
-        sum_x2 += x*x;
-    }
-
     avg_x = sum_x/N;
     double avg_y = sum_y/N;
 
-    var_x  = (sum_x2 - N*avg_x*avg_x) /(N-1.0);
+    double var_x  = (sum_x2 - N*avg_x*avg_x) /(N-1.0);
     double cov_xy = (sum_xy - N*avg_x*avg_y) /(N-1.0);
 
     b = cov_xy / var_x;
     a = avg_y - b * avg_x;
 }
 
+void BaseCluster::updateInterval() const {
+
+    if (intervalValid) return;
+
+    int N=anchorpoints.size();
+
+    var_x= 0.0;
+    mrss = 0.0;
+
+    vector<AnchorPoint>::const_iterator e = anchorpoints.begin();
+    for ( ; e != anchorpoints.end(); e++) {
+        int x = e->getX();
+        int y = e->getY();
+        double y_est = b * x + a;
+        mrss += (y - y_est) * (y - y_est);
+        var_x += (x - avg_x) * (x - avg_x);
+    }
+
+    mrss   = mrss  / (N-2);
+    var_x  = var_x / (N-1);
+    intervalValid = true;
+}
+
 double BaseCluster::distanceToPoint(int x, int y) const
 {
     if (x >= x_end1 && x <= x_end2) {
@@ -316,6 +294,7 @@ bool BaseCluster::inInterval(int x, int y) {
 
 void BaseCluster::intervalBounds(int x, double& up, double& down) {
     updateStatistics();
+    updateInterval();
     double tnm2_95percent = 1.96; 
     //NOTE tdistribution table used from: http://www.sociology.ohio-state.edu/people/ptv/publications/p%20values/p_value_tables.html
     //99.9% = 3.29
@@ -337,14 +316,36 @@ void BaseCluster::intervalBounds(int x, double& up, double& down) {
 
 void BaseCluster::mergeWith(BaseCluster& cluster)
 {
-    multiset<AnchorPoint>::const_iterator e = cluster.anchorpoints.begin();
-    for ( ; e != cluster.anchorpoints.end(); e++) {
-        addAnchorPoint(e->getX(), e->getY());
-    }
-
-    for (e = cluster.backBone.begin(); e != cluster.backBone.end(); e++) {
-        addBackBone(e->getX(), e->getY());
-    }
+    // linear merge, the points of this cluster precede those of the other
+    // cluster with the same x
+    vector<AnchorPoint> other, merged;
+    other.reserve(cluster.anchorpoints.size());
+    vector<AnchorPoint>::const_iterator e = cluster.anchorpoints.begin();
+    for ( ; e != cluster.anchorpoints.end(); e++)
+        other.push_back(AnchorPoint(e->getX(), e->getY(), true));
+
+    merged.reserve(anchorpoints.size() + other.size());
+    merge(anchorpoints.begin(), anchorpoints.end(), other.begin(),
+          other.end(), back_inserter(merged));
+    anchorpoints.swap(merged);
+
+    sum_x += cluster.sum_x;
+    sum_y += cluster.sum_y;
+    sum_xy += cluster.sum_xy;
+    sum_x2 += cluster.sum_x2;
+    sum_y2 += cluster.sum_y2;
+    lowest_y = std::min(lowest_y, cluster.lowest_y);
+    highest_y = std::max(highest_y, cluster.highest_y);
+
+    // backbone points of this cluster take precedence for the same x
+    other.clear();
+    for (e = cluster.backBone.begin(); e != cluster.backBone.end(); e++)
+        other.push_back(AnchorPoint(e->getX(), e->getY(), true));
+
+    merged.clear();
+    set_union(backBone.begin(), backBone.end(), other.begin(), other.end(),
+              back_inserter(merged));
+    backBone.swap(merged);
 
     b=0.0;
     updateStatistics();
@@ -494,7 +495,7 @@ bool BaseCluster::partialOverlappingInterval(BaseCluster& c) {
     updateStatistics();
     c.updateStatistics();
 
-    multiset<AnchorPoint>::const_iterator e;
+    vector<AnchorPoint>::const_iterator e;
 
     //check if AP of cluster c that are in the bounding box of THIS cluster are within the confidenceinterval of THIS cluster
 
@@ -550,9 +551,9 @@ double BaseCluster::calculateProbability(double area, double points, int level)
     double density = (double)points / (double)area;
     double probability = 1.0;
 
-    multiset<AnchorPoint>::const_iterator it1 = backBone.begin();
+    vector<AnchorPoint>::const_iterator it1 = backBone.begin();
     it1++;
-    multiset<AnchorPoint>::const_iterator it2 = backBone.begin();
+    vector<AnchorPoint>::const_iterator it2 = backBone.begin();
 
     while (it1 != backBone.end())
     {
@@ -571,19 +572,25 @@ double BaseCluster::calculateProbability(double area, double points, int level)
         it2++;
     }
 
-    it1 = anchorpoints.begin();
-    it1++;
-    it2 = anchorpoints.begin();
+    // the statistics are not updated: keep the interval of the original
+    // anchorpoints
+    updateInterval();
 
-    while (it1 != anchorpoints.end()) {
-        double distance = dpd((it2)->getX(), (it2)->getY(),
+    // remove the anchorpoints that coincide with the first one
+    if (anchorpoints.empty()) return probability;
+
+    vector<AnchorPoint>::iterator out = anchorpoints.begin() + 1;
+    for (it1 = out; it1 != anchorpoints.end(); it1++) {
+        double distance = dpd(anchorpoints.front().getX(),
+                              anchorpoints.front().getY(),
                               (it1)->getX(), (it1)->getY());
 
-        if (distance == 0) {
-            anchorpoints.erase(it1++);
-        } else {
-            it1++;
-        }
+        if (distance != 0)
+            *out++ = *it1;
+    }
+    if (out != anchorpoints.end()) {
+        anchorpoints.erase(out, anchorpoints.end());
+        recomputeSums();
     }
 
     return probability;
@@ -595,9 +602,9 @@ double BaseCluster::calculateProbability(double area, double points, int level)
     double density = (double)points / area;
     double probability = 1.0;
 
-    multiset<AnchorPoint>::const_iterator it1 = anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator it1 = anchorpoints.begin();
     it1++;
-    multiset<AnchorPoint>::const_iterator it2 = anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator it2 = anchorpoints.begin();
 
     while (it1 != anchorpoints.end()) {
 
@@ -701,18 +708,13 @@ void BaseCluster::twistCluster() {
     int max_y = getHighestY();
     int min_y = getLowestY();
 
-    // swapping the y-values might change the ordening and breaking
-    // the iterator, hence, we must use a temporary object
-    multiset<AnchorPoint> twistedAnchorpoints;
-
-    multiset<AnchorPoint>::iterator e = anchorpoints.begin();
-    for ( ; e != anchorpoints.end(); e++) {
-        AnchorPoint ap = *e;
-        ap.twistY(max_y, min_y);
-        twistedAnchorpoints.insert(ap);
-    }
+    // the anchorpoints are ordered on x only, swapping the y-values
+    // keeps them ordered
+    vector<AnchorPoint>::iterator e = anchorpoints.begin();
+    for ( ; e != anchorpoints.end(); e++)
+        e->twistY(max_y, min_y);
 
-    anchorpoints = twistedAnchorpoints;
+    recomputeSums();
 
     b = 0.0;
     updateStatistics();
@@ -725,7 +727,7 @@ void BaseCluster::write () const {
          << "\tend_x: " << end_x << "\tend_y: "<< end_y << endl;
     cout << "anchorpoints: " << endl;
 
-    multiset<AnchorPoint>::const_iterator e = anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator e = anchorpoints.begin();
     for ( ; e != anchorpoints.end(); e++) {
         cout << "------" << &(*e) << '\t' <<
              e->getX() << ' ' << e->getY() << endl;
@@ -739,11 +741,20 @@ int BaseCluster::getPackSize() const
     packSize += sizeof(random_probability) + sizeof(orientation) +
                 sizeof(a) + sizeof(b) + sizeof (avg_x) + sizeof(var_x) +
                 sizeof(mrss) + sizeof(x_end1) + sizeof(x_end2) +
-                sizeof(y_end1) + sizeof(y_end2) + sizeof(was_twisted) +
-                sizeof(begin_x) + sizeof(end_x) +
-                sizeof(begin_y) + sizeof(end_y);
-    packSize += sizeof(int); // for storing the number of anchorpoints
-    packSize += anchorpoints.size()*AnchorPoint::getPackSize();
+                sizeof(y_end1) + sizeof(y_end2) + sizeof(was_twisted);
+    packSize += WireFormat::getVarIntSize(begin_x) +
+                WireFormat::getDeltaSize(end_x, begin_x) +
+                WireFormat::getVarIntSize(begin_y) +
+                WireFormat::getDeltaSize(end_y, begin_y);
+    // the number of anchorpoints
+    packSize += WireFormat::getVarIntSize(anchorpoints.size());
+
+    AnchorPoint prev(0, 0, 0, 0, false);
+    vector<AnchorPoint>::const_iterator it = anchorpoints.begin();
+    for ( ; it != anchorpoints.end(); it++) {
+        packSize += it->getPackSize(prev);
+        prev = *it;
+    }
 
     return packSize;
 }
@@ -752,46 +763,34 @@ int BaseCluster::pack(char *buffer) const
 {
     const char *bufferOrig = buffer;
 
-    memcpy(buffer, &random_probability, sizeof(random_probability));
-    buffer += sizeof(random_probability);
-    memcpy(buffer, &orientation, sizeof(orientation));
-    buffer += sizeof(orientation);
-    memcpy(buffer, &a, sizeof(a));
-    buffer += sizeof(a);
-    memcpy(buffer, &b, sizeof(b));
-    buffer += sizeof(b);
-    memcpy(buffer, &avg_x, sizeof(avg_x));
-    buffer += sizeof(avg_x);
-    memcpy(buffer, &var_x, sizeof(var_x));
-    buffer += sizeof(var_x);
-    memcpy(buffer, &mrss, sizeof(mrss));
-    buffer += sizeof(mrss);
-    memcpy(buffer, &x_end1, sizeof(x_end1));
-    buffer += sizeof(x_end1);
-    memcpy(buffer, &x_end2, sizeof(x_end2));
-    buffer += sizeof(x_end2);
-    memcpy(buffer, &y_end1, sizeof(y_end1));
-    buffer += sizeof(y_end1);
-    memcpy(buffer, &y_end2, sizeof(y_end2));
-    buffer += sizeof(y_end2);
-    memcpy(buffer, &was_twisted, sizeof(was_twisted));
-    buffer += sizeof(was_twisted);
-    memcpy(buffer, &begin_x, sizeof(begin_x));
-    buffer += sizeof(begin_x);
-    memcpy(buffer, &end_x, sizeof(end_x));
-    buffer += sizeof(end_x);
-    memcpy(buffer, &begin_y, sizeof(begin_y));
-    buffer += sizeof(begin_y);
-    memcpy(buffer, &end_y, sizeof(end_y));
-    buffer += sizeof(end_y);
-
-    int size = anchorpoints.size();
-    memcpy(buffer, &size, sizeof(size));
-    buffer += sizeof(size);
-
-    multiset<AnchorPoint>::const_iterator it = anchorpoints.begin();
-    for ( ; it != anchorpoints.end(); it++)
-        buffer += (*it).pack(buffer);
+    updateInterval();
+
+    WireFormat::putRaw(buffer, random_probability);
+    WireFormat::putRaw(buffer, orientation);
+    WireFormat::putRaw(buffer, a);
+    WireFormat::putRaw(buffer, b);
+    WireFormat::putRaw(buffer, avg_x);
+    WireFormat::putRaw(buffer, var_x);
+    WireFormat::putRaw(buffer, mrss);
+    WireFormat::putRaw(buffer, x_end1);
+    WireFormat::putRaw(buffer, x_end2);
+    WireFormat::putRaw(buffer, y_end1);
+    WireFormat::putRaw(buffer, y_end2);
+    WireFormat::putRaw(buffer, was_twisted);
+    WireFormat::putVarInt(buffer, begin_x);
+    WireFormat::putDelta(buffer, end_x, begin_x);
+    WireFormat::putVarInt(buffer, begin_y);
+    WireFormat::putDelta(buffer, end_y, begin_y);
+
+    WireFormat::putVarInt(buffer, anchorpoints.size());
+
+    // anchorpoints are sorted on x, so the x-deltas are small
+    AnchorPoint prev(0, 0, 0, 0, false);
+    vector<AnchorPoint>::const_iterator it = anchorpoints.begin();
+    for ( ; it != anchorpoints.end(); it++) {
+        buffer += it->pack(buffer, prev);
+        prev = *it;
+    }
 
     return buffer - bufferOrig;
 }
@@ -803,6 +802,8 @@ bool operator==(const BaseCluster &lhs, const BaseCluster &rhs)
     if (lhs.a != rhs.a) return false;
     if (lhs.b != rhs.b) return false;
     if (lhs.avg_x != rhs.avg_x) return false;
+    lhs.updateInterval();
+    rhs.updateInterval();
     if (lhs.var_x != rhs.var_x) return false;
     if (lhs.mrss != rhs.mrss) return false;
     if (lhs.x_end1 != rhs.x_end1) return false;
@@ -817,8 +818,8 @@ bool operator==(const BaseCluster &lhs, const BaseCluster &rhs)
     if (lhs.end_y != rhs.end_y) return false;
 
     if (lhs.anchorpoints.size() != rhs.anchorpoints.size()) return false;
-    multiset<AnchorPoint>::const_iterator it1 = lhs.anchorpoints.begin();
-    multiset<AnchorPoint>::const_iterator it2 = rhs.anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator it1 = lhs.anchorpoints.begin();
+    vector<AnchorPoint>::const_iterator it2 = rhs.anchorpoints.begin();
 
     for ( ; it1 != lhs.anchorpoints.end(); it1++, it2++)
         if (*it1 != *it2) return false;
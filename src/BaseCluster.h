@@ -20,9 +20,12 @@ public:
     BaseCluster(const bool orient);
 
     /**
-    * Constructs a basecluster object from a packed buffer
+    * Constructs a basecluster object from a packed buffer, the buffer is
+    * advanced past the basecluster
+    * @param end End of the buffer
+    * @throw WireFormatException If the buffer ends before the basecluster
     */
-    BaseCluster(const char *buffer);
+    BaseCluster(const char *&buffer, const char *end);
 
     /**
     * Destructor
@@ -53,14 +56,14 @@ public:
     /**
     * Returns an iterator pointing to the first anchorpoint
     */
-    multiset<AnchorPoint>::const_iterator getAPBegin() {
+    vector<AnchorPoint>::const_iterator getAPBegin() const {
         return anchorpoints.begin();
     }
 
     /**
     * Returns an iterator pointing past the final anchorpoint
     */
-    multiset<AnchorPoint>::const_iterator getAPEnd() {
+    vector<AnchorPoint>::const_iterator getAPEnd() const {
         return anchorpoints.end();
     }
 
@@ -303,6 +306,36 @@ private:
     */
     void regression();
 
+    /**
+    * Inserts an anchorpoint in a vector sorted on x, after the points with
+    * the same x
+    */
+    static void insertSorted(vector<AnchorPoint>& points,
+                             const AnchorPoint& point);
+
+    /**
+    * Adds the coordinates of an anchorpoint to the running sums and bounds
+    */
+    void addToSums(int x, int y);
+
+    /**
+    * Recomputes the running sums and bounds from all anchorpoints
+    */
+    void recomputeSums();
+
+    /**
+    * Calculates the residuals and the variance of x around the best fit
+    * line, these are only needed for the prediction interval and are
+    * therefore computed on demand
+    */
+    void updateInterval() const;
+
+    /**
+    * Calculates the squared Pearson value from the sums of the coordinates
+    */
+    static double r_squared(double n, double sum_x, double sum_y,
+                            double sum_xy, double sum_x2, double sum_y2);
+
     /**
      * distance of P3 to segment P1P2
      */
@@ -313,8 +346,8 @@ private:
     //ATTRIBUTES//
     //////////////
 
-    multiset<AnchorPoint> anchorpoints;
-    set<AnchorPoint> backBone;
+    vector<AnchorPoint> anchorpoints; //sorted on x, equal x in order of insertion
+    vector<AnchorPoint> backBone; //sorted on x, one point per x
     Multiplicon* multiplicon;
 
     double random_probability;
@@ -322,8 +355,11 @@ private:
 
     double a, b; //coefficients of the best fit line a+bx
     double avg_x; 
-    double var_x;
-    double mrss; //mean residual sum of squares
+    mutable double var_x;
+    mutable double mrss; //mean residual sum of squares
+    mutable bool intervalValid; //var_x and mrss are up to date
+    double sum_x, sum_y, sum_xy, sum_x2, sum_y2; //running sums over the anchorpoints
+    int lowest_y, highest_y; //bounds of the y-coordinates of the anchorpoints
     double x_end1, x_end2, y_end1, y_end2; //coordinates of outer points of regression line
 
     bool was_twisted;
@@ -0,0 +1,109 @@
+#include "CloudGrid.h"
+
+#include "SynthenicCloud.h"
+
+using namespace std;
+
+CloudGrid::CloudGrid(const vector<SynthenicCloud*>& clouds_, int range_) :
+    clouds(clouds_), range(range_ < 1 ? 1 : range_)
+{
+    // cells of about the average box size, but not smaller than the range
+    double sumSides = 0.0;
+    for (size_t i = 0; i < clouds.size(); i++)
+        sumSides += max(clouds[i]->calculateBoxWidth(),
+                        clouds[i]->calculateBoxHeight());
+    cellSize = range;
+    if (!clouds.empty())
+        cellSize = max(cellSize, (int)(sumSides / clouds.size()));
+
+    parent.resize(clouds.size());
+    registered.resize(clouds.size());
+    for (size_t i = 0; i < clouds.size(); i++) {
+        parent[i] = i;
+        // empty range
+        registered[i].x1 = registered[i].y1 = 0;
+        registered[i].x2 = registered[i].y2 = -1;
+        insert(i);
+    }
+}
+
+int CloudGrid::find(int id)
+{
+    int root = id;
+    while (parent[root] != root)
+        root = parent[root];
+
+    // path compression
+    while (parent[id] != root) {
+        int next = parent[id];
+        parent[id] = root;
+        id = next;
+    }
+    return root;
+}
+
+CloudGrid::CellRange CloudGrid::getCells(int id, int margin) const
+{
+    const SynthenicCloud& cloud = *clouds[id];
+    CellRange r;
+    r.x1 = max(0, cloud.getBeginX() - margin) / cellSize;
+    r.x2 = max(0, cloud.getEndX() + margin) / cellSize;
+    r.y1 = max(0, cloud.getBeginY() - margin) / cellSize;
+    r.y2 = max(0, cloud.getEndY() + margin) / cellSize;
+    return r;
+}
+
+void CloudGrid::insert(int id)
+{
+    CellRange o = registered[id];
+    CellRange r = getCells(id, 0);
+
+    for (int cx = r.x1; cx <= r.x2; cx++)
+        for (int cy = r.y1; cy <= r.y2; cy++)
+            if (cx < o.x1 || cx > o.x2 || cy < o.y1 || cy > o.y2)
+                cells[key(cx, cy)].push_back(id);
+
+    registered[id] = r;
+}
+
+void CloudGrid::getCandidates(int id, vector<int>& candidates)
+{
+    candidates.clear();
+
+    const SynthenicCloud& c1 = *clouds[id];
+    CellRange r = getCells(id, range - 1);
+
+    for (int cx = r.x1; cx <= r.x2; cx++) {
+        for (int cy = r.y1; cy <= r.y2; cy++) {
+            hash_map<unsigned long, vector<int> >::const_iterator it;
+            it = cells.find(key(cx, cy));
+            if (it == cells.end()) continue;
+
+            const vector<int>& entries = it->second;
+            for (size_t i = 0; i < entries.size(); i++) {
+                int other = find(entries[i]);
+                if (other == id) continue;
+
+                // the kspd between two points is at least the kspd
+                // between their bounding boxes
+                const SynthenicCloud& c2 = *clouds[other];
+                int dx = max(0, max(c2.getBeginX() - c1.getEndX(),
+                                    c1.getBeginX() - c2.getEndX()));
+                int dy = max(0, max(c2.getBeginY() - c1.getEndY(),
+                                    c1.getBeginY() - c2.getEndY()));
+                if (max(dx, dy) < range)
+                    candidates.push_back(other);
+            }
+        }
+    }
+
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()),
+                     candidates.end());
+}
+
+void CloudGrid::merge(int id1, int id2)
+{
+    parent[find(id2)] = find(id1);
+    insert(find(id1));
+}
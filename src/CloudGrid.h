@@ -0,0 +1,103 @@
+#ifndef __CLOUDGRID_H
+#define __CLOUDGRID_H
+
+#include "headers.h"
+
+class SynthenicCloud;
+
+/*
+ * Spatial hash over the bounding boxes of synthenic clouds, used while
+ * merging clouds that lie close together.
+ *
+ * The GHM is divided into square cells and every cloud is registered in
+ * the cells its bounding box overlaps. Clouds are identified by their
+ * index in the vector passed to the constructor. When a cloud is merged
+ * into another one, a union-find structure redirects its registrations to
+ * the absorbing cloud, whose registration is extended to its grown
+ * bounding box. Boxes of clouds may only grow.
+ */
+class CloudGrid
+{
+
+public:
+    ///////////////////////////////
+    //CONSTRUCTORS AND DESTRUCTOR//
+    ///////////////////////////////
+
+    /**
+    * Constructs the grid and registers all clouds
+    * @param clouds The synthenic clouds
+    * @param range Clouds whose bounding boxes are at least range apart
+    * (kspd between the boxes) are never reported as candidates
+    */
+    CloudGrid(const vector<SynthenicCloud*>& clouds, int range);
+
+    //////////////////
+    //PUBLIC METHODS//
+    //////////////////
+
+    /**
+    * Returns the cloud a cloud has been merged into
+    * @param id Index of the cloud
+    * @return Index of the cloud that contains the anchorpoints of the cloud
+    */
+    int find(int id);
+
+    /**
+    * Returns the clouds that lie within range of a cloud
+    * @param id Index of the cloud, it must not have been merged
+    * @param candidates Indices of the clouds, sorted (output)
+    */
+    void getCandidates(int id, vector<int>& candidates);
+
+    /**
+    * Registers that a cloud was merged into another one, the bounding box
+    * of the absorbing cloud is reindexed
+    * @param id1 Index of the absorbing cloud
+    * @param id2 Index of the absorbed cloud, it may no longer be accessed
+    */
+    void merge(int id1, int id2);
+
+private:
+
+    // range of cells, inclusive
+    struct CellRange {
+        int x1, x2, y1, y2;
+    };
+
+    /**
+    * Returns the cells overlapping a box expanded by a margin
+    */
+    CellRange getCells(int id, int margin) const;
+
+    /**
+    * Registers a cloud in the cells of its bounding box that are not in
+    * its registered range yet
+    */
+    void insert(int id);
+
+    /**
+    * Returns the key of a cell in the hash
+    */
+    static unsigned long key(int cx, int cy) {
+        return ((unsigned long)(unsigned int)cx << 32) | (unsigned int)cy;
+    }
+
+    //////////////
+    //ATTRIBUTES//
+    //////////////
+
+    vector<SynthenicCloud*> clouds;
+    int range, cellSize;
+
+    // clouds registered in every cell
+    hash_map<unsigned long, vector<int> > cells;
+
+    // cells in which every cloud is registered
+    vector<CellRange> registered;
+
+    // union-find parent of every cloud
+    vector<int> parent;
+};
+
+#endif
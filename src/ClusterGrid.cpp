@@ -0,0 +1,119 @@
+#include "ClusterGrid.h"
+
+#include "BaseCluster.h"
+
+#include <cmath>
+
+using namespace std;
+
+ClusterGrid::ClusterGrid(int gap_, int width_) :
+    gap(gap_), width(width_ < 1 ? 1 : width_)
+{
+}
+
+void ClusterGrid::insert(int index, BaseCluster& cluster)
+{
+    cluster.updateStatistics();
+
+    double x1 = cluster.getXEnd1(), x2 = cluster.getXEnd2();
+    double y1 = cluster.getYEnd1(), y2 = cluster.getYEnd2();
+
+    if (index >= (int)columnsOf.size())
+        columnsOf.resize(index + 1);
+
+    // degenerate regression statistics: no bounds can be derived
+    if (!isfinite(x1) || !isfinite(x2) || !isfinite(y1) || !isfinite(y2)) {
+        unbounded.push_back(index);
+        return;
+    }
+
+    int loX = (int)x1 - gap, hiX = (int)x2 + gap;
+    vector<Entry> entries;
+
+    for (int c = column(loX); c <= column(hiX); c++) {
+        int cx1 = c * width, cx2 = cx1 + width - 1;
+        double loY = HUGE_VAL, hiY = -HUGE_VAL;
+
+        // within the x-extent, the point must be inside the prediction
+        // interval: its upper bound is convex and its lower bound is
+        // concave, so their extremes lie at the ends of the column
+        int xa = max(cx1, (int)x1), xb = min(cx2, (int)x2);
+        if (xa <= xb) {
+            double upA, downA, upB, downB;
+            cluster.intervalBounds(xa, upA, downA);
+            cluster.intervalBounds(xb, upB, downB);
+            loY = min(downA, downB);
+            hiY = max(upA, upB);
+        }
+
+        // beyond the x-extent, the dpd to the end point must be at most
+        // gap, the dpd is never smaller than the y-distance
+        if (cx1 < (int)x1) {
+            loY = min(loY, y1 - gap - 1);
+            hiY = max(hiY, y1 + gap + 1);
+        }
+        if (cx2 > (int)x2) {
+            loY = min(loY, y2 - gap - 1);
+            hiY = max(hiY, y2 + gap + 1);
+        }
+
+        if (!isfinite(loY) || !isfinite(hiY)) {
+            unbounded.push_back(index);
+            return;
+        }
+
+        Entry entry;
+        entry.index = index;
+        entry.loY = loY - 1.0;
+        entry.hiY = hiY + 1.0;
+        entries.push_back(entry);
+    }
+
+    if (column(hiX) >= (int)columns.size())
+        columns.resize(column(hiX) + 1);
+    for (size_t i = 0; i < entries.size(); i++) {
+        int c = column(loX) + i;
+        columns[c].push_back(entries[i]);
+        columnsOf[index].push_back(c);
+    }
+}
+
+void ClusterGrid::remove(int index)
+{
+    vector<int> &cols = columnsOf[index];
+    for (size_t i = 0; i < cols.size(); i++) {
+        vector<Entry> &entries = columns[cols[i]];
+        for (size_t j = 0; j < entries.size(); j++) {
+            if (entries[j].index != index) continue;
+            entries[j] = entries.back();
+            entries.pop_back();
+            break;
+        }
+    }
+    cols.clear();
+
+    vector<int>::iterator it = find(unbounded.begin(), unbounded.end(), index);
+    if (it != unbounded.end())
+        unbounded.erase(it);
+}
+
+void ClusterGrid::update(int index, BaseCluster& cluster)
+{
+    remove(index);
+    insert(index, cluster);
+}
+
+void ClusterGrid::getCandidates(int x, int y, vector<int>& candidates) const
+{
+    candidates.clear();
+
+    int c = column(x);
+    static const vector<Entry> none;
+    const vector<Entry> &entries = (c < (int)columns.size()) ? columns[c] : none;
+    for (size_t i = 0; i < entries.size(); i++)
+        if (y >= entries[i].loY && y <= entries[i].hiY)
+            candidates.push_back(entries[i].index);
+    candidates.insert(candidates.end(), unbounded.begin(), unbounded.end());
+
+    sort(candidates.begin(), candidates.end());
+}
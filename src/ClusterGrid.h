@@ -0,0 +1,100 @@
+#ifndef __CLUSTERGRID_H
+#define __CLUSTERGRID_H
+
+#include "headers.h"
+
+class BaseCluster;
+
+/*
+ * Spatial index over the baseclusters used while enriching them with the
+ * remaining points of a gene homology matrix.
+ *
+ * The x-axis is divided into columns of fixed width. For every column a
+ * cluster overlaps, the grid stores the range of y-values a point in that
+ * column can have to be accepted by the cluster: the prediction interval of
+ * the regression line within the x-extent of the cluster and a box of
+ * +/- gap around the outer points of the regression line beyond it. A
+ * point (x,y) can only be within gap range and inside the interval of a
+ * cluster if it falls inside one of these ranges, so only those clusters
+ * need to be evaluated. The ranges are slightly widened to absorb
+ * rounding differences, the exact tests are still performed by the caller.
+ * Clusters with degenerate (non-finite) statistics are always reported.
+ */
+class ClusterGrid
+{
+
+public:
+    ///////////////////////////////
+    //CONSTRUCTORS AND DESTRUCTOR//
+    ///////////////////////////////
+
+    /**
+    * Constructs an empty grid
+    * @param gap Maximum dpd between a point and a cluster
+    * @param width Width of a column (x-coordinates)
+    */
+    ClusterGrid(int gap, int width);
+
+    //////////////////
+    //PUBLIC METHODS//
+    //////////////////
+
+    /**
+    * Adds a cluster to the grid, the statistics of the cluster are updated
+    * @param index Identifier of the cluster, reported by getCandidates()
+    * @param cluster The basecluster
+    */
+    void insert(int index, BaseCluster& cluster);
+
+    /**
+    * Reindexes a cluster after it has changed
+    * @param index Identifier of the cluster
+    * @param cluster The basecluster
+    */
+    void update(int index, BaseCluster& cluster);
+
+    /**
+    * Returns the clusters that can accept a point
+    * @param x The x-coordinate of the point
+    * @param y The y-coordinate of the point
+    * @param candidates Identifiers of the clusters, sorted (output)
+    */
+    void getCandidates(int x, int y, vector<int>& candidates) const;
+
+private:
+
+    // admissible y-range of a cluster within a column
+    struct Entry {
+        int index;
+        double loY, hiY;
+    };
+
+    /**
+    * Removes all entries of a cluster
+    */
+    void remove(int index);
+
+    /**
+    * Returns the column of an x-coordinate
+    */
+    int column(int x) const {
+        return (x < 0) ? 0 : x / width;
+    }
+
+    //////////////
+    //ATTRIBUTES//
+    //////////////
+
+    int gap, width;
+
+    // entries of every column
+    vector<vector<Entry> > columns;
+
+    // columns in which every cluster has entries
+    vector<vector<int> > columnsOf;
+
+    // clusters with degenerate statistics, candidates for every point
+    vector<int> unbounded;
+};
+
+#endif
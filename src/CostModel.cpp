@@ -0,0 +1,288 @@
+#include "CostModel.h"
+
+using namespace std;
+
+/**
+ * Solves a system of linear equations by Gaussian elimination with
+ * partial pivoting, A and b are overwritten
+ * @return False if the system is singular
+ */
+static bool solve(double A[][CostModel::NUM_FEATURES], double *b, double *x)
+{
+    const int N = CostModel::NUM_FEATURES;
+
+    for (int c = 0; c < N; c++) {
+        int p = c;
+        for (int r = c + 1; r < N; r++)
+            if (fabs(A[r][c]) > fabs(A[p][c]))
+                p = r;
+        if (fabs(A[p][c]) < 1e-12)
+            return false;
+
+        for (int k = 0; k < N; k++)
+            swap(A[c][k], A[p][k]);
+        swap(b[c], b[p]);
+
+        for (int r = c + 1; r < N; r++) {
+            double f = A[r][c] / A[c][c];
+            for (int k = c; k < N; k++)
+                A[r][k] -= f * A[c][k];
+            b[r] -= f * b[c];
+        }
+    }
+
+    for (int r = N - 1; r >= 0; r--) {
+        x[r] = b[r];
+        for (int k = r + 1; k < N; k++)
+            x[r] -= A[r][k] * x[k];
+        x[r] /= A[r][r];
+    }
+
+    return true;
+}
+
+CostModel::CostModel() : random(88172645463325252ULL)
+{
+    // seconds, rough estimates: use a cost model file to get fitted values
+    coef[0] = 2.0e-5;
+    coef[1] = 1.0e-8;
+    coef[2] = 5.0e-6;
+    coef[3] = 4.0e-2;
+
+    for (int s = 0; s < NUM_STRATA; s++)
+        seen[s] = 0;
+}
+
+int CostModel::getStratum(uint64_t points)
+{
+    int s = 0;
+    while (points > 1 && s < NUM_STRATA - 1) {
+        points >>= 1;
+        s++;
+    }
+    return s;
+}
+
+size_t CostModel::getNumObservations() const
+{
+    size_t n = 0;
+    for (int s = 0; s < NUM_STRATA; s++)
+        n += strata[s].size();
+    return n;
+}
+
+void CostModel::features(uint64_t sizeX, uint64_t sizeY, uint64_t points,
+                         double *f)
+{
+    double area = (double)sizeX * (double)sizeY;
+
+    f[0] = 1.0;
+    f[1] = (double)sizeX + (double)sizeY;
+    f[2] = (double)points;
+    f[3] = (area > 0.0) ? (double)points * (double)points / area : 0.0;
+}
+
+double CostModel::predict(uint64_t sizeX, uint64_t sizeY,
+                          uint64_t points) const
+{
+    double f[NUM_FEATURES];
+    features(sizeX, sizeY, points, f);
+
+    double time = 0.0;
+    for (int i = 0; i < NUM_FEATURES; i++)
+        time += coef[i] * f[i];
+    return time;
+}
+
+void CostModel::addObservation(uint64_t sizeX, uint64_t sizeY,
+                               uint64_t points, double time)
+{
+    // an empty GHM says nothing about the point terms
+    if (points == 0) return;
+
+    Observation o;
+    o.sizeX = sizeX;
+    o.sizeY = sizeY;
+    o.points = points;
+    o.time = time;
+
+    int s = getStratum(points);
+    const size_t capacity = MAX_OBSERVATIONS / NUM_STRATA;
+    seen[s]++;
+    if (strata[s].size() < capacity) {
+        strata[s].push_back(o);
+        return;
+    }
+
+    // reservoir sampling: keep the new measurement with probability
+    // capacity / seen (xorshift64, the sample is reproducible)
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    uint64_t r = random % seen[s];
+    if (r < capacity)
+        strata[s][r] = o;
+}
+
+bool CostModel::fit()
+{
+    if (getNumObservations() < 4 * NUM_FEATURES)
+        return false;
+
+    // scale the features to comparable magnitudes
+    double scale[NUM_FEATURES], f[NUM_FEATURES];
+    for (int i = 0; i < NUM_FEATURES; i++)
+        scale[i] = 0.0;
+    for (int s = 0; s < NUM_STRATA; s++) {
+        for (size_t o = 0; o < strata[s].size(); o++) {
+            const Observation& obs = strata[s][o];
+            features(obs.sizeX, obs.sizeY, obs.points, f);
+            for (int i = 0; i < NUM_FEATURES; i++)
+                scale[i] = max(scale[i], f[i]);
+        }
+    }
+
+    // least squares, features with a negative coefficient are dropped and
+    // the remaining ones refitted until all coefficients are non-negative
+    bool active[NUM_FEATURES];
+    for (int i = 0; i < NUM_FEATURES; i++)
+        active[i] = (scale[i] > 0.0);
+
+    double x[NUM_FEATURES];
+    for (int iter = 0; iter < NUM_FEATURES; iter++) {
+        double A[NUM_FEATURES][NUM_FEATURES], b[NUM_FEATURES];
+        for (int i = 0; i < NUM_FEATURES; i++) {
+            b[i] = 0.0;
+            for (int j = 0; j < NUM_FEATURES; j++)
+                A[i][j] = 0.0;
+        }
+
+        for (int s = 0; s < NUM_STRATA; s++) {
+            for (size_t o = 0; o < strata[s].size(); o++) {
+                const Observation& obs = strata[s][o];
+                features(obs.sizeX, obs.sizeY, obs.points, f);
+                for (int i = 0; i < NUM_FEATURES; i++) {
+                    if (!active[i]) continue;
+                    double fi = f[i] / scale[i];
+                    b[i] += fi * obs.time;
+                    for (int j = 0; j < NUM_FEATURES; j++)
+                        if (active[j])
+                            A[i][j] += fi * f[j] / scale[j];
+                }
+            }
+        }
+
+        // a small ridge keeps degenerate data (e.g. lists of equal length)
+        // solvable
+        double trace = 0.0;
+        for (int i = 0; i < NUM_FEATURES; i++)
+            trace += A[i][i];
+        for (int i = 0; i < NUM_FEATURES; i++)
+            A[i][i] = active[i] ? A[i][i] + 1e-10 * trace : 1.0;
+
+        if (!solve(A, b, x))
+            return false;
+
+        bool negative = false;
+        for (int i = 0; i < NUM_FEATURES; i++) {
+            if (active[i] && x[i] < 0.0) {
+                active[i] = false;
+                negative = true;
+            }
+        }
+        if (!negative) break;
+    }
+
+    double c[NUM_FEATURES];
+    for (int i = 0; i < NUM_FEATURES; i++)
+        c[i] = (active[i] && x[i] > 0.0) ? x[i] / scale[i] : 0.0;
+
+    // the point terms are what the load balancing relies on, keep the
+    // previous coefficients rather than a fit that lost them
+    if (!hasPointTerms(c))
+        return false;
+
+    for (int i = 0; i < NUM_FEATURES; i++)
+        coef[i] = c[i];
+
+    return true;
+}
+
+bool CostModel::load(const string& filename)
+{
+    ifstream ifs(filename.c_str());
+    if (!ifs) return false;
+
+    double c[NUM_FEATURES];
+    bool haveCoef = false;
+    vector<Observation> obs;
+
+    string line;
+    while (getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        istringstream iss(line);
+        if (!haveCoef) {
+            string key;
+            iss >> key;
+            for (int i = 0; i < NUM_FEATURES; i++)
+                iss >> c[i];
+            if (key != "coefficients" || iss.fail())
+                return false;
+            haveCoef = true;
+            continue;
+        }
+
+        Observation o;
+        iss >> o.sizeX >> o.sizeY >> o.points >> o.time;
+        if (iss.fail())
+            return false;
+        obs.push_back(o);
+    }
+
+    if (!haveCoef)
+        return false;
+
+    if (hasPointTerms(c))
+        for (int i = 0; i < NUM_FEATURES; i++)
+            coef[i] = c[i];
+    else
+        cerr << "Warning: ignoring the coefficients in cost model file "
+             << filename << ", they do not depend on the number of points"
+             << endl;
+
+    for (int s = 0; s < NUM_STRATA; s++) {
+        strata[s].clear();
+        seen[s] = 0;
+    }
+    for (size_t o = 0; o < obs.size(); o++)
+        addObservation(obs[o].sizeX, obs[o].sizeY, obs[o].points,
+                       obs[o].time);
+
+    return true;
+}
+
+void CostModel::save(const string& filename) const
+{
+    ofstream ofs(filename.c_str());
+    if (!ofs) {
+        cerr << "Warning: cannot write cost model file " << filename << endl;
+        return;
+    }
+
+    ofs << "# i-ADHoRe level-2 cost model: time = c0 + c1 * (sizeX + sizeY)"
+        << " + c2 * points + c3 * points^2 / (sizeX * sizeY)" << endl;
+    ofs << "coefficients" << setprecision(8);
+    for (int i = 0; i < NUM_FEATURES; i++)
+        ofs << " " << coef[i];
+    ofs << endl;
+
+    ofs << "# sizeX sizeY points seconds" << endl;
+    for (int s = 0; s < NUM_STRATA; s++) {
+        for (size_t o = 0; o < strata[s].size(); o++) {
+            const Observation& obs = strata[s][o];
+            ofs << obs.sizeX << " " << obs.sizeY << " " << obs.points << " "
+                << obs.time << endl;
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef __COSTMODEL_H
+#define __COSTMODEL_H
+
+#include "headers.h"
+
+#include <stdint.h>
+
+/*
+ * Linear model of the time needed to process a level-2 GHM, used to
+ * balance the list pairs over the processes and threads.
+ *
+ * The predicted time is a non-negative combination of a fixed overhead,
+ * the length of both gene lists (building and scanning the matrix), the
+ * number of homologous points in the GHM and the number of points times
+ * the density of the GHM (dense regions give rise to many candidate
+ * clusters). The coefficients can be fitted by least squares to measured
+ * times; the model file keeps both the coefficients and a sample of the
+ * measurements, so the model is refined over successive runs.
+ *
+ * The measurements are stratified by the order of magnitude of the number
+ * of points and each stratum keeps a uniform random sample (reservoir) of
+ * its measurements. Runs are dominated by GHMs with few points, a plain
+ * window of the most recent measurements would leave nothing to fit the
+ * point terms to.
+ */
+class CostModel
+{
+
+public:
+    ///////////////////////////////
+    //CONSTRUCTORS AND DESTRUCTOR//
+    ///////////////////////////////
+
+    /**
+    * Constructs a model with default coefficients and no measurements
+    */
+    CostModel();
+
+    //////////////////
+    //PUBLIC METHODS//
+    //////////////////
+
+    /**
+    * Returns the predicted processing time of a GHM in seconds
+    * @param sizeX Length of the x-genelist (remapped)
+    * @param sizeY Length of the y-genelist (remapped)
+    * @param points Number of homologous points in the GHM
+    */
+    double predict(uint64_t sizeX, uint64_t sizeY, uint64_t points) const;
+
+    /**
+    * Adds a measured processing time of a GHM to the sample of its
+    * stratum, GHMs without points are ignored
+    * @param time Wall time in seconds
+    */
+    void addObservation(uint64_t sizeX, uint64_t sizeY, uint64_t points,
+                        double time);
+
+    /**
+    * Fits the coefficients to the measurements
+    * @return False if there are too few measurements or if the fit does not
+    * depend on the number of points, the coefficients are left unchanged in
+    * that case
+    */
+    bool fit();
+
+    /**
+    * Reads the coefficients and measurements from a file
+    * @return False if the file does not exist or is malformed, the model is
+    * left unchanged in that case. Coefficients that do not depend on the
+    * number of points are not adopted, the measurements are.
+    */
+    bool load(const string& filename);
+
+    /**
+    * Writes the coefficients and measurements to a file
+    */
+    void save(const string& filename) const;
+
+    /**
+    * Returns the i-th coefficient
+    */
+    double getCoefficient(int i) const {
+        return coef[i];
+    }
+
+    /**
+    * Returns the number of measurements
+    */
+    size_t getNumObservations() const;
+
+    static const int NUM_FEATURES = 4;
+    static const int NUM_STRATA = 20;
+    static const size_t MAX_OBSERVATIONS = 20000;
+
+private:
+
+    struct Observation {
+        uint64_t sizeX, sizeY, points;
+        double time;
+    };
+
+    /**
+    * Computes the features of a GHM
+    */
+    static void features(uint64_t sizeX, uint64_t sizeY, uint64_t points,
+                         double *f);
+
+    /**
+    * Checks whether coefficients depend on the number of points, a model
+    * without point terms cannot tell a dense GHM from an empty one
+    */
+    static bool hasPointTerms(const double *c) {
+        return c[2] > 0.0 || c[3] > 0.0;
+    }
+
+    /**
+    * Returns the stratum of a GHM: floor(log2(points)), capped
+    */
+    static int getStratum(uint64_t points);
+
+    //////////////
+    //ATTRIBUTES//
+    //////////////
+
+    double coef[NUM_FEATURES];
+    vector<Observation> strata[NUM_STRATA];
+    uint64_t seen[NUM_STRATA];      // measurements offered to each stratum
+    uint64_t random;                // state of the reservoir sampling
+};
+
+#endif
@@ -53,7 +53,9 @@ typedef struct s_triple {
 typedef list<string> StrLst;
 
 DataSet::DataSet(const Settings& sett) :
-    settings(sett), genepairs(NULL), threads(NULL), nThreads(0), workInProgress(0)
+    settings(sett), genepairs(NULL), cacheFile(NULL), threads(NULL),
+    scheduler(NULL), taskMultiplicons(NULL), taskClouds(NULL),
+    numWorkTasks(0), nThreads(0), workInProgress(0)
 {
     settings.displaySettings();
 
@@ -62,16 +64,19 @@ DataSet::DataSet(const Settings& sett) :
 
     const list<ListFile> &listfiles = settings.getListFiles();
 
-    genelists.reserve(listfiles.size());
-    list<ListFile>::const_iterator it = listfiles.begin();
-    for (int i = 0; it != listfiles.end(); it++, i++) {
-        genelists.push_back(new GeneList(it->getListName(),
-                                         it->getGenomeName(),
-                                         it->getFileName()));
-        // give each gene list a unique ID
-        genelists.back()->setID(i);
+    if (settings.getDatasetCache().empty() || !loadCache()) {
+        genelists.reserve(listfiles.size());
+        list<ListFile>::const_iterator it = listfiles.begin();
+        for ( ; it != listfiles.end(); it++)
+            genelists.push_back(new GeneList(it->getListName(),
+                                             it->getGenomeName(),
+                                             it->getFileName()));
     }
 
+    // give each gene list a unique ID
+    for (unsigned int i = 0; i < genelists.size(); i++)
+        genelists[i]->setID(i);
+
     // give each list element a unique ID
     for (unsigned int i = 0, cnt = 0; i < genelists.size(); i++) {
         geneIDmap[cnt] = genelists[i];
@@ -80,6 +85,8 @@ DataSet::DataSet(const Settings& sett) :
             elements[j]->setNumID(cnt);
     }
 
+    profileID = 1;
+
     cout << "\t\t\tdone. (time: " << Util::stopChrono() << "s)" << endl;
 }
 
@@ -125,10 +132,20 @@ DataSet::~DataSet()
 
     // delete the genepairs
     delete genepairs;
+
+    // the genes of the cached dataset point into the cache file
+    delete cacheFile;
+
+    releaseLevel2Files();
 }
 
 void DataSet::mapGenes()
 {
+    if (cacheFile != NULL) {
+        cout << "Gene pairs or families loaded from dataset cache." << endl;
+        return;
+    }
+
     Util::startChrono();
     if (settings.useFamily() == true) {
         cout << "Mapping gene families..."; cout.flush();
@@ -141,68 +158,72 @@ void DataSet::mapGenes()
     cout << "\t\tdone. (time: " << Util::stopChrono() << "s)" << endl;
 }
 
-void DataSet::getGenePairs()
+void DataSet::internGeneIDs()
 {
-    // load the gene pairs
-    genepairs = new GenePairs(settings.getBlastTable());
-
     unsigned int count = 0;
     for (unsigned int i = 0; i < genelists.size(); i++) {
         count += genelists[i]->getElementsLength();
     }
 
-    hash_set<string, stringhash> geneID (count);
+    geneIDTable = StringTable(count);
     for (unsigned int i = 0; i < genelists.size(); i++) {
         vector<ListElement*>& list = genelists[i]->getElements();
         for (unsigned int j = 0; j < list.size(); j++) {
-            geneID.insert(list[j]->getGene().getID());
+            Gene &gene = list[j]->getGene();
+            gene.setInternID(geneIDTable.intern(gene.getID()));
         }
     }
+}
+
+void DataSet::getGenePairs()
+{
+    internGeneIDs();
 
+    // load the gene pairs, pairs with genes that do not exist in the
+    // gene lists are dropped while reading the table
+    genepairs = new GenePairs(settings.getBlastTable(), geneIDTable,
+                              settings.getNumThreads());
+
+    // the genes point into the adjacency arrays of genepairs
     for (unsigned int i = 0; i < genelists.size(); i++) {
         vector<ListElement*>& list = genelists[i]->getElements();
         for (unsigned int j = 0; j < list.size(); j++) {
-            hash_set<string,stringhash>* pairs =
-            genepairs->getPairsOf(list[j]->getGene().getID());
-
-            list[j]->getGene().setPairs(*pairs);
-
-            if (pairs == NULL) continue;
-
-            // remove genes from the pairs set, if they do not
-            // exist in the genes
-            hash_set<string, stringhash>::iterator it;
-            vector<string> removeEl;
-            for (it = pairs->begin(); it != pairs->end(); it++) {
-                if (geneID.find(*it) == geneID.end()) {
-                    removeEl.push_back(*it);
-                }
-            }
-            for (unsigned int k = 0; k < removeEl.size(); k ++) {
-                pairs->erase(removeEl[k]);
-            }
+            Gene &gene = list[j]->getGene();
+            uint32_t numPairs;
+            const uint32_t* pairs =
+                genepairs->getPairsOf(gene.getInternID(), numPairs);
+            if (pairs != NULL)
+                gene.setPairs(pairs, numPairs);
         }
     }
 }
 
 void DataSet::getGeneFamilies()
 {
-    GeneFamily genefamily(settings.getBlastTable());
+    internGeneIDs();
+
+    GeneFamily genefamily(settings.getBlastTable(), geneIDTable,
+                          settings.getNumThreads());
 
+    StringTable familyTable;
     for (unsigned int i = 0; i < genelists.size(); i++) {
         vector<ListElement*>& list = genelists[i]->getElements();
         for (unsigned int j = 0; j < list.size(); j++) {
 
-            string ID(list[j]->getGene().getID());
-
-            string fam = genefamily.getFamilyOf(ID);
-            list[j]->getGene().setFamily(genefamily.getFamilyOf(ID));
+            Gene &gene = list[j]->getGene();
+            const string& fam = genefamily.getFamilyOf(gene.getInternID());
+            gene.setFamily(fam, familyTable.intern(fam));
         }
     }
 }
 
 void DataSet::remapTandems()
 {
+    if (cacheFile != NULL) {
+        cout << "Tandem remapping loaded from dataset cache." << endl;
+        return;
+    }
+
     Util::startChrono();
     cout << "Remapping tandem duplicates..."; cout.flush();
     for (unsigned int i = 0; i < genelists.size(); i++)
@@ -210,6 +231,13 @@ void DataSet::remapTandems()
                                    settings.useFamily());
 
     cout << "\tdone. (time: " << Util::stopChrono() << "s)" << endl;
+
+    if (!settings.getDatasetCache().empty() && ParToolBox::getProcID() == 0) {
+        Util::startChrono();
+        cout << "Writing dataset cache..."; cout.flush();
+        saveCache();
+        cout << "\t\tdone. (time: " << Util::stopChrono() << "s)" << endl;
+    }
 }
 
 void DataSet::indexToXY(int i, int N, int &x, int &y)
@@ -228,21 +256,8 @@ void DataSet::indexToXY(int i, int N, int &x, int &y)
 
 void DataSet::finishWorkPacket()
 {
-    int firstItem, nItems;
-    while (runGetSomeWork(firstItem, nItems, 0, false))
-        (this->*workFunction)(firstItem, nItems, 0, masterTMultiplicons,masterTClouds);
-
-    pthread_mutex_lock(&mpcMutex);
-    localMultiplicons.insert(localMultiplicons.end(),
-                             masterTMultiplicons.begin(),
-                             masterTMultiplicons.end());
-    localClouds.insert(localClouds.end(),
-                        masterTClouds.begin(),
-                        masterTClouds.end());
-
-    masterTMultiplicons.clear();
-    masterTClouds.clear();
-    pthread_mutex_unlock(&mpcMutex);
+    // the master thread takes part in the work
+    runTasks(0);
 }
 
 void DataSet::addMultiplicons(const vector<Multiplicon*>& mplicons)
@@ -306,36 +321,7 @@ void DataSet::prepareOutput()
     if (system(command.append(outputPath).c_str()) == -1)
         throw runtime_error("Cannot create directory " + outputPath);
 
-    // create the output filenames
-    geneFile = settings.getOutputPath();
-    geneFile.append("genes.txt");
-
-    multipliconsFile = settings.getOutputPath();
-    multipliconsFile.append("multiplicons.txt");
-
-    baseclustersFile = settings.getOutputPath();
-    baseclustersFile.append("baseclusters.txt");
-
-    anchorpointsFile = settings.getOutputPath();
-    anchorpointsFile.append("anchorpoints.txt");
-
-    mplpairsFile = settings.getOutputPath();
-    mplpairsFile.append("multiplicon_pairs.txt");
-
-    segmentsFile = settings.getOutputPath();
-    segmentsFile.append("segments.txt");
-
-    listElementsFile = settings.getOutputPath();
-    listElementsFile.append("list_elements.txt");
-
-    alignmentFile = settings.getOutputPath();
-    alignmentFile.append("alignment.txt");
-
-    synthenicCloudsFile = settings.getOutputPath();
-    synthenicCloudsFile.append("clouds.txt");
-
-    cloudAnchorPointsFile = settings.getOutputPath();
-    cloudAnchorPointsFile.append("cloudAP.txt");
+    setOutputFileNames();
 
     // clear the contents of the empty files
     // we can then safely append data to these files
@@ -450,21 +436,49 @@ void DataSet::prepareOutput()
     cloudID = 1;
 }
 
-void DataSet::flushCollinear()
+void DataSet::setOutputFileNames()
 {
-    ofstream ofs;
-    ofstream seg, le;
+    geneFile = settings.getOutputPath();
+    geneFile.append("genes.txt");
+
+    multipliconsFile = settings.getOutputPath();
+    multipliconsFile.append("multiplicons.txt");
+
+    baseclustersFile = settings.getOutputPath();
+    baseclustersFile.append("baseclusters.txt");
+
+    anchorpointsFile = settings.getOutputPath();
+    anchorpointsFile.append("anchorpoints.txt");
+
+    mplpairsFile = settings.getOutputPath();
+    mplpairsFile.append("multiplicon_pairs.txt");
+
+    segmentsFile = settings.getOutputPath();
+    segmentsFile.append("segments.txt");
+
+    listElementsFile = settings.getOutputPath();
+    listElementsFile.append("list_elements.txt");
+
+    alignmentFile = settings.getOutputPath();
+    alignmentFile.append("alignment.txt");
+
+    synthenicCloudsFile = settings.getOutputPath();
+    synthenicCloudsFile.append("clouds.txt");
+
+    cloudAnchorPointsFile = settings.getOutputPath();
+    cloudAnchorPointsFile.append("cloudAP.txt");
+}
 
+void DataSet::flushCollinear(const vector<Multiplicon*>& mplicons)
+{
      /**
     * Creating multiplicons.txt
     */
 
-    ofs.open(multipliconsFile.c_str(), ios::app);
-    if (!ofs) {
-        cerr << "Error creating file " << multipliconsFile << endl;
-    } else {
-        for (unsigned int i = 0; i < evaluated_multiplicons.size(); i++) {
-            Multiplicon &mpl = *evaluated_multiplicons[i];
+    if (multipliconsOfs) {
+        ofstream &ofs = multipliconsOfs;
+        for (unsigned int i = 0; i < mplicons.size(); i++) {
+            Multiplicon &mpl = *mplicons[i];
 
             ofs << mpl.getId() << '\t';
             if (mpl.getLevel() == 2) {
@@ -506,35 +520,31 @@ void DataSet::flushCollinear()
                 ofs << "-1";
             else
                 ofs << "0";
-            ofs << endl;
+            ofs << '\n';
         }
     }
 
-    ofs.close();
-
     /**
     * Creating baseclusters.txt
     */
 
     // give all baseclusters a unique id
-    for (unsigned int i = 0; i < evaluated_multiplicons.size(); i++) {
-        Multiplicon &mpl = *evaluated_multiplicons[i];
+    for (unsigned int i = 0; i < mplicons.size(); i++) {
+        Multiplicon &mpl = *mplicons[i];
         for (unsigned int j = 0; j < mpl.getBaseClusters().size(); j++)
             mpl.getBaseClusters()[j]->setID(baseclusterID++);
     }
 
-    ofs.open(baseclustersFile.c_str(), ios::app);
-    if (!ofs) {
-        cerr << "Error creating file " << baseclustersFile << endl;
-    } else {
-        for (unsigned int i = 0; i < evaluated_multiplicons.size(); i++) {
-            Multiplicon &mpl = *evaluated_multiplicons[i];
+    if (baseclustersOfs) {
+        ofstream &ofs = baseclustersOfs;
+        for (unsigned int i = 0; i < mplicons.size(); i++) {
+            Multiplicon &mpl = *mplicons[i];
 
             for (unsigned int j = 0; j < mpl.getBaseClusters().size(); j++) {
                 BaseCluster* basecluster = mpl.getBaseClusters()[j];
 
                 ofs << basecluster->getID() << '\t';
-                ofs << evaluated_multiplicons[i]->getId() << '\t';
+                ofs << mplicons[i]->getId() << '\t';
                 ofs << basecluster->getCountAnchorPoints() << '\t';
                 if (basecluster->getOrientation())
                     ofs << "+" << '\t';
@@ -545,34 +555,30 @@ void DataSet::flushCollinear()
                 else
                     ofs << "0" << '\t';
                 ofs << basecluster->getRandomProbability();
-                ofs << endl;
+                ofs << '\n';
             }
         }
     }
 
-    ofs.close();
-
 
     /**
     * Creating anchorpoints.txt
     */
 
-    ofs.open(anchorpointsFile.c_str(), ios::app);
-    if (!ofs) {
-        cerr << "Error creating file " << anchorpointsFile << endl;
-    } else {
-        for (unsigned int i = 0; i < evaluated_multiplicons.size(); i++) {
-            Multiplicon &mpl = *evaluated_multiplicons[i];
+    if (anchorpointsOfs) {
+        ofstream &ofs = anchorpointsOfs;
+        for (unsigned int i = 0; i < mplicons.size(); i++) {
+            Multiplicon &mpl = *mplicons[i];
 
             for (unsigned int j = 0; j < mpl.getBaseClusters().size(); j++) {
                 BaseCluster* basecluster = mpl.getBaseClusters()[j];
 
-                multiset<AnchorPoint>::const_iterator e = basecluster->getAPBegin();
+                vector<AnchorPoint>::const_iterator e = basecluster->getAPBegin();
                 for ( ; e != basecluster->getAPEnd(); e++) {
                     const AnchorPoint& anchorpoint = *e;
 
                     ofs << anchorpointID << '\t';
-                    ofs << evaluated_multiplicons[i]->getId() << '\t';
+                    ofs << mplicons[i]->getId() << '\t';
                     ofs << basecluster->getID() << '\t';
                     const Gene &geneX = getGene(anchorpoint.getGeneXID());
                     const Gene &geneY = getGene(anchorpoint.getGeneYID());
@@ -584,7 +590,7 @@ void DataSet::flushCollinear()
                         ofs << "-1";
                     else
                         ofs << "0";
-                    ofs << endl;
+                    ofs << '\n';
 
                     anchorpointID++;
                 }
@@ -592,18 +598,14 @@ void DataSet::flushCollinear()
         }
     }
 
-    ofs.close();
-
     /**
     * Creating multiplicon_pairs.txt
     */
 
-    ofs.open(mplpairsFile.c_str(), ios::app);
-    if (!ofs) {
-        cerr << "Error creating file " << mplpairsFile << endl;
-    } else {
-        for (unsigned int i = 0; i < evaluated_multiplicons.size(); i++) {
-            const Profile *profile = evaluated_multiplicons[i]->getProfile();
+    if (mplpairsOfs) {
+        ofstream &ofs = mplpairsOfs;
+        for (unsigned int i = 0; i < mplicons.size(); i++) {
+            const Profile *profile = mplicons[i]->getProfile();
 
             set<Link>::const_iterator it = profile->getHomBegin();
             for ( ; it != profile->getHomEnd(); it++) {
@@ -616,30 +618,22 @@ void DataSet::flushCollinear()
                     code += 1;
                 const Gene &geneX = getGene(it->geneXID);
                 const Gene &geneY = getGene(it->geneYID);
-                ofs << pairID++ << "\t" << evaluated_multiplicons[i]->getId()
+                ofs << pairID++ << "\t" << mplicons[i]->getId()
                     << "\t" << geneX.getID() << "\t" << geneY.getID() << "\t"
-                    << code << endl;
+                    << code << '\n';
             }
         }
     }
 
-    ofs.close();
-
     /**
     * Creating segments.txt and list_elements.txt
     */
 
-    seg.open(segmentsFile.c_str(), ios::app);
-    le.open(listElementsFile.c_str(), ios::app);
-
-    if (!seg || !le) {
-        if (!seg)
-            cerr << "Error creating file " << segmentsFile << endl;
-        if (!le)
-            cerr << "Error creating file " << listElementsFile << endl;
-    } else {
-        for (unsigned int i = 0; i < evaluated_multiplicons.size(); i++) {
-            Multiplicon &mpl = *evaluated_multiplicons[i];
+    if (segmentsOfs && listElementsOfs) {
+        ofstream &seg = segmentsOfs;
+        ofstream &le = listElementsOfs;
+        for (unsigned int i = 0; i < mplicons.size(); i++) {
+            Multiplicon &mpl = *mplicons[i];
 
             try {
                 mpl.align(settings.getAlignmentMethod(),
@@ -677,7 +671,7 @@ void DataSet::flushCollinear()
                             le << "+";
                         else
                             le << "-";
-                        le << endl;
+                        le << '\n';
 
                         if (element->getGene().getCoordinate() < first->getCoordinate()) {
                             first = &element->getGene();
@@ -691,13 +685,13 @@ void DataSet::flushCollinear()
                 }
 
                 seg << segmentID << '\t';
-                seg << evaluated_multiplicons[i]->getId() << '\t';
+                seg << mplicons[i]->getId() << '\t';
                 seg << segment.getGenomeName() << '\t';
                 seg << segment.getListName() << '\t';
                 seg << first->getID() << '\t';
                 seg << last->getID() << '\t';
                 seg << order;
-                seg << endl;
+                seg << '\n';
 
                 segmentID++;
                 order++;
@@ -705,106 +699,119 @@ void DataSet::flushCollinear()
         }
     }
 
-    seg.close();
-    le.close();
-
     if (settings.showAlignedProfiles())
-           visualizeAlignedProfiles();
+           visualizeAlignedProfiles(mplicons);
     //NOTE only for debugging purposes
     //  printProfiles();
 
 }
 
-void DataSet::flushClouds()
+void DataSet::flushClouds(const vector<SynthenicCloud*>& sclouds)
 {
-    ofstream ofs;
-
         /**
         * Creating clouds.txt
         */
 
         // give all clouds a unique id
-        for (unsigned int i = 0; i < clouds.size(); i++)
+        for (unsigned int i = 0; i < sclouds.size(); i++)
         {
-            clouds[i]->setID(cloudID++);
+            sclouds[i]->setID(cloudID++);
         }
-        ofs.open(synthenicCloudsFile.c_str(), ios::app);
-        if (!ofs) {
-            cerr << "Error creating file " << synthenicCloudsFile << endl;
-        } else {
+        if (cloudsOfs) {
+            ofstream &ofs = cloudsOfs;
 
-            for (int i=0; i<clouds.size(); i++) {
+            for (int i=0; i<sclouds.size(); i++) {
 
-                    int xID = clouds[i]->getXObjectID();
-                    int yID = clouds[i]->getYObjectID();
+                    int xID = sclouds[i]->getXObjectID();
+                    int yID = sclouds[i]->getYObjectID();
 
                     const GeneList& xlist=*genelists[xID];
                     const GeneList& ylist=*genelists[yID];
 
-                    ofs << clouds[i]->getID()                 <<"\t";
-                    ofs << xlist.getGenomeName()              <<"\t";
-                    ofs << xlist.getListName()                <<"\t";
-                    ofs << ylist.getGenomeName()              <<"\t";
-                    ofs << ylist.getListName()                <<"\t";
-                    ofs << clouds[i]->getCountAnchorPoints()  <<"\t";
-                    ofs << clouds[i]->calculateCloudDensity() <<"\t";
-                    ofs << clouds[i]->calculateBoxWidth()     <<"\t";
-                    ofs << clouds[i]->calculateBoxHeight()    << endl;
+                    ofs << sclouds[i]->getID()                 <<"\t";
+                    ofs << xlist.getGenomeName()               <<"\t";
+                    ofs << xlist.getListName()                 <<"\t";
+                    ofs << ylist.getGenomeName()               <<"\t";
+                    ofs << ylist.getListName()                 <<"\t";
+                    ofs << sclouds[i]->getCountAnchorPoints()  <<"\t";
+                    ofs << sclouds[i]->calculateCloudDensity() <<"\t";
+                    ofs << sclouds[i]->calculateBoxWidth()     <<"\t";
+                    ofs << sclouds[i]->calculateBoxHeight()    << '\n';
             }
         }
-        ofs.close();
 
         /**
         * Creating cloudAP.txt
         */
-        ofs.open(cloudAnchorPointsFile.c_str(), ios::app);
-        if (!ofs) {
-            cerr << "Error creating file " << cloudAnchorPointsFile << endl;
-        } else {
+        if (cloudAnchorPointsOfs) {
+            ofstream &ofs = cloudAnchorPointsOfs;
 
             vector<AnchorPoint>::const_iterator it;
 
-            for (int i=0; i<clouds.size(); i++) {
+            for (int i=0; i<sclouds.size(); i++) {
 
-                int xID = clouds[i]->getXObjectID();
-                int yID = clouds[i]->getYObjectID();
+                int xID = sclouds[i]->getXObjectID();
+                int yID = sclouds[i]->getYObjectID();
 
                 GeneList& xlist=*genelists[xID];
                 GeneList& ylist=*genelists[yID];
 
-                it=clouds[i]->getAPBegin();
+                it=sclouds[i]->getAPBegin();
 
-                for (; it!=clouds[i]->getAPEnd(); it++) {
+                for (; it!=sclouds[i]->getAPEnd(); it++) {
 
-                    ofs << clouds[i]->getID() << "\t";
+                    ofs << sclouds[i]->getID() << "\t";
                     ofs << xlist.getGeneName(it->getX()) <<"\t";
                     ofs << ylist.getGeneName(it->getY()) <<"\t";
                     ofs << it->getX()         << "\t";
-                    ofs << it->getY()         << endl;
+                    ofs << it->getY()         << '\n';
 
                 }
             }
         }
+}
 
-        ofs.close();
+vector<string> DataSet::getFlushedFiles() const
+{
+    vector<string> files;
+
+    if (settings.getClusterType() != Cloud) {
+        files.push_back(multipliconsFile);
+        files.push_back(baseclustersFile);
+        files.push_back(anchorpointsFile);
+        files.push_back(mplpairsFile);
+        files.push_back(segmentsFile);
+        files.push_back(listElementsFile);
+    }
+
+    if (settings.getClusterType() != Collinear) {
+        files.push_back(synthenicCloudsFile);
+        files.push_back(cloudAnchorPointsFile);
+    }
+
+    return files;
 }
 
-void DataSet::flushOutput()
+vector<ofstream*> DataSet::getFlushedStreams()
 {
-    cout << "Flushing output files...";
-    switch (settings.getClusterType()) {
-        case Collinear:
-            flushCollinear();
-            break;
-        case Cloud:
-            flushClouds();
-            break;
-        case Hybrid:
-            flushCollinear();
-            flushClouds();
-            break;
+    // in the order of getFlushedFiles
+    vector<ofstream*> streams;
+
+    if (settings.getClusterType() != Cloud) {
+        streams.push_back(&multipliconsOfs);
+        streams.push_back(&baseclustersOfs);
+        streams.push_back(&anchorpointsOfs);
+        streams.push_back(&mplpairsOfs);
+        streams.push_back(&segmentsOfs);
+        streams.push_back(&listElementsOfs);
     }
-    cout << "done." << endl;
+
+    if (settings.getClusterType() != Collinear) {
+        streams.push_back(&cloudsOfs);
+        streams.push_back(&cloudAnchorPointsOfs);
+    }
+
+    return streams;
 }
 
 void DataSet::outputGenes()
@@ -1249,15 +1256,15 @@ void DataSet::statistics()
 }
 
 
-void DataSet::visualizeAlignedProfiles()
+void DataSet::visualizeAlignedProfiles(const vector<Multiplicon*>& mplicons)
 {
     cout << "Visualize AlignedProfiles" << endl;
     char buffer[50];
 
     string tempfilename=settings.getOutputPath()+"AlignmentMultiplicon";
 
-    for (int i=0; i<evaluated_multiplicons.size(); i++) {
-        Multiplicon& multiplicon=*evaluated_multiplicons[i];
+    for (int i=0; i<mplicons.size(); i++) {
+        Multiplicon& multiplicon=*mplicons[i];
 
         try {
                 multiplicon.align(settings.getAlignmentMethod(),
@@ -1270,7 +1277,7 @@ void DataSet::visualizeAlignedProfiles()
         int id=multiplicon.getId();
         sprintf(buffer,"%i.svg",multiplicon.getId());
         string filename=tempfilename+string(buffer);
-        AlignmentDrawer drawer(evaluated_multiplicons[i]->getProfile());
+        AlignmentDrawer drawer(mplicons[i]->getProfile());
         bool succes=drawer.buildColorMatrix(this,settings.getTandemGap());
         drawer.visualizeConflicts=true;
         if (succes){
@@ -10,7 +10,11 @@ class ListElement;
 class Gene;
 class Profile;
 class GHMProfile;
+class GHM;
 class ListFile;
+class MappedFile;
+class TaskScheduler;
+class CostModel;
 
 class PackingTest;
 class GapsTest;
@@ -21,10 +25,13 @@ class DataSet;
 
 #include "headers.h"
 #include "alignComp.h"
+#include "datastructures/StringTable.h"
+#include "HomologPointCache.h"
 
 #include <stdint.h>
 
 extern "C" void* startThread(void *args);
+extern "C" void* startOutputWriter(void *args);
 
 typedef uint64_t lluint;
 
@@ -71,15 +78,14 @@ public:
 
     /**
      * Run a portion of the level-2 ADHoRe in thread-safe manner
-     * @param beginX First x-index of the genelist to consider
-     * @param beginY First y-index of the genelist to consider
-     * @param nItem Number of items to process
+     * @param firstItem First list pair in level2Tasks to consider
+     * @param nItem Number of list pairs to process
      * @param output Found multiplicons (output)
      */
     void level2ADHoRe(int firstItem, int nItems, int threadID,
                       vector<Multiplicon*> &output, vector<SynthenicCloud*>& scl_output) const;
 
-    void wakeThreads();
+    void wakeThreads() const;
 
     void finishWorkPacket();
 
@@ -91,18 +97,13 @@ public:
     void parallelLevel2ADHoReDyn();
 
     /**
-     * Get some workload to process in a thread
+     * Get some workload to process in a thread from the task scheduler
      * @param firstItem First item to process (output)
      * @param nItem Number of items to process (output)
+     * @param threadID Identifier of the thread, 0 is the master thread
      * @return True if there is still work to perform, false otherwise
      */
-    bool getSomeWorkHL(int &firstItem, int &nItems, int threadID,
-                     bool augmentWIP, bool getSmallWP = false);
-
-    bool getSomeWorkL2(int &firstItem, int &nItems, int threadID,
-                       bool augmentWIP, bool getSmallWP = false);
-
-    //bool getSomeWorkL2(int threadID, bool augmentWIP);
+    bool getSomeWork(int &firstItem, int &nItems, int threadID);
 
     /*
     *detects higher level multiplicons by creating profiles from each multiplicon
@@ -115,7 +116,8 @@ public:
     void output();
 
     /**
-     * Flushes the output so far into text files
+     * Hands the output so far to the output writer thread, which writes it
+     * into text files
      */
     void flushOutput();
 
@@ -124,11 +126,24 @@ public:
      */
     void prepareOutput();
 
+    /**
+     * Set the names of the output files
+     */
+    void setOutputFileNames();
+
     /**
      * Output the genes.txt output file
      */
     void outputGenes();
 
+    /**
+     * Restore the state of the profile detection from the checkpoint given
+     * by resume_from instead of detecting the level-2 multiplicons, process
+     * 0 truncates the output files to their size at the time of the
+     * checkpoint
+     */
+    void readCheckpoint();
+
     /*
     *produces a log file with general statistics
     */
@@ -157,16 +172,165 @@ public:
 
     void (DataSet::*workFunction)(int firstItem, int nItems, int nThreads,
                                   vector<Multiplicon*> & mpl_output, vector<SynthenicCloud*>& scl_output) const;
-    bool (DataSet::*getSomeWorkFunction)(int &firstItem, int &nItems, int threadID,
-                                 bool augmentWIP, bool getSmallWP);
 
     GeneList* getGeneList(const string& listName, const string& genomeName) const;
     
 private:
+    // a profile search that was done ahead of the evaluation of the
+    // multiplicon, the results for a genelist are valid as long as its
+    // masking did not change
+    struct PrefetchedSearch {
+        // found multiplicons per position of indexToList
+        vector<vector<Multiplicon*> > found;
+        // mask version of every genelist at the time of the search
+        vector<unsigned int> maskVersions;
+    };
+
+    // evaluated multiplicons and clouds that await the output writer
+    struct OutputBatch {
+        vector<Multiplicon*> multiplicons;
+        vector<SynthenicCloud*> clouds;
+    };
+
     ///////////////////
     //PRIVATE METHODS//
     ///////////////////
 
+    /**
+     * Search the profile of an evaluated multiplicon against all genelists,
+     * the profiles of the next multiplicons in the evaluation queue are
+     * searched along with it and kept in prefetchedSearches
+     * @param multiplicon Evaluated multiplicon
+     * @param target Found multiplicons (output)
+     */
+    void searchProfile(const Multiplicon& multiplicon,
+                       vector<Multiplicon*>& target);
+
+    /**
+     * Complete a profile search that was done ahead, the genelists whose
+     * masking changed since are searched again
+     * @param profile Profile of the evaluated multiplicon
+     * @param prefetch Results of the search done ahead, these are either
+     * moved to target or deleted
+     * @param target Found multiplicons (output)
+     */
+    void completePrefetchedSearch(const Profile& profile,
+                                  PrefetchedSearch& prefetch,
+                                  vector<Multiplicon*>& target);
+
+    /**
+     * Assign every gene in the gene lists its interned numerical ID
+     */
+    void internGeneIDs();
+
+    /**
+     * Computes the key of the dataset cache from the settings that affect
+     * the gene lists and their remapping and from the size and
+     * modification time of the input files
+     */
+    uint64_t getCacheKey() const;
+
+    /**
+     * Computes a key of all settings that affect the level-2 multiplicons
+     * and clouds and the profile detection, a checkpoint can only be
+     * resumed with the same settings
+     */
+    uint64_t getSettingsKey() const;
+
+    /**
+     * Returns the name of the dataset cache file for the current settings
+     */
+    string getCacheFileName() const;
+
+    /**
+     * Creates the gene lists from the dataset cache, with the gene pairs
+     * or families and the tandem remapping already applied
+     * @return False if there is no valid cache for the current settings
+     */
+    bool loadCache();
+
+    /**
+     * Writes the gene lists, gene pairs or families and the tandem
+     * remapping to the dataset cache
+     */
+    void saveCache() const;
+
+    /**
+     * Creates the level-2 cache directory, computes the content hash of
+     * every gene list and indexes the cache files of earlier runs
+     */
+    void prepareLevel2Cache();
+
+    /**
+     * Unmaps the level-2 cache files and clears their index
+     */
+    void releaseLevel2Files();
+
+    /**
+     * Computes the key of the level-2 cache entry of a list pair from the
+     * content hashes of both gene lists, their homologous points and the
+     * level-2 parameters
+     * @param task Index of the list pair in level2Tasks
+     */
+    uint64_t getLevel2Key(int task) const;
+
+    /**
+     * Adds the multiplicons and clouds of a list pair from the level-2 cache
+     * @param task Index of the list pair in level2Tasks
+     * @param key Key of the list pair, see getLevel2Key
+     * @return False if the cache holds no valid entry for the key
+     */
+    bool loadLevel2Result(int task, uint64_t key,
+                          vector<Multiplicon*>& mplicons,
+                          vector<SynthenicCloud*>& clouds) const;
+
+    /**
+     * Keeps the multiplicons and clouds of a computed list pair for the
+     * level-2 cache, see writeLevel2Cache
+     * @param task Index of the list pair in level2Tasks
+     * @param key Key of the list pair, see getLevel2Key
+     */
+    void saveLevel2Result(int task, uint64_t key,
+                          const vector<Multiplicon*>& mplicons,
+                          const vector<SynthenicCloud*>& clouds) const;
+
+    /**
+     * Writes the list pairs computed by this process that are not cached
+     * yet to a single level-2 cache file and releases the cache files
+     */
+    void writeLevel2Cache();
+
+    /**
+     * Returns the output files that are appended to by flushOutput
+     */
+    vector<string> getFlushedFiles() const;
+
+    /**
+     * Returns the streams of the files returned by getFlushedFiles
+     */
+    vector<std::ofstream*> getFlushedStreams();
+
+    /**
+     * Write the state of the profile detection to the checkpoint file: the
+     * multiplicons to evaluate, the masking of the genelists, the ID
+     * counters and the size of the output files. The evaluated multiplicons
+     * should have been flushed and no work ahead should be pending.
+     */
+    void writeCheckpoint() const;
+
+    /**
+     * Returns true if a checkpoint should be written, all processes agree
+     * @param nextCheckpoint Time at which the next checkpoint is due
+     */
+    bool checkpointDue(double nextCheckpoint) const;
+
+    /**
+     * Drop the alignments and profile searches done ahead of the evaluation
+     * of the multiplicons, the multiplicons are restored to their state
+     * before the alignment
+     */
+    void discardWorkAhead();
+
     /**
      * Check whether a portion of a gene list is completely masked
      * @param list Reference to the list under consideration
@@ -195,17 +359,48 @@ private:
     void sortByMultipliconSize(vector<Multiplicon*>& multiplicons) const;
 
     /**
-     * Search a profile against a number of genelists
-     * @param firstItem First genelist to consider
+     * Search the profiles in searchProfiles against a number of genelists,
+     * the found multiplicons are stored in searchResults
+     * @param firstItem First genelist to consider (index in searchPositions)
      * @param nItem Number of genelists to consider
-     * @param target Vector to store the found multiplicons (output)
+     * @param target Unused, the results are stored per profile and genelist
      * @param dummyVar this variable is just added to make be compatible with function pointer
      */
     void profileSearch (int firstItem, int nItems, int threadID,
                         vector<Multiplicon*>& target, vector<SynthenicCloud*>& dummyVar) const;
 
-    void parallelProfileSearch(const Profile *profile,
-                               vector<Multiplicon*>& target);
+    /**
+     * Search a number of profiles against the genelists at the given
+     * positions of indexToList on this process, with all threads
+     * @param profiles Profiles to search with
+     * @param positions Positions in indexToList of the genelists
+     * @param found Multiplicons found by profile j in the genelist at
+     * positions[p] are stored in found[p * #profiles + j] (output)
+     */
+    void searchGeneLists(const vector<const Profile*>& profiles,
+                         const vector<int>& positions,
+                         vector<vector<Multiplicon*> >& found);
+
+    /**
+     * Search a number of profiles against all genelists, every process
+     * searches its own part of the genelists and the results are exchanged
+     * @param profiles Profiles to search with
+     * @param found Multiplicons found by profile j in the genelist at
+     * position p of indexToList are stored in found[p * #profiles + j]
+     * (output)
+     */
+    void parallelProfileSearch(const vector<const Profile*>& profiles,
+                               vector<vector<Multiplicon*> >& found);
+
+    /**
+     * Select the next multiplicons in the evaluation queue whose profile can
+     * be searched along with the current one: they are aligned, pass the
+     * alignment check and are not masked, nor overlap each other
+     * @param maxProfiles Maximum number of multiplicons to select
+     * @param batch Selected multiplicons (output)
+     */
+    void selectSearchBatch(unsigned int maxProfiles,
+                           vector<Multiplicon*>& batch);
 
     //returns the size of the specified remapped genome
     int getRemappedGenomeSize(string genome);
@@ -226,7 +421,7 @@ private:
     /**
     * Visualize Alignments with AlignmentDrawer class (SVG)
     */
-    void visualizeAlignedProfiles();
+    void visualizeAlignedProfiles(const vector<Multiplicon*>& mplicons);
 
     /**
     * Prints profiles via GeneID followed by links (txt format)
@@ -235,23 +430,121 @@ private:
 
     uint getProcForPackage(const vector<uint64_t> &weightPerProc);
 
+    /**
+     * Count the homologous points in every level-2 GHM from the inverted
+     * homolog indices of the genelists, without building the GHMs
+     * @param points Number of points of GHM(x, y), x <= y, stored under key
+     * x * #genelists + y, GHMs without points are absent (output)
+     */
+    void countHomologousPoints(hash_map<lluint, lluint>& points) const;
+
+    /**
+     * Refit the cost model to the measured level-2 GHM times of all
+     * processes and write it to the cost model file
+     */
+    void calibrateCostModel(CostModel& model) const;
+
+    /**
+     * Process the level-2 list pairs in packages that are handed out on
+     * demand by a shared counter on process 0, heaviest list pairs first
+     * @param weights Predicted cost of every list pair in level2Tasks
+     */
+    void dynamicLevel2Packages(const vector<lluint>& weights);
+
+    /**
+     * Runs a GHM split in x-bands on the thread pool
+     * @param ghm GHM of a list pair in level2Split
+     */
+    void runBanded(GHM& ghm) const;
+
+    /**
+     * Processes the bands of a split GHM on the thread pool. The bands are
+     * queued for the idle worker threads and the calling thread processes
+     * bands until all of them are done
+     * @param bands GHMs of the bands
+     */
+    void runBands(const vector<GHM*>& bands) const;
+
+    /**
+     * Processes one queued band of a split GHM, if there is any
+     * @return True if a band was processed
+     */
+    bool runPendingBand() const;
+
     void runWorkFunction(int firstItem, int nItems, int threadID,
                          vector<Multiplicon*> &multiplicons, vector<SynthenicCloud*>& clouds) {
         (this->*workFunction)(firstItem, nItems, threadID, multiplicons,clouds);
     }
 
-    bool runGetSomeWork(int &firstItem, int &nItems, int threadID,
-                        bool augmentWIP, bool getSmallWP = false) {
-        return (this->*getSomeWorkFunction)(firstItem, nItems, threadID,
-                                    augmentWIP, getSmallWP);
-    }
+    /**
+     * Process tasks until the scheduler runs out of work, the results are
+     * stored in the result vectors of the thread
+     * @param threadID Identifier of the thread, 0 is the master thread
+     */
+    void runTasks(int threadID);
+
+    /**
+     * Append the results of all threads to localMultiplicons and
+     * localClouds, in task order
+     */
+    void collectTaskResults();
+
+    /**
+     * Hand out a new set of tasks to the threads, the speculative
+     * alignments in alignTasks are appended to the given tasks
+     * @param weights Estimated cost of every task
+     */
+    void distributeTasks(vector<lluint> weights);
+
+    /**
+     * Select the next multiplicons in the evaluation queue that are not
+     * aligned yet and will need an alignment, as far as the current masking
+     * tells, and store them in alignTasks
+     * @param maxTasks Maximum number of multiplicons to select
+     */
+    void selectAlignTasks(unsigned int maxTasks);
+
+    /**
+     * Create and align the profile of a multiplicon in alignTasks ahead of
+     * its evaluation, a failed alignment is stored in alignErrors
+     * @param alignTask Index in alignTasks
+     */
+    void alignSpeculatively(int alignTask);
+
+    /**
+     * Returns true if the evaluation of a multiplicon involves aligning it
+     * under the current masking of its y-list
+     */
+    bool needsAlignment(const Multiplicon& multiplicon);
 
     void createThreadPool();
     void destroyThreadPool();
 
 
-    void flushCollinear();
-    void flushClouds();
+    /**
+     * Opens the output files and starts the output writer thread
+     */
+    void createOutputWriter();
+
+    /**
+     * Waits until the output writer has written all batches and flushed
+     * the output files
+     */
+    void drainOutput();
+
+    /**
+     * Writes the remaining batches, stops the output writer thread and
+     * closes the output files
+     */
+    void destroyOutputWriter();
+
+    /**
+     * Writes and deletes the queued batches until the writer is stopped
+     */
+    void runOutputWriter();
+
+    void flushCollinear(const vector<Multiplicon*>& mplicons);
+    void flushClouds(const vector<SynthenicCloud*>& sclouds);
 
     int max(int a, int b) {
         return (a > b) ? a : b;
@@ -282,36 +575,76 @@ private:
     //vector containing all multiplicons that have been evaluated
     vector<Multiplicon*> evaluated_multiplicons;
 
-    vector<Multiplicon *> masterTMultiplicons;
-    vector<SynthenicCloud*> masterTClouds;
-
     GenePairs *genepairs;
 
+    // memory mapped dataset cache, NULL if the dataset was parsed
+    MappedFile *cacheFile;
+
+    // interning table for the gene names
+    StringTable geneIDTable;
+
     // threading information
 
     pthread_t *threads;
     ThreadArgs *threadArgs;
-    pthread_cond_t workerCond, masterCond;
-    pthread_mutex_t workerMutex, queueMutex, mpcMutex;
-
-    // load balancing parameters
-    double packagePerc;
-    double minPackagePerc;
-
-    lluint totalWeight;
-    lluint weightSoFar;
-    lluint minWeight;
-
-    // level 2 load balancing variables
-    uint cX, cY;
-    std::vector<lluint> weightPerProc;
+    mutable pthread_cond_t workerCond;
+    pthread_cond_t masterCond;
+    mutable pthread_mutex_t workerMutex;
+    pthread_mutex_t wipMutex;
+
+    // work-stealing scheduler of the tasks in the current work packet
+    TaskScheduler *scheduler;
+    // task i processes item taskOffset + i
+    int taskOffset;
+    // results of every thread, tagged with the task that found them
+    std::vector<std::pair<int, Multiplicon*> > *taskMultiplicons;
+    std::vector<std::pair<int, SynthenicCloud*> > *taskClouds;
+    // number of regular tasks in the current work packet, the speculative
+    // alignments of alignTasks follow them
+    int numWorkTasks;
+    std::vector<Multiplicon*> alignTasks;
+    std::vector<std::string> alignErrors;
+    // multiplicons that were aligned ahead of their evaluation, with the
+    // error message of a failed alignment (empty on success)
+    std::map<const Multiplicon*, std::string> alignedMultiplicons;
+
+    // level 2 list pairs to process on this process (all list pairs with
+    // dynamic load balancing), with their number of homologous points and
+    // measured wall time (negative if not processed by this process)
+    std::vector<std::pair<uint, uint> > level2Tasks;
+    std::vector<lluint> level2Points;
+    mutable std::vector<double> level2Times;
+    // list pairs that are split in x-bands over all threads
+    std::vector<bool> level2Split;
+    // queued bands of split GHMs, with the number of unfinished bands of
+    // their GHM, the thread that queued them waits on bandCond
+    mutable std::deque<std::pair<GHM*, int*> > bandQueue;
+    mutable pthread_mutex_t bandMutex;
+    mutable pthread_cond_t bandCond;
+    // list pairs that were taken from the level-2 cache, one char per list
+    // pair so that the threads can set them concurrently
+    mutable std::vector<char> level2Cached;
+    // content hash of every gene list for the level-2 cache
+    std::vector<uint64_t> level2ListKeys;
+    // mapped level-2 cache files and the results of the list pairs in them
+    // by key (NULL and 0 for a list pair without results)
+    std::vector<MappedFile*> level2Files;
+    std::map<uint64_t, std::pair<const char*, size_t> > level2Index;
+    // key and packed results of the list pairs that were computed for the
+    // level-2 cache, written by the thread that processes the list pair
+    mutable std::vector<uint64_t> level2Keys;
+    mutable std::vector<std::vector<char> > level2Results;
+    mutable std::vector<char> level2Computed;
+    // position of every list pair in the walk over the list pair matrix,
+    // the order in which the results are stored
+    std::vector<int> level2Items;
     std::vector<uint> indexToList;
-    std::vector<std::pair<uint, uint> > *workForThread;
 
-    // higher level load balancing variables
-    int currentIndex, finalIndex;
     vector<Multiplicon*> localMultiplicons;
     vector<SynthenicCloud*> localClouds;
+    // item that found every local multiplicon and cloud
+    vector<int> localMultipliconItems;
+    vector<int> localCloudItems;
 
     int workInProgress;
     bool destroyTP;
@@ -329,7 +662,18 @@ private:
     // aux map for mapping between geneID and the gene itself
     map<int, GeneList*> geneIDmap;
 
-    const Profile *profileUC;
+    // profiles searched in the current work packet, task k searches the
+    // genelist at position searchPositions[k] of indexToList with all of
+    // them and stores the results in searchResults[k * #profiles + j]
+    vector<const Profile*> searchProfiles;
+    vector<int> searchPositions;
+    mutable vector<vector<Multiplicon*> > searchResults;
+    // homologous positions per genelist, a genelist is searched by one
+    // task at a time
+    mutable vector<HomologPointCache> homologCaches;
+
+    // searches done ahead of the evaluation of the multiplicons
+    std::map<const Multiplicon*, PrefetchedSearch> prefetchedSearches;
 
     // output files
     std::string geneFile;
@@ -343,6 +687,22 @@ private:
     std::string synthenicCloudsFile;
     std::string cloudAnchorPointsFile;
 
+    // output files that are appended to while the writer thread runs
+    std::ofstream multipliconsOfs, baseclustersOfs, anchorpointsOfs;
+    std::ofstream mplpairsOfs, segmentsOfs, listElementsOfs;
+    std::ofstream cloudsOfs, cloudAnchorPointsOfs;
+    std::vector<std::vector<char> > outputBuffers;
+
+    // the output writer thread takes the batches from the front of the
+    // queue, flushOutput waits while it is full
+    pthread_t outputThread;
+    pthread_mutex_t outputMutex;
+    pthread_cond_t outputCond, outputDoneCond;
+    std::deque<OutputBatch> outputQueue;
+    bool outputBusy;
+    bool stopOutput;
+
+    uint profileID;
     uint multipliconID;
     uint baseclusterID;
     uint anchorpointID;
@@ -355,8 +715,11 @@ private:
 
     friend class PackingTest;
     friend class GapsTest;
+    friend class DataSetCacheTest;
+    friend class CheckpointTest;
 
     friend void* startThread(void *args);
+    friend void* startOutputWriter(void *args);
 
     int nThreads;   // number of spawned (i.e. extra) threads
 
@@ -0,0 +1,799 @@
+#include "DataSet.h"
+
+#include "GeneList.h"
+#include "GenePairs.h"
+#include "ListElement.h"
+#include "ListFile.h"
+#include "Gene.h"
+#include "MappedFile.h"
+#include "Multiplicon.h"
+#include "BaseCluster.h"
+#include "SynthenicCloud.h"
+#include "AnchorPoint.h"
+#include "Settings.h"
+#include "WireFormat.h"
+#include "parallel.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+/*
+ * Layout of the binary dataset cache (native byte order). The file starts
+ * with a CacheHeader, followed by these sections, each of which starts at
+ * a multiple of 8 bytes:
+ *
+ *   uint64_t nameOffsets[numGenes+1]      interned gene names
+ *   char     names[nameOffsets[numGenes]]
+ *   uint64_t famOffsets[numFamilies+1]    gene family names
+ *   char     famNames[famOffsets[numFamilies]]
+ *   uint32_t familyOf[numGenes]           family of every gene (family mode)
+ *   uint64_t pairOffsets[numGenes+1]      pairs of every gene (pairs mode)
+ *   uint32_t pairs[numPairs]
+ *   uint32_t listSizes[numLists]          number of genes per gene list
+ *   CacheElement elements[numElements]    genes of all gene lists in order
+ *
+ * The gene lists themselves (names, genomes and files) are taken from the
+ * settings, which are part of the cache key.
+ */
+
+// bump when the layout changes
+static const uint32_t CACHE_VERSION = 1;
+static const char CACHE_MAGIC[8] = {'i', 'A', 'D', 'H', 'C', 'A', 'C', 'H'};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t useFamily;
+    uint64_t key;
+    uint32_t numLists;
+    uint32_t numGenes;
+    uint32_t numFamilies;
+    uint32_t reserved;
+    uint64_t numPairs;
+    uint64_t numElements;
+} CacheHeader;
+
+// flags of a CacheElement
+static const uint32_t CACHE_ORIENTATION = 1;
+static const uint32_t CACHE_TANDEM = 2;
+static const uint32_t CACHE_REPRESENTATIVE = 4;
+static const uint32_t CACHE_REMAPPED = 8;
+
+typedef struct {
+    uint32_t geneID;
+    uint32_t flags;
+    int32_t representative;     // coordinate of the representative, or -1
+} CacheElement;
+
+static size_t align8(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+/*
+ * 64-bit FNV-1a hash
+ */
+static void hashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+static void hashString(uint64_t& hash, const string& str)
+{
+    // include the terminating zero to separate consecutive strings
+    hashBytes(hash, str.c_str(), str.size() + 1);
+}
+
+static void hashFile(uint64_t& hash, const string& fileName)
+{
+    hashString(hash, fileName);
+
+    struct stat sb;
+    int64_t meta[2] = {-1, -1};
+    if (stat(fileName.c_str(), &sb) == 0) {
+        meta[0] = sb.st_size;
+        meta[1] = sb.st_mtime;
+    }
+    hashBytes(hash, meta, sizeof(meta));
+}
+
+/*
+ * Writes a section followed by padding up to a multiple of 8 bytes
+ */
+static void writeSection(ofstream& ofs, const void* data, size_t size)
+{
+    static const char zeros[8] = {0};
+    if (size > 0)
+        ofs.write(static_cast<const char*>(data), size);
+    ofs.write(zeros, align8(size) - size);
+}
+
+/*
+ * Returns a pointer to the next section and advances the position, NULL if
+ * the section does not fit in the file
+ */
+static const char* readSection(const MappedFile& file, size_t& pos, size_t size)
+{
+    if (pos > file.getSize() || size > file.getSize() - pos ||
+        align8(size) > file.getSize() - pos)
+        return NULL;
+    const char* section = file.getData() + pos;
+    pos += align8(size);
+    return section;
+}
+
+/*
+ * Creates a directory and its parents
+ * @throw runtime_error If the directory cannot be created
+ */
+static void createDirectory(const string& dir)
+{
+    string command = "mkdir -p " + dir;
+    int status = system(command.c_str());
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw runtime_error("Cannot create directory " + dir);
+}
+
+/*
+ * Returns true if count+1 offsets start at zero, never decrease and end at
+ * size, i.e. if every range they delimit lies within the section
+ */
+static bool validOffsets(const uint64_t* offsets, uint64_t count, uint64_t size)
+{
+    if (offsets[0] != 0 || offsets[count] != size)
+        return false;
+    for (uint64_t i = 0; i < count; i++)
+        if (offsets[i] > offsets[i+1])
+            return false;
+    return true;
+}
+
+uint64_t DataSet::getCacheKey() const
+{
+    uint64_t key = 14695981039346656037ULL;
+
+    hashBytes(key, &CACHE_VERSION, sizeof(CACHE_VERSION));
+    int32_t tandemGap = settings.getTandemGap();
+    hashBytes(key, &tandemGap, sizeof(tandemGap));
+    char useFamily = settings.useFamily() ? 1 : 0;
+    hashBytes(key, &useFamily, sizeof(useFamily));
+
+    hashFile(key, settings.getBlastTable());
+
+    const list<ListFile> &listfiles = settings.getListFiles();
+    list<ListFile>::const_iterator it = listfiles.begin();
+    for ( ; it != listfiles.end(); it++) {
+        hashString(key, it->getGenomeName());
+        hashString(key, it->getListName());
+        hashFile(key, it->getFileName());
+    }
+
+    return key;
+}
+
+uint64_t DataSet::getSettingsKey() const
+{
+    uint64_t key = 14695981039346656037ULL;
+
+    // the parameters of the level-2 search and the profile detection
+    int32_t params[] = {(int32_t)settings.getClusterType(),
+                        settings.useFamily(), settings.level2Only(),
+                        settings.getGapSize(), settings.getClusterGap(),
+                        settings.getTandemGap(), settings.getAnchorPoints(),
+                        (int32_t)settings.getMultHypCorMethod(),
+                        settings.getCloudGapSize(),
+                        settings.getCloudClusterGap(),
+                        (int32_t)settings.getCloudFilterMethod(),
+                        settings.isBruteforce(),
+                        (int32_t)settings.getAlignmentMethod(),
+                        settings.getMaxGapsInAlignment(),
+                        settings.splitLargeGHMs()};
+    hashBytes(key, params, sizeof(params));
+    double q[] = {settings.getQValue(), settings.getProbCutoff()};
+    hashBytes(key, q, sizeof(q));
+
+    return key;
+}
+
+string DataSet::getCacheFileName() const
+{
+    char name[64];
+    sprintf(name, "dataset_%016llx.bin", (unsigned long long)getCacheKey());
+    return settings.getDatasetCache() + name;
+}
+
+bool DataSet::loadCache()
+{
+    const string fileName = getCacheFileName();
+
+    struct stat sb;
+    if (stat(fileName.c_str(), &sb) != 0)
+        return false;
+
+    MappedFile *file = new MappedFile(fileName, "dataset cache");
+
+    // validate the header and locate the sections
+    size_t pos = 0;
+    const CacheHeader *header = reinterpret_cast<const CacheHeader*>
+        (readSection(*file, pos, sizeof(CacheHeader)));
+    const list<ListFile> &listfiles = settings.getListFiles();
+    if (header == NULL || memcmp(header->magic, CACHE_MAGIC, 8) != 0 ||
+        header->version != CACHE_VERSION || header->key != getCacheKey() ||
+        header->useFamily != (settings.useFamily() ? 1u : 0u) ||
+        header->numLists != listfiles.size()) {
+        delete file;
+        return false;
+    }
+
+    uint64_t numGenes = header->numGenes;
+    uint64_t numFamilies = header->numFamilies;
+    uint64_t numPairs = header->numPairs;
+    uint64_t numElements = header->numElements;
+    bool useFamily = header->useFamily;
+
+    // counts that cannot fit in the file would overflow the section sizes
+    if (numPairs > file->getSize() || numElements > file->getSize()) {
+        cerr << "WARNING: Dataset cache " << fileName << " is truncated or "
+                "corrupt, rebuilding it" << endl;
+        delete file;
+        return false;
+    }
+
+    const uint64_t *nameOffsets = reinterpret_cast<const uint64_t*>
+        (readSection(*file, pos, (numGenes + 1) * sizeof(uint64_t)));
+    const char *names = (nameOffsets == NULL) ? NULL :
+        readSection(*file, pos, nameOffsets[numGenes]);
+    const uint64_t *famOffsets = reinterpret_cast<const uint64_t*>
+        (readSection(*file, pos, (numFamilies + 1) * sizeof(uint64_t)));
+    const char *famNames = (famOffsets == NULL) ? NULL :
+        readSection(*file, pos, famOffsets[numFamilies]);
+    const uint32_t *familyOf = reinterpret_cast<const uint32_t*>
+        (readSection(*file, pos, (useFamily ? numGenes : 0) * sizeof(uint32_t)));
+    const uint64_t *pairOffsets = reinterpret_cast<const uint64_t*>
+        (readSection(*file, pos, (useFamily ? 0 : numGenes + 1) * sizeof(uint64_t)));
+    const uint32_t *pairs = reinterpret_cast<const uint32_t*>
+        (readSection(*file, pos, numPairs * sizeof(uint32_t)));
+    const uint32_t *listSizes = reinterpret_cast<const uint32_t*>
+        (readSection(*file, pos, header->numLists * sizeof(uint32_t)));
+    const CacheElement *elements = reinterpret_cast<const CacheElement*>
+        (readSection(*file, pos, numElements * sizeof(CacheElement)));
+
+    bool valid = (names != NULL && famNames != NULL && familyOf != NULL &&
+                  pairOffsets != NULL && pairs != NULL && listSizes != NULL &&
+                  elements != NULL);
+
+    // every index in the body must point into the array it refers to
+    if (valid) {
+        valid = validOffsets(nameOffsets, numGenes, nameOffsets[numGenes]) &&
+                validOffsets(famOffsets, numFamilies, famOffsets[numFamilies]);
+    }
+    if (valid && useFamily) {
+        for (uint64_t g = 0; valid && g < numGenes; g++)
+            valid = familyOf[g] < numFamilies;
+    } else if (valid) {
+        valid = validOffsets(pairOffsets, numGenes, numPairs);
+        for (uint64_t p = 0; valid && p < numPairs; p++)
+            valid = pairs[p] < numGenes;
+    }
+
+    uint64_t sumSizes = 0;
+    for (uint32_t l = 0; valid && l < header->numLists; l++) {
+        for (uint64_t i = 0; valid && i < listSizes[l]; i++) {
+            if (sumSizes + i >= numElements) {
+                valid = false;
+                break;
+            }
+            const CacheElement &ce = elements[sumSizes + i];
+            valid = ce.geneID < numGenes && ce.representative >= -1 &&
+                    ce.representative < (int64_t)listSizes[l];
+        }
+        sumSizes += listSizes[l];
+    }
+
+    if (!valid || sumSizes != numElements) {
+        cerr << "WARNING: Dataset cache " << fileName << " is truncated or "
+                "corrupt, rebuilding it" << endl;
+        delete file;
+        return false;
+    }
+
+    // create the gene lists
+    genelists.reserve(listfiles.size());
+    list<ListFile>::const_iterator it = listfiles.begin();
+    uint64_t e = 0;
+    for (uint32_t l = 0; it != listfiles.end(); it++, l++) {
+        GeneList *genelist = new GeneList(it->getListName(),
+                                          it->getGenomeName(),
+                                          listSizes[l]);
+        genelists.push_back(genelist);
+        const string* genome = Gene::internName(it->getGenomeName());
+
+        for (uint32_t i = 0; i < listSizes[l]; i++, e++) {
+            const CacheElement &ce = elements[e];
+            uint32_t g = ce.geneID;
+            bool orientation = ce.flags & CACHE_ORIENTATION;
+
+            Gene gene (string(names + nameOffsets[g],
+                              nameOffsets[g+1] - nameOffsets[g]),
+                       genome, i, orientation);
+            gene.setInternID(g);
+            if (useFamily) {
+                uint32_t f = familyOf[g];
+                gene.setFamily(string(famNames + famOffsets[f],
+                                      famOffsets[f+1] - famOffsets[f]), f);
+            } else if (pairOffsets[g+1] > pairOffsets[g]) {
+                gene.setPairs(pairs + pairOffsets[g],
+                              pairOffsets[g+1] - pairOffsets[g]);
+            }
+            genelist->addGene(gene);
+        }
+
+        // restore the tandems once all genes of the list are in place
+        vector<ListElement*> &list = genelist->getElements();
+        e -= listSizes[l];
+        for (uint32_t i = 0; i < listSizes[l]; i++, e++) {
+            const CacheElement &ce = elements[e];
+            const Gene *rep = (ce.representative < 0) ? NULL :
+                &list[ce.representative]->getGene();
+            list[i]->getGene().restoreTandem(ce.flags & CACHE_TANDEM,
+                                             ce.flags & CACHE_REPRESENTATIVE,
+                                             ce.flags & CACHE_REMAPPED, rep);
+        }
+        genelist->restoreTandems(useFamily);
+    }
+
+    cacheFile = file;
+    return true;
+}
+
+void DataSet::saveCache() const
+{
+    createDirectory(settings.getDatasetCache());
+
+    bool useFamily = settings.useFamily();
+
+    // collect the gene names, families and elements
+    uint32_t numGenes = geneIDTable.size();
+    vector<uint64_t> nameOffsets(1, 0);
+    string names;
+    for (uint32_t g = 0; g < numGenes; g++) {
+        names.append(geneIDTable.getString(g));
+        nameOffsets.push_back(names.size());
+    }
+
+    vector<uint32_t> familyOf(useFamily ? numGenes : 0, 0);
+    vector<string> familyNames;
+    vector<uint32_t> listSizes;
+    vector<CacheElement> elements;
+    for (unsigned int l = 0; l < genelists.size(); l++) {
+        vector<ListElement*> &list = genelists[l]->getElements();
+        listSizes.push_back(list.size());
+
+        for (unsigned int i = 0; i < list.size(); i++) {
+            const Gene &gene = list[i]->getGene();
+
+            CacheElement ce;
+            ce.geneID = gene.getInternID();
+            ce.flags = 0;
+            if (gene.getOrientation()) ce.flags |= CACHE_ORIENTATION;
+            if (gene.isTandem()) ce.flags |= CACHE_TANDEM;
+            if (gene.isTandemRepresentative()) ce.flags |= CACHE_REPRESENTATIVE;
+            if (gene.isRemapped()) ce.flags |= CACHE_REMAPPED;
+            // the coordinate of a gene is its position in the gene list
+            ce.representative = gene.isTandem() ?
+                gene.tandemRepresentative().getCoordinate() : -1;
+            elements.push_back(ce);
+
+            if (useFamily) {
+                uint32_t f = gene.getFamilyID();
+                if (f >= familyNames.size())
+                    familyNames.resize(f + 1);
+                familyNames[f] = gene.getFamily();
+                familyOf[ce.geneID] = f;
+            }
+        }
+    }
+
+    vector<uint64_t> famOffsets(1, 0);
+    string famNames;
+    for (size_t f = 0; f < familyNames.size(); f++) {
+        famNames.append(familyNames[f]);
+        famOffsets.push_back(famNames.size());
+    }
+
+    vector<uint64_t> pairOffsets;
+    vector<uint32_t> pairs;
+    if (!useFamily) {
+        pairOffsets.push_back(0);
+        for (uint32_t g = 0; g < numGenes; g++) {
+            uint32_t numPairs;
+            const uint32_t *p = genepairs->getPairsOf(g, numPairs);
+            pairs.insert(pairs.end(), p, p + numPairs);
+            pairOffsets.push_back(pairs.size());
+        }
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    header.version = CACHE_VERSION;
+    header.useFamily = useFamily ? 1 : 0;
+    header.key = getCacheKey();
+    header.numLists = genelists.size();
+    header.numGenes = numGenes;
+    header.numFamilies = familyNames.size();
+    header.numPairs = pairs.size();
+    header.numElements = elements.size();
+
+    // write to a temporary file first, so that other processes never
+    // see a partially written cache
+    const string fileName = getCacheFileName();
+    const string tmpName = fileName + ".tmp";
+    ofstream ofs(tmpName.c_str(), std::ios::binary);
+    if (!ofs) {
+        cerr << "WARNING: Cannot write dataset cache " << fileName << endl;
+        return;
+    }
+
+    writeSection(ofs, &header, sizeof(header));
+    writeSection(ofs, &nameOffsets[0], nameOffsets.size() * sizeof(uint64_t));
+    writeSection(ofs, names.data(), names.size());
+    writeSection(ofs, &famOffsets[0], famOffsets.size() * sizeof(uint64_t));
+    writeSection(ofs, famNames.data(), famNames.size());
+    writeSection(ofs, familyOf.empty() ? NULL : &familyOf[0],
+                 familyOf.size() * sizeof(uint32_t));
+    writeSection(ofs, pairOffsets.empty() ? NULL : &pairOffsets[0],
+                 pairOffsets.size() * sizeof(uint64_t));
+    writeSection(ofs, pairs.empty() ? NULL : &pairs[0],
+                 pairs.size() * sizeof(uint32_t));
+    writeSection(ofs, listSizes.empty() ? NULL : &listSizes[0],
+                 listSizes.size() * sizeof(uint32_t));
+    writeSection(ofs, elements.empty() ? NULL : &elements[0],
+                 elements.size() * sizeof(CacheElement));
+    ofs.close();
+
+    if (!ofs || rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        cerr << "WARNING: Cannot write dataset cache " << fileName << endl;
+        remove(tmpName.c_str());
+    }
+}
+
+/*
+ * Layout of a level-2 cache file (native byte order): a Level2Header, the
+ * index of its numEntries list pairs and the results of the list pairs in
+ * index order. Every process writes one file per run with the list pairs it
+ * computed. A list pair without multiplicons and clouds only has an index
+ * entry (size 0), the others hold the multiplicons and the clouds of the GHM
+ * packed in the wire format. An entry does not depend on the other gene
+ * lists: the anchorpoints are identified by their coordinates, the list and
+ * gene IDs are filled in when it is loaded.
+ */
+
+// bump when the layout or the level-2 algorithms change
+static const uint32_t LEVEL2_CACHE_VERSION = 2;
+static const char LEVEL2_MAGIC[8] = {'i', 'A', 'D', 'H', 'L', 'V', 'L', '2'};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t numEntries;
+} Level2Header;
+
+typedef struct {
+    uint64_t key;
+    uint64_t offset;            // from the start of the file
+    uint64_t size;
+} Level2Entry;
+
+/*
+ * Checks a level-2 cache file: the results of the entries must follow the
+ * index back to back and end at the end of the file
+ */
+static bool validLevel2File(const char* data, size_t size)
+{
+    const Level2Header* header = reinterpret_cast<const Level2Header*>(data);
+    if (size < sizeof(Level2Header) ||
+        memcmp(header->magic, LEVEL2_MAGIC, 8) != 0 ||
+        header->version != LEVEL2_CACHE_VERSION ||
+        header->numEntries > (size - sizeof(Level2Header)) / sizeof(Level2Entry))
+        return false;
+
+    const Level2Entry* entries =
+        reinterpret_cast<const Level2Entry*>(data + sizeof(Level2Header));
+    uint64_t offset = sizeof(Level2Header) +
+                      header->numEntries * sizeof(Level2Entry);
+    for (uint64_t i = 0; i < header->numEntries; i++) {
+        if (entries[i].offset != offset || entries[i].size > size - offset)
+            return false;
+        offset += entries[i].size;
+    }
+    return offset == size;
+}
+
+void DataSet::prepareLevel2Cache()
+{
+    const string& dir = settings.getLevel2Cache();
+    createDirectory(dir);
+
+    // the remapped genes and their orientation, the input of a GHM
+    level2ListKeys.resize(genelists.size());
+    for (size_t l = 0; l < genelists.size(); l++) {
+        uint64_t key = 14695981039346656037ULL;
+        const vector<ListElement*> &list = genelists[l]->getRemappedElements();
+        uint64_t size = list.size();
+        hashBytes(key, &size, sizeof(size));
+        for (size_t i = 0; i < list.size(); i++) {
+            hashString(key, list[i]->getGene().getID());
+            char orientation = list[i]->getOrientation() ? 1 : 0;
+            hashBytes(key, &orientation, sizeof(orientation));
+        }
+        level2ListKeys[l] = key;
+    }
+
+    level2Keys.assign(level2Tasks.size(), 0);
+    level2Results.assign(level2Tasks.size(), vector<char>());
+    level2Computed.assign(level2Tasks.size(), 0);
+
+    // index the entries of all cache files of earlier runs
+    releaseLevel2Files();
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL)
+        return;
+
+    vector<string> fileNames;
+    for (struct dirent* e = readdir(d); e != NULL; e = readdir(d)) {
+        string name = e->d_name;
+        if (name.compare(0, 7, "level2_") == 0 && name.size() > 11 &&
+            name.compare(name.size() - 4, 4, ".bin") == 0)
+            fileNames.push_back(dir + name);
+    }
+    closedir(d);
+    sort(fileNames.begin(), fileNames.end());
+
+    for (size_t f = 0; f < fileNames.size(); f++) {
+        MappedFile* file = NULL;
+        try {
+            file = new MappedFile(fileNames[f], "level-2 cache");
+        } catch (const FileException&) {
+            // removed by a concurrent run
+            continue;
+        }
+
+        // files of another version, e.g. the single entries of version 1,
+        // are skipped
+        const Level2Header* header =
+            reinterpret_cast<const Level2Header*>(file->getData());
+        if (file->getSize() >= sizeof(Level2Header) &&
+            memcmp(header->magic, LEVEL2_MAGIC, 8) == 0 &&
+            header->version != LEVEL2_CACHE_VERSION) {
+            delete file;
+            continue;
+        }
+
+        if (!validLevel2File(file->getData(), file->getSize())) {
+            cerr << "WARNING: Level-2 cache file " << fileNames[f]
+                 << " is corrupt, ignoring it" << endl;
+            delete file;
+            continue;
+        }
+
+        level2Files.push_back(file);
+        const Level2Entry* entries = reinterpret_cast<const Level2Entry*>
+            (file->getData() + sizeof(Level2Header));
+        for (uint64_t i = 0; i < header->numEntries; i++) {
+            const char* data = file->getData() + entries[i].offset;
+            level2Index.insert(make_pair(entries[i].key,
+                make_pair(data, (size_t)entries[i].size)));
+        }
+    }
+}
+
+void DataSet::releaseLevel2Files()
+{
+    level2Index.clear();
+    for (size_t i = 0; i < level2Files.size(); i++)
+        delete level2Files[i];
+    level2Files.clear();
+}
+
+uint64_t DataSet::getLevel2Key(int task) const
+{
+    uint x = level2Tasks[task].first;
+    uint y = level2Tasks[task].second;
+
+    uint64_t key = 14695981039346656037ULL;
+    hashBytes(key, &LEVEL2_CACHE_VERSION, sizeof(LEVEL2_CACHE_VERSION));
+    const unsigned char wireVersion = WireFormat::VERSION;
+    hashBytes(key, &wireVersion, sizeof(wireVersion));
+
+    // the parameters used by GHM::run
+    int32_t params[] = {(int32_t)settings.getClusterType(),
+                        settings.useFamily(),
+                        settings.getGapSize(), settings.getClusterGap(),
+                        settings.getAnchorPoints(),
+                        (int32_t)settings.getMultHypCorMethod(),
+                        settings.getCloudGapSize(),
+                        settings.getCloudClusterGap(),
+                        (int32_t)settings.getCloudFilterMethod(),
+                        settings.isBruteforce(),
+                        // a split GHM may differ from an unsplit one
+                        level2Split[task] ? 1 : 0,
+                        x == y};
+    hashBytes(key, params, sizeof(params));
+    double q[] = {settings.getQValue(), settings.getProbCutoff()};
+    hashBytes(key, q, sizeof(q));
+
+    hashBytes(key, &level2ListKeys[x], sizeof(uint64_t));
+    hashBytes(key, &level2ListKeys[y], sizeof(uint64_t));
+
+    // the homologous points, the same way GHM::buildMatrix finds them
+    const vector<ListElement*> &xList = genelists[x]->getRemappedElements();
+    vector<int> positions;
+    for (int i = 0; i < (int)xList.size(); i++) {
+        if (xList[i]->isGap()) continue;
+        if (!xList[i]->getGene().hasPairs()) continue;
+
+        genelists[y]->matchingPositions(xList[i]->getGene(), positions);
+        for (size_t p = 0; p < positions.size(); p++) {
+            if (x == y && positions[p] > i) continue;
+            int32_t point[2] = {i, positions[p]};
+            hashBytes(key, point, sizeof(point));
+        }
+    }
+
+    return key;
+}
+
+bool DataSet::loadLevel2Result(int task, uint64_t key,
+                               vector<Multiplicon*>& mplicons,
+                               vector<SynthenicCloud*>& clouds) const
+{
+    map<uint64_t, pair<const char*, size_t> >::const_iterator entry;
+    entry = level2Index.find(key);
+    if (entry == level2Index.end())
+        return false;
+
+    // a list pair without results
+    if (entry->second.second == 0)
+        return true;
+
+    const GeneList &xList = *genelists[level2Tasks[task].first];
+    const GeneList &yList = *genelists[level2Tasks[task].second];
+
+    // both sets start with a header that holds their length
+    const char *ptr = entry->second.first;
+    const char *end = ptr + entry->second.second;
+    size_t firstMultiplicon = mplicons.size();
+    size_t firstCloud = clouds.size();
+    try {
+        int length = WireFormat::getHeader(ptr, end);
+        const char *endM = ptr + length;
+        int nMultiplicons = WireFormat::getCount(ptr, endM);
+        for (int i = 0; i < nMultiplicons; i++)
+            mplicons.push_back(Multiplicon::unpackL2Multiplicon(ptr, endM,
+                                                                xList, yList,
+                                                                settings.useFamily()));
+        if (ptr != endM)
+            throw WireFormatException();
+
+        ptr += SynthenicCloud::unpackSynthenicClouds(ptr, end, clouds);
+        if (ptr != end)
+            throw WireFormatException();
+
+        const vector<ListElement*> &xElements = xList.getRemappedElements();
+        const vector<ListElement*> &yElements = yList.getRemappedElements();
+        for (size_t i = firstCloud; i < clouds.size(); i++) {
+            clouds[i]->setXObjectID(xList.getID());
+            clouds[i]->setYObjectID(yList.getID());
+
+            vector<AnchorPoint>::const_iterator e = clouds[i]->getAPBegin();
+            for ( ; e != clouds[i]->getAPEnd(); e++) {
+                if (e->getX() < 0 || e->getX() >= (int)xElements.size() ||
+                    e->getY() < 0 || e->getY() >= (int)yElements.size())
+                    throw WireFormatException();
+                const_cast<AnchorPoint&>(*e).setGeneIDs(xElements[e->getX()]->getNumID(),
+                                                        yElements[e->getY()]->getNumID());
+            }
+        }
+    } catch (const WireFormatException&) {
+        cerr << "WARNING: Level-2 cache entry " << hex << key << dec
+             << " is corrupt, recomputing it" << endl;
+        for (size_t i = firstMultiplicon; i < mplicons.size(); i++)
+            delete mplicons[i];
+        mplicons.resize(firstMultiplicon);
+        for (size_t i = firstCloud; i < clouds.size(); i++)
+            delete clouds[i];
+        clouds.resize(firstCloud);
+        return false;
+    }
+
+    return true;
+}
+
+void DataSet::saveLevel2Result(int task, uint64_t key,
+                               const vector<Multiplicon*>& mplicons,
+                               const vector<SynthenicCloud*>& clouds) const
+{
+    level2Keys[task] = key;
+    level2Computed[task] = 1;
+    if (mplicons.empty() && clouds.empty())
+        return;
+
+    int sizeM = Multiplicon::getPackSize(mplicons);
+    int sizeC = SynthenicCloud::getPackSize(clouds);
+    vector<char> &buffer = level2Results[task];
+    buffer.resize(sizeM + sizeC);
+    Multiplicon::packMultiplicons(mplicons, &buffer[0]);
+    SynthenicCloud::packSynthenicClouds(clouds, &buffer[sizeM]);
+}
+
+void DataSet::writeLevel2Cache()
+{
+    // list pairs with the same content have the same key
+    vector<int> tasks;
+    set<uint64_t> keys;
+    for (size_t i = 0; i < level2Tasks.size(); i++) {
+        if (!level2Computed[i] || level2Index.count(level2Keys[i]) > 0)
+            continue;
+        if (keys.insert(level2Keys[i]).second)
+            tasks.push_back(i);
+    }
+
+    releaseLevel2Files();
+    if (tasks.empty())
+        return;
+
+    Level2Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL2_MAGIC, 8);
+    header.version = LEVEL2_CACHE_VERSION;
+    header.numEntries = tasks.size();
+
+    vector<Level2Entry> entries(tasks.size());
+    uint64_t offset = sizeof(Level2Header) + tasks.size() * sizeof(Level2Entry);
+    uint64_t name = 14695981039346656037ULL;
+    for (size_t i = 0; i < tasks.size(); i++) {
+        entries[i].key = level2Keys[tasks[i]];
+        entries[i].offset = offset;
+        entries[i].size = level2Results[tasks[i]].size();
+        offset += entries[i].size;
+        hashBytes(name, &entries[i].key, sizeof(uint64_t));
+    }
+
+    // the name follows from the content, runs that compute the same list
+    // pairs write the same file
+    char baseName[64];
+    sprintf(baseName, "level2_%016llx.bin", (unsigned long long)name);
+    const string fileName = settings.getLevel2Cache() + baseName;
+    ostringstream tmpName;
+    tmpName << fileName << ".tmp" << ParToolBox::getProcID() << "_" << getpid();
+
+    ofstream ofs(tmpName.str().c_str(), std::ios::binary);
+    if (ofs) {
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(&entries[0]),
+                  entries.size() * sizeof(Level2Entry));
+        for (size_t i = 0; i < tasks.size(); i++) {
+            const vector<char> &buffer = level2Results[tasks[i]];
+            if (!buffer.empty())
+                ofs.write(&buffer[0], buffer.size());
+        }
+        ofs.close();
+    }
+
+    if (!ofs || rename(tmpName.str().c_str(), fileName.c_str()) != 0) {
+        cerr << "WARNING: Cannot write level-2 cache file " << fileName << endl;
+        remove(tmpName.str().c_str());
+    }
+}
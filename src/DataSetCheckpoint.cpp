@@ -0,0 +1,303 @@
+#ifdef HAVE_MPI
+    #include <mpi.h>
+#endif
+
+#include "DataSet.h"
+
+#include "GeneList.h"
+#include "ListElement.h"
+#include "Multiplicon.h"
+#include "Settings.h"
+#include "WireFormat.h"
+
+#include <cassert>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util.h"
+#include "parallel.h"
+
+using namespace std;
+
+/*
+ * Layout of a checkpoint of the profile detection. The file starts with a
+ * CheckpointHeader (native byte order), followed by a WireFormat header and
+ *
+ *   the ID counters    profileID, multipliconID, baseclusterID,
+ *                      anchorpointID, pairID, segmentID, elementID, cloudID
+ *   the output files   number of files, size of every file (int64_t, -1 if
+ *                      it did not exist)
+ *   the masking        per genelist: mask version, number of boundaries and
+ *                      the begin and end (exclusive) of every masked stretch
+ *   the queue          number of multiplicons, state of every multiplicon
+ *
+ * A checkpoint is written right after the evaluated multiplicons have been
+ * flushed, so the output files hold exactly the multiplicons that were
+ * evaluated before it. The input is identified by the dataset cache key,
+ * the parameters of the run by the settings key.
+ */
+
+// bump when the layout changes
+static const uint32_t CHECKPOINT_VERSION = 2;
+static const char CHECKPOINT_MAGIC[8] = {'i', 'A', 'D', 'H', 'C', 'K', 'P', 'T'};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t numLists;
+    uint64_t key;
+    uint64_t settingsKey;
+} CheckpointHeader;
+
+bool DataSet::checkpointDue(double nextCheckpoint) const
+{
+    int due = (Util::getTime() >= nextCheckpoint) ? 1 : 0;
+
+#ifdef HAVE_MPI
+    // the processes evaluate the same multiplicons, process 0 decides
+    if (ParToolBox::getNumProcesses() > 1)
+        MPI_Bcast(&due, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+
+    return due != 0;
+}
+
+void DataSet::discardWorkAhead()
+{
+    // the multiplicons are aligned ahead with a revertible profile when
+    // checkpoints are written
+    deque<Multiplicon*>::iterator it = multiplicons_to_evaluate.begin();
+    for ( ; it != multiplicons_to_evaluate.end(); it++) {
+        if (alignedMultiplicons.empty()) break;
+        if (alignedMultiplicons.erase(*it) > 0)
+            (*it)->discardProfile();
+    }
+    assert(alignedMultiplicons.empty());
+
+    map<const Multiplicon*, PrefetchedSearch>::iterator pf;
+    for (pf = prefetchedSearches.begin(); pf != prefetchedSearches.end(); pf++) {
+        vector<vector<Multiplicon*> > &found = pf->second.found;
+        for (size_t p = 0; p < found.size(); p++)
+            for (size_t i = 0; i < found[p].size(); i++)
+                delete found[p][i];
+    }
+    prefetchedSearches.clear();
+}
+
+void DataSet::writeCheckpoint() const
+{
+    assert(evaluated_multiplicons.empty() && clouds.empty());
+    assert(alignedMultiplicons.empty() && prefetchedSearches.empty());
+
+    const uint counters[] = {profileID, multipliconID, baseclusterID,
+                             anchorpointID, pairID, segmentID, elementID,
+                             cloudID};
+    const int numCounters = sizeof(counters) / sizeof(uint);
+
+    vector<string> files = getFlushedFiles();
+    vector<int64_t> fileSizes;
+    for (size_t f = 0; f < files.size(); f++) {
+        struct stat sb;
+        fileSizes.push_back((stat(files[f].c_str(), &sb) == 0) ?
+                            (int64_t)sb.st_size : (int64_t)-1);
+    }
+
+    // boundaries of the masked stretches of every genelist
+    vector<vector<int> > masked(genelists.size());
+    for (size_t l = 0; l < genelists.size(); l++) {
+        const vector<ListElement*> &elements =
+            genelists[l]->getRemappedElements();
+        for (int i = 0; i < (int)elements.size(); i++) {
+            if (!elements[i]->isMasked()) continue;
+            if (!masked[l].empty() && masked[l].back() == i) {
+                masked[l].back() = i + 1;
+            } else {
+                masked[l].push_back(i);
+                masked[l].push_back(i + 1);
+            }
+        }
+    }
+
+    // compute the size of the checkpoint
+    int size = 0;
+    for (int i = 0; i < numCounters; i++)
+        size += WireFormat::getVarIntSize(counters[i]);
+
+    size += WireFormat::getVarIntSize(files.size());
+    size += files.size() * sizeof(int64_t);
+
+    for (size_t l = 0; l < genelists.size(); l++) {
+        size += WireFormat::getVarIntSize(genelists[l]->getMaskVersion());
+        size += WireFormat::getVarIntSize(masked[l].size());
+        int prev = 0;
+        for (size_t b = 0; b < masked[l].size(); b++) {
+            size += WireFormat::getDeltaSize(masked[l][b], prev);
+            prev = masked[l][b];
+        }
+    }
+
+    size += WireFormat::getVarIntSize(multiplicons_to_evaluate.size());
+    deque<Multiplicon*>::const_iterator it = multiplicons_to_evaluate.begin();
+    for ( ; it != multiplicons_to_evaluate.end(); it++)
+        size += (*it)->getStatePackSize();
+
+    // pack the checkpoint
+    vector<char> buffer(WireFormat::HEADER_SIZE + size);
+    char *ptr = &buffer[0];
+    WireFormat::putHeader(ptr, size);
+
+    for (int i = 0; i < numCounters; i++)
+        WireFormat::putVarInt(ptr, counters[i]);
+
+    WireFormat::putVarInt(ptr, files.size());
+    for (size_t f = 0; f < files.size(); f++)
+        WireFormat::putRaw(ptr, fileSizes[f]);
+
+    for (size_t l = 0; l < genelists.size(); l++) {
+        WireFormat::putVarInt(ptr, genelists[l]->getMaskVersion());
+        WireFormat::putVarInt(ptr, masked[l].size());
+        int prev = 0;
+        for (size_t b = 0; b < masked[l].size(); b++) {
+            WireFormat::putDelta(ptr, masked[l][b], prev);
+            prev = masked[l][b];
+        }
+    }
+
+    WireFormat::putVarInt(ptr, multiplicons_to_evaluate.size());
+    for (it = multiplicons_to_evaluate.begin();
+         it != multiplicons_to_evaluate.end(); it++)
+        ptr += (*it)->packState(ptr);
+    assert(ptr == &buffer[0] + buffer.size());
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+    header.version = CHECKPOINT_VERSION;
+    header.numLists = genelists.size();
+    header.key = getCacheKey();
+    header.settingsKey = getSettingsKey();
+
+    // write to a temporary file first, so that a job that is killed while
+    // writing leaves the previous checkpoint intact
+    const string &fileName = settings.getCheckpointFile();
+    const string tmpName = fileName + ".tmp";
+    ofstream ofs(tmpName.c_str(), std::ios::binary);
+    if (ofs) {
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(&buffer[0], buffer.size());
+        ofs.close();
+    }
+
+    if (!ofs || rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        cerr << "WARNING: Cannot write checkpoint " << fileName << endl;
+        remove(tmpName.c_str());
+        return;
+    }
+
+    cout << "Checkpoint written (" << multiplicons_to_evaluate.size()
+         << " multiplicons to evaluate)." << endl;
+}
+
+void DataSet::readCheckpoint()
+{
+    const string &fileName = settings.getResumeFrom();
+    ifstream ifs(fileName.c_str(), std::ios::binary);
+    if (!ifs)
+        throw FileException("Could not open checkpoint file: " + fileName);
+
+    CheckpointHeader header;
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!ifs || memcmp(header.magic, CHECKPOINT_MAGIC, 8) != 0 ||
+        header.version != CHECKPOINT_VERSION ||
+        header.numLists != genelists.size() || header.key != getCacheKey())
+        throw FileException("ERROR: " + fileName + " is not a checkpoint "
+                            "of this dataset");
+
+    // the multiplicons in the output files were found with the settings
+    // of the checkpointed run
+    if (header.settingsKey != getSettingsKey())
+        throw FileException("ERROR: " + fileName + " was written with "
+                            "different settings, resume with the settings "
+                            "of the original run");
+
+    vector<char> buffer((istreambuf_iterator<char>(ifs)),
+                        istreambuf_iterator<char>());
+    ifs.close();
+
+    const char *ptr = buffer.empty() ? NULL : &buffer[0];
+    const char *end = ptr + buffer.size();
+    vector<int64_t> fileSizes;
+    try {
+        if (WireFormat::getHeader(ptr, end) != end - ptr)
+            throw WireFormatException();
+
+        uint* counters[] = {&profileID, &multipliconID, &baseclusterID,
+                            &anchorpointID, &pairID, &segmentID, &elementID,
+                            &cloudID};
+        const int numCounters = sizeof(counters) / sizeof(uint*);
+        for (int i = 0; i < numCounters; i++)
+            *counters[i] = WireFormat::getVarInt(ptr, end);
+
+        fileSizes.resize(WireFormat::getCount(ptr, end));
+        for (size_t f = 0; f < fileSizes.size(); f++)
+            WireFormat::getRaw(ptr, fileSizes[f], end);
+
+        // replaying the masking also restores the mask versions
+        for (size_t l = 0; l < genelists.size(); l++) {
+            unsigned int maskVersion = WireFormat::getVarInt(ptr, end);
+            int numBoundaries = WireFormat::getCount(ptr, end);
+            if (numBoundaries % 2 != 0)
+                throw WireFormatException();
+
+            int size = genelists[l]->getRemappedElements().size();
+            for (int b = 0, prev = 0; b < numBoundaries; b += 2) {
+                int begin = WireFormat::getDelta(ptr, prev, end);
+                if (begin < prev)
+                    throw WireFormatException();
+                prev = WireFormat::getDelta(ptr, begin, end);
+                if (prev <= begin || prev > size)
+                    throw WireFormatException();
+                genelists[l]->mask(begin, prev - 1);
+            }
+
+            if (genelists[l]->getMaskVersion() != maskVersion)
+                throw FileException("ERROR: The masking in checkpoint " +
+                                    fileName + " does not match the gene "
+                                    "lists");
+        }
+
+        int numMultiplicons = WireFormat::getCount(ptr, end);
+        for (int i = 0; i < numMultiplicons; i++)
+            multiplicons_to_evaluate.push_back(Multiplicon::unpackState(ptr,
+                                                                        end,
+                                                                        genelists));
+        if (ptr != end)
+            throw WireFormatException();
+    } catch (const WireFormatException&) {
+        throw FileException("ERROR: Checkpoint " + fileName +
+                            " is truncated or corrupt");
+    }
+
+    if (ParToolBox::getProcID() != 0)
+        return;
+
+    // drop the output that was flushed after the checkpoint
+    setOutputFileNames();
+    vector<string> files = getFlushedFiles();
+    if (files.size() != fileSizes.size())
+        throw FileException("ERROR: Checkpoint " + fileName + " was written "
+                            "for another type of cluster search");
+
+    for (size_t f = 0; f < files.size(); f++) {
+        if (fileSizes[f] < 0) continue;
+
+        struct stat sb;
+        if (stat(files[f].c_str(), &sb) != 0 || sb.st_size < fileSizes[f])
+            throw FileException("ERROR: Output file " + files[f] + " is "
+                                "shorter than at the time of the checkpoint");
+        if (truncate(files[f].c_str(), fileSizes[f]) != 0)
+            throw FileException("ERROR: Cannot truncate output file " +
+                                files[f]);
+    }
+}
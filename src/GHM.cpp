@@ -2,12 +2,17 @@
 
 #include "AnchorPoint.h"
 #include "BaseCluster.h"
+#include "ClusterGrid.h"
+#include "CloudGrid.h"
 #include "SynthenicCloud.h"
 #include "Multiplicon.h"
 #include "ListElement.h"
 
 #include "util.h"
 #include <cassert>
+#include <cmath>
+#include <climits>
+#include <pthread.h>
 
 using namespace std;
 
@@ -37,7 +42,7 @@ void GHM::buildMatrixFast()
     const vector<ListElement*>& yList = y_object.getRemappedElements();
 
     //build family tree
-    map<string,vector<pair<ListElement*,uint> > > geneFamilyTree;
+    map<uint32_t,vector<pair<ListElement*,uint> > > geneFamilyTree;
 
     for (uint y = 0; y < yList.size(); y++) {
         ListElement &yElement = *yList[y];
@@ -46,9 +51,11 @@ void GHM::buildMatrixFast()
         Gene &geneY = yElement.getGene();
         if (!geneY.hasPairs()) continue;
 
-        geneFamilyTree[geneY.getFamily()].push_back(make_pair<>(&yElement,y));
+        geneFamilyTree[geneY.getFamilyID()].push_back(make_pair<>(&yElement,y));
     }
 
+    vector<pair<int, int> > points[2];
+
     for (uint x = 0; x < xList.size(); x++) {
         const ListElement &xElement = *xList[x];
         if (xElement.isGap()) continue;
@@ -56,32 +63,35 @@ void GHM::buildMatrixFast()
         const Gene &geneX = xElement.getGene();
         if (!geneX.hasPairs()) continue;
 
-        vector<pair<ListElement*,uint> > &geneYVector=geneFamilyTree[geneX.getFamily()];
+        vector<pair<ListElement*,uint> > &geneYVector=geneFamilyTree[geneX.getFamilyID()];
 
-        for (uint i=0; i<geneFamilyTree[geneX.getFamily()].size(); i++) {
+        for (uint i=0; i<geneYVector.size(); i++) {
             int y = geneYVector[i].second;
 
             if (identical && (y > x)) continue;
 
             const ListElement &yElement = *(geneYVector[i].first);
 
-            if (geneX.getID() == yElement.getGene().getID())
+            if (geneX.getInternID() == yElement.getGene().getInternID())
                 continue; //identical genes are not considered valid pairs
 
             if (isCloudSearch) {
-                matrix[MIXED_ORIENT][x].insert(y);
+                points[MIXED_ORIENT].push_back(make_pair(x, y));
                 count_points[MIXED_ORIENT]++;
             } else {
                 if (xElement.getOrientation() == yElement.getOrientation()) {
-                    matrix[SAME_ORIENT][x].insert(y);
+                    points[SAME_ORIENT].push_back(make_pair(x, y));
                     count_points[SAME_ORIENT]++;
                 } else {
-                    matrix[OPP_ORIENT][x].insert(y);
+                    points[OPP_ORIENT].push_back(make_pair(x, y));
                     count_points[OPP_ORIENT]++;
                 }
             }
         }
     }
+
+    for (unsigned int i = 0; i < matrix.size(); i++)
+        matrix[i].build(points[i]);
 }
 
 void GHM::buildMatrix (bool useFamilies)
@@ -105,19 +115,19 @@ void GHM::buildMatrix (bool useFamilies)
     const vector<ListElement*>& xList = x_object.getRemappedElements();
     const vector<ListElement*>& yList = y_object.getRemappedElements();
 
+    vector<pair<int, int> > points[2];
+    vector<int> positions;
+
     for (unsigned int x = 0; x < xList.size(); x++) {
         const ListElement &xElement = *xList[x];
 
         if (xElement.isGap()) continue;
         if (!xElement.getGene().hasPairs()) continue;
 
-        std::queue<int> queue;
-        xElement.matchingPositions(yList, queue);
+        y_object.matchingPositions(xElement.getGene(), positions);
 
-        while (!queue.empty()) {
-            // get and remove first element
-            unsigned int y = queue.front();
-            queue.pop();
+        for (unsigned int i = 0; i < positions.size(); i++) {
+            unsigned int y = positions[i];
 
             // in case the xList == yList,
             // only store the upper triangular part
@@ -127,24 +137,27 @@ void GHM::buildMatrix (bool useFamilies)
 
             if (isCloudSearch)
             {
-                matrix[MIXED_ORIENT][x].insert(y);
+                points[MIXED_ORIENT].push_back(make_pair(x, y));
                 count_points[MIXED_ORIENT]++;
             }
             else {
                 if (xElement.getOrientation() == yElement.getOrientation())
                 {
-                    matrix[SAME_ORIENT][x].insert(y);
+                    points[SAME_ORIENT].push_back(make_pair(x, y));
                     count_points[SAME_ORIENT]++;
                 }
                 else
                 {
-                    matrix[OPP_ORIENT][x].insert(y);
+                    points[OPP_ORIENT].push_back(make_pair(x, y));
                     count_points[OPP_ORIENT]++;
                 }
             }
 
         }
     }
+
+    for (int i = 0; i < numMatrices; i++)
+        matrix[i].build(points[i]);
 }
 
 void GHM::run(const Settings& settings)
@@ -154,11 +167,160 @@ void GHM::run(const Settings& settings)
 }
 
 
+bool GHM::beginBanded(const Settings& settings, vector<GHM*>& bands,
+                      vector<int>& boundaries)
+{
+    bands.clear();
+    unsigned long long numPoints = isCloudSearch ? count_points[MIXED_ORIENT] :
+                                   count_points[0] + count_points[1];
+    if (numPoints < (unsigned int)settings.getAnchorPoints()) return false;
+
+    if (!splitIntoBands(NUM_BANDS, bands, boundaries)) {
+        run(settings);
+        return false;
+    }
+    return true;
+}
+
+void GHM::runBand(const Settings& settings)
+{
+    if (isCloudSearch)
+        detectClouds(settings);
+    else
+        detectBaseClusters(settings);
+}
+
+void GHM::finishBanded(const Settings& settings, vector<GHM*>& bands,
+                       const vector<int>& boundaries)
+{
+    stitchBands(bands, boundaries, settings);
+
+    if (isCloudSearch) {
+        filterClouds(settings);
+    } else {
+        prepareForStatisticalValidation();
+        finishBaseClusters(settings);
+    }
+}
+
+bool GHM::splitIntoBands(int nBands, vector<GHM*>& bands,
+                         vector<int>& boundaries)
+{
+    // boundaries at the x-quantiles of the points
+    vector<int> xs;
+    for (size_t o = 0; o < matrix.size(); o++) {
+        HomologyMatrix::BoxIterator it = matrix[o].getAll();
+        for ( ; it.isValid(); it.next())
+            xs.push_back(it.getX());
+    }
+    sort(xs.begin(), xs.end());
+
+    boundaries.clear();
+    for (int b = 1; b < nBands; b++) {
+        int x = xs[xs.size() * b / nBands];
+        if (x > xs.front() && (boundaries.empty() || x > boundaries.back()))
+            boundaries.push_back(x);
+    }
+    if (boundaries.empty())
+        return false;
+
+    // move the points to the band that contains their x-coordinate
+    bands.clear();
+    for (size_t b = 0; b <= boundaries.size(); b++) {
+        GHM *band = new GHM(x_object, y_object, isCloudSearch);
+        band->level = level;
+        band->matrix.resize(matrix.size());
+        bands.push_back(band);
+    }
+
+    for (size_t o = 0; o < matrix.size(); o++) {
+        vector<vector<pair<int, int> > > points(bands.size());
+        HomologyMatrix::BoxIterator it = matrix[o].getAll();
+        for ( ; it.isValid(); it.next()) {
+            size_t b = upper_bound(boundaries.begin(), boundaries.end(),
+                                   it.getX()) - boundaries.begin();
+            points[b].push_back(make_pair(it.getX(), it.getY()));
+        }
+
+        for (size_t b = 0; b < bands.size(); b++) {
+            bands[b]->count_points[o] = points[b].size();
+            bands[b]->matrix[o].build(points[b]);
+        }
+        matrix[o].clear();
+    }
+
+    return true;
+}
+
+void GHM::stitchBands(vector<GHM*>& bands, const vector<int>& boundaries,
+                      const Settings& settings)
+{
+    // collect the clusters and remaining points in band order
+    vector<vector<pair<int, int> > > points(matrix.size());
+    for (size_t b = 0; b < bands.size(); b++) {
+        GHM *band = bands[b];
+        for (size_t o = 0; o < matrix.size(); o++) {
+            HomologyMatrix::BoxIterator it = band->matrix[o].getAll();
+            for ( ; it.isValid(); it.next())
+                points[o].push_back(make_pair(it.getX(), it.getY()));
+
+            baseclusters[o].insert(baseclusters[o].end(),
+                                   band->baseclusters[o].begin(),
+                                   band->baseclusters[o].end());
+            band->baseclusters[o].clear();
+        }
+        sClouds.splice(sClouds.end(), band->sClouds);
+        delete band;
+    }
+    bands.clear();
+
+    for (size_t o = 0; o < matrix.size(); o++)
+        matrix[o].build(points[o]);
+
+    // seed in a strip around every boundary, the seeds may grow into
+    // both bands, and merge the clusters that cross a boundary
+    int gapsizes [10];
+    if (isCloudSearch) {
+        settings.getCloudGapSizes(&gapsizes[0]);
+        bool bf = settings.isBruteforce();
+
+        for (int i = 0; i < 10 && gapsizes[i] > 0; i++) {
+            int gap = gapsizes[i];
+            for (size_t b = 0; b < boundaries.size(); b++)
+                condenseClouds(gap, bf, matrix[MIXED_ORIENT].getBox(
+                    boundaries[b] - gap, boundaries[b] + gap - 1,
+                    INT_MIN, INT_MAX));
+            inflateClouds(gap, bf);
+            mergeClouds(settings.getCloudClusterGap(), bf);
+        }
+    } else {
+        settings.getGapSizes(&gapsizes[0]);
+
+        for (int i = 0; i < 10 && gapsizes[i] > 0; i++) {
+            int gap = gapsizes[i];
+            for (int o = 0; o < 2; o++) {
+                for (size_t b = 0; b < boundaries.size(); b++)
+                    seedBaseClusters(gap, o, settings.getQValue(),
+                        matrix[o].getBox(boundaries[b] - gap,
+                                         boundaries[b] + gap - 1,
+                                         INT_MIN, INT_MAX));
+                joinClusters(gap, o, settings.getQValue());
+            }
+        }
+    }
+}
+
 void GHM::runCollinear(const Settings& settings)
 {
     if ((count_points[0]+count_points[1]) < (unsigned int)settings.getAnchorPoints()) return;
 
     prepareForStatisticalValidation();
+    detectBaseClusters(settings);
+    finishBaseClusters(settings);
+}
+
+void GHM::detectBaseClusters(const Settings& settings)
+{
     int gapsizes [10];
     settings.getGapSizes(&gapsizes[0]);
 
@@ -182,7 +344,10 @@ void GHM::runCollinear(const Settings& settings)
         visualizeBaseClustersPNG(path.c_str());
         */
     }
+}
 
+void GHM::finishBaseClusters(const Settings& settings)
+{
     enrichClusters(settings.getGapSize(), 0, 0, settings.getQValue());
     enrichClusters(settings.getGapSize(), 1, 1, settings.getQValue());
     enrichClusters(settings.getGapSize(), 1, 0, settings.getQValue());
@@ -239,7 +404,7 @@ void GHM::seedBaseCluster(BaseCluster *basecluster, int gap) const
 {
     assert(basecluster->getCountAnchorPoints() == 1);
     bool orientation = basecluster->getOrientation();
-    const map<int, set<int> > &mat = matrix[orientation];
+    const HomologyMatrix &mat = matrix[orientation];
 
     int refX = basecluster->getAPBegin()->getX();
     int refY = basecluster->getAPBegin()->getY();
@@ -250,28 +415,19 @@ void GHM::seedBaseCluster(BaseCluster *basecluster, int gap) const
         int loY = (orientation) ? refY + 1 : refY - gap;
         int hiY = (orientation) ? refY + gap : refY - 1;
 
-        map<int, set<int> >::const_iterator itX = mat.lower_bound(loX);
-        map<int, set<int> >::const_iterator endX = mat.upper_bound(hiX);
-
         int closestX = 0, closestY = 0;
         int closestDpd = gap + 1;
 
-        for ( ; itX != endX; itX++) {
-            int x = itX->first;
-            const set<int>& setY = itX->second;
-
-            set<int>::const_iterator itY = setY.lower_bound(loY);
-            set<int>::const_iterator endY = setY.upper_bound(hiY);
-
-            for ( ; itY != endY; itY++) {
-                int y = *itY;
+        HomologyMatrix::BoxIterator it = mat.getBox(loX, hiX, loY, hiY);
+        for ( ; it.isValid(); it.next()) {
+            int x = it.getX();
+            int y = it.getY();
 
-                int dpd = BaseCluster::dpd(refX, refY, x, y);
-                if (dpd < closestDpd) {
-                    closestDpd = dpd;
-                    closestX = x;
-                    closestY = y;
-                }
+            int dpd = BaseCluster::dpd(refX, refY, x, y);
+            if (dpd < closestDpd) {
+                closestDpd = dpd;
+                closestX = x;
+                closestY = y;
             }
         }
 
@@ -286,40 +442,36 @@ void GHM::seedBaseCluster(BaseCluster *basecluster, int gap) const
 
 void GHM::seedBaseClusters(int gap, bool orientation, double qValue)
 {
-    map<int, set<int> > &mat = matrix[orientation];
-    map<int, set<int> >::iterator itX;
-    set<int>::const_iterator itY;
-    multiset<AnchorPoint>::const_iterator AP;
-
-    for (itX = mat.begin(); itX != mat.end(); ) {
-        for (itY = itX->second.begin(); itY != itX->second.end(); ) {
-            BaseCluster* basecluster = new BaseCluster(orientation);
-            basecluster->addAnchorPoint(itX->first, *itY);
-            basecluster->addBackBone(itX->first, *itY);
-            seedBaseCluster(basecluster, gap);
-
-            if (basecluster->getCountAnchorPoints() > 2 &&
-                    basecluster->r_squared() >= qValue) {
-                baseclusters[orientation].push_back(basecluster);
-                basecluster->updateStatistics();
-
-                // delete found APs from matrix except the first
-                AP = basecluster->getAPBegin();
-                for (AP++; AP != basecluster->getAPEnd(); AP++)
-                    mat[AP->getX()].erase(AP->getY());
-                // delete the first AP
-                itX->second.erase(itY++);
-            } else {
-                delete basecluster;
-                itY++;
-            }
-        }
+    seedBaseClusters(gap, orientation, qValue,
+                     matrix[orientation].getAll());
+}
 
-        // it is possible that all AP for this x were deleted
-        if (itX->second.empty())
-            mat.erase(itX++);
-        else
-            itX++;
+void GHM::seedBaseClusters(int gap, bool orientation, double qValue,
+                           HomologyMatrix::BoxIterator it)
+{
+    HomologyMatrix &mat = matrix[orientation];
+    vector<AnchorPoint>::const_iterator AP;
+
+    for ( ; it.isValid(); it.next()) {
+        BaseCluster* basecluster = new BaseCluster(orientation);
+        basecluster->addAnchorPoint(it.getX(), it.getY());
+        basecluster->addBackBone(it.getX(), it.getY());
+        seedBaseCluster(basecluster, gap);
+
+        if (basecluster->getCountAnchorPoints() > 2 &&
+                basecluster->r_squared() >= qValue) {
+            baseclusters[orientation].push_back(basecluster);
+            basecluster->updateStatistics();
+
+            // delete found APs from matrix except the first
+            AP = basecluster->getAPBegin();
+            for (AP++; AP != basecluster->getAPEnd(); AP++)
+                mat.erase(AP->getX(), AP->getY());
+            // delete the first AP
+            mat.erase(it);
+        } else {
+            delete basecluster;
+        }
     }
 }
 
@@ -333,74 +485,215 @@ void GHM::enrichClusters(int gap, bool clusterOrientation,
 {
     //make copy of the baseclusters vector
     vector<BaseCluster*> clusters (baseclusters[clusterOrientation]);
-    map<int, set<int> > &mat = matrix[ghmOrientation];
-
-    map<int, set<int> >::iterator itX;
-    set<int>::iterator itY;
+    HomologyMatrix &mat = matrix[ghmOrientation];
 
     while (!clusters.empty()) {
         vector<BaseCluster*> clustersNextIteration;
         clustersNextIteration.reserve(clusters.size());
         vector<bool> changedClusters (clusters.size(), false);
 
-        for (itX = mat.begin(); itX != mat.end(); ) {
-            for (itY = itX->second.begin(); itY != itX->second.end(); ) {
-                double closestDistance = gap + 1;
-
-                int closestClusterIndex = -1;
-                vector<BaseCluster*>::iterator it = clusters.begin();
-                for (int index = 0; it != clusters.end(); it++, index++) {
-                    (*it)->updateStatistics();
-
-                    double distance = (*it)->distanceToPoint(itX->first,*itY);
-                    if (distance >= closestDistance) continue;
-
-                    if ((*it)->r_squared(itX->first,*itY) >= qValue &&
-                            (*it)->inInterval(itX->first,*itY))
-                        // && distance <= 2*(*it)->averageDPD())
-                    {
-                        closestDistance = distance;
-                        closestClusterIndex = index;
-                    }
+        // index the clusters so that only those that can accept a point
+        // are evaluated, candidates are visited in the original order
+        ClusterGrid grid(gap, gap);
+        for (size_t i = 0; i < clusters.size(); i++)
+            grid.insert(i, *clusters[i]);
+        vector<int> candidates;
+
+        HomologyMatrix::BoxIterator itP = mat.getAll();
+        for ( ; itP.isValid(); itP.next()) {
+            int x = itP.getX();
+            int y = itP.getY();
+            double closestDistance = gap + 1;
+
+            int closestClusterIndex = -1;
+            grid.getCandidates(x, y, candidates);
+            for (size_t i = 0; i < candidates.size(); i++) {
+                int index = candidates[i];
+                BaseCluster *cluster = clusters[index];
+                cluster->updateStatistics();
+
+                double distance = cluster->distanceToPoint(x, y);
+                if (distance >= closestDistance) continue;
+
+                if (cluster->r_squared(x, y) >= qValue &&
+                        cluster->inInterval(x, y))
+                    // && distance <= 2*cluster->averageDPD())
+                {
+                    closestDistance = distance;
+                    closestClusterIndex = index;
                 }
+            }
 
-                if (closestClusterIndex != -1) {
-                    BaseCluster *closestCluster = clusters[closestClusterIndex];
-                    closestCluster->addAnchorPoint(itX->first, *itY);
-                    closestCluster->updateStatistics();
-
-                    if (!changedClusters[closestClusterIndex]) {
-                        clustersNextIteration.push_back(closestCluster);
-                        changedClusters[closestClusterIndex] = true;
-                    }
+            if (closestClusterIndex != -1) {
+                BaseCluster *closestCluster = clusters[closestClusterIndex];
+                closestCluster->addAnchorPoint(x, y);
+                closestCluster->updateStatistics();
+                grid.update(closestClusterIndex, *closestCluster);
 
-                    itX->second.erase(itY++);
-                } else {
-                    itY++;
+                if (!changedClusters[closestClusterIndex]) {
+                    clustersNextIteration.push_back(closestCluster);
+                    changedClusters[closestClusterIndex] = true;
                 }
-            }
 
-            if (itX->second.empty())
-                mat.erase(itX++);
-            else
-                itX++;
+                mat.erase(itP);
+            }
         }
         clusters = clustersNextIteration;
     }
 }
 
+/*
+ * Bounding box of the regression line and the outer anchor points of a
+ * basecluster, every point used by BaseCluster::distanceToCluster lies
+ * inside it
+ */
+struct JoinBox {
+    double loX, hiX, loY, hiY;
+
+    JoinBox() : loX(0), hiX(0), loY(0), hiY(0) {}
+
+    JoinBox(BaseCluster& c) {
+        c.updateStatistics();
+        const AnchorPoint &first = *c.getAPBegin();
+        const AnchorPoint &last = *(--c.getAPEnd());
+        loX = min(min(c.getXEnd1(), c.getXEnd2()),
+                  (double)min(first.getX(), last.getX()));
+        hiX = max(max(c.getXEnd1(), c.getXEnd2()),
+                  (double)max(first.getX(), last.getX()));
+        loY = min(min(c.getYEnd1(), c.getYEnd2()),
+                  (double)min(first.getY(), last.getY()));
+        hiY = max(max(c.getYEnd1(), c.getYEnd2()),
+                  (double)max(first.getY(), last.getY()));
+
+        // degenerate regression line: the box bounds nothing
+        if (!isfinite(c.getYEnd1()) || !isfinite(c.getYEnd2())) {
+            loX = loY = -HUGE_VAL;
+            hiX = hiY = HUGE_VAL;
+        }
+    }
+
+    /*
+     * The dpd between two points is at least their Chebyshev distance,
+     * so no pair of points in both boxes is closer than this
+     */
+    double distanceTo(const JoinBox& o) const {
+        double dx = max(0.0, max(o.loX - hiX, loX - o.hiX));
+        double dy = max(0.0, max(o.loY - hiY, loY - o.hiY));
+        return max(dx, dy);
+    }
+};
+
+/*
+ * Candidate pair of baseclusters for joining. Clusters are identified by
+ * their rank in the basecluster vector, which is not altered by joining,
+ * so ordering on (distance, rankI, rankJ) reproduces the scan order of
+ * getClosestClusters()
+ */
+struct JoinCandidate {
+    double distance;
+    int rankI, rankJ;
+    int versionI, versionJ;
+
+    // reversed: the priority queue returns the smallest candidate first
+    bool operator<(const JoinCandidate& o) const {
+        if (distance != o.distance) return distance > o.distance;
+        if (rankI != o.rankI) return rankI > o.rankI;
+        return rankJ > o.rankJ;
+    }
+};
+
+bool GHM::evaluateJoin(BaseCluster& cI, BaseCluster& cJ, int gap,
+                       double qValue, double& distance)
+{
+    if (cI.getMultiplicon() != NULL &&
+            cJ.getMultiplicon() != NULL &&
+            cI.getMultiplicon() == cJ.getMultiplicon())
+        return false;
+
+    distance = cI.distanceToCluster(cJ);
+
+    return (distance < gap + 1) && cI.partialOverlappingInterval(cJ) &&
+           (cI.r_squared(cJ) >= qValue);
+}
+
 void GHM::joinClusters(int gap, bool orient, double qValue)
 {
-    vector<BaseCluster*>::iterator i, j;
-    while (getClosestClusters(gap, orient, orient, i, j, qValue)) {
-        // merge the two clusters
-        (*i)->mergeWith(**j);
+    vector<BaseCluster*> &bc = baseclusters[orient];
+    int n = bc.size();
+
+    // clusters[r] is NULL once it has been merged into another cluster
+    vector<BaseCluster*> clusters(bc);
+    vector<JoinBox> boxes(n);
+    vector<int> version(n, 0);
+    for (int r = 0; r < n; r++)
+        boxes[r] = JoinBox(*clusters[r]);
+
+    priority_queue<JoinCandidate> queue;
+    JoinCandidate cand;
+
+    // initial candidates: sweep over the clusters sorted by their lowest x
+    vector<pair<double, int> > byX(n);
+    for (int r = 0; r < n; r++)
+        byX[r] = make_pair(boxes[r].loX, r);
+    sort(byX.begin(), byX.end());
+
+    for (int a = 0; a < n; a++) {
+        int r = byX[a].second;
+        for (int b = a + 1; b < n; b++) {
+            if (byX[b].first - boxes[r].hiX >= gap + 1) break;
+            int s = byX[b].second;
+            if (boxes[r].distanceTo(boxes[s]) >= gap + 1) continue;
+
+            cand.rankI = min(r, s);
+            cand.rankJ = max(r, s);
+            if (evaluateJoin(*clusters[cand.rankI], *clusters[cand.rankJ],
+                             gap, qValue, cand.distance)) {
+                cand.versionI = cand.versionJ = 0;
+                queue.push(cand);
+            }
+        }
+    }
+
+    while (!queue.empty()) {
+        JoinCandidate top = queue.top();
+        queue.pop();
 
-        // remove the old basecluster
-        delete *j;
-        baseclusters[orient].erase(j);
+        // discard candidates that involve merged or altered clusters
+        if (clusters[top.rankI] == NULL || clusters[top.rankJ] == NULL ||
+                version[top.rankI] != top.versionI ||
+                version[top.rankJ] != top.versionJ)
+            continue;
 
+        // merge the two clusters
+        int i = top.rankI, j = top.rankJ;
+        clusters[i]->mergeWith(*clusters[j]);
+        delete clusters[j];
+        clusters[j] = NULL;
+
+        version[i]++;
+        boxes[i] = JoinBox(*clusters[i]);
+
+        // reevaluate all pairs of the merged cluster
+        for (int r = 0; r < n; r++) {
+            if (r == i || clusters[r] == NULL) continue;
+            if (boxes[i].distanceTo(boxes[r]) >= gap + 1) continue;
+
+            cand.rankI = min(i, r);
+            cand.rankJ = max(i, r);
+            if (evaluateJoin(*clusters[cand.rankI], *clusters[cand.rankJ],
+                             gap, qValue, cand.distance)) {
+                cand.versionI = version[cand.rankI];
+                cand.versionJ = version[cand.rankJ];
+                queue.push(cand);
+            }
+        }
     }
+
+    // remove the old baseclusters, preserving the order of the others
+    bc.clear();
+    for (int r = 0; r < n; r++)
+        if (clusters[r] != NULL)
+            bc.push_back(clusters[r]);
 }
 
 bool GHM::getClosestClusters(int gap, bool orientI, bool orientJ,
@@ -453,10 +746,10 @@ void GHM::filterBaseClusters(double probCutoff)
 
             // if the cluster was generated by chance
             if (pGlobal > probCutoff) {
-                multiset<AnchorPoint>::iterator AP;
+                vector<AnchorPoint>::const_iterator AP;
                 AP = (*it)->getAPBegin();
                 for ( ; AP != (*it)->getAPEnd(); AP++)
-                    matrix[orient][AP->getX()].insert(AP->getY());
+                    matrix[orient].insert(AP->getX(), AP->getY());
 
                 filteredBC[orient].push_back(*it);
                 it = baseclusters[orient].erase(it);
@@ -465,6 +758,7 @@ void GHM::filterBaseClusters(double probCutoff)
                 it++;
             }
         }
+        matrix[orient].merge();
     }
 }
 
@@ -488,10 +782,10 @@ void GHM::filterBaseClustersBF(double probCutoff)
 
             // if the cluster was generated by chance
             if (pGlobal > (probCutoff / count_points[orient])) {
-                multiset<AnchorPoint>::iterator AP;
+                vector<AnchorPoint>::const_iterator AP;
                 AP = (*it)->getAPBegin();
                 for ( ; AP != (*it)->getAPEnd(); AP++)
-                    matrix[orient][AP->getX()].insert(AP->getY());
+                    matrix[orient].insert(AP->getX(), AP->getY());
 
                 filteredBC[orient].push_back(*it);
                 it = baseclusters[orient].erase(it);
@@ -499,6 +793,7 @@ void GHM::filterBaseClustersBF(double probCutoff)
                 it++;
             }
         }
+        matrix[orient].merge();
     }
 }
 
@@ -681,7 +976,7 @@ void GHM::setMultiplicons(bool useFamily,
         for (unsigned int j = 0; j < baseclusters.size(); j++) {
             baseclusters[j]->setBounds();
 
-            multiset<AnchorPoint>::const_iterator e = baseclusters[j]->getAPBegin();
+            vector<AnchorPoint>::const_iterator e = baseclusters[j]->getAPBegin();
             for ( ; e != baseclusters[j]->getAPEnd(); e++) {
                 int x = e->getX();
                 int y = e->getY();
@@ -712,11 +1007,8 @@ bool GHM::identity(int x, int y)
     bool found = false;
     int orient = 0;
     while (orient < 2 && !found) {
-        if (matrix[orient].find(x) != matrix[orient].end()) {
-            if (matrix[orient][x].find(y) != matrix[orient][x].end()) {
-                found = true;
-            }
-        }
+        if (matrix[orient].contains(x, y))
+            found = true;
         orient++;
     }
 
@@ -756,6 +1048,12 @@ void GHM::runSyntheny(const Settings& settings)
 {
     if (count_points[MIXED_ORIENT] < (unsigned int)settings.getAnchorPoints()) return;
 
+    detectClouds(settings);
+    filterClouds(settings);
+}
+
+void GHM::detectClouds(const Settings& settings)
+{
     int gapsizes [10];
     settings.getCloudGapSizes(&gapsizes[0]);
     int clusterGap=settings.getCloudClusterGap();
@@ -766,7 +1064,10 @@ void GHM::runSyntheny(const Settings& settings)
         inflateClouds(gapsizes[i],settings.isBruteforce());
         mergeClouds(clusterGap,settings.isBruteforce());
     }
+}
 
+void GHM::filterClouds(const Settings& settings)
+{
     switch (settings.getCloudFilterMethod()) {
 
     case Binomial:
@@ -804,51 +1105,51 @@ void GHM::runSyntheny(const Settings& settings)
 
 void GHM::condenseClouds(uint gap, bool bf)
 {
-    map<int, set<int> > &mat = matrix[MIXED_ORIENT];
-    map<int, set<int> >::iterator itX;
-    set<int>::const_iterator itY;
+    condenseClouds(gap, bf, matrix[MIXED_ORIENT].getAll());
+}
+
+void GHM::condenseClouds(uint gap, bool bf, HomologyMatrix::BoxIterator it)
+{
+    HomologyMatrix &mat = matrix[MIXED_ORIENT];
 
     vector<AnchorPoint> APRecycleBin; //APs to be removed from GHM
 
-    for (itX = mat.begin(); itX != mat.end(); ) {
-        for (itY = itX->second.begin(); itY != itX->second.end(); ) {
+    for ( ; it.isValid(); it.next()) {
 
-            SynthenicCloud* sCloud = new SynthenicCloud();
-            sCloud->addAnchorPoint(itX->first, *itY);
+        SynthenicCloud* sCloud = new SynthenicCloud();
+        sCloud->addAnchorPoint(it.getX(), it.getY());
 
-            condenseCloud(*sCloud, gap, APRecycleBin,bf); //note that first AP will not be added to APRecycleBin!
+        condenseCloud(*sCloud, gap, APRecycleBin,bf); //note that first AP will not be added to APRecycleBin!
 
 
-            if (sCloud->getCountAnchorPoints() > 2) {
-                sClouds.push_back(sCloud);
+        if (sCloud->getCountAnchorPoints() > 2) {
+            sClouds.push_back(sCloud);
 
-                removeAddedAnchorPoints(APRecycleBin);
+            removeAddedAnchorPoints(APRecycleBin);
 
-                // delete the first AP
-                itX->second.erase(itY++);
+            // delete the first AP
+            mat.erase(it);
 
-                if (bf) { //scan bounding box for extra dots
-                    addAPFromSearchBoxBF(gap,sCloud->getBeginX(),sCloud->getEndX()
-                        ,sCloud->getBeginY(),sCloud->getEndY(),*sCloud,APRecycleBin);
-                    removeAddedAnchorPoints(APRecycleBin);
-                }
+            if (bf) { //scan bounding box for extra dots
+                addAPFromSearchBoxBF(gap,sCloud->getBeginX(),sCloud->getEndX()
+                    ,sCloud->getBeginY(),sCloud->getEndY(),*sCloud,APRecycleBin);
+                removeAddedAnchorPoints(APRecycleBin);
+            }
 
-            } else {
+        } else {
 
-                delete sCloud;
-                APRecycleBin.clear();
-                itY++;
-            }
+            delete sCloud;
+            APRecycleBin.clear();
         }
-        // it is possible that all AP for this x were deleted
-        if (itX->second.empty()) mat.erase(itX++);
-        else itX++;
     }
 }
 
 void GHM::condenseCloud(SynthenicCloud& sCloud, uint gap, vector<AnchorPoint>& foundNewAP, bool bf)
 {
-    map<int, set<int> > &mat = matrix[MIXED_ORIENT];
+    if (!bf) {
+        expandCloud(sCloud, gap, foundNewAP);
+        return;
+    }
 
     int numberOfAP;
 
@@ -862,36 +1163,80 @@ void GHM::condenseCloud(SynthenicCloud& sCloud, uint gap, vector<AnchorPoint>& f
         int ymin=sCloud.getBeginY();
         int ymax=sCloud.getEndY();
 
-        if (!bf) {
-            //search above
-            addAPFromSearchBox(xmin-gap,xmax+gap,ymax+1,ymax+gap,sCloud,foundNewAP);
-            //search below
-            addAPFromSearchBox(xmin-gap,xmax+gap,ymin-gap,ymin-1,sCloud,foundNewAP);
-            //search left
-            addAPFromSearchBox(xmin-gap,xmin-1,ymin,ymax,sCloud,foundNewAP);
-            //search right
-            addAPFromSearchBox(xmax+1,xmax+gap,ymin,ymax,sCloud,foundNewAP);
-        } else {
-            //search above
-            addAPFromSearchBoxBF(gap,xmin-gap,xmax+gap,ymax+1,ymax+gap,sCloud,foundNewAP);
-            //search below
-            addAPFromSearchBoxBF(gap,xmin-gap,xmax+gap,ymin-gap,ymin-1,sCloud,foundNewAP);
-            //search left
-            addAPFromSearchBoxBF(gap,xmin-gap,xmin-1,ymin,ymax,sCloud,foundNewAP);
-            //search right
-            addAPFromSearchBoxBF(gap,xmax+1,xmax+gap,ymin,ymax,sCloud,foundNewAP);
-        }
+        //search above
+        addAPFromSearchBoxBF(gap,xmin-gap,xmax+gap,ymax+1,ymax+gap,sCloud,foundNewAP);
+        //search below
+        addAPFromSearchBoxBF(gap,xmin-gap,xmax+gap,ymin-gap,ymin-1,sCloud,foundNewAP);
+        //search left
+        addAPFromSearchBoxBF(gap,xmin-gap,xmin-1,ymin,ymax,sCloud,foundNewAP);
+        //search right
+        addAPFromSearchBoxBF(gap,xmax+1,xmax+gap,ymin,ymax,sCloud,foundNewAP);
 
     } while (sCloud.getCountAnchorPoints()-numberOfAP > 0); //while new points are found
 }
 
+void GHM::expandCloud(SynthenicCloud& sCloud, int gap, vector<AnchorPoint>& foundNewAP)
+{
+    const HomologyMatrix &mat = matrix[MIXED_ORIENT];
+
+    //region of the GHM that has been searched: initially the bounding box
+    int sLoX=sCloud.getBeginX(), sHiX=sCloud.getEndX();
+    int sLoY=sCloud.getBeginY(), sHiY=sCloud.getEndY();
+
+    //APs found above, below, left and right of the bounding box
+    vector<pair<int, int> > side[4];
+
+    while (true) {
+        //determine boundaries of current bounding box and search frame
+        int xmin=sCloud.getBeginX();
+        int xmax=sCloud.getEndX();
+        int ymin=sCloud.getBeginY();
+        int ymax=sCloud.getEndY();
+
+        int loX=xmin-gap, hiX=xmax+gap, loY=ymin-gap, hiY=ymax+gap;
+
+        //all AP found so far lie within the bounding box, so only the part
+        //of the frame outside the searched region needs to be visited
+        int strips[4][4]={{loX,sLoX-1,loY,hiY},{sHiX+1,hiX,loY,hiY},
+                          {sLoX,sHiX,loY,sLoY-1},{sLoX,sHiX,sHiY+1,hiY}};
+
+        bool found=false;
+        for (int i=0; i<4; i++) {
+            HomologyMatrix::BoxIterator it=mat.getBox(strips[i][0],
+                strips[i][1],strips[i][2],strips[i][3]);
+            for ( ; it.isValid(); it.next()) {
+                int x=it.getX(), y=it.getY();
+                if (y>ymax) side[0].push_back(make_pair(x,y));
+                else if (y<ymin) side[1].push_back(make_pair(x,y));
+                else if (x<xmin) side[2].push_back(make_pair(x,y));
+                else side[3].push_back(make_pair(x,y));
+                found=true;
+            }
+        }
+
+        sLoX=loX; sHiX=hiX; sLoY=loY; sHiY=hiY;
+
+        if (!found) break;
+
+        //add the AP in the same order as four separate searches would
+        for (int i=0; i<4; i++) {
+            sort(side[i].begin(),side[i].end());
+            for (size_t j=0; j<side[i].size(); j++) {
+                sCloud.addAnchorPoint(side[i][j].first,side[i][j].second);
+                foundNewAP.push_back(AnchorPoint(side[i][j].first,side[i][j].second,true));
+            }
+            side[i].clear();
+        }
+    }
+}
+
 void GHM::removeAddedAnchorPoints(vector<AnchorPoint>& APRecycleBin)
 {
-    map<int, set<int> > &mat = matrix[MIXED_ORIENT];
+    HomologyMatrix &mat = matrix[MIXED_ORIENT];
 
     for (int i=0; i<APRecycleBin.size(); i++) {
         AnchorPoint& AP=APRecycleBin.at(i);
-        mat[AP.getX()].erase(AP.getY()); /*NOTE (is actually =="find and remove", so no risk at segmentation faults due to
+        mat.erase(AP.getX(), AP.getY()); /*NOTE (is actually =="find and remove", so no risk at segmentation faults due to
         multiple removements!*/
     }
     APRecycleBin.clear();
@@ -900,47 +1245,37 @@ void GHM::removeAddedAnchorPoints(vector<AnchorPoint>& APRecycleBin)
 void  GHM::addAPFromSearchBox(int loX, int hiX, int loY, int hiY, SynthenicCloud& sCloud, vector<AnchorPoint>& foundAP)
 
 {
-    map<int, set<int> > &mat = matrix[MIXED_ORIENT];
-    map<int, set<int> >::const_iterator itX = mat.lower_bound(loX);
+    const HomologyMatrix &mat = matrix[MIXED_ORIENT];
+    HomologyMatrix::BoxIterator it = mat.getBox(loX, hiX, loY, hiY);
 
     int coX, coY; //coordinates of AP found in search box
 
-    for ( ; itX != mat.upper_bound(hiX); itX++) {
-        const set<int>& setY = itX->second;
-        set<int>::const_iterator itY = setY.lower_bound(loY);
+    for ( ; it.isValid(); it.next()) {
+        coX = it.getX();
+        coY = it.getY();
 
-        for ( ; itY !=setY.upper_bound(hiY); itY++) {
-            coX = itX->first;
-            coY = *itY;
-
-            sCloud.addAnchorPoint(coX,coY);
-            foundAP.push_back(AnchorPoint(coX,coY,true));
-        }
+        sCloud.addAnchorPoint(coX,coY);
+        foundAP.push_back(AnchorPoint(coX,coY,true));
     }
 }
 
 void GHM::addAPFromSearchBoxBF(int gap, int loX, int hiX, int loY, int hiY, SynthenicCloud& sCloud, vector< AnchorPoint >& foundAP)
 {
-    map<int, set<int> > &mat = matrix[MIXED_ORIENT];
-    map<int, set<int> >::const_iterator itX = mat.lower_bound(loX);
+    const HomologyMatrix &mat = matrix[MIXED_ORIENT];
+    HomologyMatrix::BoxIterator it = mat.getBox(loX, hiX, loY, hiY);
 
     int coX, coY; //coordinates of AP found in search box
 
-    for ( ; itX != mat.upper_bound(hiX); itX++) {
-        const set<int>& setY = itX->second;
-        set<int>::const_iterator itY = setY.lower_bound(loY);
-
-        for ( ; itY !=setY.upper_bound(hiY); itY++) {
-            coX = itX->first;
-            coY = *itY;
+    for ( ; it.isValid(); it.next()) {
+        coX = it.getX();
+        coY = it.getY();
 
-            //calculate distance to cloudIt
-            int dist=sCloud.distanceToCloud(coX,coY);
+        //calculate distance to cloudIt
+        int dist=sCloud.distanceToCloud(coX,coY);
 
-            if (dist<=gap) {
-                sCloud.addAnchorPoint(coX,coY);
-                foundAP.push_back(AnchorPoint(coX,coY,true));
-            }
+        if (dist<=gap) {
+            sCloud.addAnchorPoint(coX,coY);
+            foundAP.push_back(AnchorPoint(coX,coY,true));
         }
     }
 }
@@ -958,74 +1293,91 @@ void GHM::inflateClouds(uint gap, bool bf)
     }
 }
 
-void GHM::mergeClouds(uint clustergap, bool bf)
+bool GHM::cloudsMergeable(SynthenicCloud& sCloud1, SynthenicCloud& sCloud2,
+                          int max1, uint clustergap) const
 {
     int distEst; //estimate of distance between clouds
-    int sV1,sH1; //box side horizontal and vertical of box 1 and 2
-    int sV2,sH2;
-    int max1;  //maximum side of box 1
+    int sV2,sH2; //box side horizontal and vertical of box 2
     int max2;  //maximum side of box 2
     int max3;  //maximum side of the two boxes
 
     int dist;
 
-    list<SynthenicCloud*>::iterator it1=sClouds.begin();
+    if (boxOverlap(sCloud1,sCloud2)) {
 
-    for (; it1!=sClouds.end(); it1++) {
-        SynthenicCloud& sCloud1=*(*it1);
+        if (cloudsOverlap(sCloud1,sCloud2))
+            return true;
 
-        sH1=sCloud1.calculateBoxWidth();
-        sV1=sCloud1.calculateBoxHeight();
+        //FIXME this should be calcBruteForce -> since the boxes overlap closest points
+        //are not necessarily in the outer frames!!!!
+        dist=calculateMinimalKspdBetweenCloudsBruteForce(sCloud1,sCloud2/*,clustergap*/);
 
-        max1=max(sH1,sV1);
+        return (dist<clustergap);
+    }
 
-        list<SynthenicCloud*>::iterator it2=sClouds.begin();
-        for (; it2!=sClouds.end(); ) {
+    distEst=estimateCloudKspd(sCloud1,sCloud2);
 
-            if (it1==it2) { //don't compare cloud with itself
-                it2++;
-                continue;
-            }
-            SynthenicCloud& sCloud2=*(*it2);
+    sH2=sCloud2.calculateBoxWidth();
+    sV2=sCloud2.calculateBoxHeight();
 
-            if (boxOverlap(sCloud1,sCloud2)) {
+    max2=max(sH2,sV2);
+    max3=max(max1,max2);
 
-                if (cloudsOverlap(sCloud1,sCloud2)) {
-                    joinClouds(it1,it2,bf);
-                    it2=sClouds.begin(); //let it2 start over to allow further merging
-                } else {
+    //check if clouds could be close
+    if (distEst< max((int)clustergap,max3/2)) {
+        dist=calculateMinimalKspdBetweenClouds(sCloud1,sCloud2,clustergap);
+        return (dist<clustergap);
+    }
 
-                    //FIXME this should be calcBruteForce -> since the boxes overlap closest points
-                    //are not necessarily in the outer frames!!!!
-                    dist=calculateMinimalKspdBetweenCloudsBruteForce(sCloud1,sCloud2/*,clustergap*/);
+    return false;
+}
 
-                    if (dist<clustergap)
-                    {
-                        joinClouds(it1,it2,bf);
-                        it2=sClouds.begin(); //let it2 start over to allow further merging
-                    } else
-                        it2++;
-                }
-            } else {
-                distEst=estimateCloudKspd(sCloud1,sCloud2);
+void GHM::mergeClouds(uint clustergap, bool bf)
+{
+    int sV1,sH1; //box side horizontal and vertical of box 1
+    int max1;  //maximum side of box 1
 
-                sH2=sCloud2.calculateBoxWidth();
-                sV2=sCloud2.calculateBoxHeight();
+    // clouds are identified by their position in the list, which merging
+    // does not alter
+    vector<SynthenicCloud*> clouds;
+    vector<list<SynthenicCloud*>::iterator> cloudIts;
+    list<SynthenicCloud*>::iterator it=sClouds.begin();
+    for (; it!=sClouds.end(); it++) {
+        clouds.push_back(*it);
+        cloudIts.push_back(it);
+    }
+
+    // mergeable clouds are either overlapping or have APs less than
+    // clustergap apart, so only those within that range are evaluated
+    CloudGrid grid(clouds, clustergap);
+    vector<int> candidates;
+
+    for (int id1=0; id1<(int)clouds.size(); id1++) {
+        if (grid.find(id1)!=id1) //cloud was merged into another one
+            continue;
 
-                max2=max(sH2,sV2);
-                max3=max(max1,max2);
+        SynthenicCloud& sCloud1=*clouds[id1];
+
+        sH1=sCloud1.calculateBoxWidth();
+        sV1=sCloud1.calculateBoxHeight();
 
-                //check if clouds could be close
-                if (distEst< max((int)clustergap,max3/2)) {
-                    dist=calculateMinimalKspdBetweenClouds(sCloud1,sCloud2,clustergap);
-                    if (dist<clustergap) {
+        max1=max(sH1,sV1);
 
-                        joinClouds(it1,it2,bf);
-                        it2=sClouds.begin(); //let j start over to allow further merging
-                    } else
-                        it2++;
-                } else
-                    it2++;
+        // join the first mergeable cloud (in list order) until there are
+        // none left
+        bool joined=true;
+        while (joined) {
+            joined=false;
+            grid.getCandidates(id1, candidates);
+
+            for (size_t i=0; i<candidates.size(); i++) {
+                int id2=candidates[i];
+                if (cloudsMergeable(sCloud1,*clouds[id2],max1,clustergap)) {
+                    joinClouds(cloudIts[id1],cloudIts[id2],bf);
+                    grid.merge(id1,id2);
+                    joined=true;
+                    break;
+                }
             }
         }
     }
@@ -1120,62 +1472,19 @@ uint GHM::calculateMinimalKspdBetweenClouds(SynthenicCloud& sCloud1, SynthenicCl
     outerAPCloud1=sCloud1.calcAPInOuterFrame(frameThickness);
     outerAPCloud2=sCloud2.calcAPInOuterFrame(frameThickness);
 
-    int xAP1,yAP1;
-    int xAP2,yAP2;
-
-    int calcKspd;
-
-    for (int i=0; i<outerAPCloud1.size(); i++) {
-        xAP1=outerAPCloud1[i].getX();
-        yAP1=outerAPCloud1[i].getY();
-
-        for (int j=0; j<outerAPCloud2.size(); j++) {
-            xAP2=outerAPCloud2[j].getX();
-            yAP2=outerAPCloud2[j].getY();
-
-            calcKspd=Cluster::kspd(xAP1,yAP1,xAP2,yAP2);
-
-            if (calcKspd<minKspd)
-                minKspd=calcKspd;
-
-        }
-
-    }
-    return minKspd;
+    //minimal kspd between all pairs of AP in the frames
+    KspdIndex frameIndex(outerAPCloud2);
+    return frameIndex.distanceTo(outerAPCloud1,minKspd);
 }
 
 uint GHM::calculateMinimalKspdBetweenCloudsBruteForce(SynthenicCloud& sCloud1, SynthenicCloud& sCloud2) const
 {
-    vector<AnchorPoint>::const_iterator it1=sCloud1.getAPBegin();
-    vector<AnchorPoint>::const_iterator it2=sCloud2.getAPBegin();
-
-    vector<AnchorPoint>::const_iterator it1End=sCloud1.getAPEnd();
-    vector<AnchorPoint>::const_iterator it2End=sCloud2.getAPEnd();
-
-    unsigned int x1,y1,x2,y2; //AP coordinates in both clouds
+    //NOTE the original pairwise loop never reset the iterator over the
+    //second cloud, so only the first AP of the first cloud was compared
+    //with all AP of the second cloud; this behaviour is preserved
+    const AnchorPoint& first=*sCloud1.getAPBegin();
 
-    x1=it1->getX();
-    y1=it1->getY();
-    x2=it2->getX();
-    y2=it2->getY();
-
-    uint minDist = Cluster::kspd(x1,y1,x2,y2);
-    uint dist;
-
-    for (; it1!=it1End; it1++) {
-        for (; it2!=it2End; it2++) {
-
-            x1=it1->getX();
-            y1=it1->getY();
-            x2=it2->getX();
-            y2=it2->getY();
-
-            dist=Cluster::kspd(x1,y1,x2,y2);
-            if (minDist > dist)
-                minDist=dist;
-        }
-    }
-    return minDist;
+    return sCloud2.distanceToCloud(first.getX(),first.getY());
 }
 
 bool GHM::boxOverlap(SynthenicCloud& sCloud1, SynthenicCloud& sCloud2) const
@@ -1384,24 +1693,13 @@ void GHM::visualizeSynthenicCloudsPNG(const std::string& output_path) const
 
     Grafix png(xList.size() + 4 - (xList.size() % 4), yList.size()); //FIXME is this still necessary?
 
-    const map<int, set<int> > &mat = matrix[MIXED_ORIENT];
-    map<int, set<int> >::const_iterator itX = mat.begin();
-    map<int, set<int> >::const_iterator endX = mat.end();
+    HomologyMatrix::BoxIterator itP = matrix[MIXED_ORIENT].getAll();
 
     png.setDrawingColor(white);
 
     // plot all AP not in any cloud in white
-    for ( ; itX != endX; itX++) {
-        int x = itX->first;
-        const set<int> setY = itX->second;
-
-        set<int>::const_iterator itY = setY.begin();
-        set<int>::const_iterator endY = setY.end();
-
-        for ( ; itY != endY; itY++) {
-            int y = *itY;
-            png.putPixel(x, y);
-        }
+    for ( ; itP.isValid(); itP.next()) {
+        png.putPixel(itP.getX(), itP.getY());
     }
 
     //draw bounding box all clouds
@@ -1469,24 +1767,13 @@ void GHM::visualizeSynthenicClouds(const std::string& output_path) const
     Grafix bmp(xList.size() + 4 - (xList.size() % 4), yList.size());
 
 
-    const map<int, set<int> > &mat = matrix[MIXED_ORIENT];
-    map<int, set<int> >::const_iterator itX = mat.begin();
-    map<int, set<int> >::const_iterator endX = mat.end();
+    HomologyMatrix::BoxIterator itP = matrix[MIXED_ORIENT].getAll();
 
     bmp.setDrawingColor(white);
 
     // plot all AP not in any cloud in white
-    for ( ; itX != endX; itX++) {
-        int x = itX->first;
-        const set<int> setY = itX->second;
-
-        set<int>::const_iterator itY = setY.begin();
-        set<int>::const_iterator endY = setY.end();
-
-        for ( ; itY != endY; itY++) {
-            int y = *itY;
-            bmp.putPixel(x, y);
-        }
+    for ( ; itP.isValid(); itP.next()) {
+        bmp.putPixel(itP.getX(), itP.getY());
     }
 
     //draw bounding box all good clouds
@@ -1548,32 +1835,18 @@ void GHM::visualizeBaseClustersPNG(const std::string& output_path) const
                       +y_object.getListName()+".png";
     cout << "Visualize: " << filename  << endl;
 
-    map<int, set<int> >::iterator itX;
-    set<int>::const_iterator itY;
-
     const vector<ListElement*>& xList = x_object.getRemappedElements();
     const vector<ListElement*>& yList = y_object.getRemappedElements();
 
     Grafix png(xList.size() + 4 - (xList.size() % 4), yList.size());
 
     for (int orient = 0; orient < 2; orient++) {
-        const map<int, set<int> > &mat = matrix[orient];
-        map<int, set<int> >::const_iterator itX = mat.begin();
-        map<int, set<int> >::const_iterator endX = mat.end();
+        HomologyMatrix::BoxIterator itP = matrix[orient].getAll();
 
         png.setDrawingColor(white);
         // plot the dots which have never been in any cluster
-        for ( ; itX != endX; itX++) {
-            int x = itX->first;
-            const set<int> setY = itX->second;
-
-            set<int>::const_iterator itY = setY.begin();
-            set<int>::const_iterator endY = setY.end();
-
-            for ( ; itY != endY; itY++) {
-                int y = *itY;
-                png.putPixel(x, y);
-            }
+        for ( ; itP.isValid(); itP.next()) {
+            png.putPixel(itP.getX(), itP.getY());
         }
 
         vector<BaseCluster*>::const_iterator it;
@@ -1587,7 +1860,7 @@ void GHM::visualizeBaseClustersPNG(const std::string& output_path) const
             png.drawBox(xmin,xmax,ymin,ymax);
 
             png.setDrawingColor(white);
-            multiset<AnchorPoint>::const_iterator e = (*it)->getAPBegin();
+            vector<AnchorPoint>::const_iterator e = (*it)->getAPBegin();
             for ( ; e != (*it)->getAPEnd(); e++) {
                 int x = e->getX();
                 int y = e->getY();
@@ -1609,7 +1882,7 @@ void GHM::visualizeBaseClustersPNG(const std::string& output_path) const
 
 
         png.setDrawingColor(blue);
-        multiset<AnchorPoint>::const_iterator f = baseclusters[1][i]->getAPBegin();
+        vector<AnchorPoint>::const_iterator f = baseclusters[1][i]->getAPBegin();
         double upL,downL;
         double upR,downR;
         double xL,xR;
@@ -1630,7 +1903,7 @@ void GHM::visualizeBaseClustersPNG(const std::string& output_path) const
         }
 
         png.setDrawingColor(yellow);
-        multiset<AnchorPoint>::const_iterator e = baseclusters[1][i]->getAPBegin();
+        vector<AnchorPoint>::const_iterator e = baseclusters[1][i]->getAPBegin();
         for ( ; e != baseclusters[1][i]->getAPEnd(); e++) {
                 int x = e->getX();
                 int y = e->getY();
@@ -1653,7 +1926,7 @@ void GHM::visualizeBaseClustersPNG(const std::string& output_path) const
 
 
         png.setDrawingColor(blue);
-        multiset<AnchorPoint>::const_iterator f = baseclusters[0][i]->getAPBegin();
+        vector<AnchorPoint>::const_iterator f = baseclusters[0][i]->getAPBegin();
         double upL,downL;
         double upR,downR;
         double xL,xR;
@@ -1675,7 +1948,7 @@ void GHM::visualizeBaseClustersPNG(const std::string& output_path) const
 
 
         png.setDrawingColor(yellow);
-        multiset<AnchorPoint>::const_iterator e = baseclusters[0][i]->getAPBegin();
+        vector<AnchorPoint>::const_iterator e = baseclusters[0][i]->getAPBegin();
         for ( ; e != baseclusters[0][i]->getAPEnd(); e++) {
                 int x = e->getX();
                 int y = e->getY();
@@ -1698,7 +1971,7 @@ void GHM::visualizeBaseClustersPNG(const std::string& output_path) const
             png.drawBox(xmin,xmax,ymin,ymax);
 
             png.setDrawingColor(blue);
-            multiset<AnchorPoint>::const_iterator f = BCs[i]->getAPBegin();
+            vector<AnchorPoint>::const_iterator f = BCs[i]->getAPBegin();
             double upL,downL;
             double upR,downR;
             int xL,xR;
@@ -1715,7 +1988,7 @@ void GHM::visualizeBaseClustersPNG(const std::string& output_path) const
                 xL=xR;
             }
 
-            multiset<AnchorPoint>::const_iterator e = BCs[i]->getAPBegin();
+            vector<AnchorPoint>::const_iterator e = BCs[i]->getAPBegin();
             png.setDrawingColor(yellow);
             for ( ; e != BCs[i]->getAPEnd(); e++) {
                 int x = e->getX();
@@ -1738,32 +2011,18 @@ void GHM::visualizeBaseClusters(const std::string& output_path) const
                       +y_object.getListName()+".bmp";
     cout << "Visualize: " << filename  << endl;
 
-    map<int, set<int> >::iterator itX;
-    set<int>::const_iterator itY;
-
     const vector<ListElement*>& xList = x_object.getRemappedElements();
     const vector<ListElement*>& yList = y_object.getRemappedElements();
 
     Grafix bmp(xList.size() +  4 - (xList.size() % 4), yList.size());
 
     for (int orient = 0; orient < 2; orient++) {
-        const map<int, set<int> > &mat = matrix[orient];
-        map<int, set<int> >::const_iterator itX = mat.begin();
-        map<int, set<int> >::const_iterator endX = mat.end();
+        HomologyMatrix::BoxIterator itP = matrix[orient].getAll();
         bmp.setDrawingColor(white);
 
         // plot the dots which haven't been in any cluster
-        for ( ; itX != endX; itX++) {
-            int x = itX->first;
-            const set<int> setY = itX->second;
-
-            set<int>::const_iterator itY = setY.begin();
-            set<int>::const_iterator endY = setY.end();
-
-            for ( ; itY != endY; itY++) {
-                int y = *itY;
-                bmp.putPixel(x, y);
-            }
+        for ( ; itP.isValid(); itP.next()) {
+            bmp.putPixel(itP.getX(), itP.getY());
         }
 
         vector<BaseCluster*>::const_iterator it;
@@ -1777,7 +2036,7 @@ void GHM::visualizeBaseClusters(const std::string& output_path) const
             bmp.drawBox(xmin,xmax,ymin,ymax);
 
             bmp.setDrawingColor(white);
-            multiset<AnchorPoint>::const_iterator e = (*it)->getAPBegin();
+            vector<AnchorPoint>::const_iterator e = (*it)->getAPBegin();
             for ( ; e != (*it)->getAPEnd(); e++) {
                 int x = e->getX();
                 int y = e->getY();
@@ -1799,7 +2058,7 @@ void GHM::visualizeBaseClusters(const std::string& output_path) const
             bmp.drawBox(xmin,xmax,ymin,ymax);
 
             bmp.setDrawingColor(blue);
-            multiset<AnchorPoint>::const_iterator f = BCs[i]->getAPBegin();
+            vector<AnchorPoint>::const_iterator f = BCs[i]->getAPBegin();
             double upL,downL;
             double upR,downR;
             int xL,xR;
@@ -1816,7 +2075,7 @@ void GHM::visualizeBaseClusters(const std::string& output_path) const
                 xL=xR;
             }
 
-            multiset<AnchorPoint>::const_iterator e = BCs[i]->getAPBegin();
+            vector<AnchorPoint>::const_iterator e = BCs[i]->getAPBegin();
             bmp.setDrawingColor(yellow);
             for ( ; e != BCs[i]->getAPEnd(); e++) {
                 int x = e->getX();
@@ -1841,7 +2100,7 @@ void GHM::removeAPFromMultiplicons(const vector<Multiplicon*>& mps) {
 
         for (int j=0; j<BCs.size(); j++)
         {
-            multiset<AnchorPoint>::const_iterator it=BCs[j]->getAPBegin();
+            vector<AnchorPoint>::const_iterator it=BCs[j]->getAPBegin();
 
             for (; it!=BCs[j]->getAPEnd(); it++) {
                 APinMps.push_back(*it);
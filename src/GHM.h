@@ -2,6 +2,7 @@
 #define __GHM_H
 
 #include "GeneList.h"
+#include "HomologyMatrix.h"
 #include "bmp/bmp.h"
 #include "bmp/grafix.h"
 
@@ -60,6 +61,44 @@ public:
     */
     void run(const Settings& sett);
 
+    /**
+    * Prepares a run with the seeding and enrichment (condensing in cloud
+    * mode) split over at most NUM_BANDS x-bands. The bands are independent
+    * GHMs that can be processed in parallel with runBand(), after which
+    * finishBanded() seeds around the band boundaries and merges the
+    * clusters that cross them. The bands only depend on the points, so the
+    * result does not depend on the number of threads. It is not
+    * necessarily identical to that of run(): a cluster close to a boundary
+    * can grow from other seeds. If the points cannot be split, run() is
+    * used instead.
+    *
+    * @param sett Settings object with the settings needed to run the algorithm
+    * @param bands GHMs of the bands (output)
+    * @param boundaries First x-coordinate of every band but the first (output)
+    * @return True if the bands still have to be processed and finished
+    */
+    bool beginBanded(const Settings& sett, vector<GHM*>& bands,
+                     vector<int>& boundaries);
+
+    /**
+    * Seeds and enriches (condenses in cloud mode) the clusters of a band
+    * @param sett Settings object with the settings needed to run the algorithm
+    */
+    void runBand(const Settings& sett);
+
+    /**
+    * Stitches the processed bands together and finishes the run
+    * @param sett Settings object with the settings needed to run the algorithm
+    * @param bands GHMs of the bands, they are deleted
+    * @param boundaries First x-coordinate of every band but the first
+    */
+    void finishBanded(const Settings& sett, vector<GHM*>& bands,
+                      const vector<int>& boundaries);
+
+    // maximum number of bands of a split GHM, every boundary is a chance
+    // to deviate from the unsplit result
+    static const int NUM_BANDS = 8;
+
     /**
     * This creates every matching point in the matrix,
     *
@@ -166,6 +205,35 @@ private:
     */
     void runCollinear(const Settings& settings);
 
+    /**
+    * Seeds, enriches and joins baseclusters for all gap sizes
+    */
+    void detectBaseClusters(const Settings& settings);
+
+    /**
+    * Final enrichment, filtering and metaclustering of the baseclusters
+    */
+    void finishBaseClusters(const Settings& settings);
+
+    /**
+    * Moves the points to x-bands with about the same number of points
+    * @param nBands Maximum number of bands
+    * @param bands GHMs of the bands (output)
+    * @param boundaries First x-coordinate of every band but the first (output)
+    * @return False if the points cannot be split, nothing is moved then
+    */
+    bool splitIntoBands(int nBands, vector<GHM*>& bands,
+                        vector<int>& boundaries);
+
+    /**
+    * Collects the clusters and remaining points of the bands, in band
+    * order, and merges the clusters across the band boundaries
+    * @param bands GHMs of the bands, they are deleted
+    * @param boundaries First x-coordinate of every band but the first
+    */
+    void stitchBands(vector<GHM*>& bands, const vector<int>& boundaries,
+                     const Settings& settings);
+
     /**
     *calculates a number of properties used in the statistical validation of clusters
     */
@@ -179,6 +247,13 @@ private:
     */
     void seedBaseClusters(int gap, bool orientation, double qValue);
 
+    /**
+    * Creates initial baseclusters from the seeds an iterator visits
+    * @param it Iterator over the seeds
+    */
+    void seedBaseClusters(int gap, bool orientation, double qValue,
+                          HomologyMatrix::BoxIterator it);
+
     /**
      * Creates initial baseclusters starting from a singleton basecluster
      * @param basecluster Basecluster object (input / output)
@@ -204,6 +279,19 @@ private:
      */
     void joinClusters(int gap, bool orientation, double qValue);
 
+    /**
+     * Checks whether two baseclusters of the same orientation class can be
+     * joined
+     * @param cI First cluster
+     * @param cJ Second cluster
+     * @param gap Maximum gap size allowed between the two clusters
+     * @param qValue Qualitiy assessment criterium
+     * @param distance Distance between the two clusters (output)
+     * @return True if the clusters can be joined
+     */
+    bool evaluateJoin(BaseCluster& cI, BaseCluster& cJ, int gap,
+                      double qValue, double& distance);
+
     /**
      * Searches for the closest clusters within specified orientation classes
      * @param gap Maximum gap size allowed between the two clusters
@@ -272,6 +360,16 @@ private:
     */
     void runSyntheny(const Settings& settings);
 
+    /**
+    * Condenses, inflates and merges clouds for all gap sizes
+    */
+    void detectClouds(const Settings& settings);
+
+    /**
+    * Filters the clouds with the configured method
+    */
+    void filterClouds(const Settings& settings);
+
     /**
     * Creates intial clouds
     * @param gap Gap size (criterium for adding new points to the SC) ->extension over which is the bounding box is resized
@@ -279,6 +377,12 @@ private:
     */
     void condenseClouds(uint gap, bool bf);
 
+    /**
+    * Creates initial clouds from the seeds an iterator visits
+    * @param it Iterator over the seeds
+    */
+    void condenseClouds(uint gap, bool bf, HomologyMatrix::BoxIterator it);
+
     /**
     * In contrast to the equivalent seedBaseCluster condenseCloud can also inflate nonunit size clouds
     * @param gap Gap size (criterium for adding new points to the SC) ->extension over which is the bounding box is resized
@@ -288,6 +392,16 @@ private:
     */
     void condenseCloud(SynthenicCloud& sCloud, uint gap, vector<AnchorPoint>& foundNewAP, bool bf);
 
+    /**
+    * Condenses a cloud without bruteforce: the bounding box is repeatedly extended by gap on all sides
+    * until no more AP are found. Only the part of the extended box that was not searched before is
+    * visited, so every point of the GHM is visited at most once
+    * @param sCloud Cloud to be inflated
+    * @param gap Gap size
+    * @param foundNewAP New AP found during condensing process
+    */
+    void expandCloud(SynthenicCloud& sCloud, int gap, vector<AnchorPoint>& foundNewAP);
+
 
 
     /**
@@ -329,6 +443,14 @@ private:
     */
     void mergeClouds(uint clustergap, bool bf);
 
+    /**
+    * Checks whether two clouds lie closely enough together to be merged
+    * @param max1 Maximum side of the bounding box of the first cloud
+    * @param clustergap Maximum distance between the clouds
+    */
+    bool cloudsMergeable(SynthenicCloud& sCloud1, SynthenicCloud& sCloud2,
+                         int max1, uint clustergap) const;
+
     /**
     * The difference with mergeClouds is that always the exact distance will be calculated between the clouds
     * which is alot more time intensive, and not really useful
@@ -352,8 +474,9 @@ private:
     uint calculateMinimalKspdBetweenClouds(SynthenicCloud& scloud1, SynthenicCloud& scloud2, uint frameThickness) const;
 
     /**
-    * Calculates the exact distance between two clusters by calculating the distance between all AP pairs
-    * @return Returns exact distance O(AP^2) time!
+    * Calculates the distance between the first AP of the first cloud and the closest AP of the second cloud
+    * (the behaviour of the former pairwise loop, which never reset its inner iterator)
+    * @return Returns the distance, O(log AP) time using the index of the second cloud
     */
     uint calculateMinimalKspdBetweenCloudsBruteForce(SynthenicCloud& scloud1, SynthenicCloud& scloud2) const;
 
@@ -427,7 +550,7 @@ protected:
     int level;
 
     //vector of 2 homology matrices (one for every orientation)
-    vector<map<int, set<int> > > matrix;
+    vector<HomologyMatrix> matrix;
 
     //vector containing the multiplicons
     vector<Multiplicon*> multiplicons;
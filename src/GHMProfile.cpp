@@ -6,11 +6,13 @@
 #include "ListElement.h"
 #include "Gene.h"
 #include "Multiplicon.h"
+#include "HomologPointCache.h"
 
 #include <cassert>
 
-GHMProfile::GHMProfile(const Profile& xObject, const GeneList& yObject)
-: GHM(*xObject.getSegments()[0], yObject), x_object(xObject) {
+GHMProfile::GHMProfile(const Profile& xObject, const GeneList& yObject,
+                       HomologPointCache *_cache)
+: GHM(*xObject.getSegments()[0], yObject), x_object(xObject), cache(_cache) {
     level = xObject.getLevel() + 1;
 }
 
@@ -24,6 +26,10 @@ void GHMProfile::buildMatrix ()
     matrix.clear();
     matrix.resize(2);
 
+    // the same point can be found through several segments of the profile
+    vector<pair<int, int> > points[2];
+    vector<int> positions;
+
     for (unsigned int i = 0; i < x_object.getSegments().size(); i++) {
 
         const vector<ListElement*>& xList = x_object.getSegments()[i]->getRemappedElements();
@@ -35,13 +41,15 @@ void GHMProfile::buildMatrix ()
             if (xElement.isGap()) continue;
             if (!xElement.getGene().hasPairs()) continue;
 
-            std::queue<int> queue;
-            xElement.matchingPositions(yList, queue);
+            const vector<int> *matches = &positions;
+            if (cache != NULL)
+                matches = &cache->matchingPositions(y_object,
+                                                    xElement.getGene());
+            else
+                y_object.matchingPositions(xElement.getGene(), positions);
 
-            while (!queue.empty()) {
-                // get and remove first element
-                unsigned int y = queue.front();
-                queue.pop();
+            for (unsigned int j = 0; j < matches->size(); j++) {
+                unsigned int y = (*matches)[j];
 
                 const ListElement &yElement = *yList[y];
 
@@ -49,13 +57,16 @@ void GHMProfile::buildMatrix ()
                                       yElement.getOrientation()) ?
                     SAME_ORIENT : OPP_ORIENT;
 
-                if (matrix[orient][x].find(y) == matrix[orient][x].end()) {
-                    count_points[orient]++;
-                    matrix[orient][x].insert(y);
-                }
+                points[orient].push_back(pair<int, int>(x, y));
             }
         }
     }
+
+    // duplicates are removed when building the matrix
+    for (int orient = 0; orient < 2; orient++) {
+        matrix[orient].build(points[orient]);
+        count_points[orient] = matrix[orient].size();
+    }
 }
 
 void GHMProfile::getMultiplicons(vector<Multiplicon*>& mps) const
@@ -87,7 +98,7 @@ void GHMProfile::setMultiplicons(bool useFamily, int minHomologs)
 
             vector<AnchorPoint> false_anchorpoints;
 
-            multiset<AnchorPoint>::const_iterator e = baseclusters[j]->getAPBegin();
+            vector<AnchorPoint>::const_iterator e = baseclusters[j]->getAPBegin();
             for ( ; e != baseclusters[j]->getAPEnd(); e++) {
                 int x = e->getX();
                 int y = e->getY();
@@ -146,31 +157,17 @@ void GHMProfile::visualizeGHM(const std::string& output_path) const
     string filename = "GHMProfile"+string(lev)+"_"+string(multip)+"_"+y_object.getListName()+".png";
     cout << "Visualize: " << filename << endl;
 
-    map<int, set<int> >::iterator itX;
-    set<int>::const_iterator itY;
-
     const vector<ListElement*>& yList = y_object.getRemappedElements();
 
     Grafix png(x_object.getSize() + 4 - (x_object.getSize() % 4), yList.size());
 
     for (int orient = 0; orient < 2; orient++) {
-        const map<int, set<int> > &mat = matrix[orient];
-        map<int, set<int> >::const_iterator itX = mat.begin();
-        map<int, set<int> >::const_iterator endX = mat.end();
+        HomologyMatrix::BoxIterator itP = matrix[orient].getAll();
 
         png.setDrawingColor(white);
         // plot the dots which have never been in any cluster
-        for ( ; itX != endX; itX++) {
-            int x = itX->first;
-            const set<int> setY = itX->second;
-
-            set<int>::const_iterator itY = setY.begin();
-            set<int>::const_iterator endY = setY.end();
-
-            for ( ; itY != endY; itY++) {
-                int y = *itY;
-                png.putPixel(x, y);
-            }
+        for ( ; itP.isValid(); itP.next()) {
+            png.putPixel(itP.getX(), itP.getY());
         }
 
         vector<BaseCluster*>::const_iterator it;
@@ -184,7 +181,7 @@ void GHMProfile::visualizeGHM(const std::string& output_path) const
             png.drawBox(xmin,xmax,ymin,ymax);
 
             png.setDrawingColor(white);
-            multiset<AnchorPoint>::const_iterator e = (*it)->getAPBegin();
+            vector<AnchorPoint>::const_iterator e = (*it)->getAPBegin();
             for ( ; e != (*it)->getAPEnd(); e++) {
                     int x = e->getX();
                     int y = e->getY();
@@ -207,7 +204,7 @@ void GHMProfile::visualizeGHM(const std::string& output_path) const
             png.drawBox(xmin,xmax,ymin,ymax);
 
             png.setDrawingColor(blue);
-            multiset<AnchorPoint>::const_iterator f = BCs[i]->getAPBegin();
+            vector<AnchorPoint>::const_iterator f = BCs[i]->getAPBegin();
             double upL,downL;
             double upR,downR;
             int xL,xR;
@@ -224,7 +221,7 @@ void GHMProfile::visualizeGHM(const std::string& output_path) const
                 xL=xR;
             }
 
-            multiset<AnchorPoint>::const_iterator e = BCs[i]->getAPBegin();
+            vector<AnchorPoint>::const_iterator e = BCs[i]->getAPBegin();
             png.setDrawingColor(yellow);
             for ( ; e != BCs[i]->getAPEnd(); e++) {
                 int x = e->getX();
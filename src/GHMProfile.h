@@ -4,6 +4,7 @@
 #include "GHM.h"
 
 class Profile;
+class HomologPointCache;
 class ListElement;
 class Gene;
 
@@ -20,8 +21,10 @@ public:
     *
     * @param xObject The Profile object corresponding to the X-axis
     * @param yObject The GeneList object corresponding to the Y-axis
+    * @param cache Cache of homologous positions in yObject, can be NULL
     */
-    GHMProfile(const Profile& xObject, const GeneList& yObject);
+    GHMProfile(const Profile& xObject, const GeneList& yObject,
+               HomologPointCache *cache = NULL);
 
     //////////////////
     //PUBLIC METHODS//
@@ -55,6 +58,7 @@ private:
     //////////////
 
     const Profile& x_object;
+    HomologPointCache *cache;
 };
 
 #endif
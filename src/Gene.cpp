@@ -1,32 +1,55 @@
 #include "Gene.h"
+#include "datastructures/StringTable.h"
+
+#include <pthread.h>
+
+// shared copies of the genome and family names
+static StringTable nameTable;
+static pthread_mutex_t nameMutex = PTHREAD_MUTEX_INITIALIZER;
+static const string emptyName;
+
+const string* Gene::internName(const string& name)
+{
+    if (name.empty())
+        return &emptyName;
+
+    pthread_mutex_lock(&nameMutex);
+    const string* interned = &nameTable.getString(nameTable.intern(name));
+    pthread_mutex_unlock(&nameMutex);
+    return interned;
+}
 
 Gene::Gene(const string& _ID, const string& genomeName, const int _coordinate,
+           const bool _orientation) : ID(_ID),
+        genomename(internName(genomeName)), coordinate(_coordinate),
+        orientation(_orientation), is_tandem(false),
+        is_tandem_representative(false), remapped(false), gf_id(&emptyName),
+        famID(0), has_gf(false), internID(0), pairs(NULL), numPairs(0)
+{
+
+}
+
+Gene::Gene(const string& _ID, const string* genomeName, const int _coordinate,
            const bool _orientation) : ID(_ID), genomename(genomeName),
         coordinate(_coordinate), orientation(_orientation), is_tandem(false),
-        is_tandem_representative(false), remapped(false), has_gf(false),
-        pairs(NULL)
+        is_tandem_representative(false), remapped(false), gf_id(&emptyName),
+        famID(0), has_gf(false), internID(0), pairs(NULL), numPairs(0)
 {
 
 }
 
-Gene::Gene() : pairs(NULL)
+Gene::Gene() : genomename(&emptyName), gf_id(&emptyName), famID(0),
+    has_gf(false), internID(0), pairs(NULL), numPairs(0)
 {
 
 }
 
 bool Gene::isPairWith(const Gene& gene) const
 {
-    if (has_gf) {
-        if (gf_id == gene.getFamily() && ID != gene.getID())
-            return true;
-        else
-            return false;
-    } else {
-        if (hasPairs() && pairs->find(string(gene.getID())) != pairs->end())
-            return true;
-    }
+    if (has_gf)
+        return (famID == gene.famID && internID != gene.internID);
 
-    return false;
+    return std::binary_search(pairs, pairs + numPairs, gene.internID);
 }
 
 
@@ -39,11 +62,14 @@ bool Gene::isIndirectPairWith(const Gene& gene) const
     // is it a direct pair?
     if (isPairWith(gene)) return true;
 
-    // is it an indirect pair
-    hash_set<string,stringhash>::const_iterator it = pairs->begin();
-    for ( ; it != pairs->end(); it++)
-        if (gene.pairs->find(*it) != gene.pairs->end())
-            return true;
+    // is it an indirect pair: do both sorted pair arrays intersect?
+    const uint32_t *a = pairs, *aEnd = pairs + numPairs;
+    const uint32_t *b = gene.pairs, *bEnd = gene.pairs + gene.numPairs;
+    while (a != aEnd && b != bEnd) {
+        if (*a < *b) a++;
+        else if (*b < *a) b++;
+        else return true;
+    }
 
     return false;
 }
@@ -2,7 +2,7 @@
 #define __GENE_H
 
 #include "headers.h"
-
+#include <stdint.h>
 
 
 class Gene {
@@ -18,13 +18,20 @@ public:
     Gene(const string& ID, const string& genomeName, const int coordinate,
          const bool orientation);
 
+    /*
+    *constructs the gene with a genome name obtained from internName()
+    */
+    Gene(const string& ID, const string* genomeName, const int coordinate,
+         const bool orientation);
+
     /*
     *default constructor (gap)
     */
     Gene();
 
     //operator the combination genomename && ID should be unique !!
-    bool operator== (Gene other) const {
+    bool operator== (const Gene& other) const {
+        // genome names are interned: equal names share the same string
         return (genomename == other.genomename && ID == other.ID);
     }
 
@@ -37,9 +44,15 @@ public:
     *returns the genome name
     */
     const string& getGenomeName() const {
-        return genomename;
+        return *genomename;
     }
 
+    /*
+    *returns the shared copy of a genome or family name, genes refer to
+    *these copies instead of storing the name themselves (thread-safe)
+    */
+    static const string* internName(const string& name);
+
     /*
     *returns the ID of this gene
     */
@@ -48,17 +61,47 @@ public:
     }
 
     /*
-    *sets the pairs corresponding this gene
+    *returns the interned (dense, numerical) identifier of this gene
+    */
+    uint32_t getInternID() const {
+        return internID;
+    }
+
+    /*
+    *sets the interned identifier of this gene
     */
-    void setPairs(const hash_set<string,stringhash>& table) {
-        pairs = &table;
+    void setInternID(uint32_t ID) {
+        internID = ID;
+    }
+
+    /*
+    *sets the pairs corresponding this gene: a sorted array with the
+    *interned identifiers of the homologous genes
+    */
+    void setPairs(const uint32_t* pairs_, uint32_t numPairs_) {
+        pairs = pairs_;
+        numPairs = numPairs_;
     }
 
     /*
     *returns true if this gene has pairs
     */
     bool hasPairs() const {
-        return (pairs != NULL || has_gf);
+        return (numPairs != 0 || has_gf);
+    }
+
+    /*
+    *returns the number of pairs of this gene (pairs mode only)
+    */
+    uint32_t getNumPairs() const {
+        return numPairs;
+    }
+
+    /*
+    *returns the sorted interned identifiers of the pairs of this gene
+    */
+    const uint32_t* getPairs() const {
+        return pairs;
     }
 
     /*
@@ -76,6 +119,22 @@ public:
     */
     void remapTo(Gene& gene);
 
+    /*
+    *restores the tandem state of the gene as computed by remapTo
+    *@param isTandem True if the gene forms a tandem
+    *@param isRepresentative True if the gene is the tandem representative
+    *@param isRemapped True if the gene was remapped
+    *@param representative The tandem representative (NULL if no tandem)
+    */
+    void restoreTandem(bool isTandem, bool isRepresentative, bool isRemapped,
+                       const Gene* representative)
+    {
+        is_tandem = isTandem;
+        is_tandem_representative = isRepresentative;
+        remapped = isRemapped;
+        tandem_representative = representative;
+    }
+
     /*
     *returns true if this gene was remapped
     */
@@ -137,12 +196,25 @@ public:
     *returns the gene family ID of this gene
     */
     const string& getFamily() const {
-        return gf_id;
+        return *gf_id;
+    }
+
+    /*
+    *returns the interned identifier of the gene family of this gene
+    */
+    uint32_t getFamilyID() const {
+        return famID;
     }
 
-    void setFamily(string fam)
+    /*
+    *sets the gene family of this gene
+    *@param fam Gene family ID
+    *@param famID_ Interned identifier of the gene family
+    */
+    void setFamily(const string& fam, uint32_t famID_)
     {
-        gf_id = fam;
+        gf_id = internName(fam);
+        famID = famID_;
         has_gf = true;
     }
 
@@ -153,18 +225,21 @@ private:
     //////////////
 
     string ID;
-    string genomename;
+    const string* genomename;   // interned
     int coordinate;
     bool orientation;
     int remapped_coordinate;
     bool is_tandem;
     bool is_tandem_representative;
     bool remapped;
-    string gf_id;
+    const string* gf_id;        // interned
+    uint32_t famID;
     bool has_gf;
+    uint32_t internID;
 
     const Gene* tandem_representative; // pointer to the representative
-    const hash_set<string, stringhash>* pairs; // pointer to the pairs
+    const uint32_t* pairs; // pointer to the (sorted) interned pair IDs
+    uint32_t numPairs;
 };
 
 #endif
@@ -1,47 +1,83 @@
 #include "GeneFamily.h"
 
-GeneFamily::GeneFamily(const string& blastTableFile) 
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+GeneFamily::GeneFamily(const string& blastTableFile, const StringTable& geneIDs_,
+		       int numThreads) : geneIDs(geneIDs_)
 {
-	//only read the gene pairs if they haven't been read before
-	if (pairs.size() != 0) return;
+	MappedFile file(blastTableFile, "BLAST table file");
 
-	ifstream fin(blastTableFile.c_str());
-	if (!fin) throw FileException ("Error opening BLAST table file: " + 
-						blastTableFile);
+	if (numThreads < 1) numThreads = 1;
+	chunkGenes.resize(numThreads);
+	chunkFamilies.resize(numThreads);
+	int numChunks = file.parse(*this, numThreads);
 
-	string A, F;
+	// merge the chunks in file order, a later line overrides an earlier one
+	// a local copy, assign() would need a definition of NOT_FOUND
+	const uint32_t notFound = StringTable::NOT_FOUND;
+	familyOf.assign(geneIDs.size(), notFound);
+	for (int c = 0; c < numChunks; c++) {
+		const StringTable& local = chunkFamilies[c];
+		vector<uint32_t> localToGlobal(local.size());
+		for (uint32_t f = 0; f < local.size(); f++)
+			localToGlobal[f] = families.intern(local.getString(f));
 
-	while(readLine(fin, A, F))
-		pairs[A] = F;
+		const vector<pair<uint32_t, uint32_t> >& genes = chunkGenes[c];
+		for (size_t i = 0; i < genes.size(); i++)
+			familyOf[genes[i].first] = localToGlobal[genes[i].second];
+	}
 
-	fin.close();
+	chunkGenes.clear();
+	chunkFamilies.clear();
 }
 
-bool GeneFamily::readLine(ifstream& fin, string &geneA, string &geneB)
+void GeneFamily::parseChunk(const char* begin, const char* end, int chunkID)
 {
-        getline(fin, geneA, '\t');
-        if (!fin.good()) return false;
-        getline(fin, geneB);
+	vector<pair<uint32_t, uint32_t> >& genes = chunkGenes[chunkID];
+	StringTable& localFamilies = chunkFamilies[chunkID];
 
-        // perhaps we are reading the final empty line(s) of the file
-        if (geneA.empty() || geneB.empty()) return false;
+	// reused for every line to avoid an allocation per name
+	string buf;
 
-        char charA = geneA[geneA.length()-1];  // final character in geneA
-        if ((charA == '+') || (charA == '-')) geneA.erase(geneA.length()-1);
+	for (const char* line = begin; line < end; ) {
+		const char* eol = (const char*)memchr(line, '\n', end - line);
+		if (eol == NULL) eol = end;
 
-        char charB = geneB[geneB.length()-1];  // final character in geneB
-        if ((charB == '+') || (charB == '-')) geneB.erase(geneB.length()-1);
+		// the gene ends at the first tab, the family is the remainder
+		// of the line
+		const char* tab = (const char*)memchr(line, '\t', eol - line);
 
-        return true;
+		// skip empty lines and lines without a family
+		if ((tab != NULL) && (tab > line) && (tab + 1 < eol)) {
+			// strip the orientations
+			const char* endA = tab;
+			if ((endA[-1] == '+') || (endA[-1] == '-')) endA--;
+			const char* endF = eol;
+			if ((endF[-1] == '+') || (endF[-1] == '-')) endF--;
+
+			buf.assign(line, endA);
+			uint32_t A = geneIDs.find(buf);
+			if (A != StringTable::NOT_FOUND) {
+				buf.assign(tab + 1, endF);
+				genes.push_back(pair<uint32_t, uint32_t>
+						(A, localFamilies.intern(buf)));
+			}
+		}
+
+		line = eol + 1;
+	}
 }
 
-const string& GeneFamily::getFamilyOf(const string& geneName)
+const string& GeneFamily::getFamilyOf(uint32_t geneID) const
 {
-	if (pairs.find(geneName) != pairs.end()) {
-		return pairs[geneName];
+	if (hasFamily(geneID)) {
+		return families.getString(familyOf[geneID]);
 	}
 	else {
-		cerr << geneName << " not found in blast table. EXITING...." 
+		cerr << geneIDs.getString(geneID) << " not found in blast table. EXITING...."
 		     << endl << endl;
 		exit(EXIT_FAILURE);
 	}
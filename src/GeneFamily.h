@@ -3,8 +3,19 @@
 
 #include "debug/FileException.h"
 #include "headers.h"
+#include "MappedFile.h"
+#include "datastructures/StringTable.h"
 
-class GeneFamily
+#include <stdint.h>
+
+/*
+ * Family of every gene, read from a tab separated file with one gene and
+ * its family per line. Genes that are absent from every gene list are
+ * dropped while parsing. The file can be parsed by several threads: every
+ * thread collects the families of one chunk of lines, the chunks are merged
+ * in file order afterwards so that the last line of a gene wins.
+ */
+class GeneFamily : private ChunkParser
 {
 public:
 	////////////////
@@ -12,42 +23,55 @@ public:
 	////////////////
 
 	/*
-	 *constructor that reads the blasttable file and builds up the hashtable
+	 *constructor that reads the blasttable file and builds up the table
+	 * @param blastTableFile Tab separated file with gene-family lines
+	 * @param geneIDs Interning table with the names of all genes in the
+	 * gene lists
+	 * @param numThreads Number of threads used to parse the file
 	 */
-	GeneFamily(const string& blastTableFile);
+	GeneFamily(const string& blastTableFile, const StringTable& geneIDs,
+		   int numThreads = 1);
 
 	//////////////////
 	//PUBLIC METHODS//
 	//////////////////
 
 	/*
-	 * returns a pointer to the hashtable containing the genes
-	 * corresponding with the specified genome
+	 * returns the family of the gene with the specified interned
+	 * identifier, exits if the gene is not in the file
 	 */
-	const string& getFamilyOf(const string& geneName);
+	const string& getFamilyOf(uint32_t geneID) const;
 
-	bool hasFamily(const string& geneName) {
-		return (pairs.find(geneName) != pairs.end());
+	bool hasFamily(uint32_t geneID) const {
+		return (familyOf[geneID] != StringTable::NOT_FOUND);
 	}
 
 private:
 	///////////////////
 	//PRIVATE METHODS//
 	///////////////////
-		
+
 	/*
-	 * reads a single line from the blast table file and puts the 2
-	 * genes into the 2 strings
+	 * Parses the lines in [begin, end) into the buffers of the chunk
 	 */
-	bool readLine(ifstream& fin, string &geneA, string &geneB);
+	void parseChunk(const char* begin, const char* end, int chunkID);
 
 	//////////////
 	//ATTRIBUTES//
 	//////////////
 
-	//the hash_map containing all pairs read from the blast table file
-	hash_map<string, string, stringhash> pairs;
+	// the interning table of the genes in the gene lists
+	const StringTable& geneIDs;
+
+	// (gene, chunk family) pairs and family names read by every chunk
+	vector<vector<pair<uint32_t, uint32_t> > > chunkGenes;
+	vector<StringTable> chunkFamilies;
+
+	// family names
+	StringTable families;
 
+	// family of every gene in the gene lists, NOT_FOUND if unknown
+	vector<uint32_t> familyOf;
 };
 
 
@@ -3,22 +3,41 @@
 #include "Gene.h"
 #include "ListElement.h"
 
+#include "WireFormat.h"
+
 #include "debug/FileException.h"
 #include <cassert>
+#include <climits>
+
+// flags of a packed segment element
+static const unsigned char ELEMENT_GAP = 1;
+static const unsigned char ELEMENT_ORIENTATION = 2;
+static const unsigned char ELEMENT_MASKED = 4;
+static const unsigned char ELEMENT_HOMOLOG = 8;
+static const unsigned char ELEMENT_AP = 16;
+static const unsigned char ELEMENT_AL_HOMOLOG = 32;
+static const unsigned char ELEMENT_AL_AP = 64;
 
 GeneList::GeneList(const string& listName, const string& genomeName,
                    const string& fileName) :
-        is_segment(false), listname(listName), genomename(genomeName), id(-1)
+        is_segment(false), listname(listName), genomename(genomeName),
+        hasHomologIndex(false), familyIndex(false), id(-1), maskVersion(0)
 {
     ifstream fin (fileName.c_str());
 
     if (!fin) throw FileException("Could not open gene list file: " +
                                       fileName + "!");
 
-    int coordinate = 0;
-    string ID;
+    vector<string> IDs;
+    for (string ID; fin >> ID; )
+        IDs.push_back(ID);
+
+    // intern the genome name once for all genes of the list
+    const string* genome = Gene::internName(genomename);
 
-    while (fin >> ID) {
+    store.reserve(IDs.size());
+    for (size_t coordinate = 0; coordinate < IDs.size(); coordinate++) {
+        string &ID = IDs[coordinate];
         char c = ID[ID.length()-1];  // final character in ID
 
         if (c != '+' && c != '-') {
@@ -29,23 +48,32 @@ GeneList::GeneList(const string& listName, const string& genomeName,
         bool orientation = (c == '+');
         ID.erase(ID.length()-1);    // erase final character
 
-        Gene gene (ID, genomename, coordinate, orientation);
-        elements.push_back(new ListElement(gene, orientation, false));
-        coordinate++;
+        Gene gene (ID, genome, coordinate, orientation);
+        addGene(gene);
     }
 
     fin.close();
 }
 
+GeneList::GeneList(const string& listName, const string& genomeName,
+                   size_t numGenes) :
+        is_segment(false), listname(listName), genomename(genomeName),
+        hasHomologIndex(false), familyIndex(false), id(-1), maskVersion(0)
+{
+    store.reserve(numGenes);
+}
+
 GeneList::GeneList(const string& listName, const string& genomeName, const vector< ListElement* >& segmentFromFile)
-    : is_segment(true), listname(listName), genomename(genomeName), id(-1)
+    : is_segment(true), listname(listName), genomename(genomeName),
+    hasHomologIndex(false), familyIndex(false), id(-1), maskVersion(0)
 {
     for (int i=0; i<segmentFromFile.size(); i++){
         remapped_elements.push_back(new ListElement(*segmentFromFile[i]));
     }
 }
 
-GeneList::GeneList(int size) : is_segment(true), id(-1)
+GeneList::GeneList(int size) : is_segment(true), hasHomologIndex(false),
+    familyIndex(false), id(-1), maskVersion(0)
 {
     Gene gene;
     for (int i = 0; i < size; i++)
@@ -54,7 +82,9 @@ GeneList::GeneList(int size) : is_segment(true), id(-1)
 
 GeneList::GeneList(const GeneList& genelist, int begin, int end) :
     is_segment(true), listname(genelist.listname),
-    genomename(genelist.genomename), id(genelist.getID())
+    genomename(genelist.genomename), hasHomologIndex(false),
+    familyIndex(false), id(genelist.getID()),
+    maskVersion(0)
 {
     if (end < begin) return;
 
@@ -62,23 +92,167 @@ GeneList::GeneList(const GeneList& genelist, int begin, int end) :
         remapped_elements.push_back(new ListElement (*genelist.getRemappedElements()[i]));
 }
 
+GeneList::GeneList(const char *&buffer, const char *end,
+                   const vector<GeneList*>& genelists) :
+    is_segment(true), hasHomologIndex(false), familyIndex(false), id(-1),
+    maskVersion(0)
+{
+    id = WireFormat::getVarInt(buffer, end);
+    if (id < 0 || id >= (int)genelists.size())
+        throw WireFormatException("segment of an unknown gene list");
+    const GeneList &genelist = *genelists[id];
+    listname = genelist.listname;
+    genomename = genelist.genomename;
+
+    int size = WireFormat::getCount(buffer, end);
+    remapped_elements.reserve(size);
+
+    try {
+        int coordinate = 0;
+        for (int i = 0; i < size; i++) {
+            unsigned char flags;
+            WireFormat::getRaw(buffer, flags, end);
+
+            // the genes are taken from the genelist by their coordinate
+            ListElement *le;
+            if (flags & ELEMENT_GAP) {
+                le = new ListElement();
+            } else {
+                coordinate = WireFormat::getDelta(buffer, coordinate, end);
+                if (coordinate < 0 || coordinate >= (int)genelist.elements.size())
+                    throw WireFormatException("segment gene outside its list");
+                le = new ListElement(*genelist.elements[coordinate]);
+            }
+
+            if (le->getOrientation() != ((flags & ELEMENT_ORIENTATION) != 0))
+                le->invertOrientation();
+            le->setMasked((flags & ELEMENT_MASKED) != 0);
+            le->hasHomolog = (flags & ELEMENT_HOMOLOG) != 0;
+            le->hasAP = (flags & ELEMENT_AP) != 0;
+            le->hasAlHomolog = (flags & ELEMENT_AL_HOMOLOG) != 0;
+            le->hasAlAP = (flags & ELEMENT_AL_AP) != 0;
+
+            remapped_elements.push_back(le);
+        }
+    } catch (const WireFormatException&) {
+        // the destructor is not called for a partially built segment
+        for (size_t i = 0; i < remapped_elements.size(); i++)
+            delete remapped_elements[i];
+        throw;
+    }
+}
+
 GeneList::~GeneList ()
 {
+    // the elements of a gene list are released together with the store
     if (isSegment()) {
         for (int i = 0; i < remapped_elements.size(); i++)
             delete remapped_elements[i];
-    } else {
-        for (int i = 0; i < elements.size(); i++)
-            delete elements[i];
     }
 }
 
+void GeneList::addGene(Gene& gene)
+{
+    // the elements point into the store, so it should never reallocate
+    assert(store.size() < store.capacity());
+    store.push_back(ListElement(gene, gene.getOrientation(), false));
+    elements.push_back(&store.back());
+}
+
 void GeneList::remapTandems(int gapSize, bool useFamily)
 {
     if (useFamily)
         remapTandemsFamily(gapSize);
     else
         remapTandemsPairs(gapSize);
+
+    buildHomologIndex(useFamily);
+}
+
+void GeneList::restoreTandems(bool useFamily)
+{
+    buildRemappedElements();
+    buildHomologIndex(useFamily);
+}
+
+void GeneList::buildRemappedElements()
+{
+    //calculate remapped coordinate for each gene
+    int substract = 0;
+    for (unsigned int i = 0; i < elements.size(); i++) {
+        if (elements[i]->getGene().isRemapped()) {
+            substract++;
+        }
+        else {
+            remapped_elements.push_back(elements[i]);
+        }
+
+        elements[i]->getGene().setRemappedCoordinate(substract);
+    }
+}
+
+void GeneList::buildHomologIndex(bool useFamily)
+{
+    homologIndex.clear();
+    homologIndex.reserve(remapped_elements.size());
+
+    for (int i = 0; i < remapped_elements.size(); i++) {
+        const ListElement &le = *remapped_elements[i];
+        if (le.isGap()) continue;
+        if (!le.getGene().hasPairs()) continue;
+
+        uint32_t key = useFamily ? le.getGene().getFamilyID()
+                                 : le.getGene().getInternID();
+        homologIndex.push_back(pair<uint32_t, int>(key, i));
+    }
+
+    sort(homologIndex.begin(), homologIndex.end());
+    hasHomologIndex = true;
+    familyIndex = useFamily;
+}
+
+void GeneList::matchingPositions(const Gene& gene,
+                                 vector<int>& positions) const
+{
+    positions.clear();
+
+    // no index available (e.g. for segments): scan the whole list
+    if (!hasHomologIndex) {
+        for (int i = 0; i < remapped_elements.size(); i++) {
+            if (remapped_elements[i]->isGap()) continue;
+            if (remapped_elements[i]->isMasked()) continue;
+
+            if (gene.isPairWith(remapped_elements[i]->getGene()))
+                positions.push_back(i);
+        }
+        return;
+    }
+
+    vector<pair<uint32_t, int> >::const_iterator it, end;
+    if (familyIndex) {
+        it = lower_bound(homologIndex.begin(), homologIndex.end(),
+                         pair<uint32_t, int>(gene.getFamilyID(), INT_MIN));
+        for ( ; it != homologIndex.end() &&
+                it->first == gene.getFamilyID(); it++) {
+            const ListElement &le = *remapped_elements[it->second];
+            if (le.isMasked()) continue;
+            if (le.getGene().getInternID() == gene.getInternID()) continue;
+            positions.push_back(it->second);
+        }
+        // positions are sorted within a family
+        return;
+    }
+
+    const uint32_t *pairs = gene.getPairs();
+    for (uint32_t p = 0; p < gene.getNumPairs(); p++) {
+        it = lower_bound(homologIndex.begin(), homologIndex.end(),
+                         pair<uint32_t, int>(pairs[p], INT_MIN));
+        for ( ; it != homologIndex.end() && it->first == pairs[p]; it++) {
+            if (remapped_elements[it->second]->isMasked()) continue;
+            positions.push_back(it->second);
+        }
+    }
+    sort(positions.begin(), positions.end());
 }
 
 void GeneList::remapTandemsPairs(int gapSize)
@@ -126,18 +300,7 @@ void GeneList::remapTandemsPairs(int gapSize)
         }
     }
 
-    //calculate remapped coordinate for each gene
-    int substract = 0;
-    for (unsigned int i = 0; i < elements.size(); i++) {
-        if (elements[i]->getGene().isRemapped()) {
-            substract++;
-        }
-        else {
-            remapped_elements.push_back(elements[i]);
-        }
-
-        elements[i]->getGene().setRemappedCoordinate(substract);
-    }
+    buildRemappedElements();
 }
 
 void GeneList::remapTandemsFamily(int gapSize)
@@ -185,18 +348,7 @@ void GeneList::remapTandemsFamily(int gapSize)
         }
     }
 
-    //calculate remapped coordinate for each gene
-    int substract = 0;
-    for (unsigned int i = 0; i < elements.size(); i++) {
-        if (elements[i]->getGene().isRemapped()) {
-            substract++;
-        }
-        else {
-            remapped_elements.push_back(elements[i]);
-        }
-
-        elements[i]->getGene().setRemappedCoordinate(substract);
-    }
+    buildRemappedElements();
 }
 
 int GeneList::getNumberOfMaskedElements() const {
@@ -282,6 +434,8 @@ void GeneList::invertSection(int begin, int end)
 
 void GeneList::mask(int begin, int end) {
     for (int i = begin; i <= end; i++) {
+        if (!remapped_elements[i]->isMasked())
+            maskVersion++;
         remapped_elements[i]->setMasked(true);
     }
 }
@@ -340,4 +494,51 @@ void GeneList::removeGaps()
     }
 }
 
+int GeneList::getPackSize() const
+{
+    int packSize = WireFormat::getVarIntSize(id) +
+                   WireFormat::getVarIntSize(remapped_elements.size());
+
+    int coordinate = 0;
+    for (unsigned int i = 0; i < remapped_elements.size(); i++) {
+        const ListElement &le = *remapped_elements[i];
+        packSize++;
+        if (le.isGap()) continue;
 
+        packSize += WireFormat::getDeltaSize(le.getGene().getCoordinate(),
+                                             coordinate);
+        coordinate = le.getGene().getCoordinate();
+    }
+
+    return packSize;
+}
+
+int GeneList::pack(char *buffer) const
+{
+    const char *bufferOrig = buffer;
+
+    WireFormat::putVarInt(buffer, id);
+    WireFormat::putVarInt(buffer, remapped_elements.size());
+
+    int coordinate = 0;
+    for (unsigned int i = 0; i < remapped_elements.size(); i++) {
+        const ListElement &le = *remapped_elements[i];
+
+        unsigned char flags = 0;
+        if (le.isGap()) flags |= ELEMENT_GAP;
+        if (le.getOrientation()) flags |= ELEMENT_ORIENTATION;
+        if (le.isMasked()) flags |= ELEMENT_MASKED;
+        if (le.hasHomolog) flags |= ELEMENT_HOMOLOG;
+        if (le.hasAP) flags |= ELEMENT_AP;
+        if (le.hasAlHomolog) flags |= ELEMENT_AL_HOMOLOG;
+        if (le.hasAlAP) flags |= ELEMENT_AL_AP;
+        *buffer++ = (char)flags;
+
+        if (le.isGap()) continue;
+
+        WireFormat::putDelta(buffer, le.getGene().getCoordinate(), coordinate);
+        coordinate = le.getGene().getCoordinate();
+    }
+
+    return buffer - bufferOrig;
+}
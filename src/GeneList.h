@@ -1,11 +1,11 @@
 #ifndef __GENELIST_H
 #define __GENELIST_H
 
-class ListElement;
 class Gene;
 
 #include "headers.h"
-
+#include "ListElement.h"
+#include <stdint.h>
 
 class GeneList {
 
@@ -22,12 +22,33 @@ public:
     GeneList(const string& listName, const string& genomeName,
              const string& fileName);
 
+    /**
+    * Constructs an empty genelist with room for a fixed number of genes,
+    * the genes are added through addGene() (used when loading a dataset
+    * cache)
+    */
+    GeneList(const string& listName, const string& genomeName,
+             size_t numGenes);
+
 
     /**
     * Constructs a genelist from a segment of another genelist
     */
     GeneList(const GeneList& genelist, int begin, int end);
 
+    /**
+    * Constructs a segment from a packed buffer, the genes are copied from
+    * the genelist the segment was extracted from
+    * @param buffer Buffer that contains a packed segment, it is advanced
+    * past the segment
+    * @param end End of the buffer
+    * @param genelists Genelists, indexed by their ID
+    * @throw WireFormatException If the buffer ends before the segment or
+    * the segment refers to a gene that does not exist
+    */
+    GeneList(const char *&buffer, const char *end,
+             const vector<GeneList*>& genelists);
+
     /**
      * Default constructor
      */
@@ -55,6 +76,42 @@ public:
     */
     void remapTandems(int gapSize, bool useFamily);
 
+    /**
+     * Appends a gene to a list that was constructed with room for it
+     * @param gene Gene to add, its orientation is used for the element
+     */
+    void addGene(Gene& gene);
+
+    /**
+     * Completes the remapping when the tandem state of the genes has been
+     * restored from a dataset cache instead of computed by remapTandems
+     * @param useFamily True if the genes are mapped onto gene families
+     */
+    void restoreTandems(bool useFamily);
+
+    /**
+     * Builds the inverted homolog index of the remapped elements, i.e. a
+     * sorted list of (gene or family ID, position) pairs. This is done once
+     * after the tandems have been remapped.
+     * @param useFamily True if the index should be keyed on gene family
+     */
+    void buildHomologIndex(bool useFamily);
+
+    /**
+     * Get the inverted homolog index, see buildHomologIndex
+     */
+    const vector<pair<uint32_t, int> >& getHomologIndex() const {
+        return homologIndex;
+    }
+
+    /**
+     * Get the positions of the remapped elements that are homologous to a
+     * gene, gaps and masked elements are skipped
+     * @param gene Gene to find the homologs for
+     * @param positions Positions in ascending order (output)
+     */
+    void matchingPositions(const Gene& gene, vector<int>& positions) const;
+
     /*
     *returns the total number of listelements that have not been remapped
     */
@@ -145,6 +202,13 @@ public:
     */
     void mask(int begin, int end);
 
+    /*
+    *returns a counter that is incremented whenever the masking changes
+    */
+    unsigned int getMaskVersion() const {
+        return maskVersion;
+    }
+
     /*
     *returns true if the genelist was contructed from a segment of another genelist
     */
@@ -198,6 +262,19 @@ public:
      */
     void removeGaps();
 
+    /**
+     * Calculate the number of chars needed to pack a segment
+     */
+    int getPackSize() const;
+
+    /**
+     * Pack a segment in a char stream: the position of every element in
+     * its genelist together with its orientation, masking and homolog flags
+     * @param buffer Pre-allocated buffer to store the data in
+     * @return The number of chars in the buffer that were used
+     */
+    int pack(char *buffer) const;
+
 private:
     ///////////////////
     //PRIVATE METHODS//
@@ -206,6 +283,12 @@ private:
     void remapTandemsPairs(int gapSize);
     void remapTandemsFamily(int gapSize);
 
+    /**
+     * Builds the remapped elements from the genes that were not remapped
+     * and calculates the remapped coordinate of every gene
+     */
+    void buildRemappedElements();
+
     /**
     * Copy constructor
     */
@@ -225,10 +308,22 @@ private:
     string listname;
     string genomename;
 
+    // the elements of a gene list are allocated as one contiguous block,
+    // elements points into it (segments own their elements instead)
+    vector<ListElement> store;
+
     vector<ListElement*> elements;
     vector<ListElement*> remapped_elements;
 
+    // inverted homolog index: sorted (gene or family ID, position) pairs
+    vector<pair<uint32_t, int> > homologIndex;
+    bool hasHomologIndex;
+    bool familyIndex;
+
     int id;
+
+    // incremented by every call to mask that masks an unmasked element
+    unsigned int maskVersion;
 };
 
 #endif
@@ -1,82 +1,106 @@
 #include "GenePairs.h"
 
-GenePairs::GenePairs(const string& blastTableFile) 
-{
-        // only read the gene pairs if they haven't been read before
-	if (pairs.size() != 0) return;
-
-        ifstream fin(blastTableFile.c_str());
-        if (!fin) throw FileException ("Error opening BLAST table file: " +
-						blastTableFile);
-
-        // count the number of lines in the input file
-        int c_lines = 0;
-        for (string dummy; getline(fin, dummy); c_lines++);
-	int initHashSize = (int)(c_lines*0.0005);
-
-        // reset input file stream to begin position
-        fin.clear();
-        fin.seekg(0);
-
-	string A, B;
+#include <cstring>
 
-	while(readLine(fin, A, B)) {
+using namespace std;
 
-                if (A == B) continue;   //only insert when not the same gene
-
-		if (pairs.find(A) != pairs.end()) {		//insert A-B
-			pairs[A]->insert(B);
-		} else {
-			hash_set<string, stringhash>* tab =
-				new hash_set<string,stringhash>(initHashSize);
-			tab->insert(B);
-			pairs[A] = tab;
-		}
+GenePairs::GenePairs(const string& blastTableFile, const StringTable& geneIDs_,
+		     int numThreads) : geneIDs(geneIDs_)
+{
+	MappedFile file(blastTableFile, "BLAST table file");
 
-		if (pairs.find(B) != pairs.end()) {		//insert B-A
-			pairs[B]->insert(A);
-		} else {
-			hash_set<string, stringhash>* tab =
-				new hash_set<string,stringhash>(initHashSize);
-			tab->insert(A);
-			pairs[B] = tab;
-		}
-	}
+	chunkEdges.resize(numThreads < 1 ? 1 : numThreads);
+	file.parse(*this, numThreads);
 
-        fin.close();
+	buildAdjacency();
 }
 
-GenePairs::~GenePairs()
+uint32_t GenePairs::lookup(const char* begin, const char* end,
+			   string& buf) const
 {
- 	hash_map<string, hash_set<string,stringhash>*,stringhash>::const_iterator it = pairs.begin();
-	for ( ; it != pairs.end(); it++)
-		delete it->second;
+	// strip the orientation
+	if ((end[-1] == '+') || (end[-1] == '-')) end--;
+	buf.assign(begin, end);
+	return geneIDs.find(buf);
 }
 
-bool GenePairs::readLine(ifstream& fin, string &geneA, string &geneB)
+void GenePairs::parseChunk(const char* begin, const char* end, int chunkID)
 {
-        getline(fin, geneA, '\t');
-        if (!fin.good()) return false;
-        getline(fin, geneB);
-
-        // perhaps we are reading the final empty line(s) of the file
-        if (geneA.empty() || geneB.empty()) return false;
-
-        char charA = geneA[geneA.length()-1];  // final character in geneA
-        if ((charA == '+') || (charA == '-')) geneA.erase(geneA.length()-1);
-
-        char charB = geneB[geneB.length()-1];  // final character in geneB
-        if ((charB == '+') || (charB == '-')) geneB.erase(geneB.length()-1);
+	vector<uint32_t>& edges = chunkEdges[chunkID];
+
+	// reused for every lookup to avoid an allocation per gene name
+	string buf;
+
+	for (const char* line = begin; line < end; ) {
+		const char* eol = (const char*)memchr(line, '\n', end - line);
+		if (eol == NULL) eol = end;
+
+		// the first gene ends at the first tab, the second gene is the
+		// remainder of the line
+		const char* tab = (const char*)memchr(line, '\t', eol - line);
+
+		// skip empty lines and lines without a pair
+		if ((tab != NULL) && (tab > line) && (tab + 1 < eol)) {
+			uint32_t A = lookup(line, tab, buf);
+			if (A != StringTable::NOT_FOUND) {
+				uint32_t B = lookup(tab + 1, eol, buf);
+				// only insert when not the same gene
+				if ((B != StringTable::NOT_FOUND) && (A != B)) {
+					edges.push_back(A);
+					edges.push_back(B);
+				}
+			}
+		}
 
-        return true;
+		line = eol + 1;
+	}
 }
 
-hash_set<string,stringhash>* GenePairs::getPairsOf(const string& geneName)
+void GenePairs::buildAdjacency()
 {
-	if (pairs.find(geneName) != pairs.end()) {
-		return pairs[geneName];
+	uint32_t numGenes = geneIDs.size();
+
+	// count the degree of every gene, each edge is stored in both directions
+	offsets.assign(numGenes + 1, 0);
+	size_t numEdges = 0;
+	for (size_t c = 0; c < chunkEdges.size(); c++) {
+		const vector<uint32_t>& edges = chunkEdges[c];
+		for (size_t i = 0; i < edges.size(); i++)
+			offsets[edges[i] + 1]++;
+		numEdges += edges.size();
 	}
-	else {
-		return NULL;
+	for (uint32_t g = 0; g < numGenes; g++)
+		offsets[g + 1] += offsets[g];
+
+	neighbors.resize(numEdges);
+	vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+	for (size_t c = 0; c < chunkEdges.size(); c++) {
+		vector<uint32_t>& edges = chunkEdges[c];
+		for (size_t i = 0; i < edges.size(); i += 2) {
+			neighbors[pos[edges[i]]++] = edges[i + 1];
+			neighbors[pos[edges[i + 1]]++] = edges[i];
+		}
+		vector<uint32_t>().swap(edges);
+	}
+	chunkEdges.clear();
+
+	// sort the neighbors of every gene and remove duplicate pairs in place
+	size_t out = 0;
+	for (uint32_t g = 0; g < numGenes; g++) {
+		vector<uint32_t>::iterator b = neighbors.begin() + offsets[g];
+		vector<uint32_t>::iterator e = neighbors.begin() + offsets[g + 1];
+		sort(b, e);
+		e = unique(b, e);
+
+		offsets[g] = out;
+		out = copy(b, e, neighbors.begin() + out) - neighbors.begin();
 	}
+	offsets[numGenes] = out;
+	neighbors.resize(out);
+}
+
+const uint32_t* GenePairs::getPairsOf(uint32_t geneID, uint32_t& numPairs) const
+{
+	numPairs = offsets[geneID + 1] - offsets[geneID];
+	return (numPairs == 0) ? NULL : &neighbors[offsets[geneID]];
 }
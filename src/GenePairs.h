@@ -3,8 +3,24 @@
 
 #include "debug/FileException.h"
 #include "headers.h"
+#include "MappedFile.h"
+#include "datastructures/StringTable.h"
 
-class GenePairs
+#include <stdint.h>
+
+/*
+ * Homologous gene pairs read from a BLAST table. The table is memory mapped
+ * and parsed in place: gene names are looked up in the interning table of
+ * the gene lists and pairs involving a gene that is absent from every gene
+ * list are dropped while parsing. The remaining pairs are stored as a
+ * compressed sparse row adjacency: the sorted, distinct pairs of gene g are
+ * neighbors[offsets[g]] .. neighbors[offsets[g+1]-1].
+ *
+ * The table can be parsed by several threads: every thread collects the
+ * pairs of one chunk of lines, the chunks are merged into the adjacency
+ * afterwards.
+ */
+class GenePairs : private ChunkParser
 {
 public:
 	////////////////
@@ -12,24 +28,33 @@ public:
 	////////////////
 
 	/**
-	 * Constructor that reads the blasttable file and builds up the hashtable
-	 */
-	GenePairs(const string& blastTableFile);
-
-	/**
-	 * Destructor
+	 * Constructor that reads the blasttable file and builds up the adjacency
+	 * @param blastTableFile Tab separated file with one gene pair per line
+	 * @param geneIDs Interning table with the names of all genes in the
+	 * gene lists, the identifiers are used as vertex indices
+	 * @param numThreads Number of threads used to parse the table
 	 */
-	~GenePairs();
+	GenePairs(const string& blastTableFile, const StringTable& geneIDs,
+		  int numThreads = 1);
 
 	//////////////////
 	//PUBLIC METHODS//
 	//////////////////
 
 	/**
-	 * returns a pointer to the hashtable containing the genes 
-	 * corresponding with the specified genome
+	 * Returns the sorted identifiers of the pairs of a gene
+	 * @param geneID Interned identifier of the gene
+	 * @param numPairs Number of pairs (output)
+	 * @return Pointer to the first pair, NULL if the gene has no pairs
 	 */
-	hash_set<string,stringhash>* getPairsOf(const string& geneName);
+	const uint32_t* getPairsOf(uint32_t geneID, uint32_t& numPairs) const;
+
+	/**
+	 * Returns the total number of (directed) pairs in the adjacency
+	 */
+	size_t getNumPairs() const {
+		return neighbors.size();
+	}
 
 private:
 	///////////////////
@@ -37,17 +62,37 @@ private:
 	///////////////////
 
 	/*
-	 * reads a single line from the blast table file and puts the 2
-	 * genes into the 2 strings
+	 * Parses the lines in [begin, end) and stores the identifiers of the
+	 * two genes of every retained pair in the edges of the chunk
+	 */
+	void parseChunk(const char* begin, const char* end, int chunkID);
+
+	/*
+	 * Looks up a gene name after removing a trailing orientation character
+	 */
+	uint32_t lookup(const char* begin, const char* end, string& buf) const;
+
+	/*
+	 * Builds the compressed adjacency from the undirected edges of all
+	 * chunks and releases the edge buffers
 	 */
-	static bool readLine(ifstream& fin, string &geneA, string &geneB);
+	void buildAdjacency();
 
 	//////////////
 	//ATTRIBUTES//
 	//////////////
 
-	// the hash_map with all pairs read from the blast table file
-	hash_map<string, hash_set<string,stringhash>*,stringhash> pairs;
+	// the interning table of the genes in the gene lists
+	const StringTable& geneIDs;
+
+	// gene identifiers of the pairs found in every chunk, two per pair
+	vector<vector<uint32_t> > chunkEdges;
+
+	// offsets[g]..offsets[g+1] are the neighbors of gene g
+	vector<size_t> offsets;
+
+	// sorted neighbors of every gene
+	vector<uint32_t> neighbors;
 };
 
 #endif
@@ -0,0 +1,35 @@
+#include "HomologPointCache.h"
+
+#include "Gene.h"
+#include "GeneList.h"
+#include "ListElement.h"
+
+const vector<int>& HomologPointCache::matchingPositions(const GeneList& list,
+                                                        const Gene& gene)
+{
+    hash_map<uint32_t, Entry>::iterator it = entries.find(gene.getInternID());
+
+    if (it == entries.end()) {
+        if (entries.size() >= maxGenes)
+            clear();
+
+        Entry &entry = entries[gene.getInternID()];
+        entry.maskVersion = list.getMaskVersion();
+        list.matchingPositions(gene, entry.positions);
+        return entry.positions;
+    }
+
+    // drop the positions that were masked since the lookup
+    Entry &entry = it->second;
+    if (entry.maskVersion != list.getMaskVersion()) {
+        const vector<ListElement*>& elements = list.getRemappedElements();
+        vector<int>::iterator last = entry.positions.begin();
+        for (size_t i = 0; i < entry.positions.size(); i++)
+            if (!elements[entry.positions[i]]->isMasked())
+                *last++ = entry.positions[i];
+        entry.positions.erase(last, entry.positions.end());
+        entry.maskVersion = list.getMaskVersion();
+    }
+
+    return entry.positions;
+}
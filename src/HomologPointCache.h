@@ -0,0 +1,85 @@
+#ifndef __HOMOLOGPOINTCACHE_H
+#define __HOMOLOGPOINTCACHE_H
+
+#include "headers.h"
+
+#include <stdint.h>
+
+class Gene;
+class GeneList;
+
+/*
+ * Cache of the homologous positions of genes in one genelist, used to
+ * build the GHMs of successive profiles against that genelist.
+ *
+ * The segments of a profile are largely copied from the profile of the
+ * parent multiplicon, so the same genes are looked up in the same genelist
+ * over and over again. The positions are stored per gene, together with
+ * the mask version of the genelist at the time of the lookup. Masking only
+ * grows, so when the genelist was masked in the meantime, the positions
+ * that became masked are dropped from the entry instead of repeating the
+ * lookup. The cache is cleared when it holds too many genes.
+ *
+ * A cache is not thread-safe, it should be used by one thread at a time.
+ */
+class HomologPointCache
+{
+
+public:
+    ///////////////////////////////
+    //CONSTRUCTORS AND DESTRUCTOR//
+    ///////////////////////////////
+
+    /**
+    * Constructs an empty cache
+    * @param maxGenes Maximum number of genes to keep
+    */
+    HomologPointCache(size_t _maxGenes = MAX_GENES) : maxGenes(_maxGenes) {}
+
+    //////////////////
+    //PUBLIC METHODS//
+    //////////////////
+
+    /**
+    * Returns the unmasked positions in a genelist of the homologs of a
+    * gene, as GeneList::matchingPositions
+    * @param list Genelist, the same one for every call
+    * @param gene Gene to find the homologs of
+    * @return Sorted positions, valid until the next call
+    */
+    const vector<int>& matchingPositions(const GeneList& list,
+                                         const Gene& gene);
+
+    /**
+    * Removes all genes
+    */
+    void clear() {
+        entries.clear();
+    }
+
+    /**
+    * Returns the number of genes in the cache
+    */
+    size_t size() const {
+        return entries.size();
+    }
+
+    static const size_t MAX_GENES = 8192;
+
+private:
+
+    struct Entry {
+        unsigned int maskVersion;
+        vector<int> positions;
+    };
+
+    //////////////
+    //ATTRIBUTES//
+    //////////////
+
+    size_t maxGenes;
+    // positions per intern ID of the gene
+    hash_map<uint32_t, Entry> entries;
+};
+
+#endif
@@ -0,0 +1,294 @@
+#include "HomologyMatrix.h"
+
+#include <climits>
+#include <cassert>
+
+using namespace std;
+
+HomologyMatrix::HomologyMatrix() : numPoints(0)
+{
+    clear();
+}
+
+HomologyMatrix::BoxIterator HomologyMatrix::getAll() const
+{
+    return BoxIterator(*this, INT_MIN, INT_MAX, INT_MIN, INT_MAX);
+}
+
+HomologyMatrix::BoxIterator HomologyMatrix::getBox(int loX, int hiX,
+                                                   int loY, int hiY) const
+{
+    return BoxIterator(*this, loX, hiX, loY, hiY);
+}
+
+#ifdef GHM_TREE_MATRIX
+
+/*****************************************************************************/
+/* TREE BASED IMPLEMENTATION                                                 */
+/*****************************************************************************/
+
+void HomologyMatrix::clear()
+{
+    tree.clear();
+    numPoints = 0;
+}
+
+void HomologyMatrix::build(vector<pair<int, int> >& points)
+{
+    clear();
+    for (size_t i = 0; i < points.size(); i++)
+        insert(points[i].first, points[i].second);
+}
+
+void HomologyMatrix::insert(int x, int y)
+{
+    if (tree[x].insert(y).second)
+        numPoints++;
+}
+
+void HomologyMatrix::erase(int x, int y)
+{
+    map<int, set<int> >::iterator itX = tree.find(x);
+    if (itX == tree.end())
+        return;
+    numPoints -= itX->second.erase(y);
+}
+
+void HomologyMatrix::erase(BoxIterator& it)
+{
+    assert(it.valid);
+    // rows are never removed, so the row iterator remains valid
+    erase(it.x, it.y);
+}
+
+bool HomologyMatrix::contains(int x, int y) const
+{
+    map<int, set<int> >::const_iterator itX = tree.find(x);
+    if (itX == tree.end())
+        return false;
+    return itX->second.find(y) != itX->second.end();
+}
+
+size_t HomologyMatrix::size() const
+{
+    return numPoints;
+}
+
+void HomologyMatrix::merge()
+{
+}
+
+HomologyMatrix::BoxIterator::BoxIterator(const HomologyMatrix& matrix,
+                                         int loX_, int hiX_,
+                                         int loY_, int hiY_) :
+    mat(matrix), loY(loY_), hiY(hiY_), x(0), y(0), valid(false)
+{
+    if (loX_ > hiX_ || loY_ > hiY_) {
+        itX = endX = mat.tree.end();
+        return;
+    }
+
+    itX = mat.tree.lower_bound(loX_);
+    endX = mat.tree.upper_bound(hiX_);
+    if (itX != endX)
+        itY = itX->second.lower_bound(loY);
+    seek();
+}
+
+void HomologyMatrix::BoxIterator::seek()
+{
+    for ( ; itX != endX; ) {
+        if (itY != itX->second.end() && *itY <= hiY) {
+            x = itX->first;
+            y = *itY;
+            valid = true;
+            return;
+        }
+        if (++itX != endX)
+            itY = itX->second.lower_bound(loY);
+    }
+    valid = false;
+}
+
+void HomologyMatrix::BoxIterator::next()
+{
+    if (!valid)
+        return;
+    // the current point might have been erased: search past its y-value
+    itY = itX->second.upper_bound(y);
+    seek();
+}
+
+#else
+
+/*****************************************************************************/
+/* COMPRESSED SPARSE ROW IMPLEMENTATION                                      */
+/*****************************************************************************/
+
+void HomologyMatrix::clear()
+{
+    rowX.clear();
+    rowStart.clear();
+    rowStart.push_back(0);
+    cols.clear();
+    deleted.clear();
+    staged.clear();
+    numPoints = 0;
+}
+
+void HomologyMatrix::build(vector<pair<int, int> >& points)
+{
+    clear();
+
+    sort(points.begin(), points.end());
+    points.erase(unique(points.begin(), points.end()), points.end());
+
+    cols.reserve(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        if (rowX.empty() || rowX.back() != points[i].first) {
+            rowX.push_back(points[i].first);
+            rowStart.push_back(cols.size());
+        }
+        cols.push_back(points[i].second);
+        rowStart.back() = cols.size();
+    }
+
+    deleted.assign(cols.size(), false);
+    numPoints = cols.size();
+}
+
+void HomologyMatrix::merge()
+{
+    if (staged.empty())
+        return;
+
+    // merge the remaining points with the staged ones
+    vector<pair<int, int> > points;
+    points.reserve(numPoints + staged.size());
+    for (size_t r = 0; r < rowX.size(); r++)
+        for (size_t c = rowStart[r]; c < rowStart[r+1]; c++)
+            if (!deleted[c])
+                points.push_back(make_pair(rowX[r], cols[c]));
+
+    staged.swap(points);
+    points.insert(points.end(), staged.begin(), staged.end());
+    staged.clear();
+
+    build(points);
+}
+
+size_t HomologyMatrix::find(int x, int y) const
+{
+    vector<int>::const_iterator itX = lower_bound(rowX.begin(), rowX.end(), x);
+    if (itX == rowX.end() || *itX != x)
+        return cols.size();
+
+    size_t r = itX - rowX.begin();
+    vector<int>::const_iterator b = cols.begin() + rowStart[r];
+    vector<int>::const_iterator e = cols.begin() + rowStart[r+1];
+    vector<int>::const_iterator itY = lower_bound(b, e, y);
+    if (itY == e || *itY != y)
+        return cols.size();
+
+    return itY - cols.begin();
+}
+
+void HomologyMatrix::insert(int x, int y)
+{
+    size_t idx = find(x, y);
+    if (idx == cols.size()) {
+        staged.push_back(make_pair(x, y));
+    } else if (deleted[idx]) {
+        deleted[idx] = false;
+        numPoints++;
+    }
+}
+
+void HomologyMatrix::erase(int x, int y)
+{
+    assert(staged.empty());
+    size_t idx = find(x, y);
+    if (idx != cols.size() && !deleted[idx]) {
+        deleted[idx] = true;
+        numPoints--;
+    }
+}
+
+void HomologyMatrix::erase(BoxIterator& it)
+{
+    assert(it.valid && staged.empty());
+    if (!deleted[it.col]) {
+        deleted[it.col] = true;
+        numPoints--;
+    }
+}
+
+bool HomologyMatrix::contains(int x, int y) const
+{
+    assert(staged.empty());
+    size_t idx = find(x, y);
+    return (idx != cols.size() && !deleted[idx]);
+}
+
+size_t HomologyMatrix::size() const
+{
+    assert(staged.empty());
+    return numPoints;
+}
+
+HomologyMatrix::BoxIterator::BoxIterator(const HomologyMatrix& matrix,
+                                         int loX, int hiX,
+                                         int loY_, int hiY_) :
+    mat(matrix), loY(loY_), hiY(hiY_), x(0), y(0), valid(false),
+    row(0), endRow(0), col(0), endCol(0)
+{
+    assert(mat.staged.empty());
+    if (loX > hiX || loY > hiY)
+        return;
+
+    const vector<int>& rowX = mat.rowX;
+    row = lower_bound(rowX.begin(), rowX.end(), loX) - rowX.begin();
+    endRow = upper_bound(rowX.begin(), rowX.end(), hiX) - rowX.begin();
+    if (row >= endRow)
+        return;
+
+    col = lower_bound(mat.cols.begin() + mat.rowStart[row],
+                      mat.cols.begin() + mat.rowStart[row+1], loY)
+          - mat.cols.begin();
+    endCol = mat.rowStart[row+1];
+    seek();
+}
+
+void HomologyMatrix::BoxIterator::seek()
+{
+    const vector<int>& cols = mat.cols;
+    const vector<size_t>& rowStart = mat.rowStart;
+
+    while (row < endRow) {
+        for ( ; col < endCol && cols[col] <= hiY; col++) {
+            if (mat.deleted[col]) continue;
+            x = mat.rowX[row];
+            y = cols[col];
+            valid = true;
+            return;
+        }
+
+        if (++row < endRow) {
+            col = lower_bound(cols.begin() + rowStart[row],
+                              cols.begin() + rowStart[row+1], loY)
+                  - cols.begin();
+            endCol = rowStart[row+1];
+        }
+    }
+    valid = false;
+}
+
+void HomologyMatrix::BoxIterator::next()
+{
+    if (!valid)
+        return;
+    col++;
+    seek();
+}
+
+#endif
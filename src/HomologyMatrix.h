@@ -0,0 +1,209 @@
+#ifndef __HOMOLOGYMATRIX_H
+#define __HOMOLOGYMATRIX_H
+
+#include "headers.h"
+
+/*
+ * Sparse storage for the homologous points (x,y) of one orientation class
+ * of a gene homology matrix.
+ *
+ * By default the points are stored in compressed sparse row (CSR) format:
+ * the distinct x-values (rows) are kept in a sorted array, each row owns a
+ * sorted range of y-values (columns) and a deletion bitmap marks points
+ * that were removed from the matrix.  Range queries are binary searches on
+ * these arrays and erasing a point only flips a bit, so iterators remain
+ * valid while points are being erased.  Points that are (re)inserted and
+ * were never part of the compressed arrays are staged until merge() is
+ * called; the matrix may not be queried while points are staged.
+ *
+ * When compiled with -DGHM_TREE_MATRIX the original map<int, set<int> >
+ * representation is used instead, which allows the results of both
+ * implementations to be compared.
+ */
+class HomologyMatrix
+{
+
+public:
+    ///////////////////////////////
+    //CONSTRUCTORS AND DESTRUCTOR//
+    ///////////////////////////////
+
+    /**
+    * Constructs an empty homology matrix
+    */
+    HomologyMatrix();
+
+    //////////////////
+    //PUBLIC METHODS//
+    //////////////////
+
+    /**
+    * Removes all points from the matrix
+    */
+    void clear();
+
+    /**
+    * (Re)builds the matrix from a list of coordinates, duplicates are ignored
+    * @param points (x,y) coordinates of the homologous points, the vector
+    * is sorted in place
+    */
+    void build(vector<pair<int, int> >& points);
+
+    /**
+    * Inserts a point in the matrix (no-op if the point is already present).
+    * A point that is not stored in the compressed arrays is staged and only
+    * becomes visible after the next call to merge()
+    * @param x The x-coordinate
+    * @param y The y-coordinate
+    */
+    void insert(int x, int y);
+
+    /**
+    * Merges the staged points into the compressed arrays.  The arrays are
+    * rebuilt when points are staged, which invalidates all iterators
+    */
+    void merge();
+
+    /**
+    * Removes a point from the matrix (no-op if the point is not present)
+    * @param x The x-coordinate
+    * @param y The y-coordinate
+    */
+    void erase(int x, int y);
+
+    /**
+    * Checks whether a point is present in the matrix
+    * @param x The x-coordinate
+    * @param y The y-coordinate
+    * @return True if (x,y) is a homologous point in the matrix
+    */
+    bool contains(int x, int y) const;
+
+    /**
+    * Returns the number of points that are present in the matrix
+    */
+    size_t size() const;
+
+    /*
+     * Iterator over the points inside a rectangular area of the matrix,
+     * in order of increasing x and, for equal x, increasing y.
+     * Points may be erased from the matrix while iterating, points that
+     * are erased before they are reached are skipped. An iterator can only
+     * be created when no points are staged and is invalidated by merge().
+     */
+    class BoxIterator
+    {
+    public:
+        /**
+        * @return True if the iterator points to a point in the box
+        */
+        bool isValid() const {
+            return valid;
+        }
+
+        /**
+        * Advances the iterator to the next point in the box
+        */
+        void next();
+
+        /**
+        * @return The x-coordinate of the current point
+        */
+        int getX() const {
+            return x;
+        }
+
+        /**
+        * @return The y-coordinate of the current point
+        */
+        int getY() const {
+            return y;
+        }
+
+    private:
+        friend class HomologyMatrix;
+
+        BoxIterator(const HomologyMatrix& matrix, int loX, int hiX,
+                    int loY, int hiY);
+
+        /**
+        * Positions the iterator on the first point in the box, starting
+        * from the current row and column
+        */
+        void seek();
+
+        const HomologyMatrix& mat;
+        int loY, hiY;
+        int x, y;
+        bool valid;
+
+#ifdef GHM_TREE_MATRIX
+        map<int, set<int> >::const_iterator itX, endX;
+        set<int>::const_iterator itY;
+#else
+        size_t row, endRow;
+        size_t col, endCol;
+#endif
+    };
+
+    /**
+    * Returns an iterator over all points in a rectangular area
+    * @param loX Lowest x-coordinate (inclusive)
+    * @param hiX Highest x-coordinate (inclusive)
+    * @param loY Lowest y-coordinate (inclusive)
+    * @param hiY Highest y-coordinate (inclusive)
+    */
+    BoxIterator getBox(int loX, int hiX, int loY, int hiY) const;
+
+    /**
+    * Returns an iterator over all points in the matrix
+    */
+    BoxIterator getAll() const;
+
+    /**
+    * Removes the point the iterator refers to, the iterator can still
+    * be advanced with next() afterwards
+    * @param it Valid iterator obtained from this matrix
+    */
+    void erase(BoxIterator& it);
+
+private:
+
+#ifndef GHM_TREE_MATRIX
+    /**
+    * Finds the index of a point in the compressed arrays
+    * @return The index in cols, or cols.size() if the point is not stored
+    */
+    size_t find(int x, int y) const;
+#endif
+
+    //////////////
+    //ATTRIBUTES//
+    //////////////
+
+#ifdef GHM_TREE_MATRIX
+    // y-values per x-value
+    map<int, set<int> > tree;
+    size_t numPoints;
+#else
+    // sorted x-values of the non-empty rows
+    vector<int> rowX;
+
+    // rowStart[i]..rowStart[i+1] are the columns belonging to row i
+    vector<size_t> rowStart;
+
+    // sorted y-values of every row
+    vector<int> cols;
+
+    // true if the corresponding entry in cols was erased
+    vector<bool> deleted;
+
+    // points inserted since the last merge that were not in the arrays
+    vector<pair<int, int> > staged;
+
+    // number of non-deleted points in the arrays
+    size_t numPoints;
+#endif
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "KspdIndex.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+KspdIndex::KspdIndex(const vector<AnchorPoint>& others) : numSorted(0)
+{
+    points.reserve(others.size());
+    for (size_t i = 0; i < others.size(); i++)
+        add(others[i].getX(), others[i].getY());
+}
+
+void KspdIndex::consolidate() const
+{
+    vector<pair<int, int> >::iterator mid = points.begin() + numSorted;
+    sort(mid, points.end());
+    inplace_merge(points.begin(), mid, points.end());
+    numSorted = points.size();
+}
+
+int KspdIndex::distanceTo(int x, int y, int bound) const
+{
+    // merge the tail when scanning it would dominate the query
+    if (points.size() - numSorted > 16 + numSorted / 8)
+        consolidate();
+
+    int best = bound;
+
+    // sweep to the right of x, then to the left
+    vector<pair<int, int> >::const_iterator begin = points.begin();
+    vector<pair<int, int> >::const_iterator end = begin + numSorted;
+    vector<pair<int, int> >::const_iterator it, start;
+    start = lower_bound(begin, end, make_pair(x, INT_MIN));
+
+    for (it = start; it != end && it->first - x < best; it++)
+        best = min(best, max(it->first - x, abs(it->second - y)));
+
+    for (it = start; it != begin && x - (it-1)->first < best; it--)
+        best = min(best, max(x - (it-1)->first, abs((it-1)->second - y)));
+
+    // the unsorted tail
+    for (it = end; it != points.end(); it++)
+        best = min(best, max(abs(it->first - x), abs(it->second - y)));
+
+    return best;
+}
+
+int KspdIndex::distanceTo(const vector<AnchorPoint>& others, int bound) const
+{
+    int best = bound;
+    for (size_t i = 0; i < others.size() && best > 0; i++)
+        best = distanceTo(others[i].getX(), others[i].getY(), best);
+
+    return best;
+}
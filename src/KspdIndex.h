@@ -0,0 +1,98 @@
+#ifndef __KSPDINDEX_H
+#define __KSPDINDEX_H
+
+#include "headers.h"
+#include "AnchorPoint.h"
+
+#include <climits>
+
+/*
+ * Index over a set of points that answers minimal kspd (Chebyshev
+ * distance) queries.
+ *
+ * The points are kept sorted on x: a query starts at the x-coordinate of
+ * the query point and sweeps outwards in both directions until the
+ * x-distance alone exceeds the best distance found. Points can be added
+ * at any time, they are kept in an unsorted tail that is scanned linearly
+ * and merged into the sorted part once it grows too large.
+ */
+class KspdIndex
+{
+
+public:
+    ///////////////////////////////
+    //CONSTRUCTORS AND DESTRUCTOR//
+    ///////////////////////////////
+
+    /**
+    * Constructs an empty index
+    */
+    KspdIndex() : numSorted(0) {}
+
+    /**
+    * Constructs an index over the specified anchorpoints
+    */
+    KspdIndex(const vector<AnchorPoint>& points);
+
+    //////////////////
+    //PUBLIC METHODS//
+    //////////////////
+
+    /**
+    * Adds a point to the index
+    */
+    void add(int x, int y) {
+        points.push_back(std::make_pair(x, y));
+    }
+
+    /**
+    * Removes all points
+    */
+    void clear() {
+        points.clear();
+        numSorted = 0;
+    }
+
+    /**
+    * Returns the number of points
+    */
+    size_t size() const {
+        return points.size();
+    }
+
+    /**
+    * Returns the minimal kspd between a point and the points in the index
+    * @param x The x-coordinate of the point
+    * @param y The y-coordinate of the point
+    * @param bound Distances of bound or more need not be reported exactly
+    * @return The minimal kspd, or bound if no point lies closer
+    */
+    int distanceTo(int x, int y, int bound = INT_MAX) const;
+
+    /**
+    * Returns the minimal kspd between a set of anchorpoints and the points
+    * in the index
+    * @param others The anchorpoints
+    * @param bound Distances of bound or more need not be reported exactly
+    * @return The minimal kspd, or bound if no pair of points lies closer
+    */
+    int distanceTo(const vector<AnchorPoint>& others,
+                   int bound = INT_MAX) const;
+
+private:
+
+    /**
+    * Merges the unsorted tail into the sorted part of the points
+    */
+    void consolidate() const;
+
+    //////////////
+    //ATTRIBUTES//
+    //////////////
+
+    // points[0..numSorted-1] are sorted, the others are not
+    mutable vector<pair<int, int> > points;
+    mutable size_t numSorted;
+};
+
+#endif
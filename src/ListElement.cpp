@@ -17,18 +17,6 @@ Gene& ListElement::getGene() {
     return gene;
 }
 
-void ListElement::matchingPositions(const vector<ListElement*>& list,
-                                    queue<int>& q) const
-{
-    for (unsigned int i = 0; i < list.size(); i++) {
-        if (list[i]->isGap()) continue;
-        if (list[i]->isMasked()) continue;
-
-        if (gene.isPairWith(list[i]->getGene()))
-            q.push(i);
-    }
-}
-
 bool ListElement::isMasked() const {
     return masked;
 }
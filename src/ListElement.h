@@ -36,12 +36,6 @@ public:
     */
     Gene& getGene();
 
-    /*
-    *fills in the queue with integers corresponding to pairs with the listelement
-    */
-    void matchingPositions(const vector<ListElement*>& list,
-                           queue<int>& q) const;
-
     /*
     *returns true if the list element is masked
     */
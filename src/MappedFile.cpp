@@ -0,0 +1,109 @@
+#include "MappedFile.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+MappedFile::MappedFile(const string& fileName, const string& description) :
+	data(NULL), size(0)
+{
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) throw FileException ("Error opening " + description +
+					 ": " + fileName);
+
+	struct stat sb;
+	if (fstat(fd, &sb) != 0) {
+		close(fd);
+		throw FileException ("Error reading " + description + ": " +
+				     fileName);
+	}
+
+	size = sb.st_size;
+	if (size > 0) {
+		void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED) {
+			close(fd);
+			throw FileException ("Error mapping " + description +
+					     ": " + fileName);
+		}
+		madvise(map, size, MADV_SEQUENTIAL);
+		data = static_cast<const char*>(map);
+	}
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != NULL)
+		munmap(const_cast<char*>(data), size);
+}
+
+void MappedFile::split(int numChunks, vector<const char*>& bounds) const
+{
+	const char* end = data + size;
+
+	bounds.clear();
+	bounds.push_back(data);
+	for (int i = 1; i < numChunks; i++) {
+		const char* pos = data + (size / numChunks) * i;
+		if (pos <= bounds.back()) continue;
+
+		// move the boundary just past the next newline
+		const char* eol = (const char*)memchr(pos, '\n', end - pos);
+		if (eol == NULL) break;
+		if (eol + 1 < end)
+			bounds.push_back(eol + 1);
+	}
+	bounds.push_back(end);
+}
+
+struct ChunkArgs {
+	ChunkParser* parser;
+	const char* begin;
+	const char* end;
+	int chunkID;
+};
+
+extern "C" void* startChunkThread(void *args)
+{
+	ChunkArgs *chunk = reinterpret_cast<ChunkArgs*>(args);
+	chunk->parser->parseChunk(chunk->begin, chunk->end, chunk->chunkID);
+	return NULL;
+}
+
+int MappedFile::parse(ChunkParser& parser, int numThreads) const
+{
+	vector<const char*> bounds;
+	split(numThreads < 1 ? 1 : numThreads, bounds);
+	int numChunks = bounds.size() - 1;
+
+	vector<ChunkArgs> args(numChunks);
+	for (int i = 0; i < numChunks; i++) {
+		args[i].parser = &parser;
+		args[i].begin = bounds[i];
+		args[i].end = bounds[i+1];
+		args[i].chunkID = i;
+	}
+
+	// chunks for which no thread could be created are parsed serially
+	vector<pthread_t> threads(numChunks);
+	vector<bool> started(numChunks, false);
+	for (int i = 1; i < numChunks; i++)
+		started[i] = (pthread_create(&threads[i], NULL,
+					     startChunkThread, &args[i]) == 0);
+
+	startChunkThread(&args[0]);
+	for (int i = 1; i < numChunks; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			startChunkThread(&args[i]);
+	}
+
+	return numChunks;
+}
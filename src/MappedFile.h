@@ -0,0 +1,100 @@
+#ifndef __MAPPEDFILE_H
+#define __MAPPEDFILE_H
+
+#include "debug/FileException.h"
+#include "headers.h"
+
+/*
+ * Interface for parsers that process a file in independent chunks
+ */
+class ChunkParser
+{
+public:
+	virtual ~ChunkParser() {}
+
+	/**
+	 * Parses the complete lines in [begin, end), called concurrently for
+	 * different chunks, so the implementation may only modify state that
+	 * belongs to the chunk
+	 * @param begin Start of the chunk
+	 * @param end End of the chunk
+	 * @param chunkID Index of the chunk, chunks are numbered in file order
+	 */
+	virtual void parseChunk(const char* begin, const char* end,
+				int chunkID) = 0;
+};
+
+/*
+ * Read-only memory map of a complete file
+ */
+class MappedFile
+{
+public:
+	////////////////
+	//CONSTRUCTORS//
+	////////////////
+
+	/**
+	 * Maps a file into memory
+	 * @param fileName Name of the file
+	 * @param description Description of the file used in error messages
+	 */
+	MappedFile(const string& fileName, const string& description);
+
+	/**
+	 * Destructor, unmaps the file
+	 */
+	~MappedFile();
+
+	//////////////////
+	//PUBLIC METHODS//
+	//////////////////
+
+	/**
+	 * Returns a pointer to the first byte of the file
+	 */
+	const char* getData() const {
+		return data;
+	}
+
+	/**
+	 * Returns the size of the file in bytes
+	 */
+	size_t getSize() const {
+		return size;
+	}
+
+	/**
+	 * Splits the file at newline boundaries into at most numChunks chunks
+	 * of approximately equal size
+	 * @param numChunks Requested number of chunks
+	 * @param bounds Chunk i is [bounds[i], bounds[i+1]) (output)
+	 */
+	void split(int numChunks, vector<const char*>& bounds) const;
+
+	/**
+	 * Splits the file into chunks and parses every chunk in a separate
+	 * thread, the calling thread parses the first chunk
+	 * @param parser Parser to apply to the chunks
+	 * @param numThreads Number of threads (and chunks) to use
+	 * @return Number of chunks that were parsed
+	 */
+	int parse(ChunkParser& parser, int numThreads) const;
+
+private:
+	// no copies
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	//////////////
+	//ATTRIBUTES//
+	//////////////
+
+	// start of the mapping, NULL for empty files
+	const char* data;
+
+	// size of the file in bytes
+	size_t size;
+};
+
+#endif
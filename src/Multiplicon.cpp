@@ -6,6 +6,7 @@
 #include "BaseCluster.h"
 #include "ListElement.h"
 #include "Profile.h"
+#include "WireFormat.h"
 
 typedef vector<ListElement* >::const_iterator VecListElementCIt;
 
@@ -16,38 +17,12 @@ Multiplicon::Multiplicon(int xObjectID, int yObjectID, int _level)
 
 }
 
-Multiplicon::Multiplicon(const char *buffer,
+Multiplicon::Multiplicon(const char *&buffer, const char *end,
                          const vector<GeneList* >& genelists,
                          bool useFamily) :
     profile(NULL), multipliconID(0), parentID(0), ySegment(NULL)
 {
-    memcpy(&x_objectID, buffer, sizeof(x_objectID));
-    buffer += sizeof(x_objectID);
-    memcpy(&y_objectID, buffer, sizeof(y_objectID));
-    buffer += sizeof(y_objectID);
-    memcpy(&level, buffer, sizeof(level));
-    buffer += sizeof(level);
-    memcpy(&isRedundant, buffer, sizeof(isRedundant));
-    buffer += sizeof(isRedundant);
-    memcpy(&begin_x, buffer, sizeof(begin_x));
-    buffer += sizeof(begin_x);
-    memcpy(&end_x, buffer, sizeof(end_x));
-    buffer += sizeof(end_x);
-    memcpy(&begin_y, buffer, sizeof(begin_y));
-    buffer += sizeof(begin_y);
-    memcpy(&end_y, buffer, sizeof(end_y));
-    buffer += sizeof(end_y);
-
-    int size = 0;
-    memcpy(&size, buffer, sizeof(size));
-    buffer += sizeof(size);
-
-    baseclusters.reserve(size);
-    for (int i = 0; i < size; i++) {
-        BaseCluster *cluster = new BaseCluster(buffer);
-        addBaseCluster(*cluster);
-        buffer += cluster->getPackSize();
-    }
+    unpackFields(buffer, end);
 
     extractXObject(*genelists[x_objectID]);
     extractYObject(*genelists[y_objectID]);
@@ -56,37 +31,12 @@ Multiplicon::Multiplicon(const char *buffer,
     createHomologs(useFamily, 0);
 }
 
-Multiplicon::Multiplicon(const char *buffer, const Profile &xObject,
+Multiplicon::Multiplicon(const char *&buffer, const char *end,
+                         const Profile &xObject,
                          const vector<GeneList* >& genelists, bool useFamily) :
     profile(NULL), multipliconID(0), parentID(0), ySegment(NULL)
 {
-    memcpy(&x_objectID, buffer, sizeof(x_objectID));
-    buffer += sizeof(x_objectID);
-    memcpy(&y_objectID, buffer, sizeof(y_objectID));
-    buffer += sizeof(y_objectID);
-    memcpy(&level, buffer, sizeof(level));
-    buffer += sizeof(level);
-    memcpy(&isRedundant, buffer, sizeof(isRedundant));
-    buffer += sizeof(isRedundant);
-    memcpy(&begin_x, buffer, sizeof(begin_x));
-    buffer += sizeof(begin_x);
-    memcpy(&end_x, buffer, sizeof(end_x));
-    buffer += sizeof(end_x);
-    memcpy(&begin_y, buffer, sizeof(begin_y));
-    buffer += sizeof(begin_y);
-    memcpy(&end_y, buffer, sizeof(end_y));
-    buffer += sizeof(end_y);
-
-    int size = 0;
-    memcpy(&size, buffer, sizeof(size));
-    buffer += sizeof(size);
-
-    baseclusters.reserve(size);
-    for (int i = 0; i < size; i++) {
-        BaseCluster *cluster = new BaseCluster(buffer);
-        addBaseCluster(*cluster);
-        buffer += cluster->getPackSize();
-    }
+    unpackFields(buffer, end);
 
     extractXObject(xObject);
     extractYObject(*genelists[y_objectID]);
@@ -107,6 +57,9 @@ Multiplicon::~Multiplicon()
         delete (*it);
 
     delete profile;
+
+    for (int i = 0; i < savedSegments.size(); i++)
+        delete savedSegments[i];
 }
 
 void Multiplicon::addBaseClusters(Multiplicon& multiplicon) {
@@ -192,14 +145,39 @@ void Multiplicon::write () const {
     }
 }
 
+void Multiplicon::unpackFields(const char *&buffer, const char *end)
+{
+    x_objectID = WireFormat::getVarInt(buffer, end);
+    y_objectID = WireFormat::getVarInt(buffer, end);
+    level = WireFormat::getVarInt(buffer, end);
+    WireFormat::getRaw(buffer, isRedundant, end);
+    begin_x = WireFormat::getVarInt(buffer, end);
+    end_x = WireFormat::getDelta(buffer, begin_x, end);
+    begin_y = WireFormat::getVarInt(buffer, end);
+    end_y = WireFormat::getDelta(buffer, begin_y, end);
+
+    int size = WireFormat::getCount(buffer, end);
+
+    baseclusters.reserve(size);
+    for (int i = 0; i < size; i++) {
+        BaseCluster *cluster = new BaseCluster(buffer, end);
+        addBaseCluster(*cluster);
+    }
+}
+
 int Multiplicon::getPackSize() const
 {
     int packSize = 0;
 
-    packSize += sizeof(x_objectID) + sizeof(y_objectID) + sizeof(level) +
-                sizeof(isRedundant) + sizeof(begin_x) +
-                sizeof(end_x) + sizeof(begin_y) + sizeof(end_y);
-    packSize += sizeof(int); // for storing the number of baseclusters
+    packSize += WireFormat::getVarIntSize(x_objectID) +
+                WireFormat::getVarIntSize(y_objectID) +
+                WireFormat::getVarIntSize(level) + sizeof(isRedundant);
+    packSize += WireFormat::getVarIntSize(begin_x) +
+                WireFormat::getDeltaSize(end_x, begin_x) +
+                WireFormat::getVarIntSize(begin_y) +
+                WireFormat::getDeltaSize(end_y, begin_y);
+    // the number of baseclusters
+    packSize += WireFormat::getVarIntSize(baseclusters.size());
     vector<BaseCluster*>::const_iterator it = baseclusters.begin();
     for ( ; it != baseclusters.end(); it++)
         packSize += (*it)->getPackSize();
@@ -211,26 +189,16 @@ int Multiplicon::pack(char *buffer) const
 {
     const char *bufferOrig = buffer;
 
-    memcpy(buffer, &x_objectID, sizeof(x_objectID));
-    buffer += sizeof(x_objectID);
-    memcpy(buffer, &y_objectID, sizeof(y_objectID));
-    buffer += sizeof(y_objectID);
-    memcpy(buffer, &level, sizeof(level));
-    buffer += sizeof(level);
-    memcpy(buffer, &isRedundant, sizeof(isRedundant));
-    buffer += sizeof(isRedundant);
-    memcpy(buffer, &begin_x, sizeof(begin_x));
-    buffer += sizeof(begin_x);
-    memcpy(buffer, &end_x, sizeof(end_x));
-    buffer += sizeof(end_x);
-    memcpy(buffer, &begin_y, sizeof(begin_y));
-    buffer += sizeof(begin_y);
-    memcpy(buffer, &end_y, sizeof(end_y));
-    buffer += sizeof(end_y);
-
-    int size = baseclusters.size();
-    memcpy(buffer, &size, sizeof(size));
-    buffer += sizeof(size);
+    WireFormat::putVarInt(buffer, x_objectID);
+    WireFormat::putVarInt(buffer, y_objectID);
+    WireFormat::putVarInt(buffer, level);
+    WireFormat::putRaw(buffer, isRedundant);
+    WireFormat::putVarInt(buffer, begin_x);
+    WireFormat::putDelta(buffer, end_x, begin_x);
+    WireFormat::putVarInt(buffer, begin_y);
+    WireFormat::putDelta(buffer, end_y, begin_y);
+
+    WireFormat::putVarInt(buffer, baseclusters.size());
 
     vector<BaseCluster*>::const_iterator it = baseclusters.begin();
     for ( ; it != baseclusters.end(); it++)
@@ -243,57 +211,256 @@ int Multiplicon::getPackSize(const vector<Multiplicon*> &mplicons)
 {
     int packSize = 0;
 
-    packSize += sizeof(int);    // for storing mplicons.size()
+    packSize += WireFormat::getVarIntSize(mplicons.size());
     vector<Multiplicon*>::const_iterator it = mplicons.begin();
     for ( ; it != mplicons.end(); it++)
         packSize += (*it)->getPackSize();
 
-    return packSize;
+    return WireFormat::HEADER_SIZE + packSize;
 }
 
-void Multiplicon::packMultiplicons(const vector<Multiplicon*> &mplicons,
-                                   char* buffer)
+int Multiplicon::packMultiplicons(const vector<Multiplicon*> &mplicons,
+                                  char* buffer)
 {
-    int nMultiplicons = mplicons.size();
-    memcpy(buffer, &nMultiplicons, sizeof(nMultiplicons));
-    buffer += sizeof(nMultiplicons);
+    char *header = buffer;
+    buffer += WireFormat::HEADER_SIZE;
+    WireFormat::putVarInt(buffer, mplicons.size());
 
     vector<Multiplicon*>::const_iterator it = mplicons.begin();
     for ( ; it != mplicons.end(); it++)
         buffer += (*it)->pack(buffer);
+
+    int length = buffer - header - WireFormat::HEADER_SIZE;
+    WireFormat::putHeader(header, length);
+
+    return WireFormat::HEADER_SIZE + length;
 }
 
-void Multiplicon::unpackL2Multiplicons(const char *buffer,
-                                       vector<Multiplicon*> &mplicons,
-                                       const vector<GeneList *>& genelists,
-                                       bool useFamily)
+int Multiplicon::unpackL2Multiplicons(const char *buffer, const char *end,
+                                      vector<Multiplicon*> &mplicons,
+                                      const vector<GeneList *>& genelists,
+                                      bool useFamily)
 {
-    int nMultiplicons = 0;
-    memcpy(&nMultiplicons, buffer, sizeof(nMultiplicons));
-    buffer += sizeof(nMultiplicons);
+    int length = WireFormat::getHeader(buffer, end);
+    end = buffer + length;
+    int nMultiplicons = WireFormat::getCount(buffer, end);
 
     mplicons.reserve(mplicons.size() + nMultiplicons);
-    for (int i = 0; i < nMultiplicons; i++) {
-        mplicons.push_back(new Multiplicon(buffer, genelists, useFamily));
-        buffer += mplicons.back()->getPackSize();
-    }
+    for (int i = 0; i < nMultiplicons; i++)
+        mplicons.push_back(new Multiplicon(buffer, end, genelists, useFamily));
+
+    return WireFormat::HEADER_SIZE + length;
 }
 
-void Multiplicon::unpackHLMultiplicons(const char *buffer,
-                                       vector<Multiplicon*> &mplicons,
-                                       const Profile &xObject,
-                                       const vector<GeneList *>& genelists,
-                                       bool useFamily)
+int Multiplicon::unpackHLMultiplicons(const char *buffer, const char *end,
+                                      vector<Multiplicon*> &mplicons,
+                                      const Profile &xObject,
+                                      const vector<GeneList *>& genelists,
+                                      bool useFamily)
 {
-    int nMultiplicons = 0;
-    memcpy(&nMultiplicons, buffer, sizeof(nMultiplicons));
-    buffer += sizeof(nMultiplicons);
+    int length = WireFormat::getHeader(buffer, end);
+    end = buffer + length;
+    int nMultiplicons = WireFormat::getCount(buffer, end);
 
     mplicons.reserve(mplicons.size() + nMultiplicons);
-    for (int i = 0; i < nMultiplicons; i++) {
-        mplicons.push_back(new Multiplicon(buffer, xObject, genelists, useFamily));
-        buffer += mplicons.back()->getPackSize();
+    for (int i = 0; i < nMultiplicons; i++)
+        mplicons.push_back(new Multiplicon(buffer, end, xObject, genelists,
+                                           useFamily));
+
+    return WireFormat::HEADER_SIZE + length;
+}
+
+/*
+ * Returns true if [begin, end] are positions in the remapped gene list
+ */
+static bool validRange(const GeneList &list, int begin, int end)
+{
+    int size = list.getRemappedElements().size();
+    return (begin >= 0) && (begin <= end) && (end < size);
+}
+
+/*
+ * Returns true if listID refers to a gene list and [begin, end] are
+ * positions in it
+ */
+static bool validRange(const vector<GeneList *>& genelists, int listID,
+                       int begin, int end)
+{
+    if (listID < 0 || listID >= (int)genelists.size())
+        return false;
+    return validRange(*genelists[listID], begin, end);
+}
+
+Multiplicon* Multiplicon::unpackL2Multiplicon(const char *&buffer,
+                                              const char *end,
+                                              const GeneList &xList,
+                                              const GeneList &yList,
+                                              bool useFamily)
+{
+    Multiplicon *multiplicon = new Multiplicon(0, 0, 0);
+    try {
+        multiplicon->unpackFields(buffer, end);
+
+        const Multiplicon &m = *multiplicon;
+        if (m.level != 2 || !validRange(xList, m.begin_x, m.end_x) ||
+            !validRange(yList, m.begin_y, m.end_y))
+            throw WireFormatException("multiplicon outside the gene lists");
+
+        // the coordinates of the anchorpoints identify the genes
+        const vector<ListElement*>& xElements = xList.getRemappedElements();
+        const vector<ListElement*>& yElements = yList.getRemappedElements();
+        for (size_t i = 0; i < m.baseclusters.size(); i++) {
+            const BaseCluster &cluster = *m.baseclusters[i];
+            vector<AnchorPoint>::const_iterator e = cluster.getAPBegin();
+            for ( ; e != cluster.getAPEnd(); e++) {
+                if (e->getX() < 0 || e->getX() >= (int)xElements.size() ||
+                    e->getY() < 0 || e->getY() >= (int)yElements.size())
+                    throw WireFormatException("anchorpoint outside the "
+                                              "gene lists");
+                const_cast<AnchorPoint&>(*e).setGeneIDs(xElements[e->getX()]->getNumID(),
+                                                        yElements[e->getY()]->getNumID());
+            }
+        }
+    } catch (const WireFormatException&) {
+        delete multiplicon;
+        throw;
     }
+    multiplicon->x_objectID = xList.getID();
+    multiplicon->y_objectID = yList.getID();
+
+    multiplicon->extractXObject(xList);
+    multiplicon->extractYObject(yList);
+
+    // ignore the return value of createHomologs
+    multiplicon->createHomologs(useFamily, 0);
+    return multiplicon;
+}
+
+// flags of a packed link
+static const unsigned char LINK_AP = 1;
+static const unsigned char LINK_ALIGNED = 2;
+
+int Multiplicon::getStatePackSize() const
+{
+    assert(profile == NULL);
+
+    int packSize = getPackSize() + WireFormat::getVarIntSize(parentID);
+
+    packSize += WireFormat::getVarIntSize(xSegments.size());
+    for (int i = 0; i < xSegments.size(); i++)
+        packSize += xSegments[i]->getPackSize();
+    packSize += ySegment->getPackSize();
+
+    // the gene IDs are stored as the difference with the previous link
+    packSize += WireFormat::getVarIntSize(homologs.size());
+    int geneX = 0, geneY = 0;
+    set<Link>::const_iterator it = homologs.begin();
+    for ( ; it != homologs.end(); it++) {
+        packSize += WireFormat::getVarIntSize(it->segmentX) +
+                    WireFormat::getVarIntSize(it->segmentY) +
+                    WireFormat::getDeltaSize(it->geneXID, geneX) +
+                    WireFormat::getDeltaSize(it->geneYID, geneY) + 1;
+        geneX = it->geneXID;
+        geneY = it->geneYID;
+    }
+
+    return packSize;
+}
+
+int Multiplicon::packState(char *buffer) const
+{
+    assert(profile == NULL);
+
+    const char *bufferOrig = buffer;
+
+    buffer += pack(buffer);
+    WireFormat::putVarInt(buffer, parentID);
+
+    WireFormat::putVarInt(buffer, xSegments.size());
+    for (int i = 0; i < xSegments.size(); i++)
+        buffer += xSegments[i]->pack(buffer);
+    buffer += ySegment->pack(buffer);
+
+    WireFormat::putVarInt(buffer, homologs.size());
+    int geneX = 0, geneY = 0;
+    set<Link>::const_iterator it = homologs.begin();
+    for ( ; it != homologs.end(); it++) {
+        WireFormat::putVarInt(buffer, it->segmentX);
+        WireFormat::putVarInt(buffer, it->segmentY);
+        WireFormat::putDelta(buffer, it->geneXID, geneX);
+        WireFormat::putDelta(buffer, it->geneYID, geneY);
+        unsigned char flags = 0;
+        if (it->isAP) flags |= LINK_AP;
+        if (it->isAligned) flags |= LINK_ALIGNED;
+        *buffer++ = (char)flags;
+        geneX = it->geneXID;
+        geneY = it->geneYID;
+    }
+
+    return buffer - bufferOrig;
+}
+
+Multiplicon* Multiplicon::unpackState(const char *&buffer, const char *end,
+                                      const vector<GeneList *>& genelists)
+{
+    Multiplicon *multiplicon = new Multiplicon(0, 0, 0);
+    try {
+        multiplicon->unpackFields(buffer, end);
+        multiplicon->parentID = WireFormat::getVarInt(buffer, end);
+
+        int nSegments = WireFormat::getCount(buffer, end);
+        multiplicon->xSegments.reserve(nSegments);
+        for (int i = 0; i < nSegments; i++)
+            multiplicon->xSegments.push_back(new GeneList(buffer, end,
+                                                          genelists));
+        multiplicon->ySegment = new GeneList(buffer, end, genelists);
+
+        // the links were packed in order, the y-segment comes last
+        int nHomologs = WireFormat::getCount(buffer, end);
+        int geneX = 0, geneY = 0;
+        for (int i = 0; i < nHomologs; i++) {
+            int segmentX = WireFormat::getVarInt(buffer, end);
+            int segmentY = WireFormat::getVarInt(buffer, end);
+            geneX = WireFormat::getDelta(buffer, geneX, end);
+            geneY = WireFormat::getDelta(buffer, geneY, end);
+            unsigned char flags;
+            WireFormat::getRaw(buffer, flags, end);
+            if (segmentX < 0 || segmentX > nSegments ||
+                segmentY < 0 || segmentY > nSegments)
+                throw WireFormatException("link to an unknown segment");
+
+            Link link(segmentX, segmentY, geneX, geneY, (flags & LINK_AP) != 0);
+            link.isAligned = (flags & LINK_ALIGNED) != 0;
+            multiplicon->homologs.insert(multiplicon->homologs.end(), link);
+        }
+
+        // the masking uses the positions, the output the gene IDs
+        const Multiplicon &m = *multiplicon;
+        bool valid = (m.level >= 2) &&
+                     validRange(genelists, m.y_objectID, m.begin_y, m.end_y);
+        if (m.level == 2)
+            valid = valid && validRange(genelists, m.x_objectID, m.begin_x,
+                                        m.end_x);
+
+        int numGenes = 0;
+        for (size_t l = 0; l < genelists.size(); l++)
+            numGenes += genelists[l]->getElementsLength();
+        for (size_t c = 0; valid && c < m.baseclusters.size(); c++) {
+            vector<AnchorPoint>::const_iterator e;
+            for (e = m.baseclusters[c]->getAPBegin();
+                 valid && e != m.baseclusters[c]->getAPEnd(); e++)
+                valid = e->getGeneXID() >= 0 && e->getGeneXID() < numGenes &&
+                        e->getGeneYID() >= 0 && e->getGeneYID() < numGenes;
+        }
+
+        if (!valid)
+            throw WireFormatException("multiplicon outside the gene lists");
+    } catch (const WireFormatException&) {
+        delete multiplicon;
+        throw;
+    }
+
+    return multiplicon;
 }
 
 bool operator==(const Multiplicon &lhs, const Multiplicon &rhs)
@@ -447,7 +614,7 @@ void Multiplicon::addLinks(bool useFamily)
             }
         }
     } else {    // we're using gene families
-        map<string, set<pair<ListElement*, int> > > pairMap;
+        map<uint32_t, set<pair<ListElement*, int> > > pairMap;
 
         // insert the elements of the profile
         for (int i = 0; i < xSegments.size(); i++) {
@@ -455,7 +622,7 @@ void Multiplicon::addLinks(bool useFamily)
                 ListElement *le = xSegments[i]->getRemappedElements()[j];
                 if (le->isGap()) continue;
 
-                pairMap[le->getGene().getFamily()].insert(pair<ListElement*, int>(le, i));
+                pairMap[le->getGene().getFamilyID()].insert(pair<ListElement*, int>(le, i));
             }
         }
 
@@ -464,7 +631,7 @@ void Multiplicon::addLinks(bool useFamily)
             ListElement *le = ySegment->getRemappedElements()[j];
             if (le->isGap()) continue;
 
-            pairMap[le->getGene().getFamily()].insert(pair<ListElement*, int>(le, xSegments.size()));
+            pairMap[le->getGene().getFamilyID()].insert(pair<ListElement*, int>(le, xSegments.size()));
         }
 
         // now extract the homologs
@@ -472,8 +639,8 @@ void Multiplicon::addLinks(bool useFamily)
             ListElement *eY = ySegment->getRemappedElements()[j];
             if (eY->isGap()) continue;
 
-            map<string, set<pair<ListElement*, int> > >::iterator it =
-                pairMap.find(eY->getGene().getFamily());
+            map<uint32_t, set<pair<ListElement*, int> > >::iterator it =
+                pairMap.find(eY->getGene().getFamilyID());
             set<pair<ListElement*, int> > &group = it->second;
 
             set<pair<ListElement*, int> >::iterator e;
@@ -498,7 +665,7 @@ void Multiplicon::addLinks(bool useFamily)
     int offY = getBeginY();
     vector<BaseCluster*>::const_iterator bc = getBaseClusters().begin();
     for ( ; bc != getBaseClusters().end(); bc++) {
-        multiset<AnchorPoint>::const_iterator e = (*bc)->getAPBegin();
+        vector<AnchorPoint>::const_iterator e = (*bc)->getAPBegin();
         for ( ; e != (*bc)->getAPEnd(); e++) {
             // get the y-element
             ListElement &eY = ySegment->getLe(e->getY()-offY);
@@ -532,11 +699,42 @@ void Multiplicon::addLinks(bool useFamily)
     }
 }
 
-void Multiplicon::createProfile(int profileID)
+void Multiplicon::createProfile(int profileID, bool revertible)
 {
+    // the profile permutes and aligns the segments in place
+    if (revertible) {
+        for (int i = 0; i < xSegments.size(); i++)
+            savedSegments.push_back(new GeneList(*xSegments[i], 0,
+                                                 xSegments[i]->getSize() - 1));
+        savedSegments.push_back(new GeneList(*ySegment, 0,
+                                             ySegment->getSize() - 1));
+    }
+
     profile = new Profile(*this, profileID);
 }
 
+void Multiplicon::discardProfile()
+{
+    assert(savedSegments.size() == xSegments.size() + 1);
+
+    delete profile;
+    profile = NULL;
+
+    for (int i = 0; i < xSegments.size(); i++) {
+        delete xSegments[i];
+        xSegments[i] = savedSegments[i];
+    }
+    delete ySegment;
+    ySegment = savedSegments.back();
+    savedSegments.clear();
+}
+
+void Multiplicon::setProfileID(int profileID)
+{
+    assert(profile != NULL);
+    profile->setId(profileID);
+}
+
 void Multiplicon::align(const AlignmentMethod &alignMethod, int maxGaps)
 {
     assert(profile != NULL);
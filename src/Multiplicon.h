@@ -69,21 +69,25 @@ public:
 
     /**
      * Constructs a multiplicon object from a packed buffer
-     * @param buffer Buffer that contains serialized multiplicon object
+     * @param buffer Buffer that contains serialized multiplicon object, it
+     * is advanced past the multiplicon
+     * @param end End of the buffer
      * @param genelists Reference to the gene lists
      * @param useFamily True if we're using gene families
      */
-    Multiplicon(const char *buffer, const vector<GeneList* >& genelists,
-                bool useFamily);
+    Multiplicon(const char *&buffer, const char *end,
+                const vector<GeneList* >& genelists, bool useFamily);
 
     /**
      * Constructs a multiplicon object from a packed buffer
-     * @param buffer Buffer that contains serialized multiplicon object
+     * @param buffer Buffer that contains serialized multiplicon object, it
+     * is advanced past the multiplicon
+     * @param end End of the buffer
      * @param xObject xObject profile used to create this multiplicon
      * @param genelists Reference to the gene lists
      * @param useFamily True if we're using gene families
      */
-    Multiplicon(const char *buffer, const Profile &xObject,
+    Multiplicon(const char *&buffer, const char *end, const Profile &xObject,
                 const vector<GeneList* >& genelists, bool useFamily);
 
     /**
@@ -157,8 +161,22 @@ public:
     /**
      * Create a profile from this multiplicon
      * @param profileID Unique identifier for the profile
+     * @param revertible Keep a copy of the segments, so that the profile can
+     * be discarded after it was aligned
+     */
+    void createProfile(int profileID, bool revertible = false);
+
+    /**
+     * Discard a revertible profile and restore the segments to their state
+     * before the profile was created
+     */
+    void discardProfile();
+
+    /**
+     * Change the identifier of the profile created from this multiplicon
+     * @param profileID Unique identifier for the profile
      */
-    void createProfile(int profileID);
+    void setProfileID(int profileID);
 
     /**
      * Align the profile associated with this multiplicon
@@ -225,43 +243,102 @@ public:
     /**
      * Get the number of chars to pack a number of multiplicons
      * @param mplicons Multiplicons to be packed
-     * @return Number of chars to pack the multiplicons
+     * @return Number of chars to pack the multiplicons, including the
+     * WireFormat header
      */
     static int getPackSize(const vector<Multiplicon*> &mplicons);
 
     /**
-     * Pack multiplicons in a buffer
+     * Pack multiplicons in a buffer, preceded by a WireFormat header
      * @param mplicons Multiplicons to be packed
      * @param buffer Pre-allocated buffer (output)
+     * @return The number of chars in the buffer that were used
      */
-    static void packMultiplicons(const vector<Multiplicon*> &mplicons,
-                                 char* buffer);
+    static int packMultiplicons(const vector<Multiplicon*> &mplicons,
+                                char* buffer);
 
     /**
      * Unpack multiplicons in a buffer
      * @param buffer Buffer that contains packed multiplicons
+     * @param end End of the buffer
      * @param mplicons Multiplicons to be unpacked (output)
      * @param genelists Reference to the genelists
      * @param useFamily True if we're using gene families
+     * @return The number of chars in the buffer that were read
+     * @throw WireFormatException If the buffer has a different version or
+     * is truncated
      */
-    static void unpackL2Multiplicons(const char *buffer,
-                                     vector<Multiplicon*> &mplicons,
-                                     const vector<GeneList *>& genelists,
-                                     bool useFamily);
+    static int unpackL2Multiplicons(const char *buffer, const char *end,
+                                    vector<Multiplicon*> &mplicons,
+                                    const vector<GeneList *>& genelists,
+                                    bool useFamily);
 
     /**
      * Unpack multiplicons in a buffer
      * @param buffer Buffer that contains packed multiplicons
+     * @param end End of the buffer
      * @param mplicons Multiplicons to be unpacked (output)
      * @param profile Reference to the profile used to create this object
      * @param genelists Reference to the genelists
      * @param useFamily True if we're using gene families
+     * @return The number of chars in the buffer that were read
+     * @throw WireFormatException If the buffer has a different version or
+     * is truncated
      */
-    static void unpackHLMultiplicons(const char *buffer,
-                                     vector<Multiplicon*> &mplicons,
-                                     const Profile &profile,
-                                     const vector<GeneList *>& genelists,
-                                     bool useFamily);
+    static int unpackHLMultiplicons(const char *buffer, const char *end,
+                                    vector<Multiplicon*> &mplicons,
+                                    const Profile &profile,
+                                    const vector<GeneList *>& genelists,
+                                    bool useFamily);
+
+    /**
+     * Unpack a level-2 multiplicon that was found in a GHM of two gene lists
+     * with the same content, e.g. in an earlier run. The list IDs and the
+     * gene IDs of the anchorpoints are taken from the given gene lists.
+     * @param buffer Buffer that contains the packed multiplicon, it is
+     * advanced past the multiplicon
+     * @param end End of the buffer
+     * @param xList Gene list in x
+     * @param yList Gene list in y
+     * @param useFamily True if we're using gene families
+     * @return The multiplicon, owned by the caller
+     * @throw WireFormatException If the buffer ends before the multiplicon
+     * or it lies outside the gene lists
+     */
+    static Multiplicon* unpackL2Multiplicon(const char *&buffer,
+                                            const char *end,
+                                            const GeneList &xList,
+                                            const GeneList &yList,
+                                            bool useFamily);
+
+    /**
+     * Get the number of chars to pack the complete state of a multiplicon
+     * that awaits its evaluation
+     * @return Number of chars to pack the fields and baseclusters, the
+     * parent, the segments and the homologous links
+     */
+    int getStatePackSize() const;
+
+    /**
+     * Pack the complete state of a multiplicon that awaits its evaluation,
+     * i.e. that has no profile
+     * @param buffer Pre-allocated buffer to store the data in
+     * @return The number of chars in the buffer that were used
+     */
+    int packState(char *buffer) const;
+
+    /**
+     * Construct a multiplicon from a state packed by packState
+     * @param buffer Buffer that contains the packed state, it is advanced
+     * past the multiplicon
+     * @param end End of the buffer
+     * @param genelists Reference to the genelists
+     * @return The multiplicon, owned by the caller
+     * @throw WireFormatException If the buffer ends before the multiplicon
+     * or the multiplicon refers to lists or genes that do not exist
+     */
+    static Multiplicon* unpackState(const char *&buffer, const char *end,
+                                    const vector<GeneList *>& genelists);
 
     friend bool operator==(const Multiplicon &lhs, const Multiplicon &rhs);
 
@@ -368,6 +445,13 @@ private:
     */
     void operator=(const Multiplicon& multiplicon) {};
 
+    /**
+     * Read the fields and baseclusters of a packed multiplicon, the buffer
+     * is advanced past the multiplicon
+     * @param end End of the buffer
+     */
+    void unpackFields(const char *&buffer, const char *end);
+
     /**
      * Remove the homologous links that are not contained in the xSegment
      */
@@ -397,6 +481,10 @@ private:
     // the profile corresponding to this multiplicon
     Profile* profile;
 
+    // copy of the x-segments and y-segment from before a revertible
+    // profile was created
+    vector<GeneList*> savedSegments;
+
     // set of homologous pairs within this multiplicon
     std::set<Link> homologs;
 
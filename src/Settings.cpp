@@ -6,7 +6,9 @@ Settings::Settings(const string& settingsFile)
         use_family(false), alignment_method(NeedlemanWunsch), nThreads(1),
         mulHypCor(Bonferroni), compareAligners(false), max_gaps_in_alignment(0),
         flush_output(1000), clusterType(Collinear),visualizeGHM(false),cloudFiltermethod(Binomial),
-        visualizeAlignment(false), verbose_output(true), bruteForceSynthenyMode(false)
+        visualizeAlignment(false), verbose_output(true), bruteForceSynthenyMode(false),
+        split_large_ghms(false), profile_batch_size(1),
+        dynamic_level_2(false), checkpoint_interval(1800)
 {
     string genomename, listname, filename;
 
@@ -50,9 +52,49 @@ Settings::Settings(const string& settingsFile)
                     output_path.append("/");
 
         }
+        else if (startsWith(buffer, "dataset_cache", next)) {
+            buffer.erase(0, next);
+            readFromBuffer(dataset_cache, buffer);
+            // add a backslash to the directory if necessary
+            if (!dataset_cache.empty())
+                if (dataset_cache[dataset_cache.length() - 1] != '/')
+                    dataset_cache.append("/");
+        }
+        else if (startsWith(buffer, "level2_cache", next)) {
+            buffer.erase(0, next);
+            readFromBuffer(level2_cache, buffer);
+            // add a backslash to the directory if necessary
+            if (!level2_cache.empty())
+                if (level2_cache[level2_cache.length() - 1] != '/')
+                    level2_cache.append("/");
+        }
+        else if (startsWith(buffer, "cost_model_file", next)) {
+            buffer.erase(0, next);
+            readFromBuffer(cost_model_file, buffer);
+        }
+        else if (startsWith(buffer, "checkpoint_file", next)) {
+            buffer.erase(0, next);
+            readFromBuffer(checkpoint_file, buffer);
+        }
+        else if (startsWith(buffer, "checkpoint_interval", next)) {
+            checkpoint_interval = atoi(&buffer[next]);
+            if (checkpoint_interval < 0)
+                throw FileException ("ERROR: The checkpoint_interval attribute "
+                                     "should be at least 0");
+        }
+        else if (startsWith(buffer, "resume_from", next)) {
+            buffer.erase(0, next);
+            readFromBuffer(resume_from, buffer);
+        }
         else if (startsWith(buffer, "flush_output", next)) {
             flush_output = atoi(&buffer[next]);
         }
+        else if (startsWith(buffer, "profile_batch_size", next)) {
+            profile_batch_size = atoi(&buffer[next]);
+            if (profile_batch_size < 1)
+                throw FileException ("ERROR: The profile_batch_size attribute "
+                                     "should be at least 1");
+        }
         else if (startsWith(buffer, "gap_size", next)) {
             gap_size = atoi(&buffer[next]);
         }
@@ -108,6 +150,30 @@ Settings::Settings(const string& settingsFile)
                 throw FileException ("ERROR: The level_2_only attribute is not "
                                      "correct (should be \"true\" or \"false\")");
         }
+        else if (startsWith(buffer, "split_large_ghms", next)) {
+            buffer.erase(0, next);
+            string boolean;
+            readFromBuffer(boolean, buffer);
+            if (boolean == "true")
+                split_large_ghms = true;
+            else if (boolean == "false")
+                split_large_ghms = false;
+            else
+                throw FileException ("ERROR: The split_large_ghms attribute is not "
+                                     "correct (should be \"true\" or \"false\")");
+        }
+        else if (startsWith(buffer, "dynamic_level_2", next)) {
+            buffer.erase(0, next);
+            string boolean;
+            readFromBuffer(boolean, buffer);
+            if (boolean == "true")
+                dynamic_level_2 = true;
+            else if (boolean == "false")
+                dynamic_level_2 = false;
+            else
+                throw FileException ("ERROR: The dynamic_level_2 attribute is not "
+                                     "correct (should be \"true\" or \"false\")");
+        }
         else if (startsWith(buffer, "write_stats", next)) {
             buffer.erase(0, next);
             string boolean;
@@ -377,6 +443,17 @@ void Settings::displaySettings() const
 
     cout << "\tBlast table = "             << blast_table             << endl;
     cout << "\tOutput path = "             << output_path             << endl;
+    if (!dataset_cache.empty())
+        cout << "\tDataset cache = "       << dataset_cache         << endl;
+    if (!level2_cache.empty())
+        cout << "\tLevel-2 cache = "       << level2_cache          << endl;
+    if (!cost_model_file.empty())
+        cout << "\tCost model file = "     << cost_model_file       << endl;
+    if (!checkpoint_file.empty())
+        cout << "\tCheckpoint file = "     << checkpoint_file       << " (every "
+             << checkpoint_interval << "s)" << endl;
+    if (!resume_from.empty())
+        cout << "\tResume from = "         << resume_from           << endl;
     cout << "\tGap size = "                << gap_size                << endl;
     cout << "\tCluster gap size = "        << cluster_gap             << endl;
     cout << "\tCloud gap size = "          << cloud_gap_size          << endl;
@@ -454,6 +531,12 @@ void Settings::displaySettings() const
     cout << endl;
 
     cout << "\tNumber of threads = " << nThreads << endl;
+    if (split_large_ghms)
+        cout << "\tSplit large GHMs over threads = true" << endl;
+    if (dynamic_level_2)
+        cout << "\tDynamic level-2 load balancing over processes = true" << endl;
+    if (profile_batch_size > 1)
+        cout << "\tProfile batch size = " << profile_batch_size << endl;
 
     cout << "\tCompare aligners = ";
     if (compareAligners) cout << "true" << endl;
@@ -148,6 +148,50 @@ public:
         return output_path;
     }
 
+    /*
+    *returns the directory of the binary dataset cache (empty if disabled)
+    */
+    const string& getDatasetCache() const {
+        return dataset_cache;
+    }
+
+    /*
+    *returns the directory of the level-2 result cache (empty if disabled)
+    */
+    const string& getLevel2Cache() const {
+        return level2_cache;
+    }
+
+    /*
+    *returns the file holding the level-2 cost model (empty if disabled)
+    */
+    const string& getCostModelFile() const {
+        return cost_model_file;
+    }
+
+    /*
+    *returns the file to which the profile detection state is written
+    *periodically (empty if disabled)
+    */
+    const string& getCheckpointFile() const {
+        return checkpoint_file;
+    }
+
+    /*
+    *returns the minimum number of seconds between two checkpoints
+    */
+    int getCheckpointInterval() const {
+        return checkpoint_interval;
+    }
+
+    /*
+    *returns the checkpoint to resume the profile detection from (empty to
+    *start from scratch)
+    */
+    const string& getResumeFrom() const {
+        return resume_from;
+    }
+
     /*
     *returns true if the user wants only level 2 multiplicons calculated
     */
@@ -217,6 +261,33 @@ public:
         return bruteForceSynthenyMode;
     }
 
+    /*
+    *returns true if a level-2 GHM that dominates the workload is split in
+    *x-bands that are processed by all threads
+    */
+    bool splitLargeGHMs() const
+    {
+        return split_large_ghms;
+    }
+
+    /*
+    *returns the maximum number of profiles that are searched against the
+    *genelists in one sweep
+    */
+    int getProfileBatchSize() const
+    {
+        return profile_batch_size;
+    }
+
+    /*
+    *returns true if the level-2 list pairs are handed out to the processes
+    *on demand instead of being assigned up front
+    */
+    bool dynamicLevel2() const
+    {
+        return dynamic_level_2;
+    }
+
 private:
     ///////////////////
     //PRIVATE METHODS//
@@ -255,6 +326,11 @@ private:
     list<ListFile> listfiles;
     string blast_table;
     string output_path;
+    string dataset_cache;
+    string level2_cache;
+    string cost_model_file;
+    string checkpoint_file;
+    string resume_from;
     int gap_size;
     int cluster_gap;
     int max_gaps_in_alignment;
@@ -280,6 +356,10 @@ private:
     FilterMethod cloudFiltermethod;
     bool verbose_output;
     bool bruteForceSynthenyMode;
+    bool split_large_ghms;
+    int profile_batch_size;
+    bool dynamic_level_2;
+    int checkpoint_interval;
 
     map<int, set<int> > GHMPairsToVisualize;
 
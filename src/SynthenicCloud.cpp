@@ -1,4 +1,5 @@
 #include "SynthenicCloud.h"
+#include "WireFormat.h"
 #include "hpmath.h"
 #include <cassert>
 
@@ -24,6 +25,7 @@ SynthenicCloud& SynthenicCloud::operator=(const SynthenicCloud& sCloud)
 
     //destruct current object
     anchorPoints.clear();
+    apIndex.clear();
 
     x_objectID=sCloud.getXObjectID();
     y_objectID=sCloud.getYObjectID();
@@ -44,12 +46,14 @@ void SynthenicCloud::addAnchorPoint (int x,int y)
 {
     modifyBoundingBox(x,y);
     anchorPoints.push_back(AnchorPoint(x,y,true));
+    apIndex.add(x,y);
 }
 
 void SynthenicCloud::addAnchorPoint(const AnchorPoint& point)
 {
     modifyBoundingBox(point.getX(),point.getY());
     anchorPoints.push_back(point);
+    apIndex.add(point.getX(),point.getY());
 }
 
 uint SynthenicCloud::getCountAnchorPoints() const
@@ -227,14 +231,7 @@ uint SynthenicCloud::distanceToCloud(int x, int y) const
 {
     assert(anchorPoints.size()!=0);
 
-    int distance=Cluster::kspd(x,y,anchorPoints[0].getX(),anchorPoints[0].getY());
-    int testDist;
-    for (int i=1; i<anchorPoints.size(); i++) {
-        const AnchorPoint& AP=anchorPoints[i];
-        testDist=Cluster::kspd(x,y,AP.getX(),AP.getY());
-        if (distance>testDist) distance=testDist;
-    }
-    return distance;
+    return apIndex.distanceTo(x,y);
 }
 
 bool SynthenicCloud::coordInCloudBox(int x, int y) const
@@ -256,17 +253,25 @@ int SynthenicCloud::getPackSize() const
     int packSize = 0;
 
     //clusterData
-    packSize += sizeof(begin_x) + sizeof(end_x) +
-                sizeof(begin_y) + sizeof(end_y) +
-                sizeof(x_objectID)+sizeof(y_objectID);
+    packSize += WireFormat::getVarIntSize(begin_x) +
+                WireFormat::getDeltaSize(end_x, begin_x) +
+                WireFormat::getVarIntSize(begin_y) +
+                WireFormat::getDeltaSize(end_y, begin_y) +
+                WireFormat::getVarIntSize(x_objectID) +
+                WireFormat::getVarIntSize(y_objectID);
 
     packSize += sizeof(random_probability);
 
 
-    packSize += sizeof(int); // for storing the number of anchorpoints
+    // the number of anchorpoints
+    packSize += WireFormat::getVarIntSize(anchorPoints.size());
 
     //anchorPoints in cloud
-    packSize += anchorPoints.size()*AnchorPoint::getPackSize();
+    AnchorPoint prev(0, 0, 0, 0, false);
+    for (int i=0; i<anchorPoints.size(); i++) {
+        packSize += anchorPoints[i].getPackSize(prev);
+        prev = anchorPoints[i];
+    }
     return packSize;
 }
 
@@ -275,51 +280,26 @@ int SynthenicCloud::pack(char *buffer) const
 {
     const char *bufferOrig = buffer;
 
-    memcpy(buffer, &x_objectID, sizeof(x_objectID));
-    buffer += sizeof(x_objectID);
-    memcpy(buffer, &y_objectID, sizeof(y_objectID));
-    buffer += sizeof(y_objectID);
+    WireFormat::putVarInt(buffer, x_objectID);
+    WireFormat::putVarInt(buffer, y_objectID);
 
-    memcpy(buffer, &begin_x, sizeof(begin_x));
-    buffer += sizeof(begin_x);
-    memcpy(buffer, &end_x, sizeof(end_x));
-    buffer += sizeof(end_x);
-    memcpy(buffer, &begin_y, sizeof(begin_y));
-    buffer += sizeof(begin_y);
-    memcpy(buffer, &end_y, sizeof(end_y));
-    buffer += sizeof(end_y);
+    WireFormat::putVarInt(buffer, begin_x);
+    WireFormat::putDelta(buffer, end_x, begin_x);
+    WireFormat::putVarInt(buffer, begin_y);
+    WireFormat::putDelta(buffer, end_y, begin_y);
 
-    memcpy(buffer, &random_probability, sizeof(random_probability));
-    buffer += sizeof(random_probability);
+    WireFormat::putRaw(buffer, random_probability);
 
-    int size = anchorPoints.size();
-    memcpy(buffer, &size, sizeof(size));
-    buffer += sizeof(size);
+    WireFormat::putVarInt(buffer, anchorPoints.size());
 
-    for (int i=0; i<anchorPoints.size(); i++)
-        buffer += anchorPoints[i].pack(buffer);
+    AnchorPoint prev(0, 0, 0, 0, false);
+    for (int i=0; i<anchorPoints.size(); i++) {
+        buffer += anchorPoints[i].pack(buffer, prev);
+        prev = anchorPoints[i];
+    }
 
     int bufSize=buffer-bufferOrig;
-    if (bufSize!=getPackSize()){
-        cout << "bufSize= " << bufSize << endl;
-        cout << "getPackSize()= " << getPackSize() << endl;
-        cout << endl;
-        cout << "anchorPoints.size= " << size << endl;
-        cout << endl;
-        cout << "sizeof(x_objectID)=" << sizeof(x_objectID) << endl;
-        cout << "sizeof(y_objectID)= " << sizeof(y_objectID) << endl;
-        cout << "sizeof(begin_x)= " << sizeof(begin_x) << endl;
-        cout << "sizeof(end_x)= " << sizeof(end_x) << endl;
-        cout << "sizeof(begin_y)= " << sizeof(begin_y) << endl;
-        cout << "sizeof(end_y)= " << sizeof(end_y) << endl;
-        cout << "sizeof(random_probability)= " << sizeof(random_probability) << endl;
-        cout << endl;
-        cout << "sizeof(size)= " << sizeof(size) << endl;
-        cout << "sizeof(int)= " << sizeof(int) << endl;
-        cout << endl;
-        cout << "size of pack(buffer) statement = " << anchorPoints[0].pack(buffer) << endl;
-        assert(bufSize==getPackSize());
-    }
+    assert(bufSize==getPackSize());
 
     return bufSize;
 
@@ -329,68 +309,63 @@ int SynthenicCloud::pack(char *buffer) const
 int SynthenicCloud::getPackSize(const vector<SynthenicCloud*> &clouds)
 {
     int packSize = 0;
-    packSize += sizeof(int);    // for storing size
+    packSize += WireFormat::getVarIntSize(clouds.size());
     for (int i=0; i<clouds.size(); i++)
         packSize += clouds[i]->getPackSize();
 
-    return packSize;
+    return WireFormat::HEADER_SIZE + packSize;
 }
 
 
-void SynthenicCloud::packSynthenicClouds(const vector<SynthenicCloud*> &clouds,
-                                char* buffer)
+int SynthenicCloud::packSynthenicClouds(const vector<SynthenicCloud*> &clouds,
+                                        char* buffer)
 {
-    int nClouds = clouds.size();
-    memcpy(buffer, &nClouds, sizeof(nClouds));
-    buffer += sizeof(nClouds);
+    char *header = buffer;
+    buffer += WireFormat::HEADER_SIZE;
+    WireFormat::putVarInt(buffer, clouds.size());
 
     for (int i=0; i<clouds.size(); i++)
         buffer += clouds[i]->pack(buffer);
 
+    int length = buffer - header - WireFormat::HEADER_SIZE;
+    WireFormat::putHeader(header, length);
+
+    return WireFormat::HEADER_SIZE + length;
 }
 
-void SynthenicCloud::unpackSynthenicClouds(const char *buffer,
-                                    vector<SynthenicCloud*>& clouds)
+int SynthenicCloud::unpackSynthenicClouds(const char *buffer, const char *end,
+                                          vector<SynthenicCloud*>& clouds)
 {
-    int nClouds = 0;
-    memcpy(&nClouds, buffer, sizeof(nClouds));
-    buffer += sizeof(nClouds);
+    int length = WireFormat::getHeader(buffer, end);
+    end = buffer + length;
+    int nClouds = WireFormat::getCount(buffer, end);
 
     clouds.reserve(clouds.size() + nClouds);
-    for (int i = 0; i < nClouds; i++) {
-        clouds.push_back(new SynthenicCloud(buffer));
-        buffer += clouds.back()->getPackSize();
-    }
-
+    for (int i = 0; i < nClouds; i++)
+        clouds.push_back(new SynthenicCloud(buffer, end));
 
+    return WireFormat::HEADER_SIZE + length;
 }
 
-SynthenicCloud::SynthenicCloud(const char *buffer) : Cluster()
+SynthenicCloud::SynthenicCloud(const char *&buffer, const char *end) : Cluster()
 {
 
-    memcpy(&x_objectID, buffer, sizeof(x_objectID));
-    buffer += sizeof(x_objectID);
-    memcpy(&y_objectID, buffer, sizeof(y_objectID));
-    buffer += sizeof(y_objectID);
-
-    memcpy(&begin_x, buffer, sizeof(begin_x));
-    buffer += sizeof(begin_x);
-    memcpy(&end_x, buffer, sizeof(end_x));
-    buffer += sizeof(end_x);
-    memcpy(&begin_y, buffer, sizeof(begin_y));
-    buffer += sizeof(begin_y);
-    memcpy(&end_y, buffer, sizeof(end_y));
-    buffer += sizeof(end_y);
-
-    memcpy(&random_probability, buffer, sizeof(random_probability));
-    buffer += sizeof(random_probability);
-
-    int nAP=0;
-    memcpy(&nAP, buffer, sizeof(nAP));
-    buffer += sizeof(nAP);
+    x_objectID = WireFormat::getVarInt(buffer, end);
+    y_objectID = WireFormat::getVarInt(buffer, end);
+
+    begin_x = WireFormat::getVarInt(buffer, end);
+    end_x = WireFormat::getDelta(buffer, begin_x, end);
+    begin_y = WireFormat::getVarInt(buffer, end);
+    end_y = WireFormat::getDelta(buffer, begin_y, end);
+
+    WireFormat::getRaw(buffer, random_probability, end);
+
+    int nAP = WireFormat::getCount(buffer, end);
+    AnchorPoint prev(0, 0, 0, 0, false);
     for (int i=0; i<nAP; i++) {
-       anchorPoints.push_back(AnchorPoint(buffer));
-       buffer += AnchorPoint::getPackSize();
+       prev = AnchorPoint(buffer, end, prev);
+       anchorPoints.push_back(prev);
+       apIndex.add(prev.getX(), prev.getY());
    }
 }
 
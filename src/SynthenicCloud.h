@@ -4,6 +4,7 @@
 #include "headers.h"
 #include "Cluster.h"
 #include "AnchorPoint.h"
+#include "KspdIndex.h"
 
 class SynthenicCloud : public Cluster
 {
@@ -17,9 +18,12 @@ public:
 
     /**
      * Constructs a synthenic cloud object from a packed buffer
-     * @param buffer Buffer that contains serialized cloud object
+     * @param buffer Buffer that contains serialized cloud object, it is
+     * advanced past the cloud
+     * @param end End of the buffer
+     * @throw WireFormatException If the buffer ends before the cloud
      */
-    SynthenicCloud(const char *buffer);
+    SynthenicCloud(const char *&buffer, const char *end);
 
     /**
     * Copy Constructor
@@ -158,24 +162,30 @@ public:
     /**
      * Get the number of chars to pack a number of clouds
      * @param clouds Clouds to be packed
-     * @return Number of chars to pack the multiplicons
+     * @return Number of chars to pack the clouds, including the WireFormat
+     * header
      */
     static int getPackSize(const vector<SynthenicCloud*> &clouds);
 
     /**
-     * Pack multiplicons in a buffer
+     * Pack clouds in a buffer, preceded by a WireFormat header
      * @param clouds Clouds to be packed
      * @param buffer Pre-allocated buffer (output)
+     * @return The number of chars in the buffer that were used
      */
-    static void packSynthenicClouds(const vector<SynthenicCloud*> &clouds,
-                                 char* buffer);
+    static int packSynthenicClouds(const vector<SynthenicCloud*> &clouds,
+                                   char* buffer);
 
     /**
-     * Unpack multiplicons in a buffer
+     * Unpack clouds in a buffer
      * @param buffer Buffer that contains packed clouds
+     * @param end End of the buffer
      * @param clouds clouds to be unpacked (output)
+     * @return The number of chars in the buffer that were read
+     * @throw WireFormatException If the buffer has a different version or
+     * is truncated
      */
-    static void unpackSynthenicClouds(const char *buffer,
+    static int unpackSynthenicClouds(const char *buffer, const char *end,
                                      vector<SynthenicCloud*>& clouds);
 
 
@@ -188,6 +198,7 @@ public:
 private:
 
     vector<AnchorPoint> anchorPoints;
+    KspdIndex apIndex; //index over the anchorpoints for distance queries
     uint clusterID;
     double random_probability;
 
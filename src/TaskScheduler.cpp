@@ -0,0 +1,78 @@
+#include "TaskScheduler.h"
+
+using namespace std;
+
+TaskScheduler::TaskScheduler(int nThreads)
+{
+    if (nThreads < 1) nThreads = 1;
+
+    deques.resize(nThreads);
+    for (int i = 0; i < nThreads; i++) {
+        deques[i] = new TaskDeque();
+        pthread_mutex_init(&deques[i]->mutex, NULL);
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    for (size_t i = 0; i < deques.size(); i++) {
+        pthread_mutex_destroy(&deques[i]->mutex);
+        delete deques[i];
+    }
+}
+
+void TaskScheduler::distribute(const vector<uint64_t>& weights)
+{
+    // heaviest tasks first, ties in task order
+    vector<pair<uint64_t, int> > order;
+    order.reserve(weights.size());
+    for (size_t i = 0; i < weights.size(); i++)
+        order.push_back(pair<uint64_t, int>(~weights[i], i));
+    sort(order.begin(), order.end());
+
+    // deal them out to the deque with the lowest load so far
+    vector<deque<int> > tasks(deques.size());
+    vector<uint64_t> load(deques.size(), 0);
+    for (size_t i = 0; i < order.size(); i++) {
+        size_t d = min_element(load.begin(), load.end()) - load.begin();
+        tasks[d].push_back(order[i].second);
+        load[d] += ~order[i].first;
+    }
+
+    // idle threads may still poll the deques
+    for (size_t i = 0; i < deques.size(); i++) {
+        pthread_mutex_lock(&deques[i]->mutex);
+        deques[i]->tasks.swap(tasks[i]);
+        pthread_mutex_unlock(&deques[i]->mutex);
+    }
+}
+
+bool TaskScheduler::getTask(int threadID, int& task)
+{
+    // the heaviest task of the own deque
+    TaskDeque& own = *deques[threadID];
+    pthread_mutex_lock(&own.mutex);
+    if (!own.tasks.empty()) {
+        task = own.tasks.front();
+        own.tasks.pop_front();
+        pthread_mutex_unlock(&own.mutex);
+        return true;
+    }
+    pthread_mutex_unlock(&own.mutex);
+
+    // steal the lightest task of another deque, tasks are never added
+    // while stealing, so all deques empty means all work is handed out
+    for (size_t i = 1; i < deques.size(); i++) {
+        TaskDeque& victim = *deques[(threadID + i) % deques.size()];
+        pthread_mutex_lock(&victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            pthread_mutex_unlock(&victim.mutex);
+            return true;
+        }
+        pthread_mutex_unlock(&victim.mutex);
+    }
+
+    return false;
+}
@@ -0,0 +1,80 @@
+#ifndef __TASKSCHEDULER_H
+#define __TASKSCHEDULER_H
+
+#include "headers.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Work-stealing scheduler for a fixed set of weighted tasks.
+ *
+ * Every thread owns a deque of tasks. The tasks are dealt out up front,
+ * heaviest first, to the deque with the lowest total weight so far, so
+ * every deque is ordered from heavy to light. A thread takes the heaviest
+ * task from the front of its own deque; once that deque is empty it steals
+ * the lightest task from the back of another deque. Every deque has its
+ * own mutex, so a thread working through its own deque never contends
+ * with other threads until the tail of the work is reached.
+ */
+class TaskScheduler
+{
+
+public:
+    ///////////////////////////////
+    //CONSTRUCTORS AND DESTRUCTOR//
+    ///////////////////////////////
+
+    /**
+    * Constructs a scheduler without any tasks
+    * @param nThreads Number of threads that will request tasks
+    */
+    TaskScheduler(int nThreads);
+
+    /**
+    * Destructor
+    */
+    ~TaskScheduler();
+
+    //////////////////
+    //PUBLIC METHODS//
+    //////////////////
+
+    /**
+    * Distributes a new set of tasks over the threads, remaining tasks
+    * are discarded
+    * @param weights Estimated cost of every task, task i has weight[i]
+    */
+    void distribute(const vector<uint64_t>& weights);
+
+    /**
+    * Gets a task to process, from the own deque or stolen from another one
+    * @param threadID Identifier of the requesting thread
+    * @param task Index of the task (output)
+    * @return True if a task was found, false if no tasks are left
+    */
+    bool getTask(int threadID, int& task);
+
+    /**
+    * Returns the number of threads
+    */
+    int getNumThreads() const {
+        return deques.size();
+    }
+
+private:
+
+    struct TaskDeque {
+        pthread_mutex_t mutex;
+        deque<int> tasks;
+    };
+
+    //////////////
+    //ATTRIBUTES//
+    //////////////
+
+    // one deque per thread, allocated separately to avoid false sharing
+    vector<TaskDeque*> deques;
+};
+
+#endif
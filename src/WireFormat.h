@@ -0,0 +1,203 @@
+#ifndef __WIREFORMAT_H
+#define __WIREFORMAT_H
+
+#include "headers.h"
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <stdexcept>
+
+// ============================================================================
+// WIRE FORMAT EXCEPTION CLASS
+// ============================================================================
+
+class WireFormatException : public runtime_error
+{
+    public:
+        WireFormatException(const string& msg = "") : runtime_error(msg) {}
+};
+
+// ============================================================================
+// WIRE FORMAT CLASS
+// ============================================================================
+
+/*
+ * Compact encoding of the clusters that are exchanged between processes.
+ *
+ * Integers are zigzag encoded (0, -1, 1, -2, ... map onto 0, 1, 2, 3, ...)
+ * and stored in groups of 7 bits, least significant group first, with the
+ * high bit set on every byte but the last. Coordinates and gene IDs are
+ * stored as the difference with those of the previous anchor point, which
+ * mostly fits in a single byte. Floating point values and booleans are
+ * copied as is.
+ *
+ * A packed set of objects starts with a header: the format version and the
+ * number of chars that follow, so a reader can skip the set or reject data
+ * written by a different version.
+ *
+ * Every read takes the end of the buffer and throws a WireFormatException
+ * rather than reading past it, so data read back from disk cannot make the
+ * decoder overrun its buffer. Whether the values make sense (e.g. indices
+ * into the gene lists) is up to the caller.
+ */
+class WireFormat
+{
+
+public:
+    //////////////////
+    //PUBLIC METHODS//
+    //////////////////
+
+    /**
+    * Returns the number of chars needed to store an integer
+    */
+    static int getVarIntSize(int value) {
+        uint32_t v = zigzag(value);
+        int size = 1;
+        for ( ; v >= 0x80; v >>= 7)
+            size++;
+        return size;
+    }
+
+    /**
+    * Returns the number of chars needed to store the difference of two
+    * integers
+    */
+    static int getDeltaSize(int value, int prev) {
+        return getVarIntSize(delta(value, prev));
+    }
+
+    /**
+    * Stores an integer and advances the buffer
+    */
+    static void putVarInt(char *&buffer, int value) {
+        uint32_t v = zigzag(value);
+        for ( ; v >= 0x80; v >>= 7)
+            *buffer++ = (char)((v & 0x7F) | 0x80);
+        *buffer++ = (char)v;
+    }
+
+    /**
+    * Reads an integer and advances the buffer
+    * @param end End of the buffer
+    * @throw WireFormatException If the buffer ends before the integer
+    */
+    static int getVarInt(const char *&buffer, const char *end) {
+        uint32_t v = 0;
+        for (int shift = 0; ; shift += 7) {
+            // an int takes at most five chars
+            if (buffer >= end || shift > 28)
+                throwCorrupt();
+            unsigned char c = (unsigned char)*buffer++;
+            v |= (uint32_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) break;
+        }
+        return unzigzag(v);
+    }
+
+    /**
+    * Reads the number of objects that follow and advances the buffer
+    * @param end End of the buffer
+    * @throw WireFormatException If the number is negative or larger than
+    * the number of chars left, every object takes at least one char
+    */
+    static int getCount(const char *&buffer, const char *end) {
+        int count = getVarInt(buffer, end);
+        if (count < 0 || count > end - buffer)
+            throwCorrupt();
+        return count;
+    }
+
+    /**
+    * Stores the difference of two integers and advances the buffer
+    */
+    static void putDelta(char *&buffer, int value, int prev) {
+        putVarInt(buffer, delta(value, prev));
+    }
+
+    /**
+    * Reads a difference stored by putDelta and advances the buffer
+    * @param end End of the buffer
+    * @return The value that was stored
+    * @throw WireFormatException If the buffer ends before the difference
+    */
+    static int getDelta(const char *&buffer, int prev, const char *end) {
+        return (int)((uint32_t)prev + (uint32_t)getVarInt(buffer, end));
+    }
+
+    /**
+    * Copies a value as is and advances the buffer
+    */
+    template<class T>
+    static void putRaw(char *&buffer, const T& value) {
+        memcpy(buffer, &value, sizeof(T));
+        buffer += sizeof(T);
+    }
+
+    /**
+    * Reads a value stored by putRaw and advances the buffer
+    * @param end End of the buffer
+    * @throw WireFormatException If the buffer ends before the value
+    */
+    template<class T>
+    static void getRaw(const char *&buffer, T& value, const char *end) {
+        if (end - buffer < (ptrdiff_t)sizeof(T))
+            throwCorrupt();
+        memcpy(&value, buffer, sizeof(T));
+        buffer += sizeof(T);
+    }
+
+    /**
+    * Stores a header and advances the buffer
+    * @param length Number of chars that follow the header
+    */
+    static void putHeader(char *&buffer, int length) {
+        *buffer++ = (char)VERSION;
+        putRaw(buffer, length);
+    }
+
+    /**
+    * Reads a header and advances the buffer
+    * @param end End of the buffer
+    * @return The number of chars that follow the header
+    * @throw WireFormatException If the data has a different version or the
+    * buffer is shorter than the header says
+    */
+    static int getHeader(const char *&buffer, const char *end) {
+        if (end - buffer < HEADER_SIZE)
+            throwCorrupt();
+        unsigned char version = (unsigned char)*buffer++;
+        if (version != VERSION)
+            throw WireFormatException("packed data has an unknown format "
+                                      "version");
+        int length;
+        getRaw(buffer, length, end);
+        if (length < 0 || length > end - buffer)
+            throwCorrupt();
+        return length;
+    }
+
+    static const unsigned char VERSION = 1;
+    static const int HEADER_SIZE = 1 + sizeof(int);
+
+private:
+
+    static void throwCorrupt() {
+        throw WireFormatException("packed data is truncated or corrupt");
+    }
+
+    static int delta(int value, int prev) {
+        return (int)((uint32_t)value - (uint32_t)prev);
+    }
+
+    static uint32_t zigzag(int value) {
+        return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    }
+
+    static int unzigzag(uint32_t v) {
+        return (int)(v >> 1) ^ -(int)(v & 1);
+    }
+};
+
+#endif
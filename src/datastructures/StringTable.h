@@ -0,0 +1,74 @@
+#ifndef __STRINGTABLE_H
+#define __STRINGTABLE_H
+
+#include "../headers.h"
+#include <stdint.h>
+
+/**
+ * Interning table that assigns a dense, zero-based integer identifier to
+ * every distinct string that is added to it. References returned by
+ * getString() remain valid while strings are added.
+ */
+class StringTable
+{
+public:
+	/**
+	 * Value returned by find() for strings that are not in the table
+	 */
+	static const uint32_t NOT_FOUND = 0xFFFFFFFF;
+
+	/**
+	 * Constructor
+	 * @param sizeHint Expected number of distinct strings
+	 */
+	StringTable(size_t sizeHint = 100) : table(sizeHint) {}
+
+	/**
+	 * Returns the identifier of a string, the string is added to the
+	 * table if it was not present yet
+	 * @param str String to intern
+	 * @return Identifier of the string
+	 */
+	uint32_t intern(const string& str) {
+		hash_map<string, uint32_t, stringhash>::const_iterator it =
+			table.find(str);
+		if (it != table.end())
+			return it->second;
+
+		uint32_t ID = names.size();
+		table[str] = ID;
+		names.push_back(str);
+		return ID;
+	}
+
+	/**
+	 * Returns the identifier of a string
+	 * @param str String to look up
+	 * @return Identifier of the string, NOT_FOUND if it was never interned
+	 */
+	uint32_t find(const string& str) const {
+		hash_map<string, uint32_t, stringhash>::const_iterator it =
+			table.find(str);
+		return (it == table.end()) ? NOT_FOUND : it->second;
+	}
+
+	/**
+	 * Returns the string that corresponds to an identifier
+	 */
+	const string& getString(uint32_t ID) const {
+		return names[ID];
+	}
+
+	/**
+	 * Returns the number of distinct strings in the table
+	 */
+	uint32_t size() const {
+		return names.size();
+	}
+
+private:
+	hash_map<string, uint32_t, stringhash> table;
+	deque<string> names;
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "Gene.h"
 #include "GHMProfile.h"
 #include "Settings.h"
+#include "TaskScheduler.h"
 
 #include <cassert>
 #include "util.h"
@@ -32,72 +33,32 @@
 void DataSet::profileSearch(int firstItem, int nItems, int threadID,
                             vector<Multiplicon*>& target, vector<SynthenicCloud*>& dummyVar) const
 {
-    for (int y = firstItem; y < firstItem + nItems; y++) {
-        double startTime = Util::getTime();
+    size_t nProfiles = searchProfiles.size();
 
-        int lst = indexToList[y];
+    for (int k = firstItem; k < firstItem + nItems; k++) {
+        int lst = indexToList[searchPositions[k]];
         GeneList &gl = *genelists[lst];
-        if (gl.getSize() - gl.getNumberOfMaskedElements() >=
-            (unsigned int)settings.getAnchorPoints()) {
-            GHMProfile ghm (*profileUC, gl);
+        if (gl.getSize() - gl.getNumberOfMaskedElements() <
+            (unsigned int)settings.getAnchorPoints())
+            continue;
+
+        // the profiles are searched one after the other, so that the
+        // genelist and its homolog index stay in cache
+        for (size_t j = 0; j < nProfiles; j++) {
+            GHMProfile ghm (*searchProfiles[j], gl, &homologCaches[lst]);
             ghm.buildMatrix();
             ghm.run(settings);
-            ghm.getMultiplicons(target);
+            ghm.getMultiplicons(searchResults[k * nProfiles + j]);
         }
     }
 }
 
-bool DataSet::getSomeWorkHL(int &firstItem, int &nItems, int threadID,
-                          bool augmentWIP, bool getSmallWP)
-{
-    // make sure no race conditions occur in this part
-    pthread_mutex_lock (&queueMutex);
-
-    // if there is no more work, unlock the mutex and exit
-    if (currentIndex > finalIndex) {
-        pthread_mutex_unlock (&queueMutex);
-        return false;
-    }
-
-    firstItem = currentIndex;
-
-    // determine a good nItems to process based on the weight of the work
-    lluint targetWeight = (totalWeight - weightSoFar) *
-        packagePerc / (double)settings.getNumThreads();
-
-    if (targetWeight < minWeight)
-        targetWeight = minWeight;
-
-    // it == final element that will be processed
-    map<lluint, uint>::iterator it = cumWeightToIndex.lower_bound(weightSoFar + targetWeight);
-    if (it == cumWeightToIndex.end()) it--;
-
-    nItems = it->second - firstItem + 1;
-    if (firstItem + nItems - 1 >= finalIndex)
-        nItems = finalIndex - firstItem + 1;
-
-    weightSoFar = it->first;
-    currentIndex += nItems;
-
-    //cerr << "Proc " << ParToolBox::getProcID() << " from " << firstItem << " to " << currentIndex+nItems-1 << endl;
-
-    if (augmentWIP)
-        workInProgress++;
-
-    pthread_mutex_unlock (&queueMutex);
-    return true;
-}
-
 void DataSet::profileDetection()
 {
     workFunction = &DataSet::profileSearch;
-    getSomeWorkFunction = &DataSet::getSomeWorkHL;
 
     cout << endl;
 
-    packagePerc = 0.1;
-    minPackagePerc = 0.005;
-
     // create the weights and a mapping list -> pair
     vector<lluint> weights;
     weights.reserve(genelists.size());
@@ -111,11 +72,26 @@ void DataSet::profileDetection()
                                   cumWeight, cumWeightToIndex);
 
     createThreadPool();
+    homologCaches.assign(genelists.size(), HomologPointCache());
+
+    // process 0 writes the output in a thread of its own
+    if (ParToolBox::getProcID() == 0)
+        createOutputWriter();
 
     for (unsigned int i = 0; i < multiplicons.size(); i++)
         multiplicons_to_evaluate.push_front(multiplicons[i]);
 
-    unsigned int profile_id = 1;
+    // the upcoming multiplicons are aligned ahead of their evaluation by the
+    // worker threads: an alignment only depends on the multiplicon itself,
+    // whereas the masking decides whether it is used, which is checked when
+    // the multiplicon is evaluated in the original order
+    bool speculate = (settings.getNumThreads() > 1) &&
+                     (!settings.getCompareAligners());
+
+    // the state is written to the checkpoint file at the end of an
+    // iteration, process 0 keeps the time
+    bool checkpoint = !settings.getCheckpointFile().empty();
+    double nextCheckpoint = Util::getTime() + settings.getCheckpointInterval();
 
     // =============================================
 
@@ -128,6 +104,39 @@ void DataSet::profileDetection()
              << "- evaluating level " << multiplicon->getLevel()
              << " multiplicon... ";
 
+        // align this and the next multiplicons in parallel
+        if (speculate && needsAlignment(*multiplicon) &&
+            alignedMultiplicons.find(multiplicon) == alignedMultiplicons.end()) {
+            selectAlignTasks(settings.getNumThreads());
+            distributeTasks(vector<lluint>());
+            wakeThreads();
+            finishWorkPacket();
+            finishWorkerThreads();
+        }
+
+        // a speculative alignment is only valid for this multiplicon
+        bool aligned = false;
+        string alignError;
+        map<const Multiplicon*, string>::iterator spec =
+            alignedMultiplicons.find(multiplicon);
+        if (spec != alignedMultiplicons.end()) {
+            aligned = true;
+            alignError = spec->second;
+            alignedMultiplicons.erase(spec);
+        }
+
+        // the same holds for a profile search done ahead
+        PrefetchedSearch prefetch;
+        bool prefetched = false;
+        map<const Multiplicon*, PrefetchedSearch>::iterator pf =
+            prefetchedSearches.find(multiplicon);
+        if (pf != prefetchedSearches.end()) {
+            prefetched = true;
+            prefetch.found.swap(pf->second.found);
+            prefetch.maskVersions.swap(pf->second.maskVersions);
+            prefetchedSearches.erase(pf);
+        }
+
         // remove the multiplicon that has been evaluated
         multiplicons_to_evaluate.pop_front();
 
@@ -135,7 +144,10 @@ void DataSet::profileDetection()
             Util::startChrono();
             GeneList &lY = *genelists[multiplicon->getYObjectID()];
 
-            multiplicon->createProfile(profile_id);
+            if (aligned)
+                multiplicon->setProfileID(profileID);
+            else
+                multiplicon->createProfile(profileID);
             const Profile *profile = multiplicon->getProfile();
 
             if (settings.getCompareAligners())
@@ -143,19 +155,31 @@ void DataSet::profileDetection()
 
             if ((multiplicon->getLevel() == 2) && (!settings.level2Only())) {
                 if (allMasked(lY, multiplicon->getBeginY(), multiplicon->getEndY())) {
-                    multiplicon->align(settings.getAlignmentMethod(),
-                                       settings.getMaxGapsInAlignment());
+                    if (!aligned)
+                        multiplicon->align(settings.getAlignmentMethod(),
+                                           settings.getMaxGapsInAlignment());
+                    else if (!alignError.empty())
+                        throw ProfileException(alignError);
                     throw ProfileException("level-2 multiplicon is redundant");
                 }
             }
 
-            // masking check
-            if (allMasked(lY, multiplicon->getBeginY(), multiplicon->getEndY()))
+            // masking check, a masked level-2 multiplicon is reported with
+            // its unaligned profile
+            if (allMasked(lY, multiplicon->getBeginY(), multiplicon->getEndY())) {
+                if (aligned && settings.level2Only()) {
+                    multiplicon->discardProfile();
+                    multiplicon->createProfile(profileID);
+                }
                 throw ProfileException("all elements masked");
+            }
 
             // align the multiplicon in a profile
-            multiplicon->align(settings.getAlignmentMethod(),
-                               settings.getMaxGapsInAlignment());
+            if (!aligned)
+                multiplicon->align(settings.getAlignmentMethod(),
+                                   settings.getMaxGapsInAlignment());
+            else if (!alignError.empty())
+                throw ProfileException(alignError);
 
             // check the quality of higher-level profiles
             if (multiplicon->getLevel() > 2)
@@ -174,8 +198,16 @@ void DataSet::profileDetection()
             alignTime += alignmentTime;
 
             if (!settings.level2Only()) {
+                // the next multiplicons are aligned along with the search
+                if (speculate)
+                    selectAlignTasks(settings.getNumThreads());
+
                 vector<Multiplicon*> new_multiplicons;
-                parallelProfileSearch(profile, new_multiplicons);
+                if (prefetched)
+                    completePrefetchedSearch(*profile, prefetch,
+                                             new_multiplicons);
+                else
+                    searchProfile(*multiplicon, new_multiplicons);
                 sortByMultipliconSize(new_multiplicons);
                 cout << new_multiplicons.size() << " new multiplicons found.";
 
@@ -193,12 +225,17 @@ void DataSet::profileDetection()
             multiplicon->setId(multipliconID++);
             evaluated_multiplicons.push_back(multiplicon);
 
-            profile_id++;
+            profileID++;
 
         } catch(const ProfileException& e) {
             alignTime += Util::stopChrono();
             cout << e.what() << endl;
 
+            // the search done ahead is of no use
+            for (size_t p = 0; p < prefetch.found.size(); p++)
+                for (size_t i = 0; i < prefetch.found[p].size(); i++)
+                    delete prefetch.found[p][i];
+
             if ( multiplicon->getLevel() == 2 ) {
                 multiplicon->setIsRedundant( true );
                 multiplicon->setId(multipliconID++);
@@ -210,14 +247,20 @@ void DataSet::profileDetection()
         }
 
         double startTime = Util::getTime();
+
+        // a checkpoint only holds the multiplicons to evaluate, so the
+        // evaluated ones are flushed first
+        bool writeState = checkpoint && checkpointDue(nextCheckpoint);
+
         if ((evaluated_multiplicons.size() >= settings.getFlushOutput())
-            or (clouds.size()>=settings.getFlushOutput())) {
+            or (clouds.size()>=settings.getFlushOutput()) or writeState) {
             if (ParToolBox::getProcID() == 0){
                 flushOutput();
                 if (settings.writeStatistics()) cout << "WARNING: statistics won't be correct when output flushing is used!!" << endl;
             }
 
-            //delete multiplicons
+            //delete multiplicons, those of process 0 are deleted by the
+            //output writer
             vector<Multiplicon*>::const_iterator itM = evaluated_multiplicons.begin();
             for ( ; itM != evaluated_multiplicons.end(); itM++)
                 delete (*itM);
@@ -230,6 +273,15 @@ void DataSet::profileDetection()
             clouds.clear();
         }
 
+        if (writeState) {
+            discardWorkAhead();
+            if (ParToolBox::getProcID() == 0) {
+                drainOutput();
+                writeCheckpoint();
+            }
+            nextCheckpoint = Util::getTime() + settings.getCheckpointInterval();
+        }
+
         flushTime += Util::getTime() - startTime;
     }
 
@@ -238,35 +290,86 @@ void DataSet::profileDetection()
     cerr << "Total flushing time " << flushTime << endl;*/
 
     destroyThreadPool();
+    homologCaches.clear();
 
     // flush final output
     if (ParToolBox::getProcID() == 0)
     {
         statistics();
         flushOutput();
+        destroyOutputWriter();
     }
     deleteEvaluatedMultiplicons();
     deleteEvaluatedClouds();
 }
 
-void DataSet::parallelProfileSearch(const Profile *profile,
-                                    vector<Multiplicon*>& target)
+bool DataSet::needsAlignment(const Multiplicon& multiplicon)
 {
-    // the the pointer to the profile under consideration
-    profileUC = profile;
+    // a redundant level-2 multiplicon is aligned as well
+    if ((multiplicon.getLevel() == 2) && (!settings.level2Only()))
+        return true;
 
-    uint thisProc = ParToolBox::getProcID();
-    uint nProc= ParToolBox::getNumProcesses();
+    // masking only grows, a masked multiplicon stays masked
+    const GeneList &lY = *genelists[multiplicon.getYObjectID()];
+    return !allMasked(lY, multiplicon.getBeginY(), multiplicon.getEndY());
+}
 
-    currentIndex = startPos[thisProc];
-    finalIndex = (thisProc == nProc -1) ? genelists.size() - 1 :
-        startPos[thisProc+1] - 1;
-    totalWeight = cumWeight[finalIndex];
-    weightSoFar = (thisProc == 0) ? 0 : cumWeight[currentIndex - 1];
+void DataSet::selectAlignTasks(unsigned int maxTasks)
+{
+    alignTasks.clear();
+
+    // only look a limited distance ahead, the queue can be long
+    deque<Multiplicon*>::const_iterator it = multiplicons_to_evaluate.begin();
+    for (unsigned int i = 0; i < 4 * maxTasks; i++, it++) {
+        if (it == multiplicons_to_evaluate.end()) break;
+        if (alignTasks.size() == maxTasks) break;
+
+        if (alignedMultiplicons.find(*it) != alignedMultiplicons.end())
+            continue;
+        if (needsAlignment(**it))
+            alignTasks.push_back(*it);
+    }
+}
 
-    minWeight = minPackagePerc * cumWeight.back() /
-        (double)settings.getNumThreads() + 1;
+void DataSet::alignSpeculatively(int alignTask)
+{
+    // the profile gets its final identifier when it is evaluated, in
+    // level-2 only mode a masked multiplicon is reported without alignment
+    // and a checkpoint drops the alignments done ahead, so the alignment
+    // may have to be undone
+    Multiplicon &multiplicon = *alignTasks[alignTask];
+    multiplicon.createProfile(0, settings.level2Only() ||
+                                 !settings.getCheckpointFile().empty());
+
+    try {
+        multiplicon.align(settings.getAlignmentMethod(),
+                          settings.getMaxGapsInAlignment());
+    } catch (const ProfileException& e) {
+        alignErrors[alignTask] = e.what();
+    }
+}
+
+void DataSet::searchGeneLists(const vector<const Profile*>& profiles,
+                              const vector<int>& positions,
+                              vector<vector<Multiplicon*> >& found)
+{
+    found.clear();
+    if (positions.empty() && alignTasks.empty())
+        return;
+
+    searchProfiles = profiles;
+    searchPositions = positions;
+    searchResults.assign(positions.size() * profiles.size(),
+                         vector<Multiplicon*>());
+
+    // every genelist is a task
+    vector<lluint> weights;
+    for (size_t k = 0; k < positions.size(); k++)
+        weights.push_back(profiles.size() *
+            genelists[indexToList[positions[k]]]->getRemappedElementsLength());
 
+    taskOffset = 0;
+    distributeTasks(weights);
     wakeThreads();
 
     // finish the work packet
@@ -275,52 +378,217 @@ void DataSet::parallelProfileSearch(const Profile *profile,
     // synchronize worker thread to make sure ALL work is finished
     finishWorkerThreads();
 
+    found.swap(searchResults);
+    searchResults.clear();
+    searchProfiles.clear();
+    searchPositions.clear();
+}
+
+void DataSet::parallelProfileSearch(const vector<const Profile*>& profiles,
+                                    vector<vector<Multiplicon*> >& found)
+{
+    uint thisProc = ParToolBox::getProcID();
+    uint nProc= ParToolBox::getNumProcesses();
+
+    int firstIndex = startPos[thisProc];
+    int finalIndex = (thisProc == nProc -1) ? genelists.size() - 1 :
+        startPos[thisProc+1] - 1;
+
+    vector<int> positions;
+    for (int i = firstIndex; i <= finalIndex; i++)
+        positions.push_back(i);
+
+    vector<vector<Multiplicon*> > local;
+    searchGeneLists(profiles, positions, local);
+
 #ifdef HAVE_MPI
-    int thisBuffSize = Multiplicon::getPackSize(localMultiplicons);
-    char *buffer = new char[thisBuffSize];
-    Multiplicon::packMultiplicons(localMultiplicons, buffer);
-
-    // Communicate the buffer size to all the processes
-    int *buffSize = new int [nProc];
-    MPI_Allgather(&thisBuffSize, 1, MPI_INT, buffSize,
-                  1, MPI_INT, MPI_COMM_WORLD);
-
-    // Calculate the displacement
-    int *displ = new int[nProc]; displ[0] = 0;
-    for (int i = 1; i < nProc; i++)
-        displ[i] = displ[i-1]+buffSize[i-1];
-
-    // Calculate the total buffer size
-    int totalBuffSize = 0;
-    for (int i = 0; i < nProc; i++)
-        totalBuffSize += buffSize[i];
-
-    char *recvBuffer = new char[totalBuffSize];
-    MPI_Allgatherv(buffer, thisBuffSize, MPI_CHAR, recvBuffer,
-                   buffSize, displ, MPI_CHAR, MPI_COMM_WORLD);
-
-    // use this construction to make sure that the order in which the
-    // multiplicons are stored is the same for all processes
+    // every process in turn broadcasts its multiplicons, packed per
+    // genelist and profile so that they can be told apart, in records of
+    // about RECORD_SIZE bytes that are unpacked as they arrive.  Use this
+    // construction to make sure that the order in which the multiplicons
+    // are stored is the same for all processes
+    found.clear();
+    found.reserve(genelists.size() * profiles.size());
+    vector<char> record;
     for (int i = 0; i < nProc; i++) {
-        if (i == thisProc) {
-            target.insert(target.end(), localMultiplicons.begin(),
-                          localMultiplicons.end());
-        } else {
-            vector<Multiplicon*> mplicons;
-            Multiplicon::unpackHLMultiplicons(recvBuffer + displ[i], mplicons,
-                                              *profile, genelists, settings.useFamily());
-            target.insert(target.end(), mplicons.begin(), mplicons.end());
+        size_t group = 0;
+        while (true) {
+            if (i == thisProc) {
+                size_t last = group;
+                lluint size = 0;
+                while (last < local.size() &&
+                       (last == group || size < RECORD_SIZE))
+                    size += Multiplicon::getPackSize(local[last++]);
+
+                record.resize(size);
+                char *packPtr = record.empty() ? NULL : &record[0];
+                for ( ; group < last; group++)
+                    packPtr += Multiplicon::packMultiplicons(local[group],
+                                                             packPtr);
+            }
+
+            ParToolBox::bcastRecord(record, i);
+            if (record.empty())
+                break;
+            if (i == thisProc)
+                continue;
+
+            const char *unpackPtr = &record[0];
+            const char *unpackEnd = unpackPtr + record.size();
+            for ( ; unpackPtr < unpackEnd; group++) {
+                found.push_back(vector<Multiplicon*>());
+                unpackPtr += Multiplicon::unpackHLMultiplicons(unpackPtr,
+                                 unpackEnd, found.back(),
+                                 *profiles[group % profiles.size()],
+                                 genelists, settings.useFamily());
+            }
         }
-    }
 
-    delete [] recvBuffer;
-    delete [] displ;
-    delete [] buffSize;
-    delete [] buffer;
+        if (i == thisProc)
+            found.insert(found.end(), local.begin(), local.end());
+    }
 #else    // don't use MPI
-    target.insert(target.end(), localMultiplicons.begin(),
-                  localMultiplicons.end());
+    found.swap(local);
 #endif
+}
+
+/**
+ * Returns true if two regions of genelists overlap
+ */
+static bool regionsOverlap(int listA, int beginA, int endA,
+                           int listB, int beginB, int endB)
+{
+    return (listA == listB) && (beginA <= endB) && (beginB <= endA);
+}
+
+/**
+ * Returns true if the regions masked by two multiplicons overlap, only a
+ * level-2 multiplicon masks its x-genelist
+ */
+static bool maskedRegionsOverlap(const Multiplicon& a, const Multiplicon& b)
+{
+    if (regionsOverlap(a.getYObjectID(), a.getBeginY(), a.getEndY(),
+                       b.getYObjectID(), b.getBeginY(), b.getEndY()))
+        return true;
+
+    if ((a.getLevel() == 2) &&
+        regionsOverlap(a.getXObjectID(), a.getBeginX(), a.getEndX(),
+                       b.getYObjectID(), b.getBeginY(), b.getEndY()))
+        return true;
+
+    if ((b.getLevel() == 2) &&
+        regionsOverlap(a.getYObjectID(), a.getBeginY(), a.getEndY(),
+                       b.getXObjectID(), b.getBeginX(), b.getEndX()))
+        return true;
+
+    return (a.getLevel() == 2) && (b.getLevel() == 2) &&
+        regionsOverlap(a.getXObjectID(), a.getBeginX(), a.getEndX(),
+                       b.getXObjectID(), b.getBeginX(), b.getEndX());
+}
+
+void DataSet::selectSearchBatch(unsigned int maxProfiles,
+                                vector<Multiplicon*>& batch)
+{
+    batch.clear();
+
+    // only look a limited distance ahead, the queue can be long
+    deque<Multiplicon*>::const_iterator it = multiplicons_to_evaluate.begin();
+    for (unsigned int i = 0; i < 4 * maxProfiles; i++, it++) {
+        if (it == multiplicons_to_evaluate.end()) break;
+        if (batch.size() == maxProfiles) break;
+
+        Multiplicon &multiplicon = **it;
+        if (prefetchedSearches.find(&multiplicon) != prefetchedSearches.end())
+            continue;
+
+        // the profile should be aligned successfully ...
+        map<const Multiplicon*, string>::const_iterator spec =
+            alignedMultiplicons.find(&multiplicon);
+        if (spec == alignedMultiplicons.end() || !spec->second.empty())
+            continue;
+
+        // ... not be masked (or redundant) under the current masking ...
+        const GeneList &lY = *genelists[multiplicon.getYObjectID()];
+        if (allMasked(lY, multiplicon.getBeginY(), multiplicon.getEndY()))
+            continue;
+
+        // ... and pass the quality check of higher-level profiles
+        if (multiplicon.getLevel() > 2) {
+            try {
+                multiplicon.checkAlignment(settings.getAnchorPoints());
+            } catch (const ProfileException&) {
+                continue;
+            }
+        }
+
+        // a multiplicon that masks part of another one in the batch would
+        // make its search invalid
+        bool overlaps = false;
+        for (size_t j = 0; j < batch.size() && !overlaps; j++)
+            overlaps = maskedRegionsOverlap(multiplicon, *batch[j]);
+        if (!overlaps)
+            batch.push_back(&multiplicon);
+    }
+}
+
+void DataSet::searchProfile(const Multiplicon& multiplicon,
+                            vector<Multiplicon*>& target)
+{
+    vector<Multiplicon*> batch;
+    if (settings.getProfileBatchSize() > 1)
+        selectSearchBatch(settings.getProfileBatchSize() - 1, batch);
+
+    vector<const Profile*> profiles(1, multiplicon.getProfile());
+    for (size_t j = 0; j < batch.size(); j++)
+        profiles.push_back(batch[j]->getProfile());
+
+    vector<vector<Multiplicon*> > found;
+    parallelProfileSearch(profiles, found);
+
+    size_t nProfiles = profiles.size();
+    for (size_t p = 0; p < genelists.size(); p++)
+        target.insert(target.end(), found[p * nProfiles].begin(),
+                      found[p * nProfiles].end());
+
+    // keep the results of the other profiles until they are evaluated
+    vector<unsigned int> maskVersions;
+    for (size_t p = 0; p < genelists.size(); p++)
+        maskVersions.push_back(genelists[indexToList[p]]->getMaskVersion());
+
+    for (size_t j = 1; j < nProfiles; j++) {
+        PrefetchedSearch &prefetch = prefetchedSearches[batch[j-1]];
+        prefetch.maskVersions = maskVersions;
+        prefetch.found.resize(genelists.size());
+        for (size_t p = 0; p < genelists.size(); p++)
+            prefetch.found[p].swap(found[p * nProfiles + j]);
+    }
+}
+
+void DataSet::completePrefetchedSearch(const Profile& profile,
+                                       PrefetchedSearch& prefetch,
+                                       vector<Multiplicon*>& target)
+{
+    vector<int> positions;
+    for (size_t p = 0; p < genelists.size(); p++) {
+        if (genelists[indexToList[p]]->getMaskVersion() ==
+            prefetch.maskVersions[p])
+            continue;
+
+        positions.push_back(p);
+        for (size_t i = 0; i < prefetch.found[p].size(); i++)
+            delete prefetch.found[p][i];
+        prefetch.found[p].clear();
+    }
 
-    localMultiplicons.clear();
+    // every process searches all these genelists itself, so that the
+    // results need not be exchanged
+    vector<vector<Multiplicon*> > found;
+    searchGeneLists(vector<const Profile*>(1, &profile), positions, found);
+    for (size_t k = 0; k < positions.size(); k++)
+        prefetch.found[positions[k]].swap(found[k]);
+
+    for (size_t p = 0; p < genelists.size(); p++)
+        target.insert(target.end(), prefetch.found[p].begin(),
+                      prefetch.found[p].end());
+    prefetch.found.clear();
 }
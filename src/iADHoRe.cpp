@@ -55,8 +55,11 @@ int main (int argc, char** argv) {
         dataset.mapGenes();
         dataset.remapTandems();
 
+        // a resumed run appends to the output of the previous run
+        bool resume = !settings.getResumeFrom().empty();
+
         // create output directory and generate empty files
-        if (ParToolBox::getProcID() == 0) {
+        if ((ParToolBox::getProcID() == 0) && !resume) {
             dataset.prepareOutput();
             dataset.outputGenes();
         }
@@ -76,10 +79,17 @@ int main (int argc, char** argv) {
                 break;
         }
 
-        cout << "Level 2 multiplicon detection..."; cout.flush();
-        Util::startChrono();
-        dataset.parallelLevel2ADHoReDyn();
-        cout << "\tdone. (time: " << Util::stopChrono() << "s)" << endl;
+        if (resume) {
+            cout << "Resuming from checkpoint..."; cout.flush();
+            Util::startChrono();
+            dataset.readCheckpoint();
+            cout << "\tdone. (time: " << Util::stopChrono() << "s)" << endl;
+        } else {
+            cout << "Level 2 multiplicon detection..."; cout.flush();
+            Util::startChrono();
+            dataset.parallelLevel2ADHoReDyn();
+            cout << "\tdone. (time: " << Util::stopChrono() << "s)" << endl;
+        }
 
         cout << "Profile detection..."; cout.flush();
         if (!settings.verboseOutput())  // enable silenced mode
@@ -16,6 +16,8 @@
 #include "Gene.h"
 #include "GHMProfile.h"
 #include "Settings.h"
+#include "TaskScheduler.h"
+#include "CostModel.h"
 
 #include <cassert>
 #include "util.h"
@@ -40,13 +42,28 @@ void DataSet::level2ADHoRe(int firstItem, int nItems, int threadID,
         case Hybrid:    cloud=true;  col=true;  break;
     }
 
-    for (int i = 0; i < workForThread[threadID].size(); i++) {
+    for (int i = firstItem; i < firstItem + nItems; i++) {
+        double startTime = Util::getTime();
 
-        uint x = workForThread[threadID][i].first;
-        uint y = workForThread[threadID][i].second;
+        uint x = level2Tasks[i].first;
+        uint y = level2Tasks[i].second;
 
         lluint w = genelists[x]->getSize() * genelists[y]->getSize();
 
+        // a GHM that is visualized is always run
+        bool useCache = !settings.getLevel2Cache().empty() &&
+                        !settings.showGHM(x, y);
+        uint64_t key = 0;
+        if (useCache) {
+            key = getLevel2Key(i);
+            if (loadLevel2Result(i, key, mpl_output, scl_output)) {
+                // the time of a cached list pair says nothing about its cost
+                level2Cached[i] = 1;
+                continue;
+            }
+        }
+        size_t firstM = mpl_output.size(), firstC = scl_output.size();
+
         //cerr << "I am proc " << ParToolBox::getProcID() << ", thread " <<
         //d threadID << ", doing: " << x << " / " << y << ", weight = " << w << endl;
 
@@ -58,7 +75,10 @@ void DataSet::level2ADHoRe(int firstItem, int nItems, int threadID,
             GHM ghm (*genelists[x], *genelists[y],false);
             ghm.buildMatrix(settings.useFamily());
 
-            ghm.run(settings);
+            if (level2Split[i])
+                runBanded(ghm);
+            else
+                ghm.run(settings);
             ghm.getMultiplicons(mpl_output);
 
             if (settings.showGHM(x,y))
@@ -76,7 +96,10 @@ void DataSet::level2ADHoRe(int firstItem, int nItems, int threadID,
             //remove AP already in baseClusters from Col Search, in cloudmode nothing is removed
             ghm.removeAPFromMultiplicons(multipliconsColSearch);
 
-            ghm.run(settings);
+            if (level2Split[i])
+                runBanded(ghm);
+            else
+                ghm.run(settings);
             ghm.getClouds(scl_output);
 
             if (settings.showGHM(x,y)) ghm.visualizeGHM(settings.getOutputPath());
@@ -84,15 +107,123 @@ void DataSet::level2ADHoRe(int firstItem, int nItems, int threadID,
 
         multipliconsColSearch.clear();
 
-        // update x and y
-        y++;
-        if (y == (int)genelists.size()) {
-            x++;
-            y = x;
+        if (useCache)
+            saveLevel2Result(i, key,
+                             vector<Multiplicon*>(mpl_output.begin() + firstM,
+                                                  mpl_output.end()),
+                             vector<SynthenicCloud*>(scl_output.begin() + firstC,
+                                                     scl_output.end()));
+
+        // every task is processed by a single thread
+        level2Times[i] = Util::getTime() - startTime;
+    }
+}
+
+void DataSet::runBanded(GHM& ghm) const
+{
+    vector<GHM*> bands;
+    vector<int> boundaries;
+    if (!ghm.beginBanded(settings, bands, boundaries))
+        return;
+
+    runBands(bands);
+    ghm.finishBanded(settings, bands, boundaries);
+}
+
+void DataSet::countHomologousPoints(hash_map<lluint, lluint>& points) const
+{
+    points.clear();
+    bool useFamily = settings.useFamily();
+
+    // inverted index over all genelists: (key, (list, position))
+    vector<pair<uint32_t, pair<uint, int> > > index;
+    for (uint l = 0; l < genelists.size(); l++) {
+        const vector<pair<uint32_t, int> >& li = genelists[l]->getHomologIndex();
+        for (size_t i = 0; i < li.size(); i++)
+            index.push_back(make_pair(li[i].first, make_pair(l, li[i].second)));
+    }
+    sort(index.begin(), index.end());
+
+    // count the points of GHM(x, y) from the x side only, x <= y, the same
+    // way GHM::buildMatrix finds them
+    for (uint x = 0; x < genelists.size(); x++) {
+        const vector<ListElement*>& xList = genelists[x]->getRemappedElements();
+        const vector<pair<uint32_t, int> >& li = genelists[x]->getHomologIndex();
+
+        for (size_t i = 0; i < li.size(); i++) {
+            int posX = li[i].second;
+            const Gene& gene = xList[posX]->getGene();
+
+            const uint32_t *keys = useFamily ? &li[i].first : gene.getPairs();
+            uint32_t nKeys = useFamily ? 1 : gene.getNumPairs();
+
+            for (uint32_t k = 0; k < nKeys; k++) {
+                vector<pair<uint32_t, pair<uint, int> > >::const_iterator it;
+                it = lower_bound(index.begin(), index.end(),
+                                 make_pair(keys[k], make_pair(x, INT_MIN)));
+                for ( ; it != index.end() && it->first == keys[k]; it++) {
+                    uint y = it->second.first;
+                    int posY = it->second.second;
+                    if (y == x && posY > posX) continue;
+
+                    if (useFamily) {
+                        const Gene& geneY = genelists[y]->getRemappedElements()[posY]->getGene();
+                        if (geneY.getInternID() == gene.getInternID())
+                            continue;
+                    }
+
+                    points[(lluint)x * genelists.size() + y]++;
+                }
+            }
         }
     }
+}
 
-    workForThread[threadID].clear();
+void DataSet::calibrateCostModel(CostModel& model) const
+{
+    // local measurements: sizeX, sizeY, points, time
+    vector<double> obs;
+    obs.reserve(4 * level2Tasks.size());
+    for (size_t i = 0; i < level2Tasks.size(); i++) {
+        // a split GHM ran on all threads and a cached GHM was not
+        // processed at all, their times do not fit the model; empty GHMs
+        // are left out as well, they would swamp the measurements
+        if (level2Split[i] || level2Cached[i] || level2Times[i] < 0.0)
+            continue;
+        if (level2Points[i] == 0) continue;
+
+        obs.push_back(genelists[level2Tasks[i].first]->getRemappedElementsLength());
+        obs.push_back(genelists[level2Tasks[i].second]->getRemappedElementsLength());
+        obs.push_back(level2Points[i]);
+        obs.push_back(level2Times[i]);
+    }
+
+#ifdef HAVE_MPI
+    // gather the measurements of all processes
+    int nProc = ParToolBox::getNumProcesses();
+    int thisSize = obs.size();
+    vector<int> sizes(nProc), displ(nProc, 0);
+    MPI_Gather(&thisSize, 1, MPI_INT, &sizes[0], 1, MPI_INT, 0, MPI_COMM_WORLD);
+    for (int i = 1; i < nProc; i++)
+        displ[i] = displ[i-1] + sizes[i-1];
+
+    vector<double> allObs(displ[nProc-1] + sizes[nProc-1] + 1);
+    MPI_Gatherv(obs.empty() ? NULL : &obs[0], thisSize, MPI_DOUBLE,
+                &allObs[0], &sizes[0], &displ[0], MPI_DOUBLE,
+                0, MPI_COMM_WORLD);
+    allObs.pop_back();
+    obs.swap(allObs);
+#endif
+
+    if (ParToolBox::getProcID() != 0)
+        return;
+
+    for (size_t i = 0; i + 3 < obs.size(); i += 4)
+        model.addObservation((lluint)obs[i], (lluint)obs[i+1],
+                             (lluint)obs[i+2], obs[i+3]);
+
+    model.fit();
+    model.save(settings.getCostModelFile());
 }
 
 uint DataSet::getProcForPackage(const vector<uint64_t> &weightPerProc)
@@ -110,51 +241,224 @@ uint DataSet::getProcForPackage(const vector<uint64_t> &weightPerProc)
     return sp;
 }
 
-bool DataSet::getSomeWorkL2(int &firstItem, int &nItems, int threadID,
-                            bool augmentWIP, bool getSmallWP)
+#ifdef HAVE_MPI
+template<class T>
+static bool itemLess(const pair<int, T>& a, const pair<int, T>& b)
+{
+    return a.first < b.first;
+}
+
+static int packResults(const vector<Multiplicon*>& mplicons, char *buffer)
 {
-    // make sure no race conditions occur in this part
-    pthread_mutex_lock (&queueMutex);
+    return Multiplicon::packMultiplicons(mplicons, buffer);
+}
 
-    // check whether we're ready
-    if (cX >= genelists.size()) {
-        pthread_mutex_unlock (&queueMutex);
-        return false;
-    }
+static int packResults(const vector<SynthenicCloud*>& clouds, char *buffer)
+{
+    return SynthenicCloud::packSynthenicClouds(clouds, buffer);
+}
 
-    // determine a good nItems to process based on the weight of the work
-    lluint targetWeight = (totalWeight - weightSoFar) * packagePerc /
-        (double)(settings.getNumThreads() * ParToolBox::getNumProcesses());
+static void unpackResults(const vector<char>& record,
+                          vector<Multiplicon*>& mplicons,
+                          const vector<GeneList*>& genelists, bool useFamily)
+{
+    Multiplicon::unpackL2Multiplicons(&record[0], &record[0] + record.size(),
+                                      mplicons, genelists, useFamily);
+}
 
-    if (targetWeight < minWeight)
-        targetWeight = minWeight;
+static void unpackResults(const vector<char>& record,
+                          vector<SynthenicCloud*>& clouds,
+                          const vector<GeneList*>& genelists, bool useFamily)
+{
+    SynthenicCloud::unpackSynthenicClouds(&record[0],
+                                          &record[0] + record.size(), clouds);
+}
 
-    lluint thisWeight = 0;
+/**
+ * Broadcasts the multiplicons or clouds of one process in records of about
+ * RECORD_SIZE bytes, the other processes unpack every record as it arrives.
+ * An empty record ends the stream.
+ * @param results Results of process root, the received results are
+ * appended on the other processes (input/output)
+ * @param items Position in the walk of the list pair that found every
+ * result, only used if withItems is true (input/output)
+ * @param withItems True if the items are broadcast as well
+ * @param root Identifier of the process that owns the results
+ * @param genelists Genelists of the dataset
+ * @param useFamily True if the dataset uses gene families
+ */
+template<class T>
+static void bcastResults(vector<T*>& results, vector<int>& items,
+                         bool withItems, int root,
+                         const vector<GeneList*>& genelists, bool useFamily)
+{
+    bool isRoot = (ParToolBox::getProcID() == root);
 
+    vector<char> record;
+    size_t first = 0;
     while (true) {
+        size_t last = first;
+        if (isRoot) {
+            lluint size = 0;
+            while (last < results.size() && (last == first || size < RECORD_SIZE))
+                size += results[last++]->getPackSize();
+
+            vector<T*> batch(results.begin() + first, results.begin() + last);
+            record.resize(batch.empty() ? 0 : T::getPackSize(batch));
+            if (!batch.empty())
+                packResults(batch, &record[0]);
+        }
+
+        ParToolBox::bcastRecord(record, root);
+        if (record.empty())
+            break;
+
+        if (!isRoot) {
+            unpackResults(record, results, genelists, useFamily);
+            last = results.size();
+        }
+
+        if (withItems) {
+            if (!isRoot)
+                items.resize(last);
+            MPI_Bcast(&items[first], last - first, MPI_INT, root, MPI_COMM_WORLD);
+        }
+        first = last;
+    }
+}
+
+/**
+ * Claims the next package of tasks from the task counter on process 0.
+ * A package holds about 1/(2 * #processes) of the remaining weight, with a
+ * minimum number of tasks, so packages shrink towards the end of the run.
+ * @param counter Window that exposes the counter of process 0
+ * @param cumWeight cumWeight[i] is the weight of the first i tasks
+ * @param minTasks Minimum number of tasks in a package
+ * @param first First task of the package, on input a lower bound of the
+ * counter (input/output)
+ * @param last One past the last task of the package (output)
+ * @return False if all tasks have been handed out
+ */
+static bool claimPackage(MPI_Win counter, const vector<lluint>& cumWeight,
+                         int minTasks, int& first, int& last)
+{
+    int nTasks = cumWeight.size() - 1;
+    lluint nProc = ParToolBox::getNumProcesses();
+
+    while (first < nTasks) {
+        lluint target = cumWeight[first] +
+                        (cumWeight[nTasks] - cumWeight[first]) / (2 * nProc);
+        int next = lower_bound(cumWeight.begin() + first + 1, cumWeight.end(),
+                               target) - cumWeight.begin();
+        next = min(max(next, first + minTasks), nTasks);
+
+        // the counter only moves forward, if another process claimed a
+        // package first, retry from its new value
+        int seen;
+        MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, counter);
+        MPI_Compare_and_swap(&next, &first, &seen, MPI_INT, 0, 0, counter);
+        MPI_Win_unlock(0, counter);
+
+        if (seen == first) {
+            last = next;
+            return true;
+        }
+        first = seen;
+    }
+
+    return false;
+}
 
+void DataSet::dynamicLevel2Packages(const vector<lluint>& weights)
+{
+    // the task counter lives on process 0, it is accessed with one-sided
+    // atomic operations so process 0 needs no coordinator thread
+    int *count = NULL;
+    MPI_Aint winSize = (ParToolBox::getProcID() == 0) ? sizeof(int) : 0;
+    MPI_Alloc_mem(max(winSize, (MPI_Aint)sizeof(int)), MPI_INFO_NULL, &count);
+    *count = 0;
+
+    MPI_Win counter;
+    MPI_Win_create(count, winSize, sizeof(int), MPI_INFO_NULL,
+                   MPI_COMM_WORLD, &counter);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    vector<lluint> cumWeight(weights.size() + 1, 0);
+    for (size_t i = 0; i < weights.size(); i++)
+        cumWeight[i+1] = cumWeight[i] + weights[i];
+
+    // a package keeps all threads of a process busy
+    int first = 0, last;
+    while (claimPackage(counter, cumWeight, settings.getNumThreads(), first, last)) {
+        taskOffset = first;
+        distributeTasks(vector<lluint>(weights.begin() + first,
+                                       weights.begin() + last));
+        wakeThreads();
+
+        finishWorkPacket();
+        finishWorkerThreads();
+        first = last;
+    }
+
+    MPI_Win_free(&counter);
+    MPI_Free_mem(count);
+}
+#endif
+
+void DataSet::parallelLevel2ADHoReDyn()
+{
+    workFunction = &DataSet::level2ADHoRe;
+
+    // predict the cost of every GHM from its number of homologous points
+    CostModel model;
+    if (!settings.getCostModelFile().empty())
+        model.load(settings.getCostModelFile());
+
+    hash_map<lluint, lluint> pointCount;
+    countHomologousPoints(pointCount);
+
+    // with dynamic load balancing, every process keeps all list pairs and
+    // the packages are handed out while running
+    bool dynamic = false;
+#ifdef HAVE_MPI
+    dynamic = settings.dynamicLevel2() && ParToolBox::getNumProcesses() > 1;
+#endif
+
+    // assign the list pairs to the processes, walking over the diagonals of
+    // the list pair matrix, every pair goes to the least loaded process
+    vector<lluint> weightPerProc(ParToolBox::getNumProcesses(), 0);
+    vector<lluint> weights;
+    level2Tasks.clear();
+    level2Points.clear();
+    level2Items.clear();
+
+    uint cX = 0, cY = 0;
+    while (cX < genelists.size()) {
         uint lX = indexToList[cX];
         uint lY = indexToList[cY];
 
-        GeneList &glX = *genelists[lX];
-        GeneList &glY = *genelists[lY];
-        lluint weight = glX.getSize() * glY.getSize();
-        uint proc = getProcForPackage(weightPerProc);
+        hash_map<lluint, lluint>::const_iterator pc;
+        pc = pointCount.find((lluint)min(lX, lY) * genelists.size() + max(lX, lY));
+        lluint points = (pc == pointCount.end()) ? 0 : pc->second;
+
+        // predicted time in microseconds
+        lluint weight = 1 + (lluint)(1e6 *
+            model.predict(genelists[lX]->getRemappedElementsLength(),
+                          genelists[lY]->getRemappedElementsLength(), points));
+        uint proc = dynamic ? 0 : getProcForPackage(weightPerProc);
         weightPerProc[proc] += weight;
 
-        if (proc == ParToolBox::getProcID()) {
-            workForThread[threadID].push_back(pair<uint, uint>(lX, lY));
-            thisWeight += weight;
+        if (dynamic || proc == ParToolBox::getProcID()) {
+            level2Items.push_back(level2Items.size());
+            level2Tasks.push_back(pair<uint, uint>(lX, lY));
+            level2Points.push_back(points);
+            weights.push_back(weight);
         }
 
-        weightSoFar += weight;
-
         if ((cX - cY) < 2) {
             // check whether we're ready
-            if ((cX == cY) && (cX == genelists.size()-1)) {
-                cX = genelists.size();
+            if ((cX == cY) && (cX == genelists.size()-1))
                 break;
-            }
             int newD = cX+cY+1;
             cX = (newD < genelists.size()) ? newD : genelists.size() - 1;
             cY = (newD < genelists.size()) ? 0 : newD - genelists.size() + 1;
@@ -162,131 +466,171 @@ bool DataSet::getSomeWorkL2(int &firstItem, int &nItems, int threadID,
             cX--;
             cY++;
         }
-
-        if (thisWeight > targetWeight)
-            break;
     }
 
-    if (augmentWIP)
-        workInProgress++;
-
-    pthread_mutex_unlock (&queueMutex);
-    return true;
-}
-
-void DataSet::parallelLevel2ADHoReDyn()
-{
-    // initialize load distribution parameters
-    workFunction = &DataSet::level2ADHoRe;
-    getSomeWorkFunction = &DataSet::getSomeWorkL2;
-    cX = cY = 0;
-    weightPerProc.clear();
-    weightPerProc.resize(ParToolBox::getNumProcesses(), 0);
-    workForThread = new std::vector<std::pair<uint, uint> >[settings.getNumThreads()];
-
-    packagePerc = 0.05;
-    minPackagePerc = 0.005;
-
-    totalWeight = 0;
-    for (uint x = 0; x < genelists.size(); x++) {
-        lluint sx = genelists[x]->getRemappedElementsLength();
-        for (unsigned int y = x; y < genelists.size(); y++) {
-            lluint sy = genelists[y]->getRemappedElementsLength();
-            totalWeight += sx * sy;
+    // the heaviest list pairs are handed out first, level2Items keeps their
+    // position in the walk
+    if (dynamic) {
+        vector<pair<lluint, int> > order;
+        for (size_t i = 0; i < weights.size(); i++)
+            order.push_back(pair<lluint, int>(weights[i], i));
+        sort(order.rbegin(), order.rend());
+
+        vector<pair<uint, uint> > tasks;
+        vector<lluint> points;
+        for (size_t i = 0; i < order.size(); i++) {
+            int item = order[i].second;
+            tasks.push_back(level2Tasks[item]);
+            points.push_back(level2Points[item]);
+            weights[i] = order[i].first;
+            level2Items[i] = item;
         }
+        level2Tasks.swap(tasks);
+        level2Points.swap(points);
     }
 
-    minWeight = minPackagePerc * totalWeight /
-        ((double)settings.getNumThreads() * ParToolBox::getNumProcesses()) + 1;
-    weightSoFar = 0;
-
     createThreadPool();
-    wakeThreads();
 
-    // finish the work packet
-    finishWorkPacket();
-    finishWorkerThreads();
+    // a GHM that takes more than the share of one thread is split over
+    // all threads
+    lluint totalWeight = 0;
+    for (size_t i = 0; i < weights.size(); i++)
+        totalWeight += weights[i];
+
+    lluint threadShare = totalWeight / settings.getNumThreads();
+    if (dynamic)
+        threadShare /= ParToolBox::getNumProcesses();
+
+    level2Split.assign(level2Tasks.size(), false);
+    if (settings.splitLargeGHMs() && settings.getNumThreads() > 1)
+        for (size_t i = 0; i < weights.size(); i++)
+            level2Split[i] = (weights[i] > threadShare);
+
+    level2Times.assign(level2Tasks.size(), -1.0);
+    level2Cached.assign(level2Tasks.size(), 0);
+    if (!settings.getLevel2Cache().empty())
+        prepareLevel2Cache();
 
+    if (dynamic) {
 #ifdef HAVE_MPI
-    // serialize the locally found multiplicons and clouds (M multiplicon, C clouds)
-    int thisBuffSizeM = Multiplicon::getPackSize(localMultiplicons);
-    char *bufferM = new char[thisBuffSizeM];
-    Multiplicon::packMultiplicons(localMultiplicons, bufferM);
+        dynamicLevel2Packages(weights);
+#endif
+    } else {
+        // every list pair is a task
+        taskOffset = 0;
+        distributeTasks(weights);
+        wakeThreads();
+
+        // finish the work packet
+        finishWorkPacket();
+        finishWorkerThreads();
+    }
 
-    int thisBuffSizeC= SynthenicCloud::getPackSize(localClouds);
-    char *bufferC = new char[thisBuffSizeC];
-    SynthenicCloud::packSynthenicClouds(localClouds,bufferC);
+    if (!settings.getLevel2Cache().empty())
+        writeLevel2Cache();
 
+#ifdef HAVE_MPI
+    // every process in turn broadcasts its multiplicons and clouds in
+    // bounded records that are merged as they arrive, so no process holds
+    // the packed results of all processes at once
     int thisProc = ParToolBox::getProcID();
     int nProc = ParToolBox::getNumProcesses();
 
-    // Communicate the buffer size to all the processes
-    int *buffSizeM = new int [nProc];
-    MPI_Allgather(&thisBuffSizeM, 1, MPI_INT,
-                  buffSizeM, 1, MPI_INT, MPI_COMM_WORLD);
-    int *buffSizeC = new int [nProc];
-    MPI_Allgather(&thisBuffSizeC, 1, MPI_INT,
-                  buffSizeC, 1, MPI_INT, MPI_COMM_WORLD);
-
-    // Calculate the displacement
-    int *displM = new int[nProc]; displM[0] = 0;
-    int *displC = new int[nProc]; displC[0] = 0;
-    for (int i = 1; i < nProc; i++) {
-        displM[i] = displM[i-1]+buffSizeM[i-1];
-        displC[i] = displC[i-1]+buffSizeC[i-1];
+    // with dynamic load balancing, also communicate the position of the
+    // list pair that found every multiplicon and cloud in the walk
+    vector<int> thisItemsM, thisItemsC;
+    if (dynamic) {
+        for (size_t i = 0; i < localMultipliconItems.size(); i++)
+            thisItemsM.push_back(level2Items[localMultipliconItems[i]]);
+        for (size_t i = 0; i < localCloudItems.size(); i++)
+            thisItemsC.push_back(level2Items[localCloudItems[i]]);
     }
-    // Calculate the total buffer size
-    int totalBuffSizeM = 0;
-    int totalBuffSizeC = 0;
-    for (int i = 0; i < nProc; i++) {
-        totalBuffSizeM+= buffSizeM[i];
-        totalBuffSizeC+= buffSizeC[i];
-    }
-    char *recvBufferM = new char[totalBuffSizeM];
-    char *recvBufferC = new char[totalBuffSizeC];
-
-    MPI_Allgatherv(bufferM, thisBuffSizeM, MPI_CHAR,
-                   recvBufferM, buffSizeM, displM, MPI_CHAR, MPI_COMM_WORLD);
-    MPI_Allgatherv(bufferC, thisBuffSizeC, MPI_CHAR,
-                   recvBufferC, buffSizeC, displC, MPI_CHAR, MPI_COMM_WORLD);
 
     // use this construction to make sure that the order in which the
     // multiplicons are stored is the same for all processes
+    vector<pair<int, Multiplicon*> > allM;
+    vector<pair<int, SynthenicCloud*> > allC;
     for (int i = 0; i < nProc; i++) {
+        vector<Multiplicon*> mplicons;
+        vector<SynthenicCloud*> sclouds;
+        vector<int> itemsM, itemsC;
         if (i == thisProc) {
-            addMultiplicons(localMultiplicons);
-            addClouds(localClouds);
-        } else {
-            vector<Multiplicon*> mplicons;
-            Multiplicon::unpackL2Multiplicons(recvBufferM + displM[i], mplicons,
-                                              genelists, settings.useFamily());
-            addMultiplicons(mplicons);
+            mplicons = localMultiplicons;
+            sclouds = localClouds;
+            itemsM = thisItemsM;
+            itemsC = thisItemsC;
+        }
 
-            vector<SynthenicCloud*> sclouds;
-            SynthenicCloud::unpackSynthenicClouds(recvBufferC + displC[i], sclouds);
+        bcastResults(mplicons, itemsM, dynamic, i, genelists,
+                     settings.useFamily());
+        bcastResults(sclouds, itemsC, dynamic, i, genelists,
+                     settings.useFamily());
+
+        if (!dynamic) {
+            addMultiplicons(mplicons);
             addClouds(sclouds);
+            continue;
         }
-    }
 
-    delete [] recvBufferM;
-    delete [] displM;
-    delete [] buffSizeM;
-    delete [] bufferM;
+        for (size_t j = 0; j < mplicons.size(); j++)
+            allM.push_back(pair<int, Multiplicon*>(itemsM[j], mplicons[j]));
+        for (size_t j = 0; j < sclouds.size(); j++)
+            allC.push_back(pair<int, SynthenicCloud*>(itemsC[j], sclouds[j]));
+    }
 
-    delete [] recvBufferC;
-    delete [] displC;
-    delete [] buffSizeC;
-    delete [] bufferC;
+    // every list pair is processed by a single process, a stable sort on
+    // the position in the walk gives the order of a single process run
+    if (dynamic) {
+        stable_sort(allM.begin(), allM.end(), itemLess<Multiplicon*>);
+        stable_sort(allC.begin(), allC.end(), itemLess<SynthenicCloud*>);
+
+        vector<Multiplicon*> mplicons;
+        for (size_t i = 0; i < allM.size(); i++)
+            mplicons.push_back(allM[i].second);
+        addMultiplicons(mplicons);
+
+        vector<SynthenicCloud*> sclouds;
+        for (size_t i = 0; i < allC.size(); i++)
+            sclouds.push_back(allC[i].second);
+        addClouds(sclouds);
+    }
 #else    // if we don't have MPI
     addMultiplicons(localMultiplicons);
     addClouds(localClouds);
 #endif
 
+    if (!settings.getLevel2Cache().empty()) {
+        int cached[2] = {0, 0};
+        for (size_t i = 0; i < level2Tasks.size(); i++) {
+            if (level2Cached[i]) cached[0]++;
+            if (level2Cached[i] || level2Times[i] >= 0.0) cached[1]++;
+        }
+#ifdef HAVE_MPI
+        MPI_Allreduce(MPI_IN_PLACE, cached, 2, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+#endif
+        if (ParToolBox::getProcID() == 0)
+            cout << endl << "\tLevel-2 cache: " << cached[0] << " of "
+                 << cached[1] << " list pairs reused" << endl;
+    }
+
     localMultiplicons.clear();
     localClouds.clear();
+    localMultipliconItems.clear();
+    localCloudItems.clear();
     sortByMultipliconSize(multiplicons);
 
+    if (!settings.getCostModelFile().empty())
+        calibrateCostModel(model);
+
     destroyThreadPool();
 
-    delete [] workForThread;
+    level2Tasks.clear();
+    level2Points.clear();
+    level2Times.clear();
+    level2Split.clear();
+    level2Cached.clear();
+    level2Keys.clear();
+    level2Results.clear();
+    level2Computed.clear();
+    level2Items.clear();
 }
@@ -0,0 +1,145 @@
+#include "DataSet.h"
+#include "Multiplicon.h"
+#include "SynthenicCloud.h"
+#include "Settings.h"
+#include <cassert>
+#include <pthread.h>
+
+using namespace std;
+
+// batches that flushOutput can queue before it waits for the writer
+static const size_t MAX_OUTPUT_BATCHES = 2;
+// stream buffer of every output file
+static const size_t OUTPUT_BUFFER_SIZE = 1 << 18;
+
+extern "C" void* startOutputWriter(void *args)
+{
+    DataSet *dataset = reinterpret_cast<DataSet*>(args);
+    dataset->runOutputWriter();
+
+    pthread_exit(NULL);
+}
+
+void DataSet::createOutputWriter()
+{
+    pthread_mutex_init(&outputMutex, NULL);
+    pthread_cond_init(&outputCond, NULL);
+    pthread_cond_init(&outputDoneCond, NULL);
+    outputBusy = false;
+    stopOutput = false;
+
+    // the files stay open until the writer is destroyed, the buffer of a
+    // stream must be set before it is opened
+    vector<string> files = getFlushedFiles();
+    vector<ofstream*> streams = getFlushedStreams();
+    assert(files.size() == streams.size());
+
+    outputBuffers.assign(files.size(), vector<char>(OUTPUT_BUFFER_SIZE));
+    for (size_t f = 0; f < files.size(); f++) {
+        streams[f]->rdbuf()->pubsetbuf(&outputBuffers[f][0],
+                                       OUTPUT_BUFFER_SIZE);
+        streams[f]->open(files[f].c_str(), ios::app);
+        if (!*streams[f])
+            cerr << "Error creating file " << files[f] << endl;
+    }
+
+    if (pthread_create(&outputThread, NULL, *startOutputWriter, this) != 0) {
+        cerr << "Failed to create the output writer thread" << endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void DataSet::flushOutput()
+{
+    cout << "Flushing output files...";
+
+    pthread_mutex_lock(&outputMutex);
+    // the writer thread is at most a few batches behind
+    while (outputQueue.size() >= MAX_OUTPUT_BATCHES)
+        pthread_cond_wait(&outputDoneCond, &outputMutex);
+
+    outputQueue.push_back(OutputBatch());
+    outputQueue.back().multiplicons.swap(evaluated_multiplicons);
+    outputQueue.back().clouds.swap(clouds);
+    pthread_cond_signal(&outputCond);
+    pthread_mutex_unlock(&outputMutex);
+
+    cout << "done." << endl;
+}
+
+void DataSet::runOutputWriter()
+{
+    pthread_mutex_lock(&outputMutex);
+    while (true) {
+        while (outputQueue.empty() && !stopOutput)
+            pthread_cond_wait(&outputCond, &outputMutex);
+        if (outputQueue.empty())
+            break;
+
+        OutputBatch batch;
+        batch.multiplicons.swap(outputQueue.front().multiplicons);
+        batch.clouds.swap(outputQueue.front().clouds);
+        outputQueue.pop_front();
+        outputBusy = true;
+        // there is room in the queue again
+        pthread_cond_broadcast(&outputDoneCond);
+        pthread_mutex_unlock(&outputMutex);
+
+        switch (settings.getClusterType()) {
+            case Collinear:
+                flushCollinear(batch.multiplicons);
+                break;
+            case Cloud:
+                flushClouds(batch.clouds);
+                break;
+            case Hybrid:
+                flushCollinear(batch.multiplicons);
+                flushClouds(batch.clouds);
+                break;
+        }
+
+        for (size_t i = 0; i < batch.multiplicons.size(); i++)
+            delete batch.multiplicons[i];
+        for (size_t i = 0; i < batch.clouds.size(); i++)
+            delete batch.clouds[i];
+
+        pthread_mutex_lock(&outputMutex);
+        outputBusy = false;
+        pthread_cond_broadcast(&outputDoneCond);
+    }
+    pthread_mutex_unlock(&outputMutex);
+}
+
+void DataSet::drainOutput()
+{
+    pthread_mutex_lock(&outputMutex);
+    while (!outputQueue.empty() || outputBusy)
+        pthread_cond_wait(&outputDoneCond, &outputMutex);
+    pthread_mutex_unlock(&outputMutex);
+
+    // the writer is idle, the streams can be flushed from here
+    vector<ofstream*> streams = getFlushedStreams();
+    for (size_t f = 0; f < streams.size(); f++)
+        streams[f]->flush();
+}
+
+void DataSet::destroyOutputWriter()
+{
+    // the writer finishes the queued batches before it stops
+    pthread_mutex_lock(&outputMutex);
+    stopOutput = true;
+    pthread_cond_signal(&outputCond);
+    pthread_mutex_unlock(&outputMutex);
+
+    void *status;
+    pthread_join(outputThread, &status);
+
+    vector<ofstream*> streams = getFlushedStreams();
+    for (size_t f = 0; f < streams.size(); f++)
+        streams[f]->close();
+    outputBuffers.clear();
+
+    pthread_mutex_destroy(&outputMutex);
+    pthread_cond_destroy(&outputCond);
+    pthread_cond_destroy(&outputDoneCond);
+}
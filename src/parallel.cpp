@@ -2,6 +2,7 @@
 #include <cmath>
 #include <cassert>
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -37,6 +38,23 @@ void ParToolBox::destroy()
 #endif
 }
 
+#ifdef HAVE_MPI
+void ParToolBox::bcastRecord(vector<char>& record, int root)
+{
+    // the size of a single MPI message is an int
+    const uint64_t maxMessage = 1 << 30;
+
+    uint64_t size = record.size();
+    MPI_Bcast(&size, 1, MPI_UINT64_T, root, MPI_COMM_WORLD);
+    record.resize(size);
+
+    for (uint64_t offset = 0; offset < size; offset += maxMessage) {
+        int count = (int)min(maxMessage, size - offset);
+        MPI_Bcast(&record[offset], count, MPI_CHAR, root, MPI_COMM_WORLD);
+    }
+}
+#endif
+
 void ParToolBox::statPartitionWorkload(const vector<double> &weight,
                                        vector<int> &startPos, int nProc)
 {
@@ -8,6 +8,10 @@
 #define MAX_PROCESSOR_NAME 10
 #endif
 
+// target size in bytes of a record of results that is exchanged between
+// the processes, larger result sets are streamed in several records
+#define RECORD_SIZE (4 << 20)
+
 #include <vector>
 #include <map>
 #include <stdint.h>
@@ -61,6 +65,17 @@ public:
                                   std::vector< uint64_t>& cumWeight,
                                   std::map< uint64_t, uint>& cumWeightToIndex);
 
+#ifdef HAVE_MPI
+    /*
+     * Broadcast a record of any size: its 64-bit size is sent first and
+     * the data follows in messages of bounded size
+     * @param record Data to send on process root, received data on the
+     * other processes (input/output)
+     * @param root Identifier of the sending process
+     */
+    static void bcastRecord(std::vector<char>& record, int root);
+#endif
+
     /*
      * Get the process name
      */
@@ -3,9 +3,12 @@
 #endif
 
 #include "DataSet.h"
+#include "Multiplicon.h"
 #include "util.h"
 #include "parallel.h"
 #include "Settings.h"
+#include "TaskScheduler.h"
+#include "GHM.h"
 #include <pthread.h>
 
 extern "C" void* startThread(void *args)
@@ -14,41 +17,23 @@ extern "C" void* startThread(void *args)
     DataSet *dataset = threadArgs->dataset;
     int threadID = threadArgs->threadID;
 
-    vector<Multiplicon *> threadMultiplicons;
-    vector<SynthenicCloud*> threadClouds;
-
     while (true) {
+        // register before taking a task, so that the master thread cannot
+        // find all deques empty and no work in progress while this thread
+        // still holds a task
+        pthread_mutex_lock (&dataset->wipMutex);
+        dataset->workInProgress++;
+        pthread_mutex_unlock (&dataset->wipMutex);
+
         // perform all the work there is to perform
-        int firstItem, nItems; bool threadDidWork = false;
-        while (dataset->runGetSomeWork(firstItem, nItems,
-                                       threadID, !threadDidWork)) {
-            dataset->runWorkFunction(firstItem, nItems, threadID, threadMultiplicons, threadClouds);
-            threadDidWork = true;
-        }
+        dataset->runTasks(threadID);
 
-        // if the thread did no work, unnecessary to lock mutexes etc...
-        if (threadDidWork) {
-            // protect again simulatenous writing
-            pthread_mutex_lock (&dataset->mpcMutex);
-            dataset->localMultiplicons.insert(dataset->localMultiplicons.end(),
-                                              threadMultiplicons.begin(),
-                                              threadMultiplicons.end());
-            dataset->localClouds.insert(dataset->localClouds.end(),
-                                        threadClouds.begin(),
-                                        threadClouds.end());
-            pthread_mutex_unlock (&dataset->mpcMutex);
-
-            // clear the found multiplicons for the next run
-            threadMultiplicons.clear();
-            threadClouds.clear();
-
-            pthread_mutex_lock (&dataset->queueMutex);
-            dataset->workInProgress--;
-            // signal master thread that threads are finished
-            if (dataset->workInProgress == 0)
-                pthread_cond_signal (&dataset->masterCond);
-            pthread_mutex_unlock (&dataset->queueMutex);
-        }
+        pthread_mutex_lock (&dataset->wipMutex);
+        dataset->workInProgress--;
+        // signal master thread that threads are finished
+        if (dataset->workInProgress == 0)
+            pthread_cond_signal (&dataset->masterCond);
+        pthread_mutex_unlock (&dataset->wipMutex);
 
         pthread_mutex_lock (&dataset->workerMutex);
         if (dataset->destroyTP) {
@@ -66,7 +51,147 @@ extern "C" void* startThread(void *args)
     pthread_exit(NULL);
 }
 
-void DataSet::wakeThreads()
+bool DataSet::getSomeWork(int &firstItem, int &nItems, int threadID)
+{
+    int task;
+    if (!scheduler->getTask(threadID, task))
+        return false;
+
+    firstItem = taskOffset + task;
+    nItems = 1;
+    return true;
+}
+
+void DataSet::runTasks(int threadID)
+{
+    vector<Multiplicon*> mplicons;
+    vector<SynthenicCloud*> sclouds;
+
+    int firstItem, nItems;
+    while (true) {
+        // the bands of a split GHM go first, its thread waits for them
+        if (runPendingBand())
+            continue;
+        if (!getSomeWork(firstItem, nItems, threadID))
+            break;
+
+        int task = firstItem - taskOffset;
+        if (task >= numWorkTasks) {
+            alignSpeculatively(task - numWorkTasks);
+            continue;
+        }
+
+        runWorkFunction(firstItem, nItems, threadID, mplicons, sclouds);
+
+        // tag the results with their task, only this thread writes here
+        for (size_t i = 0; i < mplicons.size(); i++)
+            taskMultiplicons[threadID].push_back(
+                pair<int, Multiplicon*>(task, mplicons[i]));
+        for (size_t i = 0; i < sclouds.size(); i++)
+            taskClouds[threadID].push_back(
+                pair<int, SynthenicCloud*>(task, sclouds[i]));
+        mplicons.clear();
+        sclouds.clear();
+    }
+}
+
+template<class T>
+static bool taskLess(const pair<int, T>& a, const pair<int, T>& b)
+{
+    return a.first < b.first;
+}
+
+void DataSet::collectTaskResults()
+{
+    // every task is run by a single thread, a stable sort on the task
+    // index restores the order in which a serial run finds the results
+    vector<pair<int, Multiplicon*> > allM;
+    vector<pair<int, SynthenicCloud*> > allC;
+    for (int t = 0; t < settings.getNumThreads(); t++) {
+        allM.insert(allM.end(), taskMultiplicons[t].begin(),
+                    taskMultiplicons[t].end());
+        allC.insert(allC.end(), taskClouds[t].begin(), taskClouds[t].end());
+        taskMultiplicons[t].clear();
+        taskClouds[t].clear();
+    }
+
+    stable_sort(allM.begin(), allM.end(), taskLess<Multiplicon*>);
+    stable_sort(allC.begin(), allC.end(), taskLess<SynthenicCloud*>);
+
+    for (size_t i = 0; i < allM.size(); i++) {
+        localMultiplicons.push_back(allM[i].second);
+        localMultipliconItems.push_back(taskOffset + allM[i].first);
+    }
+    for (size_t i = 0; i < allC.size(); i++) {
+        localClouds.push_back(allC[i].second);
+        localCloudItems.push_back(taskOffset + allC[i].first);
+    }
+
+    for (size_t i = 0; i < alignTasks.size(); i++)
+        alignedMultiplicons[alignTasks[i]] = alignErrors[i];
+    alignTasks.clear();
+    alignErrors.clear();
+}
+
+void DataSet::distributeTasks(vector<lluint> weights)
+{
+    numWorkTasks = weights.size();
+
+    // a speculative alignment is weighted by the length of the profile,
+    // which is of the same order as the length of a searched genelist
+    alignErrors.assign(alignTasks.size(), string());
+    for (size_t i = 0; i < alignTasks.size(); i++) {
+        const Multiplicon &m = *alignTasks[i];
+        lluint sizeX = m.getEndX() - m.getBeginX() + 1;
+        lluint sizeY = m.getEndY() - m.getBeginY() + 1;
+        weights.push_back((m.getLevel() - 1) * sizeX + sizeY);
+    }
+
+    scheduler->distribute(weights);
+}
+
+bool DataSet::runPendingBand() const
+{
+    pthread_mutex_lock(&bandMutex);
+    if (bandQueue.empty()) {
+        pthread_mutex_unlock(&bandMutex);
+        return false;
+    }
+    pair<GHM*, int*> band = bandQueue.front();
+    bandQueue.pop_front();
+    pthread_mutex_unlock(&bandMutex);
+
+    band.first->runBand(settings);
+
+    pthread_mutex_lock(&bandMutex);
+    if (--(*band.second) == 0)
+        pthread_cond_broadcast(&bandCond);
+    pthread_mutex_unlock(&bandMutex);
+    return true;
+}
+
+void DataSet::runBands(const vector<GHM*>& bands) const
+{
+    int remaining = bands.size();
+
+    pthread_mutex_lock(&bandMutex);
+    for (size_t i = 0; i < bands.size(); i++)
+        bandQueue.push_back(pair<GHM*, int*>(bands[i], &remaining));
+    pthread_mutex_unlock(&bandMutex);
+
+    // the worker threads that ran out of tasks pick up the other bands,
+    // busy ones take them once their current task is done
+    wakeThreads();
+    while (runPendingBand())
+        ;
+
+    pthread_mutex_lock(&bandMutex);
+    while (remaining > 0)
+        pthread_cond_wait(&bandCond, &bandMutex);
+    pthread_mutex_unlock(&bandMutex);
+}
+
+void DataSet::wakeThreads() const
 {
     // wake up the slaves
     pthread_mutex_lock(&workerMutex);
@@ -77,19 +202,26 @@ void DataSet::wakeThreads()
 void DataSet::finishWorkerThreads()
 {
     // make sure your worker threads are finished before continuing
-    pthread_mutex_lock(&queueMutex);
+    pthread_mutex_lock(&wipMutex);
     while (workInProgress != 0)
-        pthread_cond_wait(&masterCond, &queueMutex);
-    pthread_mutex_unlock(&queueMutex);
+        pthread_cond_wait(&masterCond, &wipMutex);
+    pthread_mutex_unlock(&wipMutex);
+
+    collectTaskResults();
 }
 
 void DataSet::createThreadPool()
 {
-    pthread_mutex_init(&mpcMutex, NULL);
     pthread_mutex_init(&workerMutex, NULL);
-    pthread_mutex_init(&queueMutex, NULL);
+    pthread_mutex_init(&wipMutex, NULL);
     pthread_cond_init(&workerCond, NULL);
     pthread_cond_init(&masterCond, NULL);
+    pthread_mutex_init(&bandMutex, NULL);
+    pthread_cond_init(&bandCond, NULL);
+
+    scheduler = new TaskScheduler(settings.getNumThreads());
+    taskMultiplicons = new vector<pair<int, Multiplicon*> >[settings.getNumThreads()];
+    taskClouds = new vector<pair<int, SynthenicCloud*> >[settings.getNumThreads()];
 
     // spawn extra threads, if necessary
     nThreads = settings.getNumThreads() - 1;
@@ -104,7 +236,6 @@ void DataSet::createThreadPool()
 
         // create the worker threads without any workload
         destroyTP = false;
-        currentIndex = 1; finalIndex = 0;
         for (int threadID = 0; threadID < nThreads; threadID++) {
             threadArgs[threadID].dataset = this;
             threadArgs[threadID].threadID = threadID + 1; // 0 == master thread
@@ -141,9 +272,17 @@ void DataSet::destroyThreadPool()
         threadArgs = NULL;
     }
 
-    pthread_mutex_destroy(&mpcMutex);
+    delete scheduler;
+    delete [] taskMultiplicons;
+    delete [] taskClouds;
+    scheduler = NULL;
+    taskMultiplicons = NULL;
+    taskClouds = NULL;
+
     pthread_mutex_destroy(&workerMutex);
-    pthread_mutex_destroy(&queueMutex);
+    pthread_mutex_destroy(&wipMutex);
     pthread_cond_destroy(&workerCond);
     pthread_cond_destroy(&masterCond);
+    pthread_mutex_destroy(&bandMutex);
+    pthread_cond_destroy(&bandCond);
 }
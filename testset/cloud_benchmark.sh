@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+# Times i-ADHoRe in cloud mode for a range of cloud gap sizes.
+#
+# Usage: cloud_benchmark.sh <i-adhore> <inifile> [<baseline i-adhore>] [gap ...]
+#
+# For every gap size a copy of <inifile> is run with cluster_type=cloud,
+# cloud_gap_size=<gap> and cloud_cluster_gap=<gap>+5. When a baseline binary
+# is given (any executable path before the gap sizes), it is run on the same
+# settings and the speedup is reported. Paths in <inifile> are resolved
+# relative to the directory containing it, as i-ADHoRe itself would when run
+# from there.
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <i-adhore> <inifile> [<baseline i-adhore>] [gap ...]"
+    exit 1
+fi
+
+BINARY=$(readlink -f "$1")
+INIFILE=$(readlink -f "$2")
+shift 2
+
+BASELINE=""
+if [ $# -gt 0 ] && [ -x "$1" ]; then
+    BASELINE=$(readlink -f "$1")
+    shift
+fi
+
+GAPS="$@"
+if [ -z "$GAPS" ]; then
+    GAPS="10 20 30 40 50"
+fi
+
+WORKDIR=$(dirname "$INIFILE")
+TMPDIR=$(mktemp -d)
+trap "rm -rf $TMPDIR" EXIT
+
+# runs an i-ADHoRe binary on an inifile, prints the wall time in ms
+run_timed()
+{
+    local start end
+    start=$(date +%s%N)
+    (cd "$WORKDIR" && "$1" "$2" > "$3" 2>&1) || { echo "FAILED"; return; }
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 ))
+}
+
+if [ -n "$BASELINE" ]; then
+    printf "%8s %12s %12s %8s\n" "gap" "time (ms)" "base (ms)" "speedup"
+else
+    printf "%8s %12s\n" "gap" "time (ms)"
+fi
+
+for GAP in $GAPS; do
+    INI=$TMPDIR/cloud_$GAP.ini
+    grep -v -E "^(cluster_type|cloud_gap_size|cloud_cluster_gap|output_path)" \
+        "$INIFILE" > "$INI"
+    echo "cluster_type=cloud" >> "$INI"
+    echo "cloud_gap_size=$GAP" >> "$INI"
+    echo "cloud_cluster_gap=$(( GAP + 5 ))" >> "$INI"
+    echo "output_path=$TMPDIR/out_$GAP/" >> "$INI"
+
+    T=$(run_timed "$BINARY" "$INI" "$TMPDIR/log_$GAP.txt")
+    if [ -n "$BASELINE" ]; then
+        sed -i "s|^output_path=.*|output_path=$TMPDIR/base_$GAP/|" "$INI"
+        B=$(run_timed "$BASELINE" "$INI" "$TMPDIR/base_log_$GAP.txt")
+        S=$(awk -v t="$T" -v b="$B" 'BEGIN { if (t > 0) printf "%.2f", b / t; else print "-" }')
+        printf "%8s %12s %12s %8s\n" "$GAP" "$T" "$B" "$S"
+    else
+        printf "%8s %12s\n" "$GAP" "$T"
+    fi
+done
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+#include "../src/BaseCluster.h"
+
+using namespace std;
+
+/*
+ * Reference squared Pearson value, computed directly from the coordinates
+ */
+static double referenceRSquared(const vector<pair<int, int> >& points)
+{
+	double sum_x = 0, sum_y = 0, sum_xy = 0, sum_x2 = 0, sum_y2 = 0;
+	unsigned int n = 0;
+
+	for (size_t i = 0; i < points.size(); i++) {
+		int x = points[i].first;
+		int y = points[i].second;
+		sum_x += x;
+		sum_y += y;
+		sum_xy += x*y;
+		sum_x2 += x*x;
+		sum_y2 += y*y;
+		n++;
+	}
+
+	double value = ((sum_x2 - sum_x * sum_x / n) * (sum_y2 - sum_y * sum_y / n));
+	if (value == 0)
+		return -1;
+	double r = (sum_xy - (sum_x * sum_y / n)) / sqrt(value);
+	return r * r;
+}
+
+class BaseClusterTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp();
+
+	vector<pair<int, int> > pointsA, pointsB;
+};
+
+void BaseClusterTest::SetUp()
+{
+	int a[][2] = {{3, 4}, {5, 7}, {6, 6}, {9, 11}, {12, 13}, {14, 17}};
+	int b[][2] = {{20, 22}, {23, 24}, {25, 29}, {27, 28}};
+
+	for (int i = 0; i < 6; i++)
+		pointsA.push_back(make_pair(a[i][0], a[i][1]));
+	for (int i = 0; i < 4; i++)
+		pointsB.push_back(make_pair(b[i][0], b[i][1]));
+}
+
+TEST_F(BaseClusterTest, RSquaredTest) {
+	BaseCluster cA(true), cB(true);
+	for (size_t i = 0; i < pointsA.size(); i++)
+		cA.addAnchorPoint(pointsA[i].first, pointsA[i].second);
+	for (size_t i = 0; i < pointsB.size(); i++)
+		cB.addAnchorPoint(pointsB[i].first, pointsB[i].second);
+
+	EXPECT_EQ(referenceRSquared(pointsA), cA.r_squared());
+
+	// hypothetical point
+	vector<pair<int, int> > points(pointsA);
+	points.push_back(make_pair(16, 18));
+	EXPECT_EQ(referenceRSquared(points), cA.r_squared(16, 18));
+
+	// hypothetical merge
+	points = pointsA;
+	points.insert(points.end(), pointsB.begin(), pointsB.end());
+	EXPECT_EQ(referenceRSquared(points), cA.r_squared(cB));
+
+	// actual merge
+	cA.mergeWith(cB);
+	EXPECT_EQ(referenceRSquared(points), cA.r_squared());
+}
+
+TEST_F(BaseClusterTest, IntervalTest) {
+	BaseCluster c(true);
+	for (size_t i = 0; i < pointsA.size(); i++)
+		c.addAnchorPoint(pointsA[i].first, pointsA[i].second);
+
+	// reference regression and prediction interval
+	double n = pointsA.size();
+	double sx = 0, sy = 0, sxy = 0, sx2 = 0;
+	for (size_t i = 0; i < pointsA.size(); i++) {
+		sx += pointsA[i].first;
+		sy += pointsA[i].second;
+		sxy += pointsA[i].first * pointsA[i].second;
+		sx2 += pointsA[i].first * pointsA[i].first;
+	}
+	double avgX = sx / n, avgY = sy / n;
+	double b = (sxy - n*avgX*avgY) / (sx2 - n*avgX*avgX);
+	double a = avgY - b * avgX;
+
+	double mrss = 0, varX = 0;
+	for (size_t i = 0; i < pointsA.size(); i++) {
+		double res = pointsA[i].second - (b * pointsA[i].first + a);
+		mrss += res * res;
+		varX += (pointsA[i].first - avgX) * (pointsA[i].first - avgX);
+	}
+	mrss /= n - 2;
+	varX /= n - 1;
+
+	double up, down;
+	c.intervalBounds(10, up, down);
+	double pred = 1.96 * sqrt(mrss) *
+		      sqrt(1.0 + 1.0/n + (10 - avgX)*(10 - avgX)/(n-1)/varX);
+	EXPECT_NEAR(a + b * 10 + pred, up, 1e-9);
+	EXPECT_NEAR(a + b * 10 - pred, down, 1e-9);
+
+	EXPECT_DOUBLE_EQ(3 * b + a, c.getYEnd1());
+	EXPECT_DOUBLE_EQ(14 * b + a, c.getYEnd2());
+
+	// adding a point invalidates the interval
+	c.addAnchorPoint(30, 2);
+	double up2, down2;
+	c.intervalBounds(10, up2, down2);
+	EXPECT_GT(up2 - down2, up - down);
+}
+
+TEST_F(BaseClusterTest, StorageTest) {
+	BaseCluster cA(true), cB(true);
+	cA.addAnchorPoint(5, 1);
+	cA.addAnchorPoint(2, 8);
+	cA.addAnchorPoint(5, 3);
+	cB.addAnchorPoint(5, 2);
+	cB.addAnchorPoint(1, 9);
+
+	// sorted on x, points with equal x in order of insertion
+	cA.mergeWith(cB);
+	int expX[] = {1, 2, 5, 5, 5};
+	int expY[] = {9, 8, 1, 3, 2};
+
+	int i = 0;
+	vector<AnchorPoint>::const_iterator e = cA.getAPBegin();
+	for ( ; e != cA.getAPEnd(); e++, i++) {
+		EXPECT_EQ(expX[i], e->getX());
+		EXPECT_EQ(expY[i], e->getY());
+	}
+	EXPECT_EQ(5, i);
+
+	EXPECT_EQ(1u, cA.getLowestX());
+	EXPECT_EQ(5u, cA.getHighestX());
+	EXPECT_EQ(1u, cA.getLowestY());
+	EXPECT_EQ(9u, cA.getHighestY());
+
+	// mirroring the y-values keeps the order
+	cA.twistCluster();
+	int twistY[] = {1, 2, 9, 7, 8};
+	i = 0;
+	for (e = cA.getAPBegin(); e != cA.getAPEnd(); e++, i++)
+		EXPECT_EQ(twistY[i], e->getY());
+
+	// duplicates are removed and points are sorted on (x, y)
+	cA.addAnchorPoint(2, 2);
+	cA.filterDuplicates();
+	int uniqY[] = {1, 2, 7, 8, 9};
+	i = 0;
+	for (e = cA.getAPBegin(); e != cA.getAPEnd(); e++, i++)
+		EXPECT_EQ(uniqY[i], e->getY());
+	EXPECT_EQ(5, i);
+}
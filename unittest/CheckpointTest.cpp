@@ -0,0 +1,299 @@
+#include <gtest/gtest.h>
+#include "../src/Settings.h"
+#include "../src/DataSet.h"
+#include "../src/GeneList.h"
+#include "../src/ListElement.h"
+#include "../src/Multiplicon.h"
+#include "../src/BaseCluster.h"
+#include "../src/AnchorPoint.h"
+
+using namespace std;
+
+class CheckpointTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp();
+
+	virtual void TearDown();
+
+	const vector<GeneList*>& getGeneLists(const DataSet& dataset) {
+		return dataset.genelists;
+	}
+
+	deque<Multiplicon*>& getQueue(DataSet& dataset) {
+		return dataset.multiplicons_to_evaluate;
+	}
+
+	// level-2 multiplicon of the first n genes of both lists
+	Multiplicon* createMultiplicon(DataSet& dataset, int n) {
+		GeneList &lX = *dataset.genelists[0];
+		GeneList &lY = *dataset.genelists[1];
+
+		BaseCluster *cluster = new BaseCluster(true);
+		for (int i = 0; i < n; i++) {
+			AnchorPoint ap(lX.getLe(i).getNumID(),
+				       lY.getLe(i).getNumID(), i, i, true);
+			cluster->addAnchorPoint(ap);
+		}
+		cluster->setBounds();
+
+		Multiplicon *multiplicon = new Multiplicon(0, 1, 2);
+		multiplicon->addBaseCluster(*cluster);
+		multiplicon->setBounds();
+		multiplicon->extractXObject(lX);
+		multiplicon->extractYObject(lY);
+		multiplicon->createHomologs(false, 0);
+		return multiplicon;
+	}
+
+	void setCounters(DataSet& dataset, uint profileID, uint multipliconID) {
+		dataset.profileID = profileID;
+		dataset.multipliconID = multipliconID;
+		dataset.baseclusterID = dataset.anchorpointID = dataset.pairID = 1;
+		dataset.segmentID = dataset.elementID = dataset.cloudID = 1;
+	}
+
+	uint getMultipliconID(const DataSet& dataset) {
+		return dataset.multipliconID;
+	}
+
+	uint getProfileID(const DataSet& dataset) {
+		return dataset.profileID;
+	}
+
+	void writeCheckpoint(const DataSet& dataset) {
+		dataset.writeCheckpoint();
+	}
+};
+
+void CheckpointTest::SetUp()
+{
+	// two collinear lists, the second one with an insertion
+	ofstream lst1("ckpttest_1.lst");
+	ofstream lst2("ckpttest_2.lst");
+	ofstream blast("ckpttest.blast");
+	for (int i = 0; i < 12; i++) {
+		lst1 << "a" << i << "+\n";
+		lst2 << "b" << i << ((i % 3 == 0) ? "-\n" : "+\n");
+		if (i == 5)
+			lst2 << "x1+\n";
+		blast << "a" << i << "\tb" << i << "\n";
+	}
+	lst1.close();
+	lst2.close();
+	blast.close();
+
+	ofstream ini("ckpttest.ini");
+	ini << "genome= A\n1 ckpttest_1.lst\n"
+	    << "genome= B\n1 ckpttest_2.lst\n"
+	    << "blast_table= ckpttest.blast\n"
+	    << "output_path= ckpttest_out/\n"
+	    << "checkpoint_file= ckpttest.ckpt\n"
+	    << "resume_from= ckpttest.ckpt\n"
+	    << "gap_size= 10\ncluster_gap= 10\ntandem_gap= 5\n"
+	    << "q_value=0.75\nprob_cutoff=0.01\nanchor_points=3\n";
+	ini.close();
+}
+
+void CheckpointTest::TearDown()
+{
+	remove("ckpttest_1.lst");
+	remove("ckpttest_2.lst");
+	remove("ckpttest.blast");
+	remove("ckpttest.ini");
+	remove("ckpttest.ckpt");
+}
+
+TEST_F(CheckpointTest, RoundTripTest) {
+	Settings settings("ckpttest.ini");
+
+	DataSet original(settings);
+	original.mapGenes();
+	original.remapTandems();
+	original.sortGeneLists();
+
+	deque<Multiplicon*>& queueO = getQueue(original);
+	queueO.push_back(createMultiplicon(original, 5));
+	queueO.push_back(createMultiplicon(original, 4));
+	queueO.front()->setParentID(7);
+
+	// segments with gaps and inverted elements
+	queueO.back()->getXSegments()[0]->introduceGap(1);
+	queueO.back()->getYSegment()->invertSection(0, 2);
+
+	// mask part of both gene lists
+	getGeneLists(original)[0]->mask(2, 4);
+	getGeneLists(original)[0]->mask(8, 8);
+	getGeneLists(original)[1]->mask(0, 3);
+
+	setCounters(original, 11, 5);
+	writeCheckpoint(original);
+
+	DataSet restored(settings);
+	restored.mapGenes();
+	restored.remapTandems();
+	restored.sortGeneLists();
+	restored.readCheckpoint();
+
+	EXPECT_EQ(11u, getProfileID(restored));
+	EXPECT_EQ(5u, getMultipliconID(restored));
+
+	const vector<GeneList*>& listsO = getGeneLists(original);
+	const vector<GeneList*>& listsR = getGeneLists(restored);
+	for (size_t l = 0; l < listsO.size(); l++) {
+		EXPECT_EQ(listsO[l]->getMaskVersion(), listsR[l]->getMaskVersion());
+		for (unsigned int i = 0; i < listsO[l]->getSize(); i++)
+			EXPECT_EQ(listsO[l]->getLe(i).isMasked(),
+				  listsR[l]->getLe(i).isMasked());
+	}
+
+	deque<Multiplicon*>& queueR = getQueue(restored);
+	ASSERT_EQ(queueO.size(), queueR.size());
+	for (size_t m = 0; m < queueO.size(); m++) {
+		const Multiplicon &mO = *queueO[m];
+		const Multiplicon &mR = *queueR[m];
+		EXPECT_TRUE(mO == mR);
+		EXPECT_EQ(mO.getParentID(), mR.getParentID());
+
+		vector<GeneList*> segO = mO.getXSegments();
+		vector<GeneList*> segR = mR.getXSegments();
+		segO.push_back(mO.getYSegment());
+		segR.push_back(mR.getYSegment());
+		ASSERT_EQ(segO.size(), segR.size());
+		for (size_t s = 0; s < segO.size(); s++) {
+			EXPECT_EQ(segO[s]->getID(), segR[s]->getID());
+			EXPECT_EQ(segO[s]->getListName(), segR[s]->getListName());
+			ASSERT_EQ(segO[s]->getSize(), segR[s]->getSize());
+			for (unsigned int i = 0; i < segO[s]->getSize(); i++) {
+				const ListElement &eO = segO[s]->getLe(i);
+				const ListElement &eR = segR[s]->getLe(i);
+				EXPECT_EQ(eO.isGap(), eR.isGap());
+				EXPECT_EQ(eO.getNumID(), eR.getNumID());
+				EXPECT_EQ(eO.getOrientation(), eR.getOrientation());
+				EXPECT_EQ(eO.isMasked(), eR.isMasked());
+				EXPECT_EQ(eO.hasHomolog, eR.hasHomolog);
+				EXPECT_EQ(eO.hasAP, eR.hasAP);
+				if (!eO.isGap())
+					EXPECT_EQ(eO.getGene().getID(),
+						  eR.getGene().getID());
+			}
+		}
+
+		ASSERT_EQ(mO.getHomologs().size(), mR.getHomologs().size());
+		set<Link>::const_iterator hO = mO.getHomBegin();
+		set<Link>::const_iterator hR = mR.getHomBegin();
+		for ( ; hO != mO.getHomEnd(); hO++, hR++) {
+			EXPECT_FALSE(*hO < *hR || *hR < *hO);
+			EXPECT_EQ(hO->isAP, hR->isAP);
+		}
+	}
+
+	for (size_t m = 0; m < queueO.size(); m++) {
+		delete queueO[m];
+		delete queueR[m];
+	}
+	queueO.clear();
+	queueR.clear();
+
+	// the checkpoint belongs to this dataset only
+	ofstream blast("ckpttest.blast", ios::app);
+	blast << "a0\tb1\n";
+	blast.close();
+
+	Settings changed("ckpttest.ini");
+	DataSet other(changed);
+	other.mapGenes();
+	other.remapTandems();
+	EXPECT_THROW(other.readCheckpoint(), FileException);
+}
+
+TEST_F(CheckpointTest, CorruptTest) {
+	Settings settings("ckpttest.ini");
+
+	DataSet original(settings);
+	original.mapGenes();
+	original.remapTandems();
+	original.sortGeneLists();
+	getQueue(original).push_back(createMultiplicon(original, 5));
+	getGeneLists(original)[0]->mask(2, 4);
+	setCounters(original, 11, 5);
+	writeCheckpoint(original);
+	delete getQueue(original).front();
+	getQueue(original).clear();
+
+	ifstream ifs("ckpttest.ckpt", ios::binary);
+	const string intact((istreambuf_iterator<char>(ifs)),
+			    istreambuf_iterator<char>());
+	ifs.close();
+
+	// every damaged byte after the checkpoint header (32 chars) must
+	// either be harmless or be reported, never read out of bounds
+	streambuf *coutBuf = cout.rdbuf(NULL);
+	int rejected = 0;
+	for (size_t pos = 32; pos <= intact.size(); pos++) {
+		string damaged = intact;
+		if (pos < intact.size())
+			damaged[pos] ^= 0x5A;
+		else
+			damaged.resize(intact.size() - 3);
+
+		ofstream ofs("ckpttest.ckpt", ios::binary);
+		ofs.write(damaged.data(), damaged.size());
+		ofs.close();
+
+		DataSet restored(settings);
+		restored.mapGenes();
+		restored.remapTandems();
+		restored.sortGeneLists();
+		try {
+			restored.readCheckpoint();
+		} catch (const FileException&) {
+			rejected++;
+		}
+
+		deque<Multiplicon*>& queue = getQueue(restored);
+		for (size_t m = 0; m < queue.size(); m++)
+			delete queue[m];
+		queue.clear();
+	}
+	cout.rdbuf(coutBuf);
+	cout.clear();
+
+	// at least the truncated checkpoint is rejected
+	EXPECT_GT(rejected, 0);
+}
+
+TEST_F(CheckpointTest, SettingsTest) {
+	Settings settings("ckpttest.ini");
+
+	DataSet original(settings);
+	original.mapGenes();
+	original.remapTandems();
+	original.sortGeneLists();
+	setCounters(original, 11, 5);
+	writeCheckpoint(original);
+
+	// the number of threads does not change the results
+	ofstream threads("ckpttest.ini", ios::app);
+	threads << "number_of_threads=2\n";
+	threads.close();
+
+	Settings sameResults("ckpttest.ini");
+	DataSet resumed(sameResults);
+	resumed.mapGenes();
+	resumed.remapTandems();
+	resumed.sortGeneLists();
+	EXPECT_NO_THROW(resumed.readCheckpoint());
+
+	// a different q-value does
+	ofstream qValue("ckpttest.ini", ios::app);
+	qValue << "q_value=0.95\n";
+	qValue.close();
+
+	Settings changed("ckpttest.ini");
+	DataSet other(changed);
+	other.mapGenes();
+	other.remapTandems();
+	other.sortGeneLists();
+	EXPECT_THROW(other.readCheckpoint(), FileException);
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "../src/SynthenicCloud.h"
+#include "../src/CloudGrid.h"
+
+using namespace std;
+
+class CloudGridTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp();
+	virtual void TearDown();
+
+	vector<SynthenicCloud*> clouds;
+};
+
+void CloudGridTest::SetUp()
+{
+	int boxes[][4] = {{10, 14, 10, 13},	// 0
+			  {17, 20, 12, 16},	// 1: 3 apart from 0
+			  {12, 13, 30, 35},	// 2: far above 0
+			  {60, 70, 60, 70},	// 3: far away
+			  {13, 25, 11, 12}};	// 4: overlaps 0 and 1
+
+	for (int i = 0; i < 5; i++) {
+		clouds.push_back(new SynthenicCloud());
+		clouds.back()->addAnchorPoint(boxes[i][0], boxes[i][2]);
+		clouds.back()->addAnchorPoint(boxes[i][1], boxes[i][3]);
+	}
+}
+
+void CloudGridTest::TearDown()
+{
+	for (size_t i = 0; i < clouds.size(); i++)
+		delete clouds[i];
+}
+
+TEST_F(CloudGridTest, CandidateTest) {
+	CloudGrid grid(clouds, 4);
+
+	vector<int> candidates;
+	grid.getCandidates(0, candidates);
+	ASSERT_EQ(2u, candidates.size());
+	EXPECT_EQ(1, candidates[0]);
+	EXPECT_EQ(4, candidates[1]);
+
+	grid.getCandidates(3, candidates);
+	EXPECT_TRUE(candidates.empty());
+
+	// a smaller range excludes the cloud 3 apart
+	CloudGrid narrow(clouds, 3);
+	narrow.getCandidates(0, candidates);
+	ASSERT_EQ(1u, candidates.size());
+	EXPECT_EQ(4, candidates[0]);
+}
+
+TEST_F(CloudGridTest, MergeTest) {
+	CloudGrid grid(clouds, 4);
+
+	// grow cloud 0 towards cloud 2 and absorb cloud 4
+	clouds[0]->addAnchorPoint(12, 28);
+	clouds[0]->addAnchorPoint(25, 12);
+	grid.merge(0, 4);
+	EXPECT_EQ(0, grid.find(4));
+
+	vector<int> candidates;
+	grid.getCandidates(0, candidates);
+	ASSERT_EQ(2u, candidates.size());
+	EXPECT_EQ(1, candidates[0]);
+	EXPECT_EQ(2, candidates[1]);
+
+	// the absorbed cloud is reported as the absorbing one
+	grid.getCandidates(1, candidates);
+	ASSERT_EQ(1u, candidates.size());
+	EXPECT_EQ(0, candidates[0]);
+}
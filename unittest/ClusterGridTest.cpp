@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <algorithm>
+#include "../src/BaseCluster.h"
+#include "../src/ClusterGrid.h"
+
+using namespace std;
+
+class ClusterGridTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp();
+	virtual void TearDown();
+
+	vector<BaseCluster*> clusters;
+};
+
+void ClusterGridTest::SetUp()
+{
+	// a diagonal, an anti-diagonal and a noisy cluster
+	int diag[][2] = {{10, 10}, {12, 13}, {15, 15}, {18, 19}, {20, 20}};
+	int anti[][2] = {{40, 60}, {43, 58}, {45, 55}, {48, 51}};
+	int noisy[][2] = {{70, 20}, {72, 28}, {75, 22}, {79, 30}, {80, 25}};
+
+	clusters.push_back(new BaseCluster(true));
+	for (int i = 0; i < 5; i++)
+		clusters.back()->addAnchorPoint(diag[i][0], diag[i][1]);
+	clusters.push_back(new BaseCluster(false));
+	for (int i = 0; i < 4; i++)
+		clusters.back()->addAnchorPoint(anti[i][0], anti[i][1]);
+	clusters.push_back(new BaseCluster(true));
+	for (int i = 0; i < 5; i++)
+		clusters.back()->addAnchorPoint(noisy[i][0], noisy[i][1]);
+}
+
+void ClusterGridTest::TearDown()
+{
+	for (size_t i = 0; i < clusters.size(); i++)
+		delete clusters[i];
+}
+
+TEST_F(ClusterGridTest, CandidateTest) {
+	int gap = 7;
+	ClusterGrid grid(gap, gap);
+	for (size_t i = 0; i < clusters.size(); i++)
+		grid.insert(i, *clusters[i]);
+
+	// every cluster that can accept a point must be a candidate
+	vector<int> candidates;
+	for (int x = 0; x < 100; x++) {
+		for (int y = 0; y < 100; y++) {
+			grid.getCandidates(x, y, candidates);
+			EXPECT_TRUE(is_sorted(candidates.begin(), candidates.end()));
+
+			for (size_t i = 0; i < clusters.size(); i++) {
+				if (clusters[i]->distanceToPoint(x, y) >= gap + 1)
+					continue;
+				if (!clusters[i]->inInterval(x, y))
+					continue;
+				EXPECT_TRUE(binary_search(candidates.begin(),
+					    candidates.end(), (int)i));
+			}
+		}
+	}
+
+	// far away points have no candidates
+	grid.getCandidates(200, 200, candidates);
+	EXPECT_TRUE(candidates.empty());
+	grid.getCandidates(15, 90, candidates);
+	EXPECT_TRUE(candidates.empty());
+}
+
+TEST_F(ClusterGridTest, UpdateTest) {
+	int gap = 5;
+	ClusterGrid grid(gap, gap);
+	for (size_t i = 0; i < clusters.size(); i++)
+		grid.insert(i, *clusters[i]);
+
+	vector<int> candidates;
+	grid.getCandidates(30, 30, candidates);
+	EXPECT_TRUE(candidates.empty());
+
+	// extend the diagonal cluster
+	clusters[0]->addAnchorPoint(25, 25);
+	clusters[0]->addAnchorPoint(28, 27);
+	grid.update(0, *clusters[0]);
+
+	grid.getCandidates(30, 30, candidates);
+	ASSERT_EQ(1u, candidates.size());
+	EXPECT_EQ(0, candidates[0]);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include "../src/CostModel.h"
+
+using namespace std;
+
+static double modelTime(uint64_t sizeX, uint64_t sizeY, uint64_t points)
+{
+	return 1e-4 + 1e-7 * (sizeX + sizeY) + 2e-6 * points +
+	       3e-3 * (double)points * points / ((double)sizeX * sizeY);
+}
+
+TEST(CostModelTest, FitTest) {
+	CostModel model;
+
+	// too few measurements
+	model.addObservation(100, 200, 50, modelTime(100, 200, 50));
+	EXPECT_FALSE(model.fit());
+
+	for (int i = 1; i < 40; i++) {
+		uint64_t sX = 100 * i, sY = 50 * (41 - i), p = (i * 37) % 400;
+		model.addObservation(sX, sY, p, modelTime(sX, sY, p));
+	}
+	ASSERT_TRUE(model.fit());
+
+	EXPECT_NEAR(1e-4, model.getCoefficient(0), 1e-9);
+	EXPECT_NEAR(1e-7, model.getCoefficient(1), 1e-12);
+	EXPECT_NEAR(2e-6, model.getCoefficient(2), 1e-11);
+	EXPECT_NEAR(3e-3, model.getCoefficient(3), 1e-8);
+	EXPECT_NEAR(modelTime(1000, 1000, 300), model.predict(1000, 1000, 300), 1e-9);
+}
+
+TEST(CostModelTest, NonNegativeTest) {
+	CostModel model;
+
+	// time decreases with the list lengths, that coefficient is dropped
+	for (int i = 1; i <= 20; i++) {
+		uint64_t sX = 100 + 7 * i, sY = 300 - 5 * i, p = (i * 13) % 50;
+		model.addObservation(sX, sY, p, 1e-3 * p - 1e-6 * (sX + sY) + 1e-3);
+	}
+	ASSERT_TRUE(model.fit());
+	EXPECT_EQ(0.0, model.getCoefficient(1));
+
+	// degenerate data, all lists have the same length
+	for (int i = 1; i <= 20; i++)
+		model.addObservation(100, 100, i, 1e-3 * i);
+	EXPECT_TRUE(model.fit());
+
+	for (int i = 0; i < CostModel::NUM_FEATURES; i++)
+		EXPECT_GE(model.getCoefficient(i), 0.0);
+}
+
+TEST(CostModelTest, FileTest) {
+	CostModel model;
+	for (int i = 1; i < 40; i++)
+		model.addObservation(10 * i, 20 * i, 3 * i, 1e-3 * i);
+	model.fit();
+	model.save("costmodel_test.txt");
+
+	CostModel loaded;
+	ASSERT_TRUE(loaded.load("costmodel_test.txt"));
+	EXPECT_EQ(model.getNumObservations(), loaded.getNumObservations());
+	for (int i = 0; i < CostModel::NUM_FEATURES; i++)
+		EXPECT_NEAR(model.getCoefficient(i), loaded.getCoefficient(i),
+			    1e-7 * model.getCoefficient(i) + 1e-15);
+	remove("costmodel_test.txt");
+
+	EXPECT_FALSE(loaded.load("costmodel_test.txt"));
+}
+
+TEST(CostModelTest, SampleTest) {
+	CostModel model;
+
+	// empty GHMs are ignored
+	for (int i = 0; i < 100; i++)
+		model.addObservation(100, 100, 0, 1e-4);
+	EXPECT_EQ(0u, model.getNumObservations());
+
+	// a flood of small GHMs does not push out the few large ones
+	for (int i = 1; i <= 20; i++)
+		model.addObservation(1000, 1000, 10000 + 1000 * i,
+				     modelTime(1000, 1000, 10000 + 1000 * i));
+	for (int i = 0; i < 50000; i++)
+		model.addObservation(100 + i % 900, 200, 1 + i % 3,
+				     modelTime(100 + i % 900, 200, 1 + i % 3));
+	size_t maxObs = CostModel::MAX_OBSERVATIONS;
+	EXPECT_GE(maxObs, model.getNumObservations());
+
+	ASSERT_TRUE(model.fit());
+	EXPECT_NEAR(2e-6, model.getCoefficient(2), 1e-9);
+	EXPECT_NEAR(modelTime(1000, 1000, 20000),
+		    model.predict(1000, 1000, 20000), 1e-6);
+}
+
+TEST(CostModelTest, CollapseTest) {
+	CostModel model;
+	double defaults[CostModel::NUM_FEATURES];
+	for (int i = 0; i < CostModel::NUM_FEATURES; i++)
+		defaults[i] = model.getCoefficient(i);
+
+	// the time does not grow with the number of points
+	for (int i = 1; i <= 40; i++)
+		model.addObservation(1000, 1000, i, 2e-3 - 1e-5 * i);
+	EXPECT_FALSE(model.fit());
+	for (int i = 0; i < CostModel::NUM_FEATURES; i++)
+		EXPECT_EQ(defaults[i], model.getCoefficient(i));
+
+	// neither are such coefficients adopted from a file
+	FILE *f = fopen("costmodel_test.txt", "w");
+	fprintf(f, "coefficients 8.7e-06 0 0 0\n1000 1000 5 0.001\n");
+	fclose(f);
+
+	CostModel loaded;
+	ASSERT_TRUE(loaded.load("costmodel_test.txt"));
+	EXPECT_EQ(1u, loaded.getNumObservations());
+	for (int i = 0; i < CostModel::NUM_FEATURES; i++)
+		EXPECT_EQ(defaults[i], loaded.getCoefficient(i));
+	remove("costmodel_test.txt");
+}
@@ -0,0 +1,361 @@
+#include <gtest/gtest.h>
+#include "../src/Settings.h"
+#include "../src/DataSet.h"
+#include "../src/GeneList.h"
+#include "../src/ListElement.h"
+#include "../src/Gene.h"
+#include "../src/Multiplicon.h"
+#include "../src/SynthenicCloud.h"
+#include "../src/BaseCluster.h"
+#include "../src/AnchorPoint.h"
+
+#include <unistd.h>
+#include <dirent.h>
+
+using namespace std;
+
+class DataSetCacheTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp();
+
+	virtual void TearDown();
+
+	const vector<GeneList*>& getGeneLists(const DataSet& dataset) {
+		return dataset.genelists;
+	}
+
+	bool isCached(const DataSet& dataset) {
+		return dataset.cacheFile != NULL;
+	}
+
+	string getCacheFileName(const DataSet& dataset) {
+		return dataset.getCacheFileName();
+	}
+
+	// runs the level-2 search of the first gene list against list y
+	bool runLevel2(DataSet& dataset, vector<Multiplicon*>& mplicons,
+		       uint y = 1) {
+		dataset.level2Tasks.assign(1, pair<uint, uint>(0, y));
+		dataset.level2Split.assign(1, false);
+		dataset.level2Times.assign(1, -1.0);
+		dataset.level2Cached.assign(1, 0);
+		dataset.prepareLevel2Cache();
+
+		vector<SynthenicCloud*> clouds;
+		dataset.level2ADHoRe(0, 1, 0, mplicons, clouds);
+		dataset.writeLevel2Cache();
+		return dataset.level2Cached[0] != 0;
+	}
+
+	bool loadLevel2(DataSet& dataset, vector<Multiplicon*>& mplicons,
+			vector<SynthenicCloud*>& clouds) {
+		dataset.prepareLevel2Cache();
+		bool loaded = dataset.loadLevel2Result(0, dataset.getLevel2Key(0),
+						       mplicons, clouds);
+		dataset.releaseLevel2Files();
+		return loaded;
+	}
+
+	// names of the files in the level-2 cache
+	vector<string> getLevel2Files(const DataSet& dataset) {
+		const string& dir = dataset.settings.getLevel2Cache();
+		vector<string> files;
+		DIR *d = opendir(dir.c_str());
+		if (d == NULL)
+			return files;
+		for (struct dirent *e = readdir(d); e != NULL; e = readdir(d))
+			if (e->d_name[0] != '.')
+				files.push_back(dir + e->d_name);
+		closedir(d);
+		return files;
+	}
+
+	// two collinear lists, the second one with an insertion
+	void writeLevel2Input() {
+		ofstream lst1("l2test_1.lst");
+		ofstream lst2("l2test_2.lst");
+		ofstream blast("l2test.blast");
+		for (int i = 0; i < 12; i++) {
+			lst1 << "a" << i << "+\n";
+			lst2 << "b" << i << "+\n";
+			if (i == 5)
+				lst2 << "x1+\n";
+			blast << "a" << i << "\tb" << i << "\n";
+		}
+		lst1.close();
+		lst2.close();
+		blast.close();
+
+		const char *params[] = {"gap_size= 10\n", "gap_size= 8\n"};
+		for (int i = 0; i < 2; i++) {
+			ofstream ini(i == 0 ? "l2test.ini" : "l2test_gap.ini");
+			ini << "genome= A\n1 l2test_1.lst\n"
+			    << "genome= B\n1 l2test_2.lst\n"
+			    << "blast_table= l2test.blast\n"
+			    << "output_path= l2test_out/\n"
+			    << "level2_cache= l2test_cache\n" << params[i]
+			    << "cluster_gap= 10\ntandem_gap= 5\n"
+			    << "q_value=0.75\nprob_cutoff=0.01\nanchor_points=3\n";
+			ini.close();
+		}
+	}
+};
+
+void DataSetCacheTest::SetUp()
+{
+	ofstream lst1("cachetest_1.lst");
+	lst1 << "a1+\na2+\na3-\na4+\na5-\n";
+	lst1.close();
+
+	ofstream lst2("cachetest_2.lst");
+	lst2 << "b1+\nb2-\nb3+\n";
+	lst2.close();
+
+	// a1 and a2 form a tandem
+	ofstream blast("cachetest.blast");
+	blast << "a1\ta2\na1\tb1\na2\tb1\na3\tb2\na5\tb3\nb3\tx9\n";
+	blast.close();
+
+	ofstream ini("cachetest.ini");
+	ini << "genome= A\n1 cachetest_1.lst\n"
+	    << "genome= B\n1 cachetest_2.lst\n"
+	    << "blast_table= cachetest.blast\n"
+	    << "output_path= cachetest_out/\n"
+	    << "dataset_cache= cachetest_cache\n"
+	    << "gap_size= 10\ncluster_gap= 10\ntandem_gap= 5\n"
+	    << "q_value=0.75\nprob_cutoff=0.01\nanchor_points=3\n";
+	ini.close();
+}
+
+void DataSetCacheTest::TearDown()
+{
+	remove("cachetest_1.lst");
+	remove("cachetest_2.lst");
+	remove("cachetest.blast");
+	remove("cachetest.ini");
+	if (system("rm -rf cachetest_cache") == -1)
+		cerr << "Cannot remove cachetest_cache" << endl;
+
+	remove("l2test_1.lst");
+	remove("l2test_2.lst");
+	remove("l2test.blast");
+	remove("l2test.ini");
+	if (system("rm -rf l2test_cache") == -1)
+		cerr << "Cannot remove l2test_cache" << endl;
+}
+
+TEST_F(DataSetCacheTest, RoundTripTest) {
+	Settings settings("cachetest.ini");
+
+	DataSet parsed(settings);
+	EXPECT_FALSE(isCached(parsed));
+	parsed.mapGenes();
+	parsed.remapTandems();
+
+	DataSet cached(settings);
+	EXPECT_TRUE(isCached(cached));
+	cached.mapGenes();
+	cached.remapTandems();
+
+	const vector<GeneList*>& listsP = getGeneLists(parsed);
+	const vector<GeneList*>& listsC = getGeneLists(cached);
+	ASSERT_EQ(listsP.size(), listsC.size());
+
+	for (size_t l = 0; l < listsP.size(); l++) {
+		EXPECT_EQ(listsP[l]->getListName(), listsC[l]->getListName());
+		EXPECT_EQ(listsP[l]->getGenomeName(), listsC[l]->getGenomeName());
+
+		const vector<ListElement*>& elP = listsP[l]->getElements();
+		const vector<ListElement*>& elC = listsC[l]->getElements();
+		ASSERT_EQ(elP.size(), elC.size());
+		for (size_t i = 0; i < elP.size(); i++) {
+			const Gene& gP = elP[i]->getGene();
+			const Gene& gC = elC[i]->getGene();
+			EXPECT_EQ(gP.getID(), gC.getID());
+			EXPECT_EQ(gP.getOrientation(), gC.getOrientation());
+			EXPECT_EQ(gP.getRemappedCoordinate(),
+				  gC.getRemappedCoordinate());
+			EXPECT_EQ(gP.isTandem(), gC.isTandem());
+			EXPECT_EQ(gP.isRemapped(), gC.isRemapped());
+			ASSERT_EQ(gP.getNumPairs(), gC.getNumPairs());
+			for (uint32_t p = 0; p < gP.getNumPairs(); p++)
+				EXPECT_EQ(gP.getPairs()[p], gC.getPairs()[p]);
+			if (gP.isTandem())
+				EXPECT_EQ(gP.tandemRepresentative().getID(),
+					  gC.tandemRepresentative().getID());
+		}
+
+		EXPECT_EQ(listsP[l]->getRemappedElements().size(),
+			  listsC[l]->getRemappedElements().size());
+	}
+
+	// a2 is remapped onto a1
+	const Gene& a2 = listsC[0]->getElements()[1]->getGene();
+	EXPECT_TRUE(a2.isRemapped());
+	EXPECT_EQ("a1", a2.tandemRepresentative().getID());
+}
+
+TEST_F(DataSetCacheTest, CorruptTest) {
+	Settings settings("cachetest.ini");
+
+	string fileName;
+	{
+		DataSet parsed(settings);
+		parsed.mapGenes();
+		parsed.remapTandems();
+		fileName = getCacheFileName(parsed);
+	}
+
+	// the last gene of the last list refers to a gene that does not exist
+	{
+		fstream fs(fileName.c_str(), ios::in | ios::out | ios::binary);
+		fs.seekp(-12, ios::end);
+		const char invalid[4] = {'\xff', '\xff', '\xff', '\xff'};
+		fs.write(invalid, sizeof(invalid));
+	}
+
+	DataSet corrupt(settings);
+	EXPECT_FALSE(isCached(corrupt));
+	corrupt.mapGenes();
+	corrupt.remapTandems();
+	ASSERT_EQ(2u, getGeneLists(corrupt).size());
+	EXPECT_EQ("b3", getGeneLists(corrupt)[1]->getElements()[2]->getGene().getID());
+
+	// the cache was rebuilt, a truncated one is rejected as well
+	ASSERT_EQ(0, truncate(fileName.c_str(), 200));
+	DataSet truncated(settings);
+	EXPECT_FALSE(isCached(truncated));
+}
+
+TEST_F(DataSetCacheTest, Level2Test) {
+	writeLevel2Input();
+
+	Settings settings("l2test.ini");
+
+	DataSet computed(settings);
+	computed.mapGenes();
+	computed.remapTandems();
+	vector<Multiplicon*> mpliconsC;
+	EXPECT_FALSE(runLevel2(computed, mpliconsC));
+	ASSERT_FALSE(mpliconsC.empty());
+	EXPECT_EQ(1u, getLevel2Files(computed).size());
+
+	DataSet cached(settings);
+	cached.mapGenes();
+	cached.remapTandems();
+	vector<Multiplicon*> mpliconsR;
+	EXPECT_TRUE(runLevel2(cached, mpliconsR));
+
+	// a run that computes nothing new writes no file
+	EXPECT_EQ(1u, getLevel2Files(cached).size());
+
+	ASSERT_EQ(mpliconsC.size(), mpliconsR.size());
+	for (size_t i = 0; i < mpliconsC.size(); i++) {
+		const Multiplicon &mC = *mpliconsC[i];
+		const Multiplicon &mR = *mpliconsR[i];
+		EXPECT_TRUE(mC == mR);
+		EXPECT_EQ(mC.getHomologs().size(), mR.getHomologs().size());
+		EXPECT_EQ(mC.getYSegment()->getSize(), mR.getYSegment()->getSize());
+
+		vector<AnchorPoint>::const_iterator a, b;
+		a = mC.getBaseClusters()[0]->getAPBegin();
+		b = mR.getBaseClusters()[0]->getAPBegin();
+		for ( ; a != mC.getBaseClusters()[0]->getAPEnd(); a++, b++) {
+			EXPECT_EQ(a->getGeneXID(), b->getGeneXID());
+			EXPECT_EQ(a->getGeneYID(), b->getGeneYID());
+		}
+	}
+
+	// another gap size needs another search
+	Settings changed("l2test_gap.ini");
+	DataSet other(changed);
+	other.mapGenes();
+	other.remapTandems();
+	vector<Multiplicon*> mpliconsO;
+	EXPECT_FALSE(runLevel2(other, mpliconsO));
+	EXPECT_EQ(2u, getLevel2Files(other).size());
+	remove("l2test_gap.ini");
+
+	// a list pair without homologs is cached without results
+	vector<Multiplicon*> mpliconsE;
+	EXPECT_FALSE(runLevel2(other, mpliconsE, 0));
+	EXPECT_TRUE(mpliconsE.empty());
+	EXPECT_EQ(3u, getLevel2Files(other).size());
+	EXPECT_TRUE(runLevel2(other, mpliconsE, 0));
+	EXPECT_TRUE(mpliconsE.empty());
+
+	for (size_t i = 0; i < mpliconsC.size(); i++) {
+		delete mpliconsC[i];
+		delete mpliconsR[i];
+	}
+	for (size_t i = 0; i < mpliconsO.size(); i++)
+		delete mpliconsO[i];
+}
+
+TEST_F(DataSetCacheTest, Level2CorruptTest) {
+	writeLevel2Input();
+	remove("l2test_gap.ini");
+
+	Settings settings("l2test.ini");
+	DataSet dataset(settings);
+	dataset.mapGenes();
+	dataset.remapTandems();
+	vector<Multiplicon*> mplicons;
+	EXPECT_FALSE(runLevel2(dataset, mplicons));
+	for (size_t i = 0; i < mplicons.size(); i++)
+		delete mplicons[i];
+
+	ASSERT_EQ(1u, getLevel2Files(dataset).size());
+	const string fileName = getLevel2Files(dataset)[0];
+	ifstream ifs(fileName.c_str(), ios::binary);
+	const string intact((istreambuf_iterator<char>(ifs)),
+			    istreambuf_iterator<char>());
+	ifs.close();
+	ASSERT_FALSE(intact.empty());
+
+	// every damaged byte must either be harmless or make us recompute the
+	// pair, never read out of bounds
+	streambuf *cerrBuf = cerr.rdbuf(NULL);
+	int rejected = 0;
+	for (size_t pos = 0; pos <= intact.size(); pos++) {
+		string damaged = intact;
+		if (pos < intact.size())
+			damaged[pos] ^= 0x5A;
+		else
+			damaged.push_back(0);
+
+		ofstream ofs(fileName.c_str(), ios::binary);
+		ofs.write(damaged.data(), damaged.size());
+		ofs.close();
+
+		vector<Multiplicon*> loaded;
+		vector<SynthenicCloud*> clouds;
+		if (loadLevel2(dataset, loaded, clouds)) {
+			EXPECT_FALSE(loaded.empty());
+		} else {
+			EXPECT_TRUE(loaded.empty() && clouds.empty());
+			rejected++;
+		}
+		for (size_t i = 0; i < loaded.size(); i++)
+			delete loaded[i];
+		for (size_t i = 0; i < clouds.size(); i++)
+			delete clouds[i];
+	}
+	cerr.rdbuf(cerrBuf);
+	cerr.clear();
+
+	// at least the entry with trailing data is rejected
+	EXPECT_GT(rejected, 0);
+
+	// the cache directory cannot be created below a regular file
+	ofstream ini("l2test.ini", ios::app);
+	ini << "level2_cache= l2test.blast/cache\n";
+	ini.close();
+	Settings blocked("l2test.ini");
+	DataSet other(blocked);
+	other.mapGenes();
+	other.remapTandems();
+	vector<Multiplicon*> mpliconsO;
+	EXPECT_THROW(runLevel2(other, mpliconsO), runtime_error);
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "../src/Settings.h"
+#include "../src/DataSet.h"
+#include "../src/GeneList.h"
+#include "../src/GHM.h"
+#include "../src/Multiplicon.h"
+#include "../src/SynthenicCloud.h"
+
+using namespace std;
+
+class GHMTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp();
+
+	virtual void TearDown();
+
+	// runs the GHM of both lists, split in bands if banded is true, the
+	// bands are processed in reverse order if reversed is true
+	void runGHM(const Settings& settings, DataSet& dataset, bool cloud,
+		    bool banded, bool reversed, vector<Multiplicon*>& mplicons,
+		    vector<SynthenicCloud*>& clouds) {
+		GHM ghm(*dataset.getGeneList("1", "A"),
+			*dataset.getGeneList("1", "B"), cloud);
+		ghm.buildMatrix(false);
+
+		if (banded) {
+			vector<GHM*> bands;
+			vector<int> boundaries;
+			ASSERT_TRUE(ghm.beginBanded(settings, bands, boundaries));
+			int numBands = GHM::NUM_BANDS;
+			EXPECT_EQ(numBands, (int)bands.size());
+			for (size_t i = 0; i < bands.size(); i++)
+				bands[reversed ? bands.size() - 1 - i : i]->runBand(settings);
+			ghm.finishBanded(settings, bands, boundaries);
+		} else {
+			ghm.run(settings);
+		}
+
+		if (cloud)
+			ghm.getClouds(clouds);
+		else
+			ghm.getMultiplicons(mplicons);
+	}
+};
+
+static bool beginXLess(const Multiplicon* lhs, const Multiplicon* rhs)
+{
+	return lhs->getBeginX() < rhs->getBeginX();
+}
+
+void GHMTest::SetUp()
+{
+	// collinear segments of 40 genes, alternately in the same and in the
+	// opposite orientation, separated by unrelated genes
+	ofstream lst1("ghmtest_1.lst");
+	ofstream lst2("ghmtest_2.lst");
+	ofstream blast("ghmtest.blast");
+	for (int s = 0; s < 6; s++) {
+		for (int i = 0; i < 40; i++) {
+			lst1 << "a" << s << "_" << i << "+\n";
+			lst2 << "b" << s << "_" << (s % 2 ? 39 - i : i)
+			     << (s % 2 ? "-\n" : "+\n");
+			blast << "a" << s << "_" << i << "\tb" << s << "_" << i << "\n";
+		}
+		for (int i = 0; i < 60; i++) {
+			lst1 << "u" << s << "_" << i << "+\n";
+			lst2 << "v" << s << "_" << i << "+\n";
+		}
+	}
+	lst1.close();
+	lst2.close();
+	blast.close();
+
+	ofstream ini("ghmtest.ini");
+	ini << "genome= A\n1 ghmtest_1.lst\n"
+	    << "genome= B\n1 ghmtest_2.lst\n"
+	    << "blast_table= ghmtest.blast\n"
+	    << "output_path= ghmtest_out/\n"
+	    << "gap_size= 30\ncluster_gap= 35\n"
+	    << "cloud_gap_size= 20\ncloud_cluster_gap= 25\n"
+	    << "q_value=0.75\nprob_cutoff=0.01\nanchor_points=3\n";
+	ini.close();
+}
+
+void GHMTest::TearDown()
+{
+	remove("ghmtest_1.lst");
+	remove("ghmtest_2.lst");
+	remove("ghmtest.blast");
+	remove("ghmtest.ini");
+	if (system("rm -rf ghmtest_out") == -1)
+		cerr << "Cannot remove ghmtest_out" << endl;
+}
+
+TEST_F(GHMTest, BandedTest) {
+	Settings settings("ghmtest.ini");
+	DataSet dataset(settings);
+	dataset.mapGenes();
+	dataset.remapTandems();
+
+	vector<Multiplicon*> single, banded, reversed;
+	vector<SynthenicCloud*> clouds;
+	runGHM(settings, dataset, false, false, false, single, clouds);
+	runGHM(settings, dataset, false, true, false, banded, clouds);
+	runGHM(settings, dataset, false, true, true, reversed, clouds);
+
+	// every segment crosses a band boundary and is found as a whole
+	ASSERT_EQ(6u, single.size());
+	sort(single.begin(), single.end(), beginXLess);
+	sort(banded.begin(), banded.end(), beginXLess);
+	sort(reversed.begin(), reversed.end(), beginXLess);
+	ASSERT_EQ(single.size(), banded.size());
+	ASSERT_EQ(single.size(), reversed.size());
+	for (size_t i = 0; i < single.size(); i++) {
+		EXPECT_TRUE(*single[i] == *banded[i]);
+		EXPECT_TRUE(*banded[i] == *reversed[i]);
+		EXPECT_EQ(40u, single[i]->getCountAnchorPoints());
+		delete single[i];
+		delete banded[i];
+		delete reversed[i];
+	}
+}
+
+TEST_F(GHMTest, BandedCloudTest) {
+	Settings settings("ghmtest.ini");
+	DataSet dataset(settings);
+	dataset.mapGenes();
+	dataset.remapTandems();
+
+	vector<Multiplicon*> mplicons;
+	vector<SynthenicCloud*> single, banded;
+	runGHM(settings, dataset, true, false, false, mplicons, single);
+	runGHM(settings, dataset, true, true, true, mplicons, banded);
+
+	ASSERT_EQ(6u, single.size());
+	ASSERT_EQ(single.size(), banded.size());
+	size_t pointsS = 0, pointsB = 0;
+	for (size_t i = 0; i < single.size(); i++) {
+		pointsS += single[i]->getCountAnchorPoints();
+		pointsB += banded[i]->getCountAnchorPoints();
+		delete single[i];
+		delete banded[i];
+	}
+	EXPECT_EQ(6u * 40u, pointsS);
+	EXPECT_EQ(pointsS, pointsB);
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include "../src/Gene.h"
+#include "../src/GeneList.h"
+#include "../src/GenePairs.h"
+#include "../src/GeneFamily.h"
+#include "../src/ListElement.h"
+#include "../src/datastructures/StringTable.h"
+
+TEST(StringTableTest, InternTest) {
+	StringTable table;
+
+	EXPECT_EQ(0u, table.intern("AT1G01010"));
+	EXPECT_EQ(1u, table.intern("AT1G01020"));
+	EXPECT_EQ(0u, table.intern("AT1G01010"));
+	EXPECT_EQ(2u, table.size());
+
+	EXPECT_EQ(1u, table.find("AT1G01020"));
+	EXPECT_TRUE(table.find("AT1G01030") == StringTable::NOT_FOUND);
+	EXPECT_EQ("AT1G01020", table.getString(1));
+}
+
+TEST(GeneTest, InternNameTest) {
+	const string* ath = Gene::internName("ath");
+	EXPECT_EQ(ath, Gene::internName(string("at") + "h"));
+	EXPECT_NE(ath, Gene::internName("vvi"));
+
+	// genes share the interned genome name
+	Gene A("A", "ath", 0, true), B("B", ath, 1, false);
+	EXPECT_EQ(&A.getGenomeName(), &B.getGenomeName());
+	EXPECT_EQ("ath", B.getGenomeName());
+	EXPECT_TRUE(A == Gene("A", "ath", 5, false));
+	EXPECT_FALSE(A == Gene("A", "vvi", 0, true));
+
+	Gene gap;
+	EXPECT_EQ("", gap.getGenomeName());
+	EXPECT_EQ("", gap.getFamily());
+}
+
+TEST(GeneTest, PairTest) {
+	// A-B, B-C and C-D are pairs
+	uint32_t pairsA[] = {1};
+	uint32_t pairsB[] = {0, 2};
+	uint32_t pairsC[] = {1, 3};
+	uint32_t pairsD[] = {2};
+
+	Gene A("A", "genome", 0, true), B("B", "genome", 1, true);
+	Gene C("C", "genome", 2, true), D("D", "genome", 3, true);
+	Gene E("E", "genome", 4, true);
+
+	A.setInternID(0); A.setPairs(pairsA, 1);
+	B.setInternID(1); B.setPairs(pairsB, 2);
+	C.setInternID(2); C.setPairs(pairsC, 2);
+	D.setInternID(3); D.setPairs(pairsD, 1);
+	E.setInternID(4);
+
+	EXPECT_TRUE(A.hasPairs());
+	EXPECT_FALSE(E.hasPairs());
+
+	EXPECT_TRUE(A.isPairWith(B));
+	EXPECT_TRUE(B.isPairWith(A));
+	EXPECT_FALSE(A.isPairWith(C));
+	EXPECT_FALSE(A.isPairWith(E));
+
+	// A and C share B as a pair
+	EXPECT_TRUE(A.isIndirectPairWith(C));
+	EXPECT_TRUE(C.isIndirectPairWith(A));
+	EXPECT_TRUE(A.isIndirectPairWith(B));
+	EXPECT_FALSE(A.isIndirectPairWith(D));
+	EXPECT_FALSE(A.isIndirectPairWith(E));
+}
+
+TEST(GeneTest, FamilyTest) {
+	Gene A("A", "genome", 0, true), B("B", "genome", 1, true);
+	Gene C("C", "genome", 2, true);
+
+	A.setInternID(0); A.setFamily("fam1", 0);
+	B.setInternID(1); B.setFamily("fam1", 0);
+	C.setInternID(2); C.setFamily("fam2", 1);
+
+	EXPECT_TRUE(A.isPairWith(B));
+	EXPECT_FALSE(A.isPairWith(A));
+	EXPECT_FALSE(A.isPairWith(C));
+}
+
+TEST(GeneListTest, HomologIndexTest) {
+	// list with genes 0..5, gene 5 is a second copy of gene 1
+	uint32_t pairs0[] = {1, 4};
+	uint32_t pairs1[] = {0};
+	uint32_t pairs4[] = {0};
+
+	GeneList indexed(6), scanned(6);
+	GeneList* lists[] = {&indexed, &scanned};
+	for (int l = 0; l < 2; l++) {
+		const vector<ListElement*>& le = lists[l]->getRemappedElements();
+		for (int i = 0; i < 6; i++)
+			le[i]->getGene().setInternID(i == 5 ? 1 : i);
+		le[0]->getGene().setPairs(pairs0, 2);
+		le[1]->getGene().setPairs(pairs1, 1);
+		le[4]->getGene().setPairs(pairs4, 1);
+		le[5]->getGene().setPairs(pairs1, 1);
+		le[4]->setMasked(true);
+	}
+	indexed.buildHomologIndex(false);
+
+	Gene query("Q", "genome", 0, true);
+	query.setInternID(0);
+	query.setPairs(pairs0, 2);
+
+	vector<int> posI, posS;
+	indexed.matchingPositions(query, posI);
+	scanned.matchingPositions(query, posS);
+
+	// gene 4 is masked
+	ASSERT_EQ(2u, posI.size());
+	EXPECT_EQ(1, posI[0]);
+	EXPECT_EQ(5, posI[1]);
+	EXPECT_TRUE(posI == posS);
+}
+
+TEST(GenePairsTest, ReadTest) {
+	StringTable genes;
+	genes.intern("A");
+	genes.intern("B");
+	genes.intern("C");
+	genes.intern("D");
+
+	const char* fileName = "GenePairsTest.blast";
+	ofstream ofs(fileName);
+	ofs << "A\tB\n"
+	    << "B-\tA+\n"	// duplicate pair with orientations
+	    << "C\tA\n"
+	    << "C\tC\n"		// self pair
+	    << "A\tX\n"		// X is not in any gene list
+	    << "\n"
+	    << "D\tB";		// no final newline
+	ofs.close();
+
+	GenePairs pairs(fileName, genes);
+	remove(fileName);
+
+	uint32_t n;
+	const uint32_t* p = pairs.getPairsOf(0, n);
+	ASSERT_EQ(2u, n);
+	EXPECT_EQ(1u, p[0]);
+	EXPECT_EQ(2u, p[1]);
+
+	p = pairs.getPairsOf(1, n);
+	ASSERT_EQ(2u, n);
+	EXPECT_EQ(0u, p[0]);
+	EXPECT_EQ(3u, p[1]);
+
+	p = pairs.getPairsOf(2, n);
+	ASSERT_EQ(1u, n);
+	EXPECT_EQ(0u, p[0]);
+
+	EXPECT_EQ(6u, pairs.getNumPairs());
+	EXPECT_THROW(GenePairs("nonexistent.blast", genes), FileException);
+}
+
+TEST(GenePairsTest, ChunkTest) {
+	StringTable genes;
+	const char* fileName = "GenePairsChunkTest.blast";
+	ofstream ofs(fileName);
+	for (int i = 0; i < 200; i++) {
+		stringstream A, B;
+		A << "G" << i;
+		B << "G" << (i * 7) % 50;
+		genes.intern(A.str());
+		ofs << A.str() << "\t" << B.str() << "\n";
+	}
+	ofs.close();
+
+	GenePairs serial(fileName, genes, 1);
+	GenePairs parallel(fileName, genes, 4);
+	remove(fileName);
+
+	ASSERT_EQ(serial.getNumPairs(), parallel.getNumPairs());
+	for (uint32_t g = 0; g < genes.size(); g++) {
+		uint32_t nS, nP;
+		const uint32_t* pS = serial.getPairsOf(g, nS);
+		const uint32_t* pP = parallel.getPairsOf(g, nP);
+		ASSERT_EQ(nS, nP);
+		for (uint32_t i = 0; i < nS; i++)
+			EXPECT_EQ(pS[i], pP[i]);
+	}
+}
+
+TEST(GeneFamilyTest, ChunkTest) {
+	StringTable genes;
+	genes.intern("A");
+	genes.intern("B");
+	genes.intern("C");
+
+	const char* fileName = "GeneFamilyTest.fam";
+	ofstream ofs(fileName);
+	ofs << "A\tfam1\n";
+	for (int i = 0; i < 100; i++)
+		ofs << "X" << i << "\tfamX\n";
+	ofs << "B+\tfam2\n"
+	    << "A\tfam3\n";	// the last family of a gene is retained
+	ofs.close();
+
+	GeneFamily family(fileName, genes, 3);
+	remove(fileName);
+
+	EXPECT_EQ("fam3", family.getFamilyOf(0));
+	EXPECT_EQ("fam2", family.getFamilyOf(1));
+	EXPECT_FALSE(family.hasFamily(2));
+}
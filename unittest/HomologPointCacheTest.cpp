@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "../src/HomologPointCache.h"
+#include "../src/Gene.h"
+#include "../src/GeneList.h"
+#include "../src/ListElement.h"
+
+using namespace std;
+
+TEST(HomologPointCacheTest, MaskTest) {
+	// list with genes 0..5, genes 1, 3 and 5 are homologs of the query
+	uint32_t pairsQ[] = {1, 3, 5};
+	uint32_t pairs0[] = {0};
+
+	GeneList list(6);
+	const vector<ListElement*>& le = list.getRemappedElements();
+	for (int i = 0; i < 6; i++) {
+		le[i]->getGene().setInternID(i);
+		le[i]->getGene().setPairs(pairs0, 1);
+	}
+	list.buildHomologIndex(false);
+
+	Gene query("Q", "genome", 0, true);
+	query.setInternID(0);
+	query.setPairs(pairsQ, 3);
+
+	HomologPointCache cache;
+	vector<int> expected;
+	list.matchingPositions(query, expected);
+	ASSERT_EQ(3u, expected.size());
+	EXPECT_TRUE(expected == cache.matchingPositions(list, query));
+	EXPECT_EQ(1u, cache.size());
+
+	// masked positions are dropped from the cached entry
+	list.mask(2, 3);
+	list.matchingPositions(query, expected);
+	ASSERT_EQ(2u, expected.size());
+	EXPECT_TRUE(expected == cache.matchingPositions(list, query));
+
+	// masking an already masked position leaves the version unchanged
+	unsigned int version = list.getMaskVersion();
+	list.mask(3, 3);
+	EXPECT_EQ(version, list.getMaskVersion());
+}
+
+TEST(HomologPointCacheTest, ClearTest) {
+	uint32_t pairs[] = {0};
+
+	GeneList list(4);
+	const vector<ListElement*>& le = list.getRemappedElements();
+	for (int i = 0; i < 4; i++) {
+		le[i]->getGene().setInternID(i);
+		le[i]->getGene().setPairs(pairs, 1);
+	}
+	list.buildHomologIndex(false);
+
+	// the cache is cleared once it holds two genes
+	HomologPointCache cache(2);
+	for (int i = 1; i < 4; i++) {
+		Gene query("Q", "genome", 0, true);
+		query.setInternID(i);
+		query.setPairs(pairs, 1);
+		ASSERT_EQ(1u, cache.matchingPositions(list, query).size());
+	}
+	EXPECT_EQ(1u, cache.size());
+}
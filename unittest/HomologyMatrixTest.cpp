@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "../src/HomologyMatrix.h"
+
+using namespace std;
+
+class HomologyMatrixTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp();
+
+	HomologyMatrix mat;
+};
+
+void HomologyMatrixTest::SetUp()
+{
+	vector<pair<int, int> > points;
+	points.push_back(make_pair(5, 3));
+	points.push_back(make_pair(1, 7));
+	points.push_back(make_pair(1, 2));
+	points.push_back(make_pair(5, 3));	// duplicate
+	points.push_back(make_pair(3, 4));
+	points.push_back(make_pair(5, 9));
+
+	mat.build(points);
+}
+
+TEST_F(HomologyMatrixTest, BuildTest) {
+	EXPECT_EQ(5, mat.size());
+	EXPECT_TRUE(mat.contains(1, 2));
+	EXPECT_TRUE(mat.contains(5, 9));
+	EXPECT_FALSE(mat.contains(2, 1));
+	EXPECT_FALSE(mat.contains(5, 4));
+}
+
+TEST_F(HomologyMatrixTest, OrderTest) {
+	int expX[] = {1, 1, 3, 5, 5};
+	int expY[] = {2, 7, 4, 3, 9};
+
+	int i = 0;
+	HomologyMatrix::BoxIterator it = mat.getAll();
+	for ( ; it.isValid(); it.next(), i++) {
+		EXPECT_EQ(expX[i], it.getX());
+		EXPECT_EQ(expY[i], it.getY());
+	}
+	EXPECT_EQ(5, i);
+}
+
+TEST_F(HomologyMatrixTest, BoxTest) {
+	int i = 0;
+	HomologyMatrix::BoxIterator it = mat.getBox(1, 4, 3, 7);
+	for ( ; it.isValid(); it.next(), i++) {
+		EXPECT_EQ(i == 0 ? 1 : 3, it.getX());
+		EXPECT_EQ(i == 0 ? 7 : 4, it.getY());
+	}
+	EXPECT_EQ(2, i);
+
+	EXPECT_FALSE(mat.getBox(6, 10, 0, 10).isValid());
+	EXPECT_FALSE(mat.getBox(4, 1, 0, 10).isValid());
+}
+
+TEST_F(HomologyMatrixTest, EraseTest) {
+	// erase the current point and a point further down the iteration
+	HomologyMatrix::BoxIterator it = mat.getAll();
+	mat.erase(it);
+	mat.erase(3, 4);
+	mat.erase(3, 4);	// erasing twice is allowed
+	mat.erase(8, 8);	// so is erasing a point that does not exist
+
+	it.next();
+	EXPECT_EQ(1, it.getX());
+	EXPECT_EQ(7, it.getY());
+	it.next();
+	EXPECT_EQ(5, it.getX());
+	EXPECT_EQ(3, it.getY());
+
+	EXPECT_EQ(3, mat.size());
+	EXPECT_FALSE(mat.contains(1, 2));
+	EXPECT_FALSE(mat.contains(3, 4));
+}
+
+TEST_F(HomologyMatrixTest, InsertTest) {
+	mat.erase(3, 4);
+	mat.insert(3, 4);	// restore an erased point
+	mat.insert(4, 1);	// insert a new point
+	mat.insert(4, 1);
+	mat.insert(1, 2);	// insert an existing point
+	mat.merge();
+
+	EXPECT_EQ(6, mat.size());
+	EXPECT_TRUE(mat.contains(3, 4));
+	EXPECT_TRUE(mat.contains(4, 1));
+
+	int expX[] = {1, 1, 3, 4, 5, 5};
+	int i = 0;
+	HomologyMatrix::BoxIterator it = mat.getAll();
+	for ( ; it.isValid(); it.next(), i++)
+		EXPECT_EQ(expX[i], it.getX());
+	EXPECT_EQ(6, i);
+}
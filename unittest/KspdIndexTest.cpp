@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdlib>
+#include "../src/KspdIndex.h"
+
+using namespace std;
+
+TEST(KspdIndexTest, QueryTest) {
+	// compare with a linear scan over pseudo-random points, while points
+	// are being added
+	srand(7);
+	KspdIndex index;
+	vector<AnchorPoint> points;
+
+	for (int i = 0; i < 500; i++) {
+		int x = rand() % 200, y = rand() % 200;
+		index.add(x, y);
+		points.push_back(AnchorPoint(x, y, true));
+
+		int qx = rand() % 220 - 10, qy = rand() % 220 - 10;
+		int expected = INT_MAX;
+		for (size_t j = 0; j < points.size(); j++)
+			expected = min(expected, max(abs(points[j].getX() - qx),
+						     abs(points[j].getY() - qy)));
+		EXPECT_EQ(expected, index.distanceTo(qx, qy));
+	}
+
+	// bounded queries
+	EXPECT_EQ(0, index.distanceTo(points[10].getX(), points[10].getY(), 5));
+	EXPECT_EQ(3, index.distanceTo(1000, 1000, 3));
+}
+
+TEST(KspdIndexTest, SetTest) {
+	vector<AnchorPoint> a, b;
+	a.push_back(AnchorPoint(10, 10, true));
+	a.push_back(AnchorPoint(14, 30, true));
+	b.push_back(AnchorPoint(20, 12, true));
+	b.push_back(AnchorPoint(18, 27, true));
+	b.push_back(AnchorPoint(40, 40, true));
+
+	KspdIndex index(b);
+	EXPECT_EQ(4, index.distanceTo(a));
+	EXPECT_EQ(2, index.distanceTo(a, 2));
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <pthread.h>
+#include "../src/TaskScheduler.h"
+
+using namespace std;
+
+TEST(TaskSchedulerTest, DistributeTest) {
+	TaskScheduler scheduler(2);
+
+	uint64_t w[] = {5, 1, 9, 3, 3};
+	scheduler.distribute(vector<uint64_t>(w, w + 5));
+
+	// heaviest first: 2 -> thread 0, 0 -> thread 1, 3 -> thread 1,
+	// 4 -> thread 1 (load 8 vs 9), 1 -> thread 0 (load 9 vs 11)
+	int task;
+	ASSERT_TRUE(scheduler.getTask(0, task));
+	EXPECT_EQ(2, task);
+	ASSERT_TRUE(scheduler.getTask(0, task));
+	EXPECT_EQ(1, task);
+
+	// thread 0 steals the lightest task of thread 1
+	ASSERT_TRUE(scheduler.getTask(0, task));
+	EXPECT_EQ(4, task);
+
+	ASSERT_TRUE(scheduler.getTask(1, task));
+	EXPECT_EQ(0, task);
+	ASSERT_TRUE(scheduler.getTask(1, task));
+	EXPECT_EQ(3, task);
+	EXPECT_FALSE(scheduler.getTask(1, task));
+	EXPECT_FALSE(scheduler.getTask(0, task));
+}
+
+struct SchedulerThreadArgs {
+	TaskScheduler *scheduler;
+	int threadID;
+	vector<int> tasks;
+};
+
+extern "C" void* runSchedulerThread(void *args)
+{
+	SchedulerThreadArgs *a = reinterpret_cast<SchedulerThreadArgs*>(args);
+	int task;
+	while (a->scheduler->getTask(a->threadID, task))
+		a->tasks.push_back(task);
+	return NULL;
+}
+
+TEST(TaskSchedulerTest, ThreadTest) {
+	const int nThreads = 4, nTasks = 1000;
+	TaskScheduler scheduler(nThreads);
+
+	vector<uint64_t> weights;
+	for (int i = 0; i < nTasks; i++)
+		weights.push_back(i % 17);
+	scheduler.distribute(weights);
+
+	pthread_t threads[nThreads];
+	SchedulerThreadArgs args[nThreads];
+	for (int t = 0; t < nThreads; t++) {
+		args[t].scheduler = &scheduler;
+		args[t].threadID = t;
+		pthread_create(&threads[t], NULL, runSchedulerThread, &args[t]);
+	}
+
+	// every task is handed out exactly once
+	vector<int> count(nTasks, 0);
+	for (int t = 0; t < nThreads; t++) {
+		pthread_join(threads[t], NULL);
+		for (size_t i = 0; i < args[t].tasks.size(); i++)
+			count[args[t].tasks[i]]++;
+	}
+	for (int i = 0; i < nTasks; i++)
+		EXPECT_EQ(1, count[i]);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <climits>
+#include "../src/WireFormat.h"
+#include "../src/AnchorPoint.h"
+#include "../src/BaseCluster.h"
+#include "../src/SynthenicCloud.h"
+
+using namespace std;
+
+TEST(WireFormatTest, VarIntTest) {
+	int values[] = {0, 1, -1, 63, -64, 64, 1000, -1000, 123456,
+			INT_MAX, INT_MIN};
+	int sizes[] = {1, 1, 1, 1, 1, 2, 2, 2, 3, 5, 5};
+	const int n = sizeof(values) / sizeof(int);
+
+	char buffer[5 * n];
+	char *out = buffer;
+	for (int i = 0; i < n; i++) {
+		EXPECT_EQ(sizes[i], WireFormat::getVarIntSize(values[i]));
+		WireFormat::putVarInt(out, values[i]);
+	}
+
+	const char *in = buffer;
+	for (int i = 0; i < n; i++)
+		EXPECT_EQ(values[i], WireFormat::getVarInt(in, out));
+	EXPECT_EQ(out, in);
+
+	// reading past the end of the buffer throws
+	EXPECT_THROW(WireFormat::getVarInt(in, out), WireFormatException);
+	// as does a count of more objects than there are chars left
+	in = buffer + 3;
+	EXPECT_THROW(WireFormat::getCount(in, out), WireFormatException);
+	in = buffer + 3;
+	EXPECT_EQ(63, WireFormat::getCount(in, buffer + 3 + 64));
+
+	// differences that overflow an int still round trip
+	out = buffer;
+	WireFormat::putDelta(out, INT_MIN, INT_MAX);
+	EXPECT_EQ(WireFormat::getDeltaSize(INT_MIN, INT_MAX), out - buffer);
+	in = buffer;
+	EXPECT_EQ(INT_MIN, WireFormat::getDelta(in, INT_MAX, out));
+
+	// an integer never takes more than five chars
+	memset(buffer, 0xFF, 6);
+	in = buffer;
+	EXPECT_THROW(WireFormat::getVarInt(in, buffer + 6), WireFormatException);
+}
+
+TEST(WireFormatTest, BaseClusterTest) {
+	BaseCluster c(false);
+	for (int i = 0; i < 50; i++)
+		c.addAnchorPoint(1000 + 3 * i, 5000 - 2 * i);
+	c.updateStatistics();
+
+	vector<char> buffer(c.getPackSize());
+	EXPECT_EQ((int)buffer.size(), c.pack(&buffer[0]));
+
+	// one char per gene ID and coordinate and one for is_real
+	EXPECT_LT((int)buffer.size(), 50 * 5 + 100);
+
+	const char *in = &buffer[0];
+	const char *end = in + buffer.size();
+	BaseCluster u(in, end);
+	EXPECT_EQ(end, in);
+	EXPECT_TRUE(c == u);
+	EXPECT_EQ(c.getCountAnchorPoints(), u.getCountAnchorPoints());
+
+	// a truncated basecluster is rejected
+	for (size_t size = 0; size < buffer.size(); size += 7) {
+		in = &buffer[0];
+		EXPECT_THROW(BaseCluster t(in, &buffer[0] + size),
+			     WireFormatException);
+	}
+}
+
+TEST(WireFormatTest, CloudTest) {
+	vector<SynthenicCloud*> clouds;
+	for (int i = 0; i < 3; i++) {
+		SynthenicCloud *cloud = new SynthenicCloud();
+		cloud->setXObjectID(i);
+		cloud->setYObjectID(i + 1);
+		for (int j = 0; j < 10; j++)
+			cloud->addAnchorPoint(AnchorPoint(j, 2 * j, 100 * i + j,
+							  200 - 7 * j, true));
+		clouds.push_back(cloud);
+	}
+
+	int size = SynthenicCloud::getPackSize(clouds);
+	vector<char> buffer(size);
+	EXPECT_EQ(size, SynthenicCloud::packSynthenicClouds(clouds, &buffer[0]));
+
+	vector<SynthenicCloud*> unpacked;
+	const char *end = &buffer[0] + size;
+	EXPECT_EQ(size, SynthenicCloud::unpackSynthenicClouds(&buffer[0], end,
+							      unpacked));
+	ASSERT_EQ(clouds.size(), unpacked.size());
+	for (size_t i = 0; i < clouds.size(); i++) {
+		EXPECT_EQ(clouds[i]->getXObjectID(), unpacked[i]->getXObjectID());
+		EXPECT_EQ(clouds[i]->getYObjectID(), unpacked[i]->getYObjectID());
+		ASSERT_EQ(clouds[i]->getCountAnchorPoints(),
+			  unpacked[i]->getCountAnchorPoints());
+
+		vector<AnchorPoint>::const_iterator a = clouds[i]->getAPBegin();
+		vector<AnchorPoint>::const_iterator b = unpacked[i]->getAPBegin();
+		for ( ; a != clouds[i]->getAPEnd(); a++, b++) {
+			EXPECT_EQ(a->getGeneXID(), b->getGeneXID());
+			EXPECT_EQ(a->getGeneYID(), b->getGeneYID());
+			EXPECT_TRUE(*a == *b);
+		}
+	}
+
+	// a header that claims more data than there is is rejected
+	vector<SynthenicCloud*> rejected;
+	EXPECT_THROW(SynthenicCloud::unpackSynthenicClouds(&buffer[0], end - 1,
+							   rejected),
+		     WireFormatException);
+
+	// data of another format version is rejected
+	buffer[0]++;
+	EXPECT_THROW(SynthenicCloud::unpackSynthenicClouds(&buffer[0], end,
+							   rejected),
+		     WireFormatException);
+
+	for (size_t i = 0; i < clouds.size(); i++) {
+		delete clouds[i];
+		delete unpacked[i];
+	}
+}